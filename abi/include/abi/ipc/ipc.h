@@ -35,6 +35,8 @@
 #ifndef ABI_IPC_IPC_H_
 #define ABI_IPC_IPC_H_
 
+#include <stddef.h>
+
 /** Length of data being transferred with IPC call
  *
  * The uspace may not be able to utilize the full length
@@ -68,6 +70,20 @@
  */
 #define DATA_XFER_LIMIT  (64 * 1024)
 
+/**
+ * Maximum number of buffers the answer to an IPC_M_DATA_READ request
+ * can gather the data from.
+ */
+#define DATA_XFER_IOV_MAX  64
+
+/** Buffer descriptor for gathering IPC_M_DATA_READ data. */
+typedef struct {
+	/** Start of the buffer in the answering address space */
+	void *base;
+	/** Size of the buffer */
+	size_t size;
+} ipc_iov_t;
+
 /* Macros for manipulating calling data */
 #define IPC_SET_RETVAL(data, retval)  ((data).args[0] = (sysarg_t) (retval))
 #define IPC_SET_IMETHOD(data, val)    ((data).args[0] = (val))
@@ -146,7 +146,10 @@ enum {
 	 * on answer, the recipient must set:
 	 *
 	 * - ARG1 - source virtual address in the destination address space
+	 *          or address of an array of ipc_iov_t if ARG3 is non-zero
 	 * - ARG2 - final size of data to be copied
+	 * - ARG3 - number of ipc_iov_t elements to gather the data from,
+	 *          zero if the data is in a single contiguous buffer
 	 */
 	IPC_M_DATA_READ,
 
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup generic
+ * @{
+ */
+/** @file
+ */
+
+#ifndef ABI_PROF_H_
+#define ABI_PROF_H_
+
+#include <stdint.h>
+
+/** Maximum number of stack frames recorded in a sample */
+#define PROF_FRAMES  8
+
+/** The sample was taken while running uspace code */
+#define PROF_SAMPLE_USPACE  (1 << 0)
+
+/** The sample was taken while the processor was idle */
+#define PROF_SAMPLE_IDLE  (1 << 1)
+
+typedef enum {
+	/** Start sampling, clear previously recorded samples */
+	PROF_START,
+	/** Stop sampling */
+	PROF_STOP,
+	/** Read and remove recorded samples */
+	PROF_READ,
+	/** Translate a kernel address to a symbol name */
+	PROF_SYMBOL
+} prof_operation_t;
+
+/** Profiling sample */
+typedef struct {
+	/** ID of the task which was interrupted */
+	uint64_t task_id;
+	/** ID of the thread which was interrupted */
+	uint64_t thread_id;
+	/** Processor which took the sample */
+	uint32_t cpu;
+	/** PROF_SAMPLE_* flags */
+	uint32_t flags;
+	/** Number of valid entries in pc */
+	uint32_t depth;
+	/** Interrupted program counter followed by return addresses */
+	uintptr_t pc[PROF_FRAMES];
+} prof_sample_t;
+
+#endif
+
+/** @}
+ */
@@ -101,6 +101,9 @@ typedef enum {
 	
 	SYS_KLOG,
 	
+	SYS_PROF,
+	SYS_TRACEPOINT,
+	
 	SYSCALL_END
 } syscall_t;
 
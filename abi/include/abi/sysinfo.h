@@ -47,6 +47,7 @@
 /** Maximum name sizes */
 #define TASK_NAME_BUFLEN  20
 #define EXC_NAME_BUFLEN   20
+#define SLAB_NAME_BUFLEN  20
 
 /** Item value type
  *
@@ -105,6 +106,7 @@ typedef struct {
 	size_t threads;               /**< Number of threads */
 	uint64_t ucycles;             /**< Number of CPU cycles in user space */
 	uint64_t kcycles;             /**< Number of CPU cycles in kernel */
+	uint64_t page_faults;         /**< Number of page faults */
 	stats_ipc_t ipc_info;         /**< IPC statistics */
 } stats_task_t;
 
@@ -122,6 +124,20 @@ typedef struct {
 	unsigned int cpu;       /**< Associated CPU ID (if on_cpu is true) */
 } stats_thread_t;
 
+/** Header of a delta snapshot of tasks or threads
+ *
+ * The header is followed by count stats_task_t or stats_thread_t
+ * structures of the tasks or threads which changed since the requested
+ * generation. These are followed by exited task or thread IDs.
+ *
+ */
+typedef struct {
+	uint64_t generation;  /**< Generation to request the next delta with */
+	uint64_t full;        /**< All existing tasks or threads are listed */
+	uint64_t count;       /**< Number of changed tasks or threads */
+	uint64_t exited;      /**< Number of exited tasks or threads */
+} stats_delta_t;
+
 /** Statistics about a single exception
  *
  */
@@ -133,6 +149,27 @@ typedef struct {
 	uint64_t count;              /**< Number of handled exceptions */
 } stats_exc_t;
 
+/** Statistics about a single slab cache
+ *
+ */
+typedef struct {
+	char name[SLAB_NAME_BUFLEN];  /**< Cache name */
+	uint64_t size;                /**< Size of a slab position */
+	uint64_t objsize;             /**< Size of the objects */
+	uint64_t frames;              /**< Number of frames per slab */
+	uint64_t objects;             /**< Number of objects per slab */
+	uint64_t allocated_slabs;     /**< Number of allocated slabs */
+	uint64_t allocated_objs;      /**< Number of allocated objects */
+	uint64_t cached_objs;         /**< Number of objects in magazines */
+	uint64_t mag_size;            /**< Size of newly allocated magazines */
+	uint64_t allocs;              /**< Number of allocations */
+	uint64_t hits;                /**< Allocations served from magazines */
+	uint64_t requested;           /**< Bytes requested by allocations */
+	uint64_t depot_gets;          /**< Full magazines taken from depot */
+	uint64_t depot_puts;          /**< Full magazines put into depot */
+	uint64_t depot_contention;    /**< Contended depot accesses */
+} stats_slab_t;
+
 /** Load fixed-point value */
 typedef uint32_t load_t;
 
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** @addtogroup generic
+ * @{
+ */
+/** @file
+ */
+
+#ifndef ABI_TRACEPOINT_H_
+#define ABI_TRACEPOINT_H_
+
+#include <stdint.h>
+
+/** Static tracepoints */
+typedef enum {
+	/** A thread starts running on a processor */
+	TP_SCHED_SWITCH,
+	/** An IPC request is sent */
+	TP_IPC_CALL,
+	/** An IPC request is answered */
+	TP_IPC_ANSWER,
+	/** A page fault is handled */
+	TP_PAGE_FAULT,
+	/** A thread goes to sleep on a futex */
+	TP_FUTEX_SLEEP,
+	/** A thread sleeping on a futex is woken up */
+	TP_FUTEX_WAKEUP,
+	/** Blocks are read from a block device */
+	TP_BLOCK_READ,
+	/** Blocks are written to a block device */
+	TP_BLOCK_WRITE,
+	TP_COUNT
+} tracepoint_t;
+
+/** First tracepoint which can be hit from uspace */
+#define TP_USPACE_FIRST  TP_BLOCK_READ
+
+/** Bit of a tracepoint in the mask of enabled tracepoints */
+#define TP_MASK(tp)  (UINT32_C(1) << (tp))
+
+/** Mask of all tracepoints */
+#define TP_MASK_ALL  (TP_MASK(TP_COUNT) - 1)
+
+typedef enum {
+	/** Set the mask of enabled tracepoints */
+	TRACEPOINT_ENABLE,
+	/** Read and remove recorded events */
+	TRACEPOINT_READ,
+	/** Record an event of a uspace tracepoint */
+	TRACEPOINT_HIT
+} tracepoint_operation_t;
+
+/** Page shared with uspace */
+typedef struct {
+	/** Mask of enabled tracepoints */
+	volatile uint32_t mask;
+} tracepoint_page_t;
+
+/** Recorded tracepoint event */
+typedef struct {
+	/** Value of the cycle counter of the processor */
+	uint64_t cycle;
+	/** ID of the current task */
+	uint64_t task_id;
+	/** ID of the current thread */
+	uint64_t thread_id;
+	/** Processor which recorded the event */
+	uint32_t cpu;
+	/** Tracepoint which was hit */
+	uint32_t tracepoint;
+	/** Tracepoint specific arguments */
+	uint64_t arg[2];
+} tracepoint_event_t;
+
+#endif
+
+/** @}
+ */
@@ -40,6 +40,10 @@ void ipi_broadcast_arch(int ipi)
 {
 }
 
+void ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
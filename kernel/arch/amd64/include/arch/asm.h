@@ -69,6 +69,14 @@ NO_TRACE static inline void cpu_sleep(void)
 	);
 }
 
+/** Hint the processor that it is spinning in a busy-wait loop */
+NO_TRACE static inline void cpu_spin_hint(void)
+{
+	asm volatile (
+		"pause\n"
+	);
+}
+
 NO_TRACE static inline void __attribute__((noreturn)) cpu_halt(void)
 {
 	while (true) {
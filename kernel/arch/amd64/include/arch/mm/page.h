@@ -148,6 +148,17 @@
 #define SET_FRAME_PRESENT_ARCH(ptl3, i) \
 	set_pt_present((pte_t *) (ptl3), (size_t) (i))
 
+/*
+ * PTL2 entries can map a 2 MiB large page directly instead of pointing
+ * to a PTL3 table.
+ */
+#define LARGE_PAGE_WIDTH_ARCH  21
+
+#define GET_PTL3_LARGE_ARCH(ptl2, i) \
+	(((pte_t *) (ptl2))[(i)].size != 0)
+#define SET_PTL3_LARGE_ARCH(ptl2, i, large) \
+	(((pte_t *) (ptl2))[(i)].size = ((large) != 0))
+
 /* Macros for querying the last-level PTE entries. */
 #define PTE_VALID_ARCH(p) \
 	((p)->soft_valid != 0)
@@ -197,7 +208,7 @@ typedef struct {
 	unsigned int page_cache_disable : 1;
 	unsigned int accessed : 1;
 	unsigned int dirty : 1;
-	unsigned int unused: 1;
+	unsigned int size : 1;  /**< Large page, in PTL2 entries only. */
 	unsigned int global : 1;
 	unsigned int soft_valid : 1;  /**< Valid content even if present bit is cleared. */
 	unsigned int avl : 2;
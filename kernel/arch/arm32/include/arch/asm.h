@@ -64,6 +64,11 @@ NO_TRACE static inline void cpu_sleep(void)
 #endif
 }
 
+/** Hint the processor that it is spinning in a busy-wait loop */
+NO_TRACE static inline void cpu_spin_hint(void)
+{
+}
+
 NO_TRACE static inline void pio_write_8(ioport8_t *port, uint8_t v)
 {
 	*port = v;
@@ -63,6 +63,16 @@ NO_TRACE static inline void cpu_sleep(void)
 	);
 }
 
+/** Hint the processor that it is spinning in a busy-wait loop */
+NO_TRACE static inline void cpu_spin_hint(void)
+{
+#ifndef PROCESSOR_i486
+	asm volatile (
+		"pause\n"
+	);
+#endif
+}
+
 #define GEN_READ_REG(reg) NO_TRACE static inline sysarg_t read_ ##reg (void) \
 	{ \
 		sysarg_t res; \
@@ -483,6 +483,11 @@ extern void cpu_halt(void) __attribute__((noreturn));
 extern void cpu_sleep(void);
 extern void asm_delay_loop(uint32_t t);
 
+/** Hint the processor that it is spinning in a busy-wait loop */
+NO_TRACE static inline void cpu_spin_hint(void)
+{
+}
+
 extern void switch_to_userspace(uintptr_t, uintptr_t, uintptr_t, uintptr_t,
     uint64_t, uint64_t);
 
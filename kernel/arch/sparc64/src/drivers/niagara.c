@@ -217,12 +217,14 @@ static void niagara_init(void)
 	outbuf_parea.pbase = (uintptr_t) (KA2PA(&output_buffer));
 	outbuf_parea.frames = 1;
 	outbuf_parea.unpriv = false;
+	outbuf_parea.readonly = false;
 	outbuf_parea.mapped = false;
 	ddi_parea_register(&outbuf_parea);
 	
 	inbuf_parea.pbase = (uintptr_t) (KA2PA(&input_buffer));
 	inbuf_parea.frames = 1;
 	inbuf_parea.unpriv = false;
+	inbuf_parea.readonly = false;
 	inbuf_parea.mapped = false;
 	ddi_parea_register(&inbuf_parea);
 	
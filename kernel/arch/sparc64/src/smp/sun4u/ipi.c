@@ -187,11 +187,16 @@ void ipi_unicast_arch(unsigned int cpu_id, int ipi)
 {
 	assert(&cpus[cpu_id] != CPU);
 	
-	if (ipi == IPI_SMP_CALL) {
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		cross_call(cpus[cpu_id].arch.mid, tlb_shootdown_ipi_recv);
+		break;
+	case IPI_SMP_CALL:
 		cross_call(cpus[cpu_id].arch.mid, smp_call_ipi_recv);
-	} else {
+		break;
+	default:
 		panic("Unknown IPI (%d).\n", ipi);
-		return;
+		break;
 	}
 }
 
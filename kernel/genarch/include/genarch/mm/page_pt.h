@@ -128,6 +128,21 @@
 #define SET_PTL3_PRESENT(ptl2, i)   SET_PTL3_PRESENT_ARCH(ptl2, i)
 #define SET_FRAME_PRESENT(ptl3, i)  SET_FRAME_PRESENT_ARCH(ptl3, i)
 
+/*
+ * Large pages mapped directly by PTL2 entries, if the architecture
+ * supports them.
+ *
+ */
+#ifdef LARGE_PAGE_WIDTH_ARCH
+
+#define LARGE_PAGE_WIDTH  LARGE_PAGE_WIDTH_ARCH
+#define LARGE_PAGE_SIZE   (1UL << LARGE_PAGE_WIDTH)
+
+#define GET_PTL3_LARGE(ptl2, i)     GET_PTL3_LARGE_ARCH(ptl2, i)
+#define SET_PTL3_LARGE(ptl2, i, x)  SET_PTL3_LARGE_ARCH(ptl2, i, x)
+
+#endif
+
 /*
  * Macros for querying the last-level PTEs.
  *
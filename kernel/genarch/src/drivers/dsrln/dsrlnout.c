@@ -88,6 +88,7 @@ outdev_t *dsrlnout_init(ioport8_t *base)
 	instance->parea.pbase = KA2PA(base);
 	instance->parea.frames = 1;
 	instance->parea.unpriv = false;
+	instance->parea.readonly = false;
 	instance->parea.mapped = false;
 	ddi_parea_register(&instance->parea);
 	
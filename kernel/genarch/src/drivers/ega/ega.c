@@ -620,6 +620,7 @@ outdev_t *ega_init(ioport8_t *base, uintptr_t addr)
 	instance->parea.pbase = addr;
 	instance->parea.frames = SIZE2FRAMES(EGA_VRAM_SIZE);
 	instance->parea.unpriv = false;
+	instance->parea.readonly = false;
 	instance->parea.mapped = false;
 	ddi_parea_register(&instance->parea);
 	
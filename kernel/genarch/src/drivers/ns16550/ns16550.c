@@ -160,6 +160,7 @@ ns16550_instance_t *ns16550_init(ioport8_t *dev, unsigned reg_shift, inr_t inr,
 		instance->parea.pbase = (uintptr_t) dev;
 		instance->parea.frames = 1;
 		instance->parea.unpriv = false;
+		instance->parea.readonly = false;
 		instance->parea.mapped = false;
 		ddi_parea_register(&instance->parea);
 	}
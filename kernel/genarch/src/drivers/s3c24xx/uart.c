@@ -138,6 +138,7 @@ outdev_t *s3c24xx_uart_init(uintptr_t paddr, inr_t inr)
 	uart->parea.pbase = paddr;
 	uart->parea.frames = 1;
 	uart->parea.unpriv = false;
+	uart->parea.readonly = false;
 	uart->parea.mapped = false;
 	ddi_parea_register(&uart->parea);
 	
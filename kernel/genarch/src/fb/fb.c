@@ -651,6 +651,7 @@ outdev_t *fb_init(fb_properties_t *props)
 	instance->parea.pbase = props->addr;
 	instance->parea.frames = SIZE2FRAMES(fbsize);
 	instance->parea.unpriv = false;
+	instance->parea.readonly = false;
 	instance->parea.mapped = false;
 	ddi_parea_register(&instance->parea);
 	
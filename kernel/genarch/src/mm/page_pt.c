@@ -56,28 +56,36 @@ static void pt_mapping_remove(as_t *, uintptr_t);
 static bool pt_mapping_find(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_update(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_make_global(uintptr_t, size_t);
+#ifdef LARGE_PAGE_WIDTH
+static bool pt_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+static void pt_mapping_split(as_t *, uintptr_t);
+static bool pt_mapping_remove_large(as_t *, uintptr_t, uintptr_t *);
+#endif
 
 page_mapping_operations_t pt_mapping_operations = {
 	.mapping_insert = pt_mapping_insert,
 	.mapping_remove = pt_mapping_remove,
 	.mapping_find = pt_mapping_find,
 	.mapping_update = pt_mapping_update,
-	.mapping_make_global = pt_mapping_make_global
+	.mapping_make_global = pt_mapping_make_global,
+#ifdef LARGE_PAGE_WIDTH
+	.mapping_insert_large = pt_mapping_insert_large,
+	.mapping_split = pt_mapping_split,
+	.mapping_remove_large = pt_mapping_remove_large,
+	.large_page_size = LARGE_PAGE_SIZE
+#endif
 };
 
-/** Map page to frame using hierarchical page tables.
+/** Get the PTL2 table covering a page, allocate missing tables on the way.
  *
- * Map virtual address page to physical address frame
- * using flags.
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of the page.
  *
- * @param as    Address space to wich page belongs.
- * @param page  Virtual address of the page to be mapped.
- * @param frame Physical address of memory frame to which the mapping is done.
- * @param flags Flags to be used for mapping.
+ * @return Kernel address of the PTL2 table.
  *
  */
-void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
-    unsigned int flags)
+static pte_t *pt_ptl2_get(as_t *as, uintptr_t page)
 {
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 
@@ -117,7 +125,259 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 		SET_PTL2_PRESENT(ptl1, PTL1_INDEX(page));
 	}
 	
+	return (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+}
+
+/** Free empty page tables from PTL2 down to PTL0.
+ *
+ * The tables needed for sharing the kernel non-identity mappings are kept.
+ *
+ * @param ptl0 PTL0 table covering the page.
+ * @param ptl1 PTL1 table covering the page.
+ * @param ptl2 PTL2 table covering the page.
+ * @param page Virtual address of the page whose mapping was removed.
+ *
+ */
+static void pt_tables_release(pte_t *ptl0, pte_t *ptl1, pte_t *ptl2,
+    uintptr_t page)
+{
+#if (PTL2_ENTRIES != 0) || (PTL1_ENTRIES != 0)
+	bool empty = true;
+	unsigned int i;
+#endif
+	
+	/* Check PTL2 */
+#if (PTL2_ENTRIES != 0)
+	for (i = 0; i < PTL2_ENTRIES; i++) {
+		if (PTE_VALID(&ptl2[i])) {
+			empty = false;
+			break;
+		}
+	}
+	
+	if (empty) {
+		/*
+		 * PTL2 is empty.
+		 * Release the frame and remove PTL2 pointer from the parent
+		 * table.
+		 */
+#if (PTL1_ENTRIES != 0)
+		memsetb(&ptl1[PTL1_INDEX(page)], sizeof(pte_t), 0);
+#else
+		if (km_is_non_identity(page))
+			return;
+
+		memsetb(&ptl0[PTL0_INDEX(page)], sizeof(pte_t), 0);
+#endif
+		frame_free(KA2PA((uintptr_t) ptl2), PTL2_FRAMES);
+	} else {
+		/*
+		 * PTL2 is not empty.
+		 * Therefore, there must be a path from PTL0 to PTL2 and
+		 * thus nothing to free in higher levels.
+		 *
+		 */
+		return;
+	}
+#endif /* PTL2_ENTRIES != 0 */
+	
+	/* Check PTL1, empty is still true */
+#if (PTL1_ENTRIES != 0)
+	for (i = 0; i < PTL1_ENTRIES; i++) {
+		if (PTE_VALID(&ptl1[i])) {
+			empty = false;
+			break;
+		}
+	}
+	
+	if (empty) {
+		/*
+		 * PTL1 is empty.
+		 * Release the frame and remove PTL1 pointer from the parent
+		 * table.
+		 */
+		if (km_is_non_identity(page))
+			return;
+
+		memsetb(&ptl0[PTL0_INDEX(page)], sizeof(pte_t), 0);
+		frame_free(KA2PA((uintptr_t) ptl1), PTL1_FRAMES);
+	}
+#endif /* PTL1_ENTRIES != 0 */
+}
+
+#ifdef LARGE_PAGE_WIDTH
+
+/** Split a large page mapping into a PTL3 table of regular mappings.
+ *
+ * The new PTL3 maps the same frames with the same flags, so concurrent
+ * accesses to the range either use the old translation or fault and wait
+ * for the page tables to be unlocked. TLB entries caching the large page
+ * need to be invalidated only by the caller removing or changing some of
+ * the regular mappings afterwards.
+ *
+ * @param ptl2 PTL2 table containing the large page mapping.
+ * @param page Virtual address of any page within the large page.
+ *
+ * @return Kernel address of the new PTL3 table.
+ *
+ */
+static pte_t *pt_mapping_demote(pte_t *ptl2, uintptr_t page)
+{
+	size_t idx = PTL2_INDEX(page);
+	uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(ptl2, idx);
+	unsigned int flags = GET_PTL3_FLAGS(ptl2, idx);
+	
+	pte_t *newpt = (pte_t *)
+	    PA2KA(frame_alloc(PTL3_FRAMES, FRAME_LOWMEM, PTL3_SIZE - 1));
+	memsetb(newpt, PTL3_SIZE, 0);
+	
+	for (unsigned int i = 0; i < PTL3_ENTRIES; i++) {
+		SET_FRAME_ADDRESS(newpt, i, frame + P2SZ(i));
+		SET_FRAME_FLAGS(newpt, i, flags);
+	}
+	
+	/*
+	 * Hide the large page while the entry is being rewritten so that a
+	 * concurrent hardware page table walk never sees a mixture of both.
+	 */
+	SET_PTL3_FLAGS(ptl2, idx, PAGE_NOT_PRESENT | PAGE_USER | PAGE_EXEC |
+	    PAGE_CACHEABLE | PAGE_WRITE);
+	write_barrier();
+	SET_PTL3_LARGE(ptl2, idx, false);
+	SET_PTL3_ADDRESS(ptl2, idx, KA2PA(newpt));
+	write_barrier();
+	SET_PTL3_PRESENT(ptl2, idx);
+	
+	atomic_inc(&page_large_demotions);
+	
+	return newpt;
+}
+
+/** Map a large page to contiguous frames using a single PTL2 entry.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the large page.
+ * @param frame Physical address of the first frame.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return False if the range is already at least partially mapped.
+ *
+ */
+bool pt_mapping_insert_large(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+	assert(IS_ALIGNED(frame, LARGE_PAGE_SIZE));
+	
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+	
+	if (!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT))
+		return false;
+	
+	SET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page), frame);
+	SET_PTL3_FLAGS(ptl2, PTL2_INDEX(page), flags | PAGE_NOT_PRESENT);
+	SET_PTL3_LARGE(ptl2, PTL2_INDEX(page), true);
+	/*
+	 * Make the new mapping visible only after it is fully initialized.
+	 */
+	write_barrier();
+	SET_PTL3_PRESENT(ptl2, PTL2_INDEX(page));
+	
+	return true;
+}
+
+/** Split the large page mapping covering a page, if there is one.
+ *
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of any page within the large page.
+ *
+ */
+void pt_mapping_split(as_t *as, uintptr_t page)
+{
+	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
+
+	assert(page_table_locked(as));
+	
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+	
+	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+	
+	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+	
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page)))
+		pt_mapping_demote(ptl2, page);
+}
+
+/** Remove a large page mapping as a whole.
+ *
+ * Unlike pt_mapping_remove(), which splits the large page first, this
+ * removes all regular pages covered by the mapping at once. TLB shootdown
+ * should follow in order to make effects of this call visible.
+ *
+ * @param as         Address space to wich page belongs.
+ * @param page       Virtual address of the large page.
+ * @param[out] frame Physical address of the first frame of the removed
+ *                   mapping.
+ *
+ * @return False if page is not mapped by a large page mapping.
+ *
+ */
+bool pt_mapping_remove_large(as_t *as, uintptr_t page, uintptr_t *frame)
+{
+	assert(page_table_locked(as));
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+	
+	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
+		return false;
+	
+	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
+		return false;
+	
 	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	if ((GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) ||
+	    (!GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))))
+		return false;
+	
+	*frame = (uintptr_t) GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page));
+	
+	SET_PTL3_FLAGS(ptl2, PTL2_INDEX(page), PAGE_NOT_PRESENT);
+	memsetb(&ptl2[PTL2_INDEX(page)], sizeof(pte_t), 0);
+	
+	pt_tables_release(ptl0, ptl1, ptl2, page);
+	return true;
+}
+
+#endif /* LARGE_PAGE_WIDTH */
+
+/** Map page to frame using hierarchical page tables.
+ *
+ * Map virtual address page to physical address frame
+ * using flags. A large page mapping covering the page
+ * is split first.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the page to be mapped.
+ * @param frame Physical address of memory frame to which the mapping is done.
+ * @param flags Flags to be used for mapping.
+ *
+ */
+void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+	
+#ifdef LARGE_PAGE_WIDTH
+	if (!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) &&
+	    GET_PTL3_LARGE(ptl2, PTL2_INDEX(page)))
+		pt_mapping_demote(ptl2, page);
+#endif
 	
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
@@ -177,6 +437,17 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 	
+#ifdef LARGE_PAGE_WIDTH
+	/*
+	 * Removing a part of a large page requires splitting it first.
+	 * Callers in the TLB shootdown sequence must have done so already
+	 * using page_mapping_split() or remove the large page as a whole
+	 * using page_mapping_remove_large().
+	 */
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page)))
+		pt_mapping_demote(ptl2, page);
+#endif
+	
 	pte_t *ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 	
 	/*
@@ -232,69 +503,26 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 		return;
 	}
 	
-	/* Check PTL2, empty is still true */
-#if (PTL2_ENTRIES != 0)
-	for (i = 0; i < PTL2_ENTRIES; i++) {
-		if (PTE_VALID(&ptl2[i])) {
-			empty = false;
-			break;
-		}
-	}
-	
-	if (empty) {
-		/*
-		 * PTL2 is empty.
-		 * Release the frame and remove PTL2 pointer from the parent
-		 * table.
-		 */
-#if (PTL1_ENTRIES != 0)
-		memsetb(&ptl1[PTL1_INDEX(page)], sizeof(pte_t), 0);
-#else
-		if (km_is_non_identity(page))
-			return;
-
-		memsetb(&ptl0[PTL0_INDEX(page)], sizeof(pte_t), 0);
-#endif
-		frame_free(KA2PA((uintptr_t) ptl2), PTL2_FRAMES);
-	} else {
-		/*
-		 * PTL2 is not empty.
-		 * Therefore, there must be a path from PTL0 to PTL2 and
-		 * thus nothing to free in higher levels.
-		 *
-		 */
-		return;
-	}
-#endif /* PTL2_ENTRIES != 0 */
-	
-	/* check PTL1, empty is still true */
-#if (PTL1_ENTRIES != 0)
-	for (i = 0; i < PTL1_ENTRIES; i++) {
-		if (PTE_VALID(&ptl1[i])) {
-			empty = false;
-			break;
-		}
-	}
-	
-	if (empty) {
-		/*
-		 * PTL1 is empty.
-		 * Release the frame and remove PTL1 pointer from the parent
-		 * table.
-		 */
-		if (km_is_non_identity(page))
-			return;
-
-		memsetb(&ptl0[PTL0_INDEX(page)], sizeof(pte_t), 0);
-		frame_free(KA2PA((uintptr_t) ptl1), PTL1_FRAMES);
-	}
-#endif /* PTL1_ENTRIES != 0 */
+	pt_tables_release(ptl0, ptl1, ptl2, page);
 }
 
-static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
+/** Find the page table entry mapping a virtual page.
+ *
+ * @param as         Address space to which page belongs.
+ * @param page       Virtual page.
+ * @param nolock     True if the page tables need not be locked.
+ * @param[out] large Set to true if the returned entry is a PTL2 entry
+ *                   mapping a whole large page.
+ *
+ * @return Pointer to the entry or NULL if there is none.
+ */
+static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock,
+    bool *large)
 {
 	assert(nolock || page_table_locked(as));
 
+	*large = false;
+
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
@@ -323,6 +551,13 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
 	read_barrier();
 #endif
 	
+#ifdef LARGE_PAGE_WIDTH
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		*large = true;
+		return &ptl2[PTL2_INDEX(page)];
+	}
+#endif
+	
 	pte_t *ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 	
 	return &ptl3[PTL3_INDEX(page)];
@@ -339,10 +574,26 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
  */
 bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
-	if (t)
-		*pte = *t;
-	return t != NULL;
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
+	if (!t)
+		return false;
+	
+	*pte = *t;
+	
+#ifdef LARGE_PAGE_WIDTH
+	if (large) {
+		/*
+		 * Pretend a regular mapping of the respective frame within
+		 * the large page.
+		 */
+		SET_FRAME_ADDRESS(pte, 0, PTE_GET_FRAME(t) +
+		    (page & (LARGE_PAGE_SIZE - 1)));
+		SET_PTL3_LARGE(pte, 0, false);
+	}
+#endif
+	
+	return true;
 }
 
 /** Update mapping for virtual page in hierarchical page tables.
@@ -354,10 +605,22 @@ bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
  */
 void pt_mapping_update(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
 	if (!t)
 		panic("Updating non-existent PTE");
 
+#ifdef LARGE_PAGE_WIDTH
+	if (large) {
+		/*
+		 * The bits of a single page can be tracked only in a regular
+		 * mapping.
+		 */
+		pte_t *ptl3 = pt_mapping_demote(t - PTL2_INDEX(page), page);
+		t = &ptl3[PTL3_INDEX(page)];
+	}
+#endif
+
 	assert(PTE_VALID(t) == PTE_VALID(pte));
 	assert(PTE_PRESENT(t) == PTE_PRESENT(pte));
 	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(pte));
@@ -37,6 +37,7 @@
 
 #include <mm/tlb.h>
 #include <synch/spinlock.h>
+#include <synch/lockstat.h>
 #include <synch/rcu_types.h>
 #include <proc/scheduler.h>
 #include <arch/cpu.h>
@@ -56,6 +57,8 @@ typedef struct cpu {
 	
 	tlb_shootdown_msg_t tlb_messages[TLB_MESSAGE_QUEUE_LEN];
 	size_t tlb_messages_count;
+	/** A TLB shootdown IPI has been sent but not handled yet. */
+	bool tlb_ipi_pending;
 	
 	context_t saved_context;
 	
@@ -75,6 +78,9 @@ typedef struct cpu {
 	 */
 	size_t missed_clock_ticks;
 	
+	/** Clock ticks since the last profiler sample. */
+	unsigned int prof_ticks;
+	
 	/**
 	 * Processor cycle accounting.
 	 */
@@ -107,6 +113,11 @@ typedef struct cpu {
 	/** RCU per-cpu data. Uses own locking. */
 	rcu_cpu_data_t rcu;
 	
+#ifdef CONFIG_LOCKSTAT
+	/** Lock statistics gathered on this processor. */
+	lockstat_counters_t lockstat[LOCKSTAT_CLASSES];
+#endif /* CONFIG_LOCKSTAT */
+	
 	/**
 	 * Stack used by scheduler when there is no running thread.
 	 */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericdebug
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_CPUBUF_H_
+#define KERN_CPUBUF_H_
+
+#include <typedefs.h>
+#include <atomic.h>
+#include <errno.h>
+#include <synch/spinlock.h>
+
+struct cpubuf_ring;
+
+/** Buffers of fixed-size records, one per processor */
+typedef struct {
+	/** Serializes the allocation of the buffers */
+	SPINLOCK_DECLARE(lock);
+	
+	/** Per-processor buffers, NULL until allocated */
+	struct cpubuf_ring **rings;
+	
+	/** Size of a record */
+	size_t record_size;
+	
+	/** Number of records the buffer of one processor can hold */
+	size_t capacity;
+	
+	/** Name of the locks of the per-processor buffers */
+	const char *name;
+	
+	/** Records stored since the last reset */
+	atomic_t recorded;
+	
+	/** Records dropped since the last reset */
+	atomic_t dropped;
+} cpubuf_t;
+
+extern void cpubuf_initialize(cpubuf_t *, size_t, size_t, const char *);
+extern errno_t cpubuf_create(cpubuf_t *);
+extern void cpubuf_reset(cpubuf_t *);
+extern bool cpubuf_put(cpubuf_t *, const void *);
+extern size_t cpubuf_read(cpubuf_t *, void *, size_t);
+extern errno_t cpubuf_read_uspace(cpubuf_t *, void *, size_t, sysarg_t *);
+
+#endif
+
+/** @}
+ */
@@ -47,6 +47,7 @@ typedef struct {
 	uintptr_t pbase;  /**< Physical base of the area. */
 	pfn_t frames;     /**< Number of frames in the area. */
 	bool unpriv;      /**< Allow mapping by unprivileged tasks. */
+	bool readonly;    /**< Allow only mappings without write access. */
 	bool mapped;      /**< Indicate whether the area is actually
 	                       mapped. */
 } parea_t;
@@ -43,6 +43,8 @@
 #include <abi/klog.h>
 
 extern void log_init(void);
+extern void klog(void *);
+extern void log_drain(void);
 extern void log_begin(log_facility_t, log_level_t);
 extern void log_end(void);
 extern int log_vprintf(const char *, va_list);
@@ -47,6 +47,7 @@
 #include <adt/btree.h>
 #include <lib/elf.h>
 #include <arch.h>
+#include <atomic.h>
 
 #define AS                   THE->as
 
@@ -82,6 +83,16 @@
 /** The page fault was not resolved by as_page_fault(). Non-verbose version. */
 #define AS_PF_SILENT 3
 
+/**
+ * Upper bound on the number of pages populated by a single page fault.
+ * A naturally aligned block of this many pages always lies within one
+ * leaf page table.
+ */
+#define FAULT_AROUND_MAX      64
+
+/** Default fault-around limit, see fault_around_max. */
+#define FAULT_AROUND_DEFAULT  16
+
 /** Address space structure.
  *
  * as_t contains the list of as_areas of userspace accessible
@@ -109,6 +120,14 @@ typedef struct as {
 	 */
 	asid_t asid;
 	
+	/**
+	 * Processors which have ever run this address space and therefore
+	 * need to take part in its TLB shootdowns. NULL for the kernel
+	 * address space, which is present on all processors. Extended only
+	 * by tlb_shootdown_track().
+	 */
+	struct cpu_mask *cpu_mask;
+	
 	/** Number of references (i.e. tasks that reference this as). */
 	atomic_t refcount;
 	
@@ -117,6 +136,21 @@ typedef struct as {
 	/** B+tree of address space areas. */
 	btree_t as_area_btree;
 	
+	/** Number of pages of all address space areas. Protected by lock. */
+	size_t pages;
+	
+	/** Number of resident pages of all areas. Protected by lock. */
+	size_t resident;
+	
+	/** Generation in which the statistics above last changed. */
+	atomic_count_t stats_generation;
+	
+	/**
+	 * Changes of the statistics of the task owning the address space,
+	 * protected by the lock of the list of changed tasks.
+	 */
+	struct stats_changes *stats_owner;
+	
 	/** Non-generic content. */
 	as_genarch_t genarch;
 	
@@ -232,6 +266,12 @@ typedef struct {
 	
 	/** Data to be used by the backend. */
 	mem_backend_data_t backend_data;
+	
+	/** Page following the last fault-around window. */
+	uintptr_t fault_next;
+	
+	/** Size of the last fault-around window in pages. */
+	size_t fault_window;
 } as_area_t;
 
 /** Address space area backend structure. */
@@ -254,6 +294,9 @@ typedef struct mem_backend {
 extern as_t *AS_KERNEL;
 
 extern as_operations_t *as_operations;
+extern size_t fault_around_max;
+extern atomic_t as_page_faults;
+extern atomic_t as_fault_around_pages;
 extern list_t inactive_as_with_asid_list;
 
 extern void as_init(void);
@@ -275,8 +318,11 @@ extern errno_t as_area_change_flags(as_t *, unsigned int, uintptr_t);
 
 extern unsigned int as_area_get_flags(as_area_t *);
 extern bool as_area_check_access(as_area_t *, pf_access_t);
+extern size_t as_area_fault_window(as_area_t *, uintptr_t);
+extern bool as_area_page_present(as_area_t *, uintptr_t);
 extern size_t as_area_get_size(uintptr_t);
 extern bool used_space_insert(as_area_t *, uintptr_t, size_t);
+extern bool used_space_overlaps(as_area_t *, uintptr_t, size_t);
 extern bool used_space_remove(as_area_t *, uintptr_t, size_t);
 
 /* Interface to be implemented by architectures. */
@@ -36,6 +36,7 @@
 #define KERN_PAGE_H_
 
 #include <typedefs.h>
+#include <atomic.h>
 #include <proc/task.h>
 #include <mm/as.h>
 #include <arch/mm/page.h>
@@ -50,10 +51,24 @@ typedef struct {
 	bool (*mapping_find)(as_t *, uintptr_t, bool, pte_t *);
 	void (*mapping_update)(as_t *, uintptr_t, bool, pte_t *);
 	void (*mapping_make_global)(uintptr_t, size_t);
+	
+	/** Optional, maps a whole large page using a single entry. */
+	bool (*mapping_insert_large)(as_t *, uintptr_t, uintptr_t,
+	    unsigned int);
+	/** Optional, splits a large page mapping into regular mappings. */
+	void (*mapping_split)(as_t *, uintptr_t);
+	/** Optional, removes a large page mapping as a whole. */
+	bool (*mapping_remove_large)(as_t *, uintptr_t, uintptr_t *);
+	/** Size of a large page or zero if large pages are not supported. */
+	size_t large_page_size;
 } page_mapping_operations_t;
 
 extern page_mapping_operations_t *page_mapping_operations;
 
+extern bool page_large_enabled;
+extern atomic_t page_large_mappings;
+extern atomic_t page_large_demotions;
+
 extern void page_init(void);
 extern void page_table_lock(as_t *, bool);
 extern void page_table_unlock(as_t *, bool);
@@ -63,6 +78,11 @@ extern void page_mapping_remove(as_t *, uintptr_t);
 extern bool page_mapping_find(as_t *, uintptr_t, bool, pte_t *);
 extern void page_mapping_update(as_t *, uintptr_t, bool, pte_t *);
 extern void page_mapping_make_global(uintptr_t, size_t);
+extern size_t page_mapping_large_size(void);
+extern bool page_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+extern void page_mapping_split(as_t *, uintptr_t, size_t);
+extern size_t page_mapping_remove_large(as_t *, uintptr_t, uintptr_t *);
 extern pte_t *page_table_create(unsigned int);
 extern void page_table_destroy(pte_t *);
 
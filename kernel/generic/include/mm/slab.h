@@ -39,6 +39,7 @@
 #include <synch/spinlock.h>
 #include <atomic.h>
 #include <mm/frame.h>
+#include <abi/sysinfo.h>
 
 /** Minimum size to be allocated by malloc */
 #define SLAB_MIN_MALLOC_W  4
@@ -46,9 +47,21 @@
 /** Maximum size to be allocated by malloc */
 #define SLAB_MAX_MALLOC_W  22
 
-/** Initial Magazine size (TODO: dynamically growing magazines) */
+/** Initial magazine size */
 #define SLAB_MAG_SIZE  4
 
+/** Maximum size the magazines can grow to */
+#define SLAB_MAG_SIZE_MAX  64
+
+/** Number of depot accesses over which the magazine size is adapted */
+#define SLAB_MAG_TUNE_WINDOW  64
+
+/** Contended depot accesses in a window which double the magazine size */
+#define SLAB_MAG_GROW_CONTENTION  8
+
+/** Uncontended windows in a row which halve the magazine size */
+#define SLAB_MAG_SHRINK_WINDOWS  16
+
 /** If object size is less, store control structure inside SLAB */
 #define SLAB_INSIDE_SIZE  (PAGE_SIZE >> 3)
 
@@ -81,6 +94,14 @@ typedef struct {
 	slab_magazine_t *current;
 	slab_magazine_t *last;
 	IRQ_SPINLOCK_DECLARE(lock);
+	
+	/*
+	 * Statistics, updated only by the owning CPU
+	 * with interrupts disabled.
+	 */
+	uint64_t allocs;     /**< Number of allocations */
+	uint64_t hits;       /**< Allocations served from the magazines */
+	uint64_t requested;  /**< Bytes requested by the allocations */
 } slab_mag_cache_t;
 
 typedef struct {
@@ -92,6 +113,8 @@ typedef struct {
 	
 	/** Size of slab position - align_up(sizeof(obj)) */
 	size_t size;
+	/** Size of the objects as requested by the creator of the cache */
+	size_t objsize;
 	
 	errno_t (*constructor)(void *obj, unsigned int kmflag);
 	size_t (*destructor)(void *obj);
@@ -118,6 +141,17 @@ typedef struct {
 	list_t magazines;  /**< List o full magazines */
 	IRQ_SPINLOCK_DECLARE(maglock);
 	
+	/*
+	 * Magazine depot tuning and statistics, protected by maglock.
+	 */
+	size_t mag_size;            /**< Size of newly allocated magazines */
+	size_t tune_accesses;       /**< Depot accesses in the current window */
+	size_t tune_contended;      /**< Contended accesses in the window */
+	size_t tune_quiet;          /**< Uncontended windows in a row */
+	uint64_t depot_gets;        /**< Full magazines taken from the depot */
+	uint64_t depot_puts;        /**< Full magazines put into the depot */
+	uint64_t depot_contention;  /**< Contended depot accesses */
+	
 	/** CPU cache */
 	slab_mag_cache_t *mag_cache;
 } slab_cache_t;
@@ -137,6 +171,10 @@ extern void slab_enable_cpucache(void);
 
 /* kconsole debug */
 extern void slab_print_list(void);
+extern void slab_print_stats(void);
+
+/* statistics */
+extern size_t slab_get_stats(stats_slab_t *, size_t);
 
 /* malloc support */
 extern void *malloc(size_t, unsigned int)
@@ -37,6 +37,7 @@
 
 #include <arch/mm/asid.h>
 #include <typedefs.h>
+#include <atomic.h>
 
 /**
  * Number of TLB shootdown messages that can be queued in processor tlb_messages
@@ -64,17 +65,25 @@ typedef struct {
 	size_t count;			/**< Number of pages to invalidate. */
 } tlb_shootdown_msg_t;
 
+struct cpu_mask;
+
+extern atomic_t tlb_shootdowns;
+extern atomic_t tlb_shootdown_ipis;
+extern atomic_t tlb_shootdown_ipis_coalesced;
+
 extern void tlb_init(void);
 
 #ifdef CONFIG_SMP
-extern ipl_t tlb_shootdown_start(tlb_invalidate_type_t, asid_t, uintptr_t,
-    size_t);
+extern ipl_t tlb_shootdown_start(struct cpu_mask *, tlb_invalidate_type_t,
+    asid_t, uintptr_t, size_t);
 extern void tlb_shootdown_finalize(ipl_t);
 extern void tlb_shootdown_ipi_recv(void);
+extern void tlb_shootdown_track(struct cpu_mask *);
 #else
-#define tlb_shootdown_start(w, x, y, z)	interrupts_disable()
+#define tlb_shootdown_start(m, w, x, y, z)	interrupts_disable()
 #define tlb_shootdown_finalize(i)	(interrupts_restore(i));
 #define tlb_shootdown_ipi_recv()
+#define tlb_shootdown_track(m)
 #endif /* CONFIG_SMP */
 
 /* Export TLB interface that each architecture must implement. */
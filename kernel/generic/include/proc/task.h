@@ -57,6 +57,7 @@
 #include <proc/scheduler.h>
 #include <udebug/udebug.h>
 #include <mm/as.h>
+#include <sysinfo/stats.h>
 #include <abi/proc/task.h>
 #include <abi/sysinfo.h>
 #include <arch.h>
@@ -144,6 +145,12 @@ typedef struct task {
 	/** Accumulated accounting. */
 	uint64_t ucycles;
 	uint64_t kcycles;
+	
+	/** Number of page faults serviced for the task. */
+	atomic_t page_faults;
+	
+	/** Changes of the statistics of the task. */
+	stats_changes_t stats_changes;
 } task_t;
 
 IRQ_SPINLOCK_EXTERN(tasks_lock);
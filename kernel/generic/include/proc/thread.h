@@ -181,6 +181,9 @@ typedef struct thread {
 	/** Thread doesn't affect accumulated accounting. */
 	bool uncounted;
 	
+	/** Changes of the statistics of the thread. */
+	stats_changes_t stats_changes;
+	
 	/** Thread's priority. Implemented as index to CPU->rq */
 	int priority;
 	/** Thread ID. */
@@ -204,6 +207,9 @@ typedef struct thread {
 	/** Thread's kernel stack. */
 	uint8_t *kstack;
 	
+	/** State saved by the innermost interrupt being handled. */
+	istate_t *istate;
+	
 #ifdef CONFIG_UDEBUG
 	/**
 	 * If true, the scheduler will print a stack trace
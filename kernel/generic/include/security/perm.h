@@ -70,6 +70,12 @@
  */
 #define PERM_IRQ_REG     (1 << 3)
 
+/**
+ * PERM_PROFILE allows its holder to control the kernel profiler and the
+ * tracepoints and to read the data they collect.
+ */
+#define PERM_PROFILE     (1 << 4)
+
 typedef uint32_t perm_t;
 
 #ifdef __32_BITS__
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup sync
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_LOCKSTAT_H_
+#define KERN_LOCKSTAT_H_
+
+#include <stdbool.h>
+#include <typedefs.h>
+
+/** Maximum number of distinct lock names tracked by lock statistics */
+#define LOCKSTAT_CLASSES  256
+
+/** Statistics of one lock class gathered on one processor */
+typedef struct {
+	/** Number of times a lock of the class was acquired. */
+	uint64_t acquisitions;
+	/** Number of acquisitions which had to wait for the lock. */
+	uint64_t contentions;
+	/** Cycles spent waiting for the lock. */
+	uint64_t spin_cycles;
+	/** Longest wait for the lock in cycles. */
+	uint64_t max_spin_cycles;
+} lockstat_counters_t;
+
+struct spinlock;
+
+extern void lockstat_acquired(struct spinlock *, bool, uint64_t);
+extern void lockstat_print(void);
+extern void lockstat_reset(void);
+
+#endif
+
+/** @}
+ */
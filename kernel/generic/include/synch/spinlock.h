@@ -44,14 +44,47 @@
 
 #ifdef CONFIG_SMP
 
+/*
+ * Spinlocks carry their name whenever it is needed either for reporting
+ * possible deadlocks or for gathering lock statistics.
+ */
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
+#define SPINLOCK_NAMED
+#endif
+
 typedef struct spinlock {
+#ifdef CONFIG_SPINLOCK_TICKET
+	/** Next ticket to be handed out to a locker. */
+	atomic_t next;
+	/** Ticket of the current holder of the lock. */
+	atomic_t owner;
+#else /* CONFIG_SPINLOCK_TICKET */
 	atomic_t val;
+#endif /* CONFIG_SPINLOCK_TICKET */
 	
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef SPINLOCK_NAMED
 	const char *name;
-#endif /* CONFIG_DEBUG_SPINLOCK */
+#endif /* SPINLOCK_NAMED */
+	
+#ifdef CONFIG_LOCKSTAT
+	/** Lock statistics class plus one, zero if not looked up yet. */
+	unsigned int lockstat;
+#endif /* CONFIG_LOCKSTAT */
 } spinlock_t;
 
+#ifdef CONFIG_SPINLOCK_TICKET
+
+#define SPINLOCK_STATE_INITIALIZER \
+	.next = { 0 }, \
+	.owner = { 0 }
+
+#else /* CONFIG_SPINLOCK_TICKET */
+
+#define SPINLOCK_STATE_INITIALIZER \
+	.val = { 0 }
+
+#endif /* CONFIG_SPINLOCK_TICKET */
+
 /*
  * SPINLOCK_DECLARE is to be used for dynamically allocated spinlocks,
  * where the lock gets initialized in run time.
@@ -64,45 +97,57 @@ typedef struct spinlock {
  * for statically allocated spinlocks. They declare (either as global
  * or static) symbol and initialize the lock.
  */
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef SPINLOCK_NAMED
 
 #define SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	spinlock_t lock_name = { \
 		.name = desc_name, \
-		.val = { 0 } \
+		SPINLOCK_STATE_INITIALIZER \
 	}
 
 #define SPINLOCK_STATIC_INITIALIZE_NAME(lock_name, desc_name) \
 	static spinlock_t lock_name = { \
 		.name = desc_name, \
-		.val = { 0 } \
+		SPINLOCK_STATE_INITIALIZER \
 	}
 
-#define ASSERT_SPINLOCK(expr, lock) \
-	assert_verbose(expr, (lock)->name)
-
-#define spinlock_lock(lock)    spinlock_lock_debug((lock))
-#define spinlock_unlock(lock)  spinlock_unlock_debug((lock))
-
-#else /* CONFIG_DEBUG_SPINLOCK */
+#else /* SPINLOCK_NAMED */
 
 #define SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	spinlock_t lock_name = { \
-		.val = { 0 } \
+		SPINLOCK_STATE_INITIALIZER \
 	}
 
 #define SPINLOCK_STATIC_INITIALIZE_NAME(lock_name, desc_name) \
 	static spinlock_t lock_name = { \
-		.val = { 0 } \
+		SPINLOCK_STATE_INITIALIZER \
 	}
 
+#endif /* SPINLOCK_NAMED */
+
+#ifdef CONFIG_DEBUG_SPINLOCK
+
+#define ASSERT_SPINLOCK(expr, lock) \
+	assert_verbose(expr, (lock)->name)
+
+#else /* CONFIG_DEBUG_SPINLOCK */
+
 #define ASSERT_SPINLOCK(expr, lock) \
 	assert(expr)
 
-#define spinlock_lock(lock)    atomic_lock_arch(&(lock)->val)
+#endif /* CONFIG_DEBUG_SPINLOCK */
+
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
+
+#define spinlock_lock(lock)    spinlock_lock_debug((lock))
+#define spinlock_unlock(lock)  spinlock_unlock_debug((lock))
+
+#else
+
+#define spinlock_lock(lock)    spinlock_lock_nondebug((lock))
 #define spinlock_unlock(lock)  spinlock_unlock_nondebug((lock))
 
-#endif /* CONFIG_DEBUG_SPINLOCK */
+#endif
 
 #define SPINLOCK_INITIALIZE(lock_name) \
 	SPINLOCK_INITIALIZE_NAME(lock_name, #lock_name)
@@ -116,6 +161,36 @@ extern void spinlock_lock_debug(spinlock_t *);
 extern void spinlock_unlock_debug(spinlock_t *);
 extern bool spinlock_locked(spinlock_t *);
 
+/** Lock spinlock
+ *
+ * Lock spinlock for non-debug kernels.
+ *
+ * Ticket spinlocks hand the lock over to the waiters in the order in
+ * which they arrived. Each waiter only reads the owner field while
+ * spinning, so the cache line is not bounced between the waiters until
+ * the lock is released.
+ *
+ * @param lock Pointer to spinlock_t structure.
+ *
+ */
+NO_TRACE static inline void spinlock_lock_nondebug(spinlock_t *lock)
+{
+#ifdef CONFIG_SPINLOCK_TICKET
+	preemption_disable();
+	
+	atomic_count_t ticket = atomic_postinc(&lock->next);
+	while (atomic_get(&lock->owner) != ticket)
+		cpu_spin_hint();
+	
+	/*
+	 * Prevent critical section code from bleeding out this way up.
+	 */
+	CS_ENTER_BARRIER();
+#else /* CONFIG_SPINLOCK_TICKET */
+	atomic_lock_arch(&lock->val);
+#endif /* CONFIG_SPINLOCK_TICKET */
+}
+
 /** Unlock spinlock
  *
  * Unlock spinlock for non-debug kernels.
@@ -130,7 +205,12 @@ NO_TRACE static inline void spinlock_unlock_nondebug(spinlock_t *lock)
 	 */
 	CS_LEAVE_BARRIER();
 	
+#ifdef CONFIG_SPINLOCK_TICKET
+	/* Only the holder of the lock ever writes the owner field. */
+	atomic_set(&lock->owner, atomic_get(&lock->owner) + 1);
+#else /* CONFIG_SPINLOCK_TICKET */
 	atomic_set(&lock->val, 0);
+#endif /* CONFIG_SPINLOCK_TICKET */
 	preemption_enable();
 }
 
@@ -208,13 +288,13 @@ typedef struct {
  * for statically allocated interrupts-disabled spinlocks. They declare (either
  * as global or static symbol) and initialize the lock.
  */
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef SPINLOCK_NAMED
 
 #define IRQ_SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	irq_spinlock_t lock_name = { \
 		.lock = { \
 			.name = desc_name, \
-			.val = { 0 } \
+			SPINLOCK_STATE_INITIALIZER \
 		}, \
 		.guard = false, \
 		.ipl = 0 \
@@ -224,18 +304,18 @@ typedef struct {
 	static irq_spinlock_t lock_name = { \
 		.lock = { \
 			.name = desc_name, \
-			.val = { 0 } \
+			SPINLOCK_STATE_INITIALIZER \
 		}, \
 		.guard = false, \
 		.ipl = 0 \
 	}
 
-#else /* CONFIG_DEBUG_SPINLOCK */
+#else /* SPINLOCK_NAMED */
 
 #define IRQ_SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	irq_spinlock_t lock_name = { \
 		.lock = { \
-			.val = { 0 } \
+			SPINLOCK_STATE_INITIALIZER \
 		}, \
 		.guard = false, \
 		.ipl = 0 \
@@ -244,13 +324,13 @@ typedef struct {
 #define IRQ_SPINLOCK_STATIC_INITIALIZE_NAME(lock_name, desc_name) \
 	static irq_spinlock_t lock_name = { \
 		.lock = { \
-			.val = { 0 } \
+			SPINLOCK_STATE_INITIALIZER \
 		}, \
 		.guard = false, \
 		.ipl = 0 \
 	}
 
-#endif /* CONFIG_DEBUG_SPINLOCK */
+#endif /* SPINLOCK_NAMED */
 
 #else /* CONFIG_SMP */
 
@@ -35,6 +35,88 @@
 #ifndef KERN_STATS_H_
 #define KERN_STATS_H_
 
+#include <typedefs.h>
+#include <atomic.h>
+#include <adt/list.h>
+#include <mm/as.h>
+#include <abi/proc/task.h>
+#include <abi/proc/thread.h>
+
+struct task;
+struct thread;
+
+/** Number of exited tasks or threads remembered for delta snapshots */
+#define STATS_EXITED_RECORDS  1024
+
+/** Changes of the statistics of a task or thread */
+typedef struct stats_changes {
+	/** Generation in which the statistics last changed */
+	atomic_count_t generation;
+	
+	/**
+	 * Link to the list of changed tasks or threads. The list is ordered by
+	 * the generation, so that a delta snapshot only visits its tail.
+	 */
+	link_t link;
+} stats_changes_t;
+
+/** Current generation of the statistics
+ *
+ * Every delta snapshot starts a new generation.
+ *
+ */
+extern atomic_t stats_generation;
+
+extern list_t stats_tasks_changed;
+extern list_t stats_threads_changed;
+
+extern void stats_changes_initialize(stats_changes_t *);
+extern void stats_changes_move(stats_changes_t *, list_t *);
+extern void stats_as_changes_move(as_t *);
+
+/** Mark the statistics of a task as changed.
+ *
+ * Only the first change in a generation takes the lock of the list.
+ *
+ * @param changes Changes of the statistics of the task.
+ *
+ */
+static inline void stats_task_changed(stats_changes_t *changes)
+{
+	if (changes->generation !=
+	    (atomic_count_t) atomic_get(&stats_generation))
+		stats_changes_move(changes, &stats_tasks_changed);
+}
+
+/** Mark the statistics of a thread as changed.
+ *
+ * @param changes Changes of the statistics of the thread.
+ *
+ */
+static inline void stats_thread_changed(stats_changes_t *changes)
+{
+	if (changes->generation !=
+	    (atomic_count_t) atomic_get(&stats_generation))
+		stats_changes_move(changes, &stats_threads_changed);
+}
+
+/** Mark the statistics of the task owning an address space as changed.
+ *
+ * @param as Address space.
+ *
+ */
+static inline void stats_as_changed(as_t *as)
+{
+	if (as->stats_generation !=
+	    (atomic_count_t) atomic_get(&stats_generation))
+		stats_as_changes_move(as);
+}
+
+extern void stats_task_created(struct task *);
+extern void stats_task_exited(struct task *);
+extern void stats_thread_attached(struct thread *);
+extern void stats_thread_exited(struct thread *);
+
 extern void kload(void *arg);
 extern void stats_init(void);
 
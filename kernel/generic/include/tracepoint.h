@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** @addtogroup genericdebug
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_TRACEPOINT_H_
+#define KERN_TRACEPOINT_H_
+
+#include <typedefs.h>
+#include <abi/tracepoint.h>
+
+/** Number of events buffered for each processor */
+#define TRACEPOINT_BUFFER_EVENTS  2048
+
+/** Mask of enabled tracepoints */
+extern uint32_t tracepoint_mask;
+
+/** Record an event if the tracepoint is enabled.
+ *
+ * A disabled tracepoint costs a single load and a branch which is not
+ * taken.
+ *
+ * @param tp Tracepoint.
+ * @param a0 First tracepoint specific argument.
+ * @param a1 Second tracepoint specific argument.
+ *
+ */
+#define TRACEPOINT(tp, a0, a1) \
+	do { \
+		if (__builtin_expect((tracepoint_mask & TP_MASK(tp)) != 0, 0)) \
+			tracepoint_hit((tp), (uint64_t) (a0), \
+			    (uint64_t) (a1)); \
+	} while (0)
+
+extern void tracepoint_init(void);
+extern void tracepoint_hit(tracepoint_t, uint64_t, uint64_t);
+
+extern sys_errno_t sys_tracepoint(sysarg_t, sysarg_t, sysarg_t, sysarg_t,
+    sysarg_t *);
+
+#endif
+
+/** @}
+ */
@@ -57,6 +57,9 @@
 #include <cpu.h>
 #include <mm/tlb.h>
 #include <mm/km.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <mm/zpool.h>
 #include <arch/mm/tlb.h>
 #include <mm/frame.h>
 #include <main/version.h>
@@ -71,6 +74,7 @@
 #include <symtab.h>
 #include <synch/workqueue.h>
 #include <synch/rcu.h>
+#include <synch/lockstat.h>
 #include <errno.h>
 
 #ifdef CONFIG_TEST
@@ -504,6 +508,14 @@ static cmd_info_t caches_info = {
 	.argc = 0
 };
 
+static int cmd_slabs(cmd_arg_t *argv);
+static cmd_info_t slabs_info = {
+	.name = "slabs",
+	.description = "Show slab cache magazine and fragmentation statistics.",
+	.func = cmd_slabs,
+	.argc = 0
+};
+
 static int cmd_sysinfo(cmd_arg_t *argv);
 static cmd_info_t sysinfo_info = {
 	.name = "sysinfo",
@@ -535,6 +547,48 @@ static cmd_info_t zone_info = {
 	.argv = &zone_argv
 };
 
+/* Data and methods for the 'faultaround' command */
+static int cmd_faultaround(cmd_arg_t *argv);
+static cmd_arg_t faultaround_argv = {
+	.type = ARG_TYPE_INT,
+};
+
+static cmd_info_t faultaround_info = {
+	.name = "faultaround",
+	.description = "<pages> Set the page fault-around limit (1 disables it).",
+	.func = cmd_faultaround,
+	.argc = 1,
+	.argv = &faultaround_argv
+};
+
+/* Data and methods for the 'largepages' command */
+static int cmd_largepages(cmd_arg_t *argv);
+static cmd_arg_t largepages_argv = {
+	.type = ARG_TYPE_INT,
+};
+
+static cmd_info_t largepages_info = {
+	.name = "largepages",
+	.description = "<0|1> Disable or enable large page mappings of anonymous memory.",
+	.func = cmd_largepages,
+	.argc = 1,
+	.argv = &largepages_argv
+};
+
+/* Data and methods for the 'zeropool' command */
+static int cmd_zeropool(cmd_arg_t *argv);
+static cmd_arg_t zeropool_argv = {
+	.type = ARG_TYPE_INT,
+};
+
+static cmd_info_t zeropool_info = {
+	.name = "zeropool",
+	.description = "<frames> Set the pre-zeroed frame pool watermark (0 disables it).",
+	.func = cmd_zeropool,
+	.argc = 1,
+	.argv = &zeropool_argv
+};
+
 /* Data and methods for the 'workq' command */
 static int cmd_workq(cmd_arg_t *argv);
 static cmd_info_t workq_info = {
@@ -553,6 +607,25 @@ static cmd_info_t rcu_info = {
 	.argc = 0
 };
 
+#ifdef CONFIG_LOCKSTAT
+
+/* Data and methods for the 'lockstat' command */
+static int cmd_lockstat(cmd_arg_t *argv);
+static cmd_arg_t lockstat_argv = {
+	.type = ARG_TYPE_STRING_OPTIONAL,
+	.buffer = flag_buf,
+	.len = sizeof(flag_buf)
+};
+static cmd_info_t lockstat_info = {
+	.name = "lockstat",
+	.description = "Show spinlock contention statistics (use -r to reset them).",
+	.func = cmd_lockstat,
+	.argc = 1,
+	.argv = &lockstat_argv
+};
+
+#endif /* CONFIG_LOCKSTAT */
+
 /* Data and methods for 'ipc' command */
 static int cmd_ipc(cmd_arg_t *argv);
 static cmd_arg_t ipc_argv = {
@@ -611,15 +684,18 @@ static cmd_info_t *basic_commands[] = {
 	&continue_info,
 	&cpus_info,
 	&desc_info,
+	&faultaround_info,
 	&halt_info,
 	&help_info,
 	&ipc_info,
 	&kill_info,
+	&largepages_info,
 	&physmem_info,
 	&reboot_info,
 	&rcu_info,
 	&sched_info,
 	&set4_info,
+	&slabs_info,
 	&symaddr_info,
 	&sysinfo_info,
 	&tasks_info,
@@ -628,6 +704,7 @@ static cmd_info_t *basic_commands[] = {
 	&uptime_info,
 	&version_info,
 	&workq_info,
+	&zeropool_info,
 	&zones_info,
 	&zone_info,
 #ifdef CONFIG_TEST
@@ -636,6 +713,9 @@ static cmd_info_t *basic_commands[] = {
 #endif
 #ifdef CONFIG_UDEBUG
 	&btrace_info,
+#endif
+#ifdef CONFIG_LOCKSTAT
+	&lockstat_info,
 #endif
 	&pio_read_8_info,
 	&pio_read_16_info,
@@ -1225,6 +1305,18 @@ int cmd_caches(cmd_arg_t *argv)
 	return 1;
 }
 
+/** Command for printing slab allocator cache statistics
+ *
+ * @param argv Ignored
+ *
+ * @return Always 1
+ */
+int cmd_slabs(cmd_arg_t *argv)
+{
+	slab_print_stats();
+	return 1;
+}
+
 /** Command for dumping sysinfo
  *
  * @param argv Ignores
@@ -1326,6 +1418,29 @@ int cmd_rcu(cmd_arg_t *argv)
 	return 1;
 }
 
+#ifdef CONFIG_LOCKSTAT
+
+/** Command for printing or resetting spinlock contention statistics
+ *
+ * @param argv Ignored
+ *
+ * @return Always 1
+ */
+int cmd_lockstat(cmd_arg_t *argv)
+{
+	if (str_cmp(flag_buf, "-r") == 0) {
+		lockstat_reset();
+		printf("Lock statistics reset.\n");
+	} else if (str_cmp(flag_buf, "") == 0)
+		lockstat_print();
+	else
+		printf("Unknown argument \"%s\".\n", flag_buf);
+	
+	return 1;
+}
+
+#endif /* CONFIG_LOCKSTAT */
+
 /** Command for listing memory zones
  *
  * @param argv Ignored
@@ -1350,6 +1465,67 @@ int cmd_zone(cmd_arg_t *argv)
 	return 1;
 }
 
+/** Command for setting the fault-around limit
+ *
+ * @param argv Integer argument from cmdline expected
+ *
+ * return Always 1
+ */
+int cmd_faultaround(cmd_arg_t *argv)
+{
+	sysarg_t pages = argv[0].intval;
+	
+	if ((pages == 0) || (pages > FAULT_AROUND_MAX)) {
+		printf("The limit must be between 1 and %d pages.\n",
+		    FAULT_AROUND_MAX);
+		return 1;
+	}
+	
+	fault_around_max = pages;
+	printf("Fault-around limit set to %" PRIun " pages.\n", pages);
+	return 1;
+}
+
+/** Command for enabling or disabling large page mappings
+ *
+ * @param argv Integer argument from cmdline expected
+ *
+ * return Always 1
+ */
+int cmd_largepages(cmd_arg_t *argv)
+{
+	page_large_enabled = (argv[0].intval != 0);
+	
+	size_t size = page_mapping_large_size();
+	if (size != 0)
+		printf("Large page mappings of %zu KiB enabled.\n",
+		    size / 1024);
+	else
+		printf("Large page mappings disabled.\n");
+	return 1;
+}
+
+/** Command for setting the size of the pool of pre-zeroed frames
+ *
+ * @param argv Integer argument from cmdline expected
+ *
+ * return Always 1
+ */
+int cmd_zeropool(cmd_arg_t *argv)
+{
+	sysarg_t frames = argv[0].intval;
+	
+	if (frames > ZPOOL_CAPACITY) {
+		printf("The pool can hold at most %d frames.\n",
+		    ZPOOL_CAPACITY);
+		return 1;
+	}
+	
+	zpool_watermark = frames;
+	printf("Zero pool watermark set to %" PRIun " frames.\n", frames);
+	return 1;
+}
+
 /** Command for printing task IPC details
  *
  * @param argv Integer argument from cmdline expected
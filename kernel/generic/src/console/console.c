@@ -194,6 +194,7 @@ void kio_init(void)
 	kio_parea.pbase = (uintptr_t) faddr;
 	kio_parea.frames = SIZE2FRAMES(sizeof(kio));
 	kio_parea.unpriv = false;
+	kio_parea.readonly = false;
 	kio_parea.mapped = false;
 	ddi_parea_register(&kio_parea);
 	
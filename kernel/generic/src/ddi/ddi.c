@@ -96,7 +96,8 @@ void ddi_parea_register(parea_t *parea)
  * @param bound Lowest virtual address bound.
  *
  * @return EOK on success.
- * @return EPERM if the caller lacks permissions to use this syscall.
+ * @return EPERM if the caller lacks permissions to use this syscall or
+ *         if it asks for write access to a read-only area.
  * @return EBADMEM if phys is not page aligned.
  * @return ENOENT if there is no task matching the specified ID or
  *         the physical address space is not enabled for mapping.
@@ -139,6 +140,11 @@ NO_TRACE static errno_t physmem_map(uintptr_t phys, size_t pages,
 			return EPERM;
 		}
 		
+		if ((parea->readonly) && (flags & AS_AREA_WRITE)) {
+			mutex_unlock(&parea_lock);
+			return EPERM;
+		}
+		
 		goto map;
 	}
 	
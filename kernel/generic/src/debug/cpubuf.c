@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericdebug
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Per-processor record buffers.
+ *
+ * The sampling profiler and the tracepoints record fixed-size records in
+ * interrupt context. Each processor stores them into its own buffer, so
+ * that recording never contends with other processors. Uspace moves the
+ * records out of the buffers and orders them itself.
+ *
+ */
+
+#include <cpubuf.h>
+#include <mm/slab.h>
+#include <syscall/copy.h>
+#include <arch/barrier.h>
+#include <config.h>
+#include <cpu.h>
+#include <macros.h>
+#include <mem.h>
+#include <arch.h>
+
+/** Buffer of records stored by one processor */
+typedef struct cpubuf_ring {
+	IRQ_SPINLOCK_DECLARE(lock);
+	
+	/** Index of the oldest record */
+	size_t first;
+	
+	/** Number of records in the buffer */
+	size_t count;
+	
+	uint8_t records[];
+} cpubuf_ring_t;
+
+/** Get a record of a per-processor buffer. */
+static void *cpubuf_record(cpubuf_t *buf, cpubuf_ring_t *ring, size_t i)
+{
+	return ring->records + i * buf->record_size;
+}
+
+/** Initialize per-processor record buffers.
+ *
+ * The buffers themselves are allocated by cpubuf_create().
+ *
+ * @param buf         Buffers to initialize.
+ * @param record_size Size of a record.
+ * @param capacity    Number of records the buffer of one processor can
+ *                    hold.
+ * @param name        Name of the locks of the per-processor buffers.
+ *
+ */
+void cpubuf_initialize(cpubuf_t *buf, size_t record_size, size_t capacity,
+    const char *name)
+{
+	spinlock_initialize(&buf->lock, "cpubuf_lock");
+	buf->rings = NULL;
+	buf->record_size = record_size;
+	buf->capacity = capacity;
+	buf->name = name;
+	atomic_set(&buf->recorded, 0);
+	atomic_set(&buf->dropped, 0);
+}
+
+/** Free the per-processor buffers.
+ *
+ * @param rings Buffers to free.
+ * @param count Number of the allocated buffers.
+ *
+ */
+static void cpubuf_rings_destroy(cpubuf_ring_t **rings, unsigned int count)
+{
+	while (count-- > 0)
+		free(rings[count]);
+	
+	free(rings);
+}
+
+/** Allocate the per-processor buffers unless they exist already.
+ *
+ * @param buf Per-processor record buffers.
+ *
+ * @return EOK on success, ENOMEM if the buffers cannot be allocated.
+ *
+ */
+errno_t cpubuf_create(cpubuf_t *buf)
+{
+	if (buf->rings != NULL)
+		return EOK;
+	
+	cpubuf_ring_t **rings =
+	    malloc(config.cpu_count * sizeof(cpubuf_ring_t *), 0);
+	if (rings == NULL)
+		return ENOMEM;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		rings[i] = malloc(sizeof(cpubuf_ring_t) +
+		    buf->capacity * buf->record_size, 0);
+		if (rings[i] == NULL) {
+			cpubuf_rings_destroy(rings, i);
+			return ENOMEM;
+		}
+		
+		irq_spinlock_initialize(&rings[i]->lock, buf->name);
+		rings[i]->first = 0;
+		rings[i]->count = 0;
+	}
+	
+	spinlock_lock(&buf->lock);
+	
+	if (buf->rings == NULL) {
+		/* Pairs with the read barrier in cpubuf_put() */
+		write_barrier();
+		buf->rings = rings;
+		rings = NULL;
+	}
+	
+	spinlock_unlock(&buf->lock);
+	
+	/* Somebody else allocated the buffers in the meantime */
+	if (rings != NULL)
+		cpubuf_rings_destroy(rings, config.cpu_count);
+	
+	return EOK;
+}
+
+/** Discard all records and reset the counters.
+ *
+ * @param buf Per-processor record buffers.
+ *
+ */
+void cpubuf_reset(cpubuf_t *buf)
+{
+	if (buf->rings != NULL) {
+		for (unsigned int i = 0; i < config.cpu_count; i++) {
+			cpubuf_ring_t *ring = buf->rings[i];
+			
+			irq_spinlock_lock(&ring->lock, true);
+			ring->first = 0;
+			ring->count = 0;
+			irq_spinlock_unlock(&ring->lock, true);
+		}
+	}
+	
+	atomic_set(&buf->recorded, 0);
+	atomic_set(&buf->dropped, 0);
+}
+
+/** Store a record into the buffer of the current processor.
+ *
+ * Must be called with interrupts disabled.
+ *
+ * @param buf    Per-processor record buffers.
+ * @param record Record to store.
+ *
+ * @return True if the record was stored, false if it was dropped.
+ *
+ */
+bool cpubuf_put(cpubuf_t *buf, const void *record)
+{
+	read_barrier();
+	
+	if ((buf->rings == NULL) || (CPU == NULL))
+		return false;
+	
+	cpubuf_ring_t *ring = buf->rings[CPU->id];
+	bool stored = false;
+	
+	irq_spinlock_lock(&ring->lock, false);
+	
+	if (ring->count < buf->capacity) {
+		size_t i = (ring->first + ring->count) % buf->capacity;
+		memcpy(cpubuf_record(buf, ring, i), record, buf->record_size);
+		ring->count++;
+		stored = true;
+	}
+	
+	irq_spinlock_unlock(&ring->lock, false);
+	
+	atomic_inc(stored ? &buf->recorded : &buf->dropped);
+	return stored;
+}
+
+/** Move records from the per-processor buffers.
+ *
+ * @param buf     Per-processor record buffers.
+ * @param records Destination buffer.
+ * @param max     Capacity of the destination buffer in records.
+ *
+ * @return Number of records moved.
+ *
+ */
+size_t cpubuf_read(cpubuf_t *buf, void *records, size_t max)
+{
+	uint8_t *dst = (uint8_t *) records;
+	size_t count = 0;
+	
+	read_barrier();
+	
+	if (buf->rings == NULL)
+		return 0;
+	
+	for (unsigned int i = 0; (i < config.cpu_count) && (count < max); i++) {
+		cpubuf_ring_t *ring = buf->rings[i];
+		
+		irq_spinlock_lock(&ring->lock, true);
+		
+		while ((ring->count > 0) && (count < max)) {
+			memcpy(dst + count * buf->record_size,
+			    cpubuf_record(buf, ring, ring->first),
+			    buf->record_size);
+			ring->first = (ring->first + 1) % buf->capacity;
+			ring->count--;
+			count++;
+		}
+		
+		irq_spinlock_unlock(&ring->lock, true);
+	}
+	
+	return count;
+}
+
+/** Move records from the per-processor buffers to uspace.
+ *
+ * @param buf           Per-processor record buffers.
+ * @param uspace_buf    Destination buffer in uspace.
+ * @param size          Size of the destination buffer.
+ * @param uspace_result Number of bytes moved.
+ *
+ * @return Error code.
+ *
+ */
+errno_t cpubuf_read_uspace(cpubuf_t *buf, void *uspace_buf, size_t size,
+    sysarg_t *uspace_result)
+{
+	size = min(size, buf->capacity * buf->record_size);
+	
+	void *records = malloc(size, 0);
+	if (records == NULL)
+		return ENOMEM;
+	
+	sysarg_t result = cpubuf_read(buf, records, size / buf->record_size) *
+	    buf->record_size;
+	
+	errno_t rc = copy_to_uspace(uspace_buf, records, result);
+	free(records);
+	
+	if (rc != EOK)
+		return rc;
+	
+	return copy_to_uspace(uspace_result, &result, sizeof(result));
+}
+
+/** @}
+ */
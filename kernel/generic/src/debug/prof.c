@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericdebug
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Sampling profiler.
+ *
+ * While profiling is active, every processor takes a sample on each n-th
+ * clock tick. A sample records the task and thread that were interrupted,
+ * the interrupted program counter and a few return addresses found by
+ * following the frame pointers. Samples are kept in a buffer per processor.
+ * Uspace reads the samples and resolves the addresses to symbols.
+ *
+ * Samples are taken in interrupt context. The kernel stack is only followed
+ * while the frame pointers stay within the kernel stack of the thread. The
+ * uspace stack is only read where its pages are present, so that taking a
+ * sample never causes a page fault.
+ *
+ */
+
+#include <prof.h>
+#include <abi/prof.h>
+#include <cpubuf.h>
+#include <stacktrace.h>
+#include <symtab.h>
+#include <interrupt.h>
+#include <proc/thread.h>
+#include <proc/task.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
+#include <mm/slab.h>
+#include <synch/spinlock.h>
+#include <security/perm.h>
+#include <sysinfo/sysinfo.h>
+#include <syscall/copy.h>
+#include <arch/barrier.h>
+#include <atomic.h>
+#include <config.h>
+#include <cpu.h>
+#include <errno.h>
+#include <macros.h>
+#include <align.h>
+#include <str.h>
+#include <arch.h>
+
+/** Bytes around a uspace frame pointer which must be present */
+#define PROF_FRAME_SLACK  (4 * sizeof(uintptr_t))
+
+/** Serializes starting and stopping the profiler */
+SPINLOCK_STATIC_INITIALIZE_NAME(prof_lock, "prof_lock");
+
+/** Per-processor sample buffers, allocated when first started */
+static cpubuf_t prof_buffer;
+
+/** Profiling is active */
+static atomic_t prof_active = {0};
+
+/** Number of clock ticks between two samples */
+static unsigned int prof_interval = 1;
+
+static sysarg_t get_prof_samples(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&prof_buffer.recorded);
+}
+
+static sysarg_t get_prof_dropped(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&prof_buffer.dropped);
+}
+
+/** Initialize the sampling profiler.
+ *
+ */
+void prof_init(void)
+{
+	cpubuf_initialize(&prof_buffer, sizeof(prof_sample_t),
+	    PROF_BUFFER_SAMPLES, "prof_buffer_lock");
+	
+	sysinfo_set_item_gen_val("prof.samples", NULL, get_prof_samples, NULL);
+	sysinfo_set_item_gen_val("prof.dropped", NULL, get_prof_dropped, NULL);
+}
+
+/** Check that a kernel frame lies on the stack of the current thread. */
+static bool prof_kernel_frame_valid(uintptr_t fp)
+{
+	uintptr_t stack = (uintptr_t) THREAD->kstack;
+	
+	return ((fp >= stack) &&
+	    (fp + 2 * sizeof(uintptr_t) <= stack + STACK_SIZE));
+}
+
+/** Check that the uspace memory around a frame pointer can be read.
+ *
+ * The page tables are looked up without locking as the TLB refill handlers
+ * do. The pages cannot be unmapped while we are reading them, because the
+ * TLB shootdown waits for this processor to enable interrupts.
+ *
+ */
+static bool prof_uspace_frame_valid(uintptr_t fp)
+{
+	if ((fp < PROF_FRAME_SLACK) || (fp + PROF_FRAME_SLACK < fp))
+		return false;
+	
+	uintptr_t first = ALIGN_DOWN(fp - PROF_FRAME_SLACK, PAGE_SIZE);
+	uintptr_t last = ALIGN_DOWN(fp + PROF_FRAME_SLACK - 1, PAGE_SIZE);
+	
+	for (uintptr_t page = first; page <= last; page += PAGE_SIZE) {
+		pte_t pte;
+		
+		if ((!page_mapping_find(AS, page, true, &pte)) ||
+		    (!PTE_PRESENT(&pte)) || (!PTE_READABLE(&pte)))
+			return false;
+		
+		if (page == last)
+			break;
+	}
+	
+	return true;
+}
+
+/** Record the program counter and the return addresses of a stack. */
+static void prof_walk(prof_sample_t *sample, stack_trace_ops_t *ops,
+    stack_trace_context_t *ctx, bool (*frame_valid)(uintptr_t))
+{
+	sample->pc[sample->depth++] = ctx->pc;
+	
+	while ((sample->depth < PROF_FRAMES) &&
+	    (ops->stack_trace_context_validate(ctx)) &&
+	    (frame_valid(ctx->fp))) {
+		uintptr_t pc = 0;
+		uintptr_t fp = 0;
+		
+		if (!ops->return_address_get(ctx, &pc))
+			break;
+		
+		if (!ops->frame_pointer_prev(ctx, &fp))
+			break;
+		
+		sample->pc[sample->depth++] = pc;
+		
+		/* Stacks grow down, anything else means a broken chain */
+		if (fp <= ctx->fp)
+			break;
+		
+		ctx->fp = fp;
+		ctx->pc = pc;
+	}
+}
+
+/** Take a sample of what the current processor was interrupted in. */
+static void prof_sample_take(prof_sample_t *sample)
+{
+	sample->cpu = CPU->id;
+	sample->flags = 0;
+	sample->depth = 0;
+	
+	if ((THREAD == NULL) || (THREAD->istate == NULL)) {
+		sample->task_id = 0;
+		sample->thread_id = 0;
+		sample->flags |= PROF_SAMPLE_IDLE;
+		return;
+	}
+	
+	istate_t *istate = THREAD->istate;
+	stack_trace_context_t ctx = {
+		.fp = istate_get_fp(istate),
+		.pc = istate_get_pc(istate),
+		.istate = istate
+	};
+	
+	sample->task_id = TASK->taskid;
+	sample->thread_id = THREAD->tid;
+	
+	if (istate_from_uspace(istate)) {
+		sample->flags |= PROF_SAMPLE_USPACE;
+		prof_walk(sample, &ust_ops, &ctx, prof_uspace_frame_valid);
+	} else
+		prof_walk(sample, &kst_ops, &ctx, prof_kernel_frame_valid);
+}
+
+/** Take a sample if it is due.
+ *
+ * Called from the clock interrupt handler with interrupts disabled.
+ *
+ */
+void prof_tick(void)
+{
+	if (!atomic_get(&prof_active))
+		return;
+	
+	read_barrier();
+	
+	if (++CPU->prof_ticks < prof_interval)
+		return;
+	
+	CPU->prof_ticks = 0;
+	
+	prof_sample_t sample;
+	prof_sample_take(&sample);
+	cpubuf_put(&prof_buffer, &sample);
+}
+
+/** Start sampling.
+ *
+ * @param interval Number of clock ticks between two samples.
+ *
+ * @return EOK on success, EINVAL if the interval is out of range,
+ *         ENOMEM if the sample buffers cannot be allocated.
+ *
+ */
+static errno_t prof_start(sysarg_t interval)
+{
+	if ((interval == 0) || (interval > PROF_INTERVAL_MAX))
+		return EINVAL;
+	
+	errno_t rc = cpubuf_create(&prof_buffer);
+	if (rc != EOK)
+		return rc;
+	
+	spinlock_lock(&prof_lock);
+	
+	atomic_set(&prof_active, false);
+	cpubuf_reset(&prof_buffer);
+	prof_interval = interval;
+	
+	write_barrier();
+	atomic_set(&prof_active, true);
+	
+	spinlock_unlock(&prof_lock);
+	
+	return EOK;
+}
+
+/** Control the sampling profiler from uspace.
+ *
+ * @param operation Operation to perform.
+ * @param arg       Clock ticks between two samples for PROF_START,
+ *                  kernel address for PROF_SYMBOL.
+ * @param buf       Buffer for the samples or for the symbol name.
+ * @param size      Size of the buffer.
+ * @param uspace_result Number of bytes read for PROF_READ, offset of the
+ *                  address from the start of the symbol for PROF_SYMBOL.
+ *
+ * @return EPERM if the task does not have the PERM_PROFILE permission.
+ * @return Error code.
+ *
+ */
+sys_errno_t sys_prof(sysarg_t operation, sysarg_t arg, void *buf,
+    size_t size, sysarg_t *uspace_result)
+{
+	const char *name;
+	uintptr_t offset;
+	sysarg_t result;
+	errno_t rc;
+	
+	if (!(perm_get(TASK) & PERM_PROFILE))
+		return (sys_errno_t) EPERM;
+	
+	switch (operation) {
+	case PROF_START:
+		return (sys_errno_t) prof_start(arg);
+	case PROF_STOP:
+		atomic_set(&prof_active, false);
+		return EOK;
+	case PROF_READ:
+		return (sys_errno_t) cpubuf_read_uspace(&prof_buffer, buf, size,
+		    uspace_result);
+	case PROF_SYMBOL:
+		if (size == 0)
+			return (sys_errno_t) EINVAL;
+		
+		rc = symtab_name_lookup(arg, &name, &offset);
+		if (rc != EOK)
+			return (sys_errno_t) rc;
+		
+		size = min(size, str_size(name) + 1);
+		rc = copy_to_uspace(buf, name, size - 1);
+		if (rc != EOK)
+			return (sys_errno_t) rc;
+		
+		rc = copy_to_uspace((char *) buf + size - 1, "", 1);
+		if (rc != EOK)
+			return (sys_errno_t) rc;
+		
+		result = offset;
+		return (sys_errno_t) copy_to_uspace(uspace_result, &result,
+		    sizeof(result));
+	default:
+		return (sys_errno_t) ENOTSUP;
+	}
+}
+
+/** @}
+ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericdebug
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Static tracepoints.
+ *
+ * Tracepoints are placed at interesting spots of the kernel and of the
+ * servers. A disabled tracepoint only tests a bit in the mask of enabled
+ * tracepoints. An enabled tracepoint records an event stamped with the
+ * cycle counter into a buffer of the current processor. Uspace collects
+ * the events and orders them per processor.
+ *
+ * The mask is mirrored on a page which any task may map, though only
+ * read-only, so that the tracepoints in the servers are as cheap as the
+ * kernel ones while they are disabled. Only events of enabled uspace
+ * tracepoints are passed to the kernel.
+ *
+ */
+
+#include <tracepoint.h>
+#include <abi/tracepoint.h>
+#include <cpubuf.h>
+#include <proc/thread.h>
+#include <proc/task.h>
+#include <mm/frame.h>
+#include <mm/page.h>
+#include <mm/slab.h>
+#include <ddi/ddi.h>
+#include <synch/spinlock.h>
+#include <security/perm.h>
+#include <sysinfo/sysinfo.h>
+#include <arch/barrier.h>
+#include <arch/cycle.h>
+#include <arch/asm.h>
+#include <atomic.h>
+#include <config.h>
+#include <cpu.h>
+#include <errno.h>
+#include <macros.h>
+#include <arch.h>
+
+/** Mask of enabled tracepoints */
+uint32_t tracepoint_mask = 0;
+
+/** Serializes changes of the mask */
+SPINLOCK_STATIC_INITIALIZE_NAME(tracepoint_lock, "tracepoint_lock");
+
+/** Per-processor event buffers, allocated when first enabled */
+static cpubuf_t tracepoint_buffer;
+
+/** Page with the mask mirrored for uspace */
+static tracepoint_page_t *tracepoint_page = NULL;
+
+/** Physical memory area of the page shared with uspace */
+static parea_t tracepoint_parea;
+
+static sysarg_t get_tracepoint_events(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&tracepoint_buffer.recorded);
+}
+
+static sysarg_t get_tracepoint_dropped(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&tracepoint_buffer.dropped);
+}
+
+/** Initialize the tracepoints.
+ *
+ * Uspace tracepoints stay disabled if the shared page cannot be
+ * allocated.
+ *
+ */
+void tracepoint_init(void)
+{
+	cpubuf_initialize(&tracepoint_buffer, sizeof(tracepoint_event_t),
+	    TRACEPOINT_BUFFER_EVENTS, "tracepoint_buffer_lock");
+	
+	sysinfo_set_item_gen_val("tracepoint.events", NULL,
+	    get_tracepoint_events, NULL);
+	sysinfo_set_item_gen_val("tracepoint.dropped", NULL,
+	    get_tracepoint_dropped, NULL);
+	
+	uintptr_t faddr = frame_alloc(1, FRAME_ATOMIC, 0);
+	if (faddr == 0)
+		return;
+	
+	tracepoint_page = (tracepoint_page_t *) PA2KA(faddr);
+	tracepoint_page->mask = 0;
+	
+	tracepoint_parea.pbase = faddr;
+	tracepoint_parea.frames = 1;
+	tracepoint_parea.unpriv = true;
+	tracepoint_parea.readonly = true;
+	tracepoint_parea.mapped = false;
+	ddi_parea_register(&tracepoint_parea);
+	
+	sysinfo_set_item_val("tracepoint.faddr", NULL, (sysarg_t) faddr);
+}
+
+/** Record an event of an enabled tracepoint.
+ *
+ * Use the TRACEPOINT() macro instead of calling this directly. May be
+ * called in any context, including interrupt handlers and the scheduler.
+ *
+ * @param tp Tracepoint.
+ * @param a0 First tracepoint specific argument.
+ * @param a1 Second tracepoint specific argument.
+ *
+ */
+void tracepoint_hit(tracepoint_t tp, uint64_t a0, uint64_t a1)
+{
+	if (CPU == NULL)
+		return;
+	
+	ipl_t ipl = interrupts_disable();
+	
+	tracepoint_event_t event = {
+		.cycle = get_cycle(),
+		.task_id = (TASK != NULL) ? TASK->taskid : 0,
+		.thread_id = (THREAD != NULL) ? THREAD->tid : 0,
+		.cpu = CPU->id,
+		.tracepoint = tp,
+		.arg = { a0, a1 }
+	};
+	
+	cpubuf_put(&tracepoint_buffer, &event);
+	interrupts_restore(ipl);
+}
+
+/** Set the mask of enabled tracepoints.
+ *
+ * Events recorded previously are discarded when the tracepoints get
+ * enabled while all of them were disabled.
+ *
+ * @param mask Mask of tracepoints to enable.
+ *
+ * @return EOK on success, EINVAL if the mask contains an unknown
+ *         tracepoint, ENOMEM if the event buffers cannot be allocated.
+ *
+ */
+static errno_t tracepoint_enable(uint32_t mask)
+{
+	if ((mask & ~TP_MASK_ALL) != 0)
+		return EINVAL;
+	
+	if (mask != 0) {
+		errno_t rc = cpubuf_create(&tracepoint_buffer);
+		if (rc != EOK)
+			return rc;
+	}
+	
+	spinlock_lock(&tracepoint_lock);
+	
+	if ((tracepoint_mask == 0) && (mask != 0))
+		cpubuf_reset(&tracepoint_buffer);
+	
+	write_barrier();
+	tracepoint_mask = mask;
+	
+	if (tracepoint_page != NULL)
+		tracepoint_page->mask = mask;
+	
+	spinlock_unlock(&tracepoint_lock);
+	
+	return EOK;
+}
+
+/** Control the tracepoints from uspace.
+ *
+ * @param operation Operation to perform.
+ * @param arg1      Mask of tracepoints for TRACEPOINT_ENABLE, destination
+ *                  buffer for TRACEPOINT_READ, uspace tracepoint for
+ *                  TRACEPOINT_HIT.
+ * @param arg2      Size of the buffer for TRACEPOINT_READ, first
+ *                  tracepoint argument for TRACEPOINT_HIT.
+ * @param arg3      Second tracepoint argument for TRACEPOINT_HIT.
+ * @param uspace_result Number of bytes read for TRACEPOINT_READ.
+ *
+ * @return EPERM if the task does not have the PERM_PROFILE permission
+ *         needed for TRACEPOINT_ENABLE and TRACEPOINT_READ.
+ * @return Error code.
+ *
+ */
+sys_errno_t sys_tracepoint(sysarg_t operation, sysarg_t arg1, sysarg_t arg2,
+    sysarg_t arg3, sysarg_t *uspace_result)
+{
+	switch (operation) {
+	case TRACEPOINT_ENABLE:
+		if (!(perm_get(TASK) & PERM_PROFILE))
+			return (sys_errno_t) EPERM;
+		
+		return (sys_errno_t) tracepoint_enable((uint32_t) arg1);
+	case TRACEPOINT_READ:
+		if (!(perm_get(TASK) & PERM_PROFILE))
+			return (sys_errno_t) EPERM;
+		
+		return (sys_errno_t) cpubuf_read_uspace(&tracepoint_buffer,
+		    (void *) arg1, (size_t) arg2, uspace_result);
+	case TRACEPOINT_HIT:
+		if ((arg1 < TP_USPACE_FIRST) || (arg1 >= TP_COUNT))
+			return (sys_errno_t) EINVAL;
+		
+		if ((tracepoint_mask & TP_MASK(arg1)) != 0)
+			tracepoint_hit((tracepoint_t) arg1, arg2, arg3);
+		
+		return EOK;
+	default:
+		return (sys_errno_t) ENOTSUP;
+	}
+}
+
+/** @}
+ */
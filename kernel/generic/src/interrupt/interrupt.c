@@ -123,6 +123,13 @@ NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 	
 	uint64_t begin_cycle = get_cycle();
 	
+	/* Let the profiler see what was interrupted, even when nested */
+	istate_t *outer_istate = NULL;
+	if (THREAD) {
+		outer_istate = THREAD->istate;
+		THREAD->istate = istate;
+	}
+	
 #ifdef CONFIG_UDEBUG
 	if (THREAD)
 		THREAD->udebug.uspace_state = istate;
@@ -135,6 +142,9 @@ NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 		THREAD->udebug.uspace_state = NULL;
 #endif
 	
+	if (THREAD)
+		THREAD->istate = outer_istate;
+	
 	/* This is a safe place to exit exiting thread */
 	if ((THREAD) && (THREAD->interrupted) && (istate_from_uspace(istate)))
 		thread_exit();
@@ -59,6 +59,8 @@
 #include <arch/interrupt.h>
 #include <ipc/irq.h>
 #include <cap/cap.h>
+#include <tracepoint.h>
+#include <sysinfo/stats.h>
 
 static void ipc_forget_call(call_t *);
 
@@ -117,7 +119,7 @@ call_t *ipc_call_alloc(unsigned int flags)
 	call_t *call = slab_alloc(call_cache, flags);
 	if (!call)
 		return NULL;
-	kobject_t *kobj = (kobject_t *) malloc(sizeof(kobject_t), flags);
+	kobject_t *kobj = kobject_alloc(flags);
 	if (!kobj) {
 		slab_free(call_cache, call);
 		return NULL;
@@ -279,7 +281,11 @@ void _ipc_answer_free_call(call_t *call, bool selflocked)
 	/* Count sent answer */
 	irq_spinlock_lock(&TASK->lock, true);
 	TASK->ipc_info.answer_sent++;
+	stats_task_changed(&TASK->stats_changes);
 	irq_spinlock_unlock(&TASK->lock, true);
+	
+	TRACEPOINT(TP_IPC_ANSWER, call->request_method,
+	    IPC_GET_RETVAL(call->data));
 
 	spinlock_lock(&call->forget_lock);
 	if (call->forget) {
@@ -393,8 +399,11 @@ static void _ipc_call(phone_t *phone, answerbox_t *box, call_t *call,
 	/* Count sent ipc call */
 	irq_spinlock_lock(&caller->lock, true);
 	caller->ipc_info.call_sent++;
+	stats_task_changed(&caller->stats_changes);
 	irq_spinlock_unlock(&caller->lock, true);
 	
+	TRACEPOINT(TP_IPC_CALL, IPC_GET_IMETHOD(call->data), box->task->taskid);
+	
 	if (!(call->flags & IPC_CALL_FORWARDED))
 		_ipc_call_actions_internal(phone, call, preforget);
 	
@@ -500,6 +509,7 @@ errno_t ipc_forward(call_t *call, phone_t *newphone, answerbox_t *oldbox,
 	/* Count forwarded calls */
 	irq_spinlock_lock(&TASK->lock, true);
 	TASK->ipc_info.forwarded++;
+	stats_task_changed(&TASK->stats_changes);
 	irq_spinlock_pass(&TASK->lock, &oldbox->lock);
 	list_remove(&call->ab_link);
 	irq_spinlock_unlock(&oldbox->lock, true);
@@ -584,6 +594,7 @@ restart:
 	TASK->ipc_info.irq_notif_received += irq_cnt;
 	TASK->ipc_info.answer_received += answer_cnt;
 	TASK->ipc_info.call_received += call_cnt;
+	stats_task_changed(&TASK->stats_changes);
 	
 	irq_spinlock_unlock(&TASK->lock, true);
 	
@@ -179,7 +179,7 @@ errno_t phone_alloc(task_t *task, cap_handle_t *out_handle)
 			cap_free(TASK, handle);
 			return ENOMEM;
 		}
-		kobject_t *kobject = malloc(sizeof(kobject_t), FRAME_ATOMIC);
+		kobject_t *kobject = kobject_alloc(FRAME_ATOMIC);
 		if (!kobject) {
 			cap_free(TASK, handle);
 			slab_free(phone_cache, phone);
@@ -56,6 +56,55 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 	return EOK;
 }
 
+/** Gather data from a list of buffers in the answering address space.
+ *
+ * @param dst     Kernel buffer of @a size bytes.
+ * @param uiov    Address of the ipc_iov_t array in the answering address
+ *                space.
+ * @param iovcnt  Number of ipc_iov_t elements.
+ * @param size    Total size of the data.
+ *
+ * @return EOK on success, ELIMIT if there are too many buffers, EINVAL
+ *         if the buffer sizes do not add up to @a size or an error code
+ *         from copy_from_uspace().
+ */
+static errno_t gather_from_uspace(void *dst, uintptr_t uiov, size_t iovcnt,
+    size_t size)
+{
+	ipc_iov_t *iov;
+	size_t total;
+	size_t i;
+	errno_t rc;
+
+	if (iovcnt > DATA_XFER_IOV_MAX)
+		return ELIMIT;
+
+	iov = malloc(iovcnt * sizeof(ipc_iov_t), 0);
+	rc = copy_from_uspace(iov, (void *) uiov, iovcnt * sizeof(ipc_iov_t));
+	if (rc != EOK)
+		goto out;
+
+	total = 0;
+	for (i = 0; i < iovcnt; i++) {
+		if (iov[i].size > size - total) {
+			rc = EINVAL;
+			goto out;
+		}
+
+		rc = copy_from_uspace(dst + total, iov[i].base, iov[i].size);
+		if (rc != EOK)
+			goto out;
+
+		total += iov[i].size;
+	}
+
+	if (total != size)
+		rc = EINVAL;
+out:
+	free(iov);
+	return rc;
+}
+
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
 	assert(!answer->buffer);
@@ -66,6 +115,11 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		uintptr_t dst = IPC_GET_ARG1(*olddata);
 		size_t max_size = IPC_GET_ARG2(*olddata);
 		size_t size = IPC_GET_ARG2(answer->data);
+		size_t iovcnt = IPC_GET_ARG3(answer->data);
+		errno_t rc;
+
+		/* The requester need not know how the data was gathered. */
+		IPC_SET_ARG3(answer->data, 0);
 
 		if (size && size <= max_size) {
 			/*
@@ -75,8 +129,13 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 			IPC_SET_ARG1(answer->data, dst);
 				
 			answer->buffer = malloc(size, 0);
-			errno_t rc = copy_from_uspace(answer->buffer,
-			    (void *) src, size);
+			if (iovcnt == 0) {
+				rc = copy_from_uspace(answer->buffer,
+				    (void *) src, size);
+			} else {
+				rc = gather_from_uspace(answer->buffer, src,
+				    iovcnt, size);
+			}
 			if (rc) {
 				IPC_SET_RETVAL(answer->data, rc);
 				/*
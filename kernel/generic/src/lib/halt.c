@@ -70,6 +70,9 @@ void halt(void)
 		kconsole("panic", "\nLast resort kernel console ready.\n", false);
 #endif
 	
+	/* The klog thread will not run again */
+	log_drain();
+	
 	if (CPU)
 		log(LF_OTHER, LVL_NOTE, "cpu%u: halted", CPU->id);
 	else
@@ -61,6 +61,7 @@ void init_rd(void *data, size_t size)
 	rd_parea.pbase = base;
 	rd_parea.frames = SIZE2FRAMES(size);
 	rd_parea.unpriv = false;
+	rd_parea.readonly = false;
 	rd_parea.mapped = false;
 	ddi_parea_register(&rd_parea);
 	
@@ -30,10 +30,29 @@
  * @{
  */
 /** @file
+ *
+ * Kernel log.
+ *
+ * Entries are first written to a ring of fixed-size slots private to the
+ * processor doing the logging. A slot is reserved by a single atomic
+ * increment and published by storing its sequence number, so writers never
+ * take a global lock and never wait for each other. Interrupt handlers
+ * logging on top of an entry which is being written simply reserve the next
+ * slot. Entries not fitting into one slot continue in further slots chained
+ * to it.
+ *
+ * The klog kernel thread merges the committed entries from all rings in the
+ * order of their global sequence counter into the cyclic log buffer read by
+ * uspace and into the kernel output buffer. Before the rings are allocated,
+ * entries are written directly to the log buffer under the log_lock.
+ *
  */
 
 #include <sysinfo/sysinfo.h>
 #include <synch/spinlock.h>
+#include <synch/waitq.h>
+#include <proc/thread.h>
+#include <preemption.h>
 #include <typedefs.h>
 #include <ddi/irq.h>
 #include <ddi/ddi.h>
@@ -41,11 +60,18 @@
 #include <ipc/irq.h>
 #include <arch.h>
 #include <panic.h>
+#include <halt.h>
 #include <putchar.h>
 #include <atomic.h>
+#include <assert.h>
+#include <config.h>
+#include <cpu.h>
+#include <mem.h>
+#include <arch/barrier.h>
 #include <syscall/copy.h>
 #include <errno.h>
 #include <str.h>
+#include <macros.h>
 #include <print.h>
 #include <printf/printf_core.h>
 #include <stdarg.h>
@@ -56,7 +82,95 @@
 
 #define LOG_PAGES    8
 #define LOG_LENGTH   (LOG_PAGES * PAGE_SIZE)
-#define LOG_ENTRY_HEADER_LENGTH (sizeof(size_t) + sizeof(uint32_t))
+#define LOG_ENTRY_HEADER_LENGTH (sizeof(size_t) + 3 * sizeof(uint32_t))
+
+/** Number of slots in the ring of each processor */
+#define LOG_RING_SLOTS  128
+
+/** Size of a slot, longer entries are chained over several slots */
+#define LOG_SLOT_SIZE  256
+
+/**
+ * Maximum length of an entry including its header, longer entries are
+ * truncated. Uspace cannot read entries longer than a page anyway.
+ */
+#define LOG_ENTRY_MAX  PAGE_SIZE
+
+/** Maximum number of entries simultaneously open on one processor */
+#define LOG_NESTING  4
+
+/** Slot of a per-processor log ring */
+typedef struct {
+	/**
+	 * Sequence number of the slot.
+	 *
+	 * The entry with ring index i has the sequence number 2i + 1 while it
+	 * is being written and 2i + 2 once it is committed.
+	 */
+	atomic_t seq;
+	
+	/** Length of the data in the slot */
+	size_t len;
+	
+	/** The slot continues an entry started in an earlier slot */
+	bool continuation;
+	
+	/** The entry continues in the slot with ring index next */
+	bool chained;
+	
+	/** Ring index of the next slot of the entry */
+	atomic_count_t next;
+	
+	/**
+	 * Part of the entry in the same format as in the log buffer. Only the
+	 * first slot of an entry starts with the header.
+	 */
+	uint8_t data[LOG_SLOT_SIZE];
+} log_slot_t;
+
+/** Entry being written to a log ring */
+typedef struct {
+	/** Slot holding the header of the entry */
+	log_slot_t *first;
+	
+	/** Slot the entry is being appended to */
+	log_slot_t *last;
+	
+	/** Length of the entry including its header */
+	size_t len;
+	
+	/** The entry did not fit into LOG_ENTRY_MAX bytes */
+	bool truncated;
+} log_open_t;
+
+/** Per-processor log ring */
+typedef struct {
+	/** Ring index of the next slot to be reserved */
+	atomic_t head;
+	
+	/** Ring index of the next slot to be merged, protected by log_lock */
+	size_t tail;
+	
+	/** Number of entries opened on this processor and not yet ended */
+	size_t depth;
+	
+	/** Number of open entries written directly to the log buffer */
+	size_t direct;
+	
+	/** Open entries, the innermost one is the last */
+	log_open_t open[LOG_NESTING];
+	
+	/** Entries overwritten before being merged, protected by log_lock */
+	size_t overwritten;
+	
+	/** Entries dropped because they were nested too deeply */
+	atomic_t dropped;
+	
+	/** Entries truncated to LOG_ENTRY_MAX bytes */
+	atomic_t truncated;
+	
+	log_slot_t slots[LOG_RING_SLOTS];
+} log_ring_t;
 
 /** Cyclic buffer holding the data for kernel log */
 uint8_t log_buffer[LOG_LENGTH] __attribute__((aligned(PAGE_SIZE)));
@@ -73,8 +187,32 @@ size_t log_used = 0;
 /** Log spinlock */
 SPINLOCK_STATIC_INITIALIZE_NAME(log_lock, "log_lock");
 
-/** Overall count of logged messages, which may overflow as needed */
-static uint32_t log_counter = 0;
+/**
+ * Overall count of logged messages, which may overflow as needed.
+ *
+ * This is the only variable all processors modify for every entry.
+ */
+static atomic_t log_counter = {0};
+
+/** Per-processor log rings, NULL until they are allocated */
+static log_ring_t **log_rings = NULL;
+
+/** The klog thread is merging the log rings */
+static bool log_merging = false;
+
+/**
+ * Entries were committed since the klog thread last looked.
+ *
+ * Writers only read this unless it is zero, so it is written once per merge
+ * rather than once per entry.
+ */
+static atomic_t log_pending = {0};
+
+/** Wait queue the klog thread sleeps in */
+static waitq_t log_wq;
+
+/** Buffer for the entry being merged, protected by log_lock */
+static uint8_t log_merge_buffer[LOG_SLOT_SIZE];
 
 /** Starting position of the entry currently being written to the log */
 static size_t log_current_start = 0;
@@ -87,15 +225,212 @@ static size_t next_for_uspace = 0;
 
 static void log_update(void *);
 
+static sysarg_t get_log_dropped(struct sysinfo_item *item, void *data)
+{
+	sysarg_t dropped = 0;
+	
+	if (log_rings == NULL)
+		return 0;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		dropped += log_rings[i]->overwritten;
+		dropped += atomic_get(&log_rings[i]->dropped);
+	}
+	
+	return dropped;
+}
+
+static sysarg_t get_log_truncated(struct sysinfo_item *item, void *data)
+{
+	sysarg_t truncated = 0;
+	
+	if (log_rings == NULL)
+		return 0;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++)
+		truncated += atomic_get(&log_rings[i]->truncated);
+	
+	return truncated;
+}
+
+/** Allocate the per-processor log rings.
+ *
+ * @return Array of rings indexed by processor ID or NULL on failure.
+ *
+ */
+static log_ring_t **log_rings_create(void)
+{
+	log_ring_t **rings = malloc(config.cpu_count * sizeof(log_ring_t *),
+	    FRAME_ATOMIC);
+	if (rings == NULL)
+		return NULL;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		rings[i] = malloc(sizeof(log_ring_t), FRAME_ATOMIC);
+		if (rings[i] == NULL) {
+			while (i-- > 0)
+				free(rings[i]);
+			
+			free(rings);
+			return NULL;
+		}
+		
+		memsetb(rings[i], sizeof(log_ring_t), 0);
+	}
+	
+	return rings;
+}
+
 /** Initialize kernel logging facility
  *
  */
 void log_init(void)
 {
+	waitq_initialize(&log_wq);
+	
+	log_ring_t **rings = log_rings_create();
+	if (rings != NULL) {
+		write_barrier();
+		log_rings = rings;
+	}
+	
+	sysinfo_set_item_gen_val("klog.dropped", NULL, get_log_dropped, NULL);
+	sysinfo_set_item_gen_val("klog.truncated", NULL, get_log_truncated,
+	    NULL);
+	
 	event_set_unmask_callback(EVENT_KLOG, log_update);
 	atomic_set(&log_inited, true);
 }
 
+/** Get the log ring of the current processor.
+ *
+ * The caller must have preemption disabled.
+ *
+ * @return Log ring or NULL if entries are written directly to the log buffer.
+ *
+ */
+static log_ring_t *log_ring_current(void)
+{
+	if ((log_rings == NULL) || (CPU == NULL))
+		return NULL;
+	
+	return log_rings[CPU->id];
+}
+
+/** Get the log ring the current entry is being written to.
+ *
+ * The caller must have preemption disabled.
+ *
+ * @return Log ring or NULL if the entry is written directly to the log
+ *         buffer.
+ *
+ */
+static log_ring_t *log_ring_entry(void)
+{
+	log_ring_t *ring = log_ring_current();
+	if ((ring == NULL) || (ring->direct > 0))
+		return NULL;
+	
+	return ring;
+}
+
+/** Get the innermost entry open on a processor.
+ *
+ * @return Entry or NULL if the entry is being dropped.
+ *
+ */
+static log_open_t *log_entry_current(log_ring_t *ring)
+{
+	if ((ring->depth == 0) || (ring->depth > LOG_NESTING))
+		return NULL;
+	
+	return &ring->open[ring->depth - 1];
+}
+
+/** Reserve the next slot of a ring.
+ *
+ * @return Ring index of the reserved slot.
+ *
+ */
+static atomic_count_t log_slot_reserve(log_ring_t *ring, bool continuation)
+{
+	atomic_count_t index = atomic_postinc(&ring->head);
+	log_slot_t *slot = &ring->slots[index % LOG_RING_SLOTS];
+	
+	atomic_set(&slot->seq, 2 * index + 1);
+	write_barrier();
+	
+	slot->len = 0;
+	slot->continuation = continuation;
+	slot->chained = false;
+	
+	return index;
+}
+
+/** Get the length of a prefix of UTF-8 data not splitting any character.
+ *
+ * @param data Data to split, longer than max.
+ * @param max  Maximum length of the prefix.
+ *
+ * @return Length of the prefix.
+ *
+ */
+static size_t log_split(const uint8_t *data, size_t max)
+{
+	size_t split = max;
+	
+	/* Do not start the rest with a continuation byte */
+	while ((split > 0) && ((data[split] & 0xc0) == 0x80))
+		split--;
+	
+	return split;
+}
+
+/** Append data to the innermost entry open on a processor.
+ *
+ * When the last slot of the entry is full, another slot is reserved and
+ * chained to it. Data is split between slots only at character boundaries.
+ *
+ */
+static void log_slot_append(log_ring_t *ring, const uint8_t *data,
+    size_t len)
+{
+	log_open_t *entry = log_entry_current(ring);
+	if (entry == NULL)
+		return;
+	
+	if (len > LOG_ENTRY_MAX - entry->len) {
+		len = log_split(data, LOG_ENTRY_MAX - entry->len);
+		entry->truncated = true;
+	}
+	
+	while (len > 0) {
+		log_slot_t *slot = entry->last;
+		size_t chunk = len;
+		
+		if (chunk > LOG_SLOT_SIZE - slot->len) {
+			chunk = log_split(data, LOG_SLOT_SIZE - slot->len);
+			
+			/* Malformed data need not have any boundary */
+			if ((chunk == 0) && (slot->len == 0))
+				chunk = LOG_SLOT_SIZE;
+		}
+		
+		if (chunk == 0) {
+			slot->next = log_slot_reserve(ring, true);
+			slot->chained = true;
+			entry->last = &ring->slots[slot->next % LOG_RING_SLOTS];
+			continue;
+		}
+		
+		memcpy(slot->data + slot->len, data, chunk);
+		slot->len += chunk;
+		entry->len += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+}
+
 static size_t log_copy_from(uint8_t *data, size_t pos, size_t len) {
 	for (size_t i = 0; i < len; i++, pos = (pos + 1) % LOG_LENGTH) {
 		data[i] = log_buffer[pos];
@@ -141,12 +476,194 @@ static void log_append(const uint8_t *data, size_t len)
 	log_current_len += len;
 }
 
-/** Begin writing an entry to the log.
+/** Move one slot of an entry from a log ring to the log buffer.
+ *
+ * This function requires that the log_lock is acquired by the caller.
+ *
+ * @param ring       Log ring.
+ * @param index      Ring index of the slot.
+ * @param[out] next  Ring index of the next slot of the entry.
+ *
+ * @return True if the entry continues in another slot, false if this is
+ *         its last slot or if the slot has been reused for another entry.
  *
- * This acquires the log and output buffer locks, so only calls to log_* functions should
- * be used until calling log_end.
  */
-void log_begin(log_facility_t fac, log_level_t level)
+static bool log_merge_slot(log_ring_t *ring, atomic_count_t index,
+    atomic_count_t *next)
+{
+	log_slot_t *slot = &ring->slots[index % LOG_RING_SLOTS];
+	if ((atomic_count_t) atomic_get(&slot->seq) != 2 * index + 2)
+		return false;
+	
+	read_barrier();
+	
+	size_t len = min(slot->len, LOG_SLOT_SIZE);
+	bool continuation = slot->continuation;
+	bool chained = slot->chained;
+	*next = slot->next;
+	memcpy(log_merge_buffer, slot->data, len);
+	
+	read_barrier();
+	
+	/* The slot might have been reused while we were copying it */
+	if ((atomic_count_t) atomic_get(&slot->seq) != 2 * index + 2)
+		return false;
+	
+	log_append(log_merge_buffer, len);
+	
+	spinlock_lock(&kio_lock);
+	
+	size_t offset = continuation ? 0 : LOG_ENTRY_HEADER_LENGTH;
+	while (offset < len)
+		kio_push_char(str_decode((const char *) log_merge_buffer,
+		    &offset, len));
+	
+	spinlock_unlock(&kio_lock);
+	
+	return chained;
+}
+
+/** Move the oldest committed entry from the log rings to the log buffer.
+ *
+ * This function requires that the log_lock is acquired by the caller.
+ *
+ * @return True if an entry was merged or found to be overwritten, false if
+ *         there is no entry to merge or if the oldest one is still being
+ *         written.
+ *
+ */
+static bool log_merge_one(void)
+{
+	log_ring_t *oldest = NULL;
+	uint32_t oldest_counter = 0;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		log_ring_t *ring = log_rings[i];
+		atomic_count_t head = atomic_get(&ring->head);
+		
+		/* Skip entries overwritten by a writer which lapped us */
+		if (head - ring->tail > LOG_RING_SLOTS) {
+			ring->overwritten += head - ring->tail - LOG_RING_SLOTS;
+			ring->tail = head - LOG_RING_SLOTS;
+		}
+		
+		if (ring->tail == head)
+			continue;
+		
+		log_slot_t *slot = &ring->slots[ring->tail % LOG_RING_SLOTS];
+		native_t diff = (native_t) (atomic_get(&slot->seq) -
+		    (2 * ring->tail + 2));
+		
+		if (diff > 0) {
+			ring->overwritten++;
+			ring->tail++;
+			return true;
+		}
+		
+		/*
+		 * The entry is still being written. Entries with a higher
+		 * counter must not be merged before it.
+		 */
+		if (diff < 0)
+			return false;
+		
+		read_barrier();
+		
+		/* The entry this slot continues has already been merged */
+		if (slot->continuation) {
+			ring->tail++;
+			return true;
+		}
+		
+		uint32_t counter;
+		memcpy(&counter, slot->data + sizeof(size_t), sizeof(uint32_t));
+		
+		if ((oldest == NULL) ||
+		    ((int32_t) (counter - oldest_counter) < 0)) {
+			oldest = ring;
+			oldest_counter = counter;
+		}
+	}
+	
+	if (oldest == NULL)
+		return false;
+	
+	log_current_start = (log_start + log_used) % LOG_LENGTH;
+	log_current_len = 0;
+	
+	atomic_count_t index = oldest->tail++;
+	while (log_merge_slot(oldest, index, &index));
+	
+	if (log_current_len == 0) {
+		/* The first slot was reused while we were copying it */
+		oldest->overwritten++;
+		return true;
+	}
+	
+	/*
+	 * Set the length in the header to the correct value, a part of the
+	 * entry might have been overwritten.
+	 */
+	log_copy_to((uint8_t *) &log_current_len, log_current_start,
+	    sizeof(size_t));
+	log_used += log_current_len;
+	
+	spinlock_lock(&kio_lock);
+	kio_push_char('\n');
+	spinlock_unlock(&kio_lock);
+	
+	return true;
+}
+
+/** Merge the committed entries from the log rings and output them. */
+static void log_merge(void)
+{
+	spinlock_lock(&log_lock);
+	while (log_merge_one());
+	spinlock_unlock(&log_lock);
+	
+	kio_flush();
+	kio_update(NULL);
+	log_update(NULL);
+}
+
+/** Merge the per-processor log rings synchronously.
+ *
+ * Used on the halt path, where the klog thread will not run again.
+ *
+ */
+void log_drain(void)
+{
+	if (log_rings != NULL)
+		log_merge();
+}
+
+/** Kernel thread merging the per-processor log rings.
+ *
+ * @param arg Not used.
+ *
+ */
+void klog(void *arg)
+{
+	thread_detach(THREAD);
+	log_merging = true;
+	
+	while (true) {
+		waitq_sleep(&log_wq);
+		
+		atomic_set(&log_pending, 0);
+		memory_barrier();
+		
+		log_merge();
+	}
+}
+
+/** Begin writing an entry directly to the log buffer.
+ *
+ * This acquires the log and output buffer locks.
+ *
+ */
+static void log_direct_begin(log_facility_t fac, log_level_t level)
 {
 	spinlock_lock(&log_lock);
 	spinlock_lock(&kio_lock);
@@ -155,21 +672,22 @@ void log_begin(log_facility_t fac, log_level_t level)
 	log_current_len = 0;
 	
 	/* Write header of the log entry, the length will be written in log_end() */
+	uint32_t counter = atomic_postinc(&log_counter);
 	log_append((uint8_t *) &log_current_len, sizeof(size_t));
-	log_append((uint8_t *) &log_counter, sizeof(uint32_t));
+	log_append((uint8_t *) &counter, sizeof(uint32_t));
 	uint32_t fac32 = fac;
 	uint32_t lvl32 = level;
 	log_append((uint8_t *) &fac32, sizeof(uint32_t));
 	log_append((uint8_t *) &lvl32, sizeof(uint32_t));
-	
-	log_counter++;
 }
 
-/** Finish writing an entry to the log.
+/** Finish writing an entry directly to the log buffer.
  *
  * This releases the log and output buffer locks.
+ *
  */
-void log_end(void) {
+static void log_direct_end(void)
+{
 	/* Set the length in the header to correct value */
 	log_copy_to((uint8_t *) &log_current_len, log_current_start, sizeof(size_t));
 	log_used += log_current_len;
@@ -184,6 +702,125 @@ void log_end(void) {
 	log_update(NULL);
 }
 
+/** Begin writing an entry to the log.
+ *
+ * Only calls to log_* functions should be used until calling log_end.
+ * Preemption is disabled until then.
+ *
+ */
+void log_begin(log_facility_t fac, log_level_t level)
+{
+	preemption_disable();
+	
+	/*
+	 * While halting, the klog thread may never merge the rings again and
+	 * waking it up might deadlock, so entries bypass the rings.
+	 */
+	log_ring_t *ring = log_ring_current();
+	if ((ring == NULL) || (ring->direct > 0) || (atomic_get(&haltstate))) {
+		log_direct_begin(fac, level);
+		if (ring != NULL)
+			ring->direct++;
+		
+		preemption_enable();
+		return;
+	}
+	
+	/* An interrupt handler may open and end an entry at any point here */
+	size_t depth = ring->depth++;
+	compiler_barrier();
+	
+	if (depth >= LOG_NESTING) {
+		atomic_inc(&ring->dropped);
+		return;
+	}
+	
+	atomic_count_t index = log_slot_reserve(ring, false);
+	log_slot_t *slot = &ring->slots[index % LOG_RING_SLOTS];
+	
+	/* Write the header, the length will be written in log_end() */
+	uint32_t counter = atomic_postinc(&log_counter);
+	uint32_t fac32 = fac;
+	uint32_t lvl32 = level;
+	uint8_t *header = slot->data + sizeof(size_t);
+	memcpy(header, &counter, sizeof(uint32_t));
+	memcpy(header + sizeof(uint32_t), &fac32, sizeof(uint32_t));
+	memcpy(header + 2 * sizeof(uint32_t), &lvl32, sizeof(uint32_t));
+	
+	slot->len = LOG_ENTRY_HEADER_LENGTH;
+	
+	ring->open[depth].first = slot;
+	ring->open[depth].last = slot;
+	ring->open[depth].len = LOG_ENTRY_HEADER_LENGTH;
+	ring->open[depth].truncated = false;
+}
+
+/** Finish writing an entry to the log.
+ *
+ * The entry is committed to the ring of the current processor and the klog
+ * thread is woken up to merge it. While halting, the rings are merged
+ * synchronously instead.
+ *
+ */
+void log_end(void)
+{
+	log_ring_t *ring = log_ring_current();
+	if ((ring == NULL) || (ring->direct > 0)) {
+		if (ring != NULL)
+			ring->direct--;
+		
+		log_direct_end();
+		return;
+	}
+	
+	assert(ring->depth > 0);
+	
+	log_open_t *entry = log_entry_current(ring);
+	if (entry != NULL) {
+		/* Set the length in the header to correct value */
+		memcpy(entry->first->data, &entry->len, sizeof(size_t));
+		
+		if (entry->truncated)
+			atomic_inc(&ring->truncated);
+		
+		write_barrier();
+		
+		/*
+		 * Commit the continuation slots first so that the whole entry
+		 * is complete once its first slot is committed.
+		 */
+		for (log_slot_t *slot = entry->first; slot->chained; ) {
+			slot = &ring->slots[slot->next % LOG_RING_SLOTS];
+			atomic_set(&slot->seq, atomic_get(&slot->seq) + 1);
+		}
+		
+		write_barrier();
+		
+		log_slot_t *first = entry->first;
+		atomic_set(&first->seq, atomic_get(&first->seq) + 1);
+	}
+	
+	compiler_barrier();
+	ring->depth--;
+	preemption_enable();
+	
+	if ((!log_merging) || (atomic_get(&haltstate))) {
+		/* The klog thread is not running yet or will not run again */
+		log_merge();
+		return;
+	}
+	
+	/*
+	 * Pairs with the barrier in klog() so that either the klog thread
+	 * sees the committed entry or we see that log_pending was reset.
+	 */
+	memory_barrier();
+	
+	if ((atomic_get(&log_pending) == 0) &&
+	    (atomic_postinc(&log_pending) == 0))
+		waitq_wakeup(&log_wq, WAKEUP_FIRST);
+}
+
 static void log_update(void *event)
 {
 	if (!atomic_get(&log_inited))
@@ -197,6 +834,12 @@ static void log_update(void *event)
 
 static int log_printf_str_write(const char *str, size_t size, void *data)
 {
+	log_ring_t *ring = log_ring_entry();
+	if (ring != NULL) {
+		log_slot_append(ring, (const uint8_t *) str, size);
+		return str_nlength(str, size);
+	}
+	
 	size_t offset = 0;
 	size_t chars = 0;
 	
@@ -216,8 +859,11 @@ static int log_printf_wstr_write(const wchar_t *wstr, size_t size, void *data)
 	size_t offset = 0;
 	size_t chars = 0;
 	
+	log_ring_t *ring = log_ring_entry();
+	
 	for (offset = 0; offset < size; offset += sizeof(wchar_t), chars++) {
-		kio_push_char(wstr[chars]);
+		if (ring == NULL)
+			kio_push_char(wstr[chars]);
 		
 		size_t buffer_offset = 0;
 		errno_t rc = chr_encode(wstr[chars], buffer, &buffer_offset, 16);
@@ -225,7 +871,11 @@ static int log_printf_wstr_write(const wchar_t *wstr, size_t size, void *data)
 			return EOF;
 		}
 		
-		log_append((const uint8_t *)buffer, buffer_offset);
+		if (ring != NULL)
+			log_slot_append(ring, (const uint8_t *) buffer,
+			    buffer_offset);
+		else
+			log_append((const uint8_t *)buffer, buffer_offset);
 	}
 	
 	return chars;
@@ -58,6 +58,7 @@
 #include <mm/as.h>
 #include <mm/frame.h>
 #include <mm/km.h>
+#include <mm/zpool.h>
 #include <print.h>
 #include <log.h>
 #include <mem.h>
@@ -161,6 +162,22 @@ void kinit(void *arg)
 	 */
 	ARCH_OP(post_smp_init);
 	
+	/* Start thread merging the per-processor kernel log rings */
+	thread = thread_create(klog, NULL, TASK, THREAD_FLAG_NONE, "klog");
+	if (thread != NULL)
+		thread_ready(thread);
+	else
+		log(LF_OTHER, LVL_ERROR, "Unable to create klog thread");
+	
+	/* Start thread pre-zeroing frames in idle time */
+	zpool_init();
+	thread = thread_create(kzpool, NULL, TASK, THREAD_FLAG_NONE,
+	    "kzpool");
+	if (thread != NULL)
+		thread_ready(thread);
+	else
+		log(LF_OTHER, LVL_ERROR, "Unable to create kzpool thread");
+	
 	/* Start thread computing system load */
 	thread = thread_create(kload, NULL, TASK, THREAD_FLAG_NONE,
 	    "kload");
@@ -262,7 +279,8 @@ void kinit(void *arg)
 				 */
 				perm_set(programs[i].task,
 				    PERM_PERM | PERM_MEM_MANAGER |
-				    PERM_IO_MANAGER | PERM_IRQ_REG);
+				    PERM_IO_MANAGER | PERM_IRQ_REG |
+				    PERM_PROFILE);
 				
 				if (!ipc_phone_0) {
 					ipc_phone_0 = &programs[i].task->answerbox;
@@ -91,6 +91,8 @@
 #include <ipc/event.h>
 #include <sysinfo/sysinfo.h>
 #include <sysinfo/stats.h>
+#include <prof.h>
+#include <tracepoint.h>
 #include <lib/ra.h>
 #include <cap/cap.h>
 
@@ -298,6 +300,8 @@ void main_bsp_separated_stack(void)
 	kio_init();
 	log_init();
 	stats_init();
+	prof_init();
+	tracepoint_init();
 	
 	/*
 	 * Create kernel task.
@@ -52,6 +52,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/tlb.h>
+#include <cpu/cpu_mask.h>
 #include <arch/mm/page.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
@@ -79,6 +80,8 @@
 #include <syscall/copy.h>
 #include <arch/interrupt.h>
 #include <interrupt.h>
+#include <tracepoint.h>
+#include <sysinfo/stats.h>
 
 /**
  * Each architecture decides what functions will be used to carry out
@@ -91,6 +94,11 @@ as_operations_t *as_operations = NULL;
  */
 static slab_cache_t *as_cache;
 
+/** Slab for as_area_t objects.
+ *
+ */
+static slab_cache_t *as_area_cache;
+
 /** ASID subsystem lock.
  *
  * This lock protects:
@@ -110,6 +118,19 @@ LIST_INITIALIZE(inactive_as_with_asid_list);
 /** Kernel address space. */
 as_t *AS_KERNEL = NULL;
 
+/** Maximum number of pages populated by a single page fault.
+ *
+ * Can be changed from the kernel console, 1 disables fault-around.
+ * Never exceeds FAULT_AROUND_MAX.
+ */
+size_t fault_around_max = FAULT_AROUND_DEFAULT;
+
+/** Number of page faults serviced by the memory backends. */
+atomic_t as_page_faults;
+
+/** Number of pages populated ahead of the faulting page. */
+atomic_t as_fault_around_pages;
+
 NO_TRACE static errno_t as_constructor(void *obj, unsigned int flags)
 {
 	as_t *as = (as_t *) obj;
@@ -133,6 +154,9 @@ void as_init(void)
 	as_cache = slab_cache_create("as_t", sizeof(as_t), 0,
 	    as_constructor, as_destructor, SLAB_CACHE_MAGDEFERRED);
 	
+	as_area_cache = slab_cache_create("as_area_t", sizeof(as_area_t), 0,
+	    NULL, NULL, SLAB_CACHE_MAGDEFERRED);
+	
 	AS_KERNEL = as_create(FLAG_AS_KERNEL);
 	if (!AS_KERNEL)
 		panic("Cannot create kernel address space.");
@@ -156,11 +180,19 @@ as_t *as_create(unsigned int flags)
 	(void) as_create_arch(as, 0);
 	
 	btree_create(&as->as_area_btree);
+	as->pages = 0;
+	as->resident = 0;
+	as->stats_generation = 0;
+	as->stats_owner = NULL;
 	
-	if (flags & FLAG_AS_KERNEL)
+	if (flags & FLAG_AS_KERNEL) {
 		as->asid = ASID_KERNEL;
-	else
+		as->cpu_mask = NULL;
+	} else {
 		as->asid = ASID_INVALID;
+		as->cpu_mask = malloc(cpu_mask_size(), 0);
+		cpu_mask_none(as->cpu_mask);
+	}
 	
 	atomic_set(&as->refcount, 0);
 	as->cpu_refcount = 0;
@@ -253,6 +285,9 @@ retry:
 	page_table_destroy(NULL);
 #endif
 	
+	if (as->cpu_mask)
+		free(as->cpu_mask);
+	
 	slab_free(as_cache, as);
 }
 
@@ -619,7 +654,7 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 		return NULL;
 	}
 	
-	as_area_t *area = (as_area_t *) malloc(sizeof(as_area_t), 0);
+	as_area_t *area = (as_area_t *) slab_alloc(as_area_cache, 0);
 	
 	mutex_initialize(&area->lock, MUTEX_PASSIVE);
 	
@@ -631,6 +666,8 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 	area->base = *base;
 	area->backend = backend;
 	area->sh_info = NULL;
+	area->fault_next = 0;
+	area->fault_window = 0;
 	
 	if (backend_data)
 		area->backend_data = *backend_data;
@@ -657,7 +694,7 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 	
 		if (area->backend && area->backend->create_shared_data) {
 			if (!area->backend->create_shared_data(area)) {
-				free(area);
+				slab_free(as_area_cache, area);
 				mutex_unlock(&as->lock);
 				sh_info_remove_reference(si);
 				return NULL;
@@ -667,7 +704,7 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 
 	if (area->backend && area->backend->create) {
 		if (!area->backend->create(area)) {
-			free(area);
+			slab_free(as_area_cache, area);
 			mutex_unlock(&as->lock);
 			if (!(attrs & AS_AREA_ATTR_PARTIAL))
 				sh_info_remove_reference(si);
@@ -679,6 +716,9 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 	btree_insert(&as->as_area_btree, *base, (void *) area,
 	    NULL);
 	
+	as->pages += pages;
+	stats_as_changed(as);
+	
 	mutex_unlock(&as->lock);
 	
 	return area;
@@ -747,6 +787,54 @@ NO_TRACE static as_area_t *find_area_and_lock(as_t *as, uintptr_t va)
 	return NULL;
 }
 
+/** Remove the mapping of a used page of an address space area.
+ *
+ * If the page is the first page of a large page mapping, the whole large
+ * page is removed at once instead of being split. The frames of the removed
+ * pages are either stored in the frames array or, if it is NULL, passed to
+ * the frame_free() operation of the area backend.
+ *
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as     Address space.
+ * @param area   Address space area to which the page belongs.
+ * @param page   Virtual address of the page.
+ * @param frames Array for storing the frames of the removed pages or NULL.
+ *
+ * @return Number of pages whose mappings have been removed.
+ *
+ */
+NO_TRACE static size_t area_page_remove(as_t *as, as_area_t *area,
+    uintptr_t page, uintptr_t *frames)
+{
+	uintptr_t frame;
+	size_t count = page_mapping_remove_large(as, page, &frame);
+	
+	if (count == 0) {
+		pte_t pte;
+		bool found = page_mapping_find(as, page, false, &pte);
+		
+		assert(found);
+		assert(PTE_VALID(&pte));
+		assert(PTE_PRESENT(&pte));
+		
+		frame = PTE_GET_FRAME(&pte);
+		page_mapping_remove(as, page);
+		count = 1;
+	}
+	
+	for (size_t i = 0; i < count; i++) {
+		if (frames) {
+			frames[i] = frame + P2SZ(i);
+		} else if ((area->backend) && (area->backend->frame_free)) {
+			area->backend->frame_free(area, page + P2SZ(i),
+			    frame + P2SZ(i));
+		}
+	}
+	
+	return count;
+}
+
 /** Find address space area and change it.
  *
  * @param as      Address space.
@@ -817,6 +905,13 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 		
 		page_table_lock(as, false);
 		
+		/*
+		 * Large pages must not be split within the TLB shootdown
+		 * sequence below. Only the one crossing the new end of the
+		 * area needs to be, the others are removed as a whole.
+		 */
+		page_mapping_split(as, start_free, area->pages - pages);
+		
 		/*
 		 * Remove frames belonging to used space starting from
 		 * the highest addresses downwards until an overlap with
@@ -883,28 +978,16 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 				 * forbidden and would hit a kernel assertion.
 				 */
 
-				ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES,
-				    as->asid, area->base + P2SZ(pages),
+				ipl_t ipl = tlb_shootdown_start(as->cpu_mask,
+				    TLB_INVL_PAGES, as->asid,
+				    area->base + P2SZ(pages),
 				    area->pages - pages);
 		
-				for (; i < node_size; i++) {
-					pte_t pte;
-					bool found = page_mapping_find(as,
-					    ptr + P2SZ(i), false, &pte);
-					
-					assert(found);
-					assert(PTE_VALID(&pte));
-					assert(PTE_PRESENT(&pte));
-					
-					if ((area->backend) &&
-					    (area->backend->frame_free)) {
-						area->backend->frame_free(area,
-						    ptr + P2SZ(i),
-						    PTE_GET_FRAME(&pte));
-					}
-					
-					page_mapping_remove(as, ptr + P2SZ(i));
+				while (i < node_size) {
+					i += area_page_remove(as, area,
+					    ptr + P2SZ(i), NULL);
 				}
+				assert(i == node_size);
 		
 				/*
 				 * Finish TLB shootdown sequence.
@@ -952,6 +1035,9 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 		}
 	}
 	
+	as->pages = as->pages - area->pages + pages;
+	stats_as_changed(as);
+	
 	area->pages = pages;
 	
 	mutex_unlock(&area->lock);
@@ -988,8 +1074,8 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_start(as->cpu_mask, TLB_INVL_PAGES, as->asid,
+	    area->base, area->pages);
 	
 	/*
 	 * Visit only the pages mapped by used_space B+tree.
@@ -1002,24 +1088,12 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 			uintptr_t ptr = node->key[i];
 			size_t size;
 			
-			for (size = 0; size < (size_t) node->value[i]; size++) {
-				pte_t pte;
-				bool found = page_mapping_find(as,
-				     ptr + P2SZ(size), false, &pte);
-				
-				assert(found);
-				assert(PTE_VALID(&pte));
-				assert(PTE_PRESENT(&pte));
-				
-				if ((area->backend) &&
-				    (area->backend->frame_free)) {
-					area->backend->frame_free(area,
-					    ptr + P2SZ(size),
-					    PTE_GET_FRAME(&pte));
-				}
-				
-				page_mapping_remove(as, ptr + P2SZ(size));
+			size = 0;
+			while (size < (size_t) node->value[i]) {
+				size += area_page_remove(as, area,
+				    ptr + P2SZ(size), NULL);
 			}
+			assert(size == (size_t) node->value[i]);
 		}
 	}
 	
@@ -1040,6 +1114,10 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	
 	btree_destroy(&area->used_space);
 	
+	as->pages -= area->pages;
+	as->resident -= area->resident;
+	stats_as_changed(as);
+	
 	area->attributes |= AS_AREA_ATTR_PARTIAL;
 	
 	sh_info_remove_reference(area->sh_info);
@@ -1051,7 +1129,7 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	 */
 	btree_remove(&as->as_area_btree, base, NULL);
 	
-	free(area);
+	slab_free(as_area_cache, area);
 	
 	mutex_unlock(&as->lock);
 	return 0;
@@ -1207,6 +1285,66 @@ NO_TRACE bool as_area_check_access(as_area_t *area, pf_access_t access)
 	return true;
 }
 
+/** Compute the fault-around window for a page fault.
+ *
+ * The window starts at the faulting page. It doubles while the faults hit
+ * the page right after the previous window (i.e. the area is being accessed
+ * sequentially) and collapses to the single faulting page otherwise.
+ * The window never extends past the end of the area nor past the naturally
+ * aligned block of FAULT_AROUND_MAX pages containing the faulting page,
+ * so that all its pages live in the same leaf page table.
+ *
+ * @param area  Address space area. Must be locked.
+ * @param upage Faulting virtual page.
+ *
+ * @return Number of pages, starting at @a upage, that the backend should
+ *         populate. Always at least one.
+ *
+ */
+size_t as_area_fault_window(as_area_t *area, uintptr_t upage)
+{
+	assert(mutex_locked(&area->lock));
+	assert(upage >= area->base);
+	
+	size_t limit = min(fault_around_max, FAULT_AROUND_MAX);
+	size_t window = 1;
+	
+	if ((upage == area->fault_next) && (limit > 1))
+		window = min(max(area->fault_window * 2, 2), limit);
+	
+	size_t page_idx = (upage - area->base) >> PAGE_WIDTH;
+	size_t block_left = FAULT_AROUND_MAX -
+	    ((upage >> PAGE_WIDTH) & (FAULT_AROUND_MAX - 1));
+	size_t count = min(window, min(block_left, area->pages - page_idx));
+	
+	area->fault_window = window;
+	area->fault_next = upage + P2SZ(count);
+	
+	return count;
+}
+
+/** Check whether a page of an address space area is already mapped.
+ *
+ * Used by the backends to skip pages of a fault-around window that
+ * have been populated before.
+ *
+ * @param area Address space area. Must be locked together with
+ *             the page tables.
+ * @param page Virtual page.
+ *
+ * @return True if the page is mapped and present.
+ *
+ */
+bool as_area_page_present(as_area_t *area, uintptr_t page)
+{
+	pte_t pte;
+	
+	assert(page_table_locked(area->as));
+	
+	return page_mapping_find(area->as, page, false, &pte) &&
+	    PTE_PRESENT(&pte);
+}
+
 /** Convert address space area flags to page flags.
  *
  * @param aflags Flags of some address space area.
@@ -1298,8 +1436,8 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_start(as->cpu_mask, TLB_INVL_PAGES, as->asid,
+	    area->base, area->pages);
 	
 	/*
 	 * Remove used pages from page tables and remember their frame
@@ -1315,20 +1453,15 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 			uintptr_t ptr = node->key[i];
 			size_t size;
 			
-			for (size = 0; size < (size_t) node->value[i]; size++) {
-				pte_t pte;
-				bool found = page_mapping_find(as,
-				    ptr + P2SZ(size), false, &pte);
-				
-				assert(found);
-				assert(PTE_VALID(&pte));
-				assert(PTE_PRESENT(&pte));
-				
-				old_frame[frame_idx++] = PTE_GET_FRAME(&pte);
+			size = 0;
+			while (size < (size_t) node->value[i]) {
+				size_t count = area_page_remove(as, area,
+				    ptr + P2SZ(size), &old_frame[frame_idx]);
 				
-				/* Remove old mapping */
-				page_mapping_remove(as, ptr + P2SZ(size));
+				frame_idx += count;
+				size += count;
 			}
+			assert(size == (size_t) node->value[i]);
 		}
 	}
 	
@@ -1410,6 +1543,8 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 {
 	uintptr_t page = ALIGN_DOWN(address, PAGE_SIZE);
 	int rc = AS_PF_FAULT;
+	
+	TRACEPOINT(TP_PAGE_FAULT, address, access);
 
 	if (!THREAD)
 		goto page_fault;
@@ -1471,6 +1606,9 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 	 * Resort to the backend page fault handler.
 	 */
 	rc = area->backend->page_fault(area, page, access);
+	atomic_inc(&as_page_faults);
+	atomic_inc(&TASK->page_faults);
+	stats_task_changed(&TASK->stats_changes);
 	if (rc != AS_PF_OK) {
 		page_table_unlock(AS, false);
 		mutex_unlock(&area->lock);
@@ -1572,6 +1710,13 @@ retry:
 			new_as->asid = asid_get();
 	}
 	
+	/*
+	 * Make sure that TLB shootdowns of the new address space will not miss
+	 * this processor before it can cache any of its translations.
+	 */
+	if (new_as->cpu_mask)
+		tlb_shootdown_track(new_as->cpu_mask);
+	
 #ifdef AS_PAGE_TABLE
 	SET_PTL0_ADDRESS(new_as->genarch.page_table);
 #endif
@@ -1712,7 +1857,7 @@ size_t as_area_get_size(uintptr_t base)
 
 /** Mark portion of address space area as used.
  *
- * The address space area must be already locked.
+ * The address space area and its address space must be already locked.
  *
  * @param area  Address space area.
  * @param page  First page to be marked.
@@ -1993,14 +2138,63 @@ bool used_space_insert(as_area_t *area, uintptr_t page, size_t count)
 	
 success:
 	area->resident += count;
+	area->as->resident += count;
+	stats_as_changed(area->as);
 	return true;
 }
 
-/** Mark portion of address space area as unused.
+/** Check whether a portion of address space area is at least partially used.
+ *
+ * Only the intervals adjacent to the position of @a page in the B+tree can
+ * intersect the given range, so at most the leaf and its two neighbours are
+ * examined.
  *
  * The address space area must be already locked.
  *
  * @param area  Address space area.
+ * @param page  First page of the range.
+ * @param count Number of pages in the range.
+ *
+ * @return True if any page of the range is marked as used.
+ *
+ */
+bool used_space_overlaps(as_area_t *area, uintptr_t page, size_t count)
+{
+	assert(mutex_locked(&area->lock));
+	assert(IS_ALIGNED(page, PAGE_SIZE));
+	assert(count);
+
+	btree_node_t *leaf = NULL;
+	if (btree_search(&area->used_space, page, &leaf))
+		return true;
+
+	assert(leaf != NULL);
+
+	for (size_t i = 0; i < leaf->keys; i++) {
+		if (overlaps(page, P2SZ(count), leaf->key[i],
+		    P2SZ((size_t) leaf->value[i])))
+			return true;
+	}
+
+	btree_node_t *node = btree_leaf_node_left_neighbour(&area->used_space,
+	    leaf);
+	if ((node) && (overlaps(page, P2SZ(count), node->key[node->keys - 1],
+	    P2SZ((size_t) node->value[node->keys - 1]))))
+		return true;
+
+	node = btree_leaf_node_right_neighbour(&area->used_space, leaf);
+	if ((node) && (overlaps(page, P2SZ(count), node->key[0],
+	    P2SZ((size_t) node->value[0]))))
+		return true;
+
+	return false;
+}
+
+/** Mark portion of address space area as unused.
+ *
+ * The address space area and its address space must be already locked.
+ *
+ * @param area  Address space area.
  * @param page  First page to be marked.
  * @param count Number of page to be marked.
  *
@@ -2176,6 +2370,8 @@ error:
 	
 success:
 	area->resident -= count;
+	area->as->resident -= count;
+	stats_as_changed(area->as);
 	return true;
 }
 
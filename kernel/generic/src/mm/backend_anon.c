@@ -45,6 +45,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/km.h>
+#include <mm/zpool.h>
 #include <synch/mutex.h>
 #include <adt/list.h>
 #include <adt/btree.h>
@@ -174,29 +175,20 @@ bool anon_is_shareable(as_area_t *area)
 	return !(area->flags & AS_AREA_LATE_RESERVE);
 }
 
-/** Service a page fault in the anonymous memory address space area.
+/** Allocate, clear and map one page of the anonymous memory area.
  *
  * The address space area and page tables must be already locked.
  *
  * @param area Pointer to the address space area.
- * @param upage Faulting virtual page.
- * @param access Access mode that caused the fault (i.e. read/write/exec).
+ * @param upage Virtual page to populate.
  *
- * @return AS_PF_FAULT on failure (i.e. page fault) or AS_PF_OK on success (i.e.
- *     serviced).
+ * @return AS_PF_OK on success or AS_PF_SILENT if the late reservation
+ *     of memory for the page failed.
  */
-int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
+static int anon_page_populate(as_area_t *area, uintptr_t upage)
 {
-	uintptr_t kpage;
 	uintptr_t frame;
 
-	assert(page_table_locked(AS));
-	assert(mutex_locked(&area->lock));
-	assert(IS_ALIGNED(upage, PAGE_SIZE));
-
-	if (!as_area_check_access(area, access))
-		return AS_PF_FAULT;
-
 	mutex_lock(&area->sh_info->lock);
 	if (area->sh_info->shared) {
 		btree_node_t *leaf;
@@ -225,10 +217,7 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 				}
 			}
 			if (allocate) {
-				kpage = km_temporary_page_get(&frame,
-				    FRAME_NO_RESERVE);
-				memsetb((void *) kpage, PAGE_SIZE, 0);
-				km_temporary_page_put(kpage);
+				frame = zpool_frame_alloc(FRAME_NO_RESERVE);
 				
 				/*
 				 * Insert the address of the newly allocated
@@ -266,9 +255,7 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 			}
 		}
 
-		kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
-		memsetb((void *) kpage, PAGE_SIZE, 0);
-		km_temporary_page_put(kpage);
+		frame = zpool_frame_alloc(FRAME_NO_RESERVE);
 	}
 	mutex_unlock(&area->sh_info->lock);
 	
@@ -284,6 +271,123 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	return AS_PF_OK;
 }
 
+/** Try to map the whole large page around a faulting page at once.
+ *
+ * This is possible only when the page table implementation supports large
+ * pages, the large page fits into the area entirely and none of its pages
+ * has been populated yet. The area must not be shared because the pagemap
+ * tracks individual frames and it must not use late reservation because
+ * that reserves memory page by page. As the memory for the whole area has
+ * already been reserved when the area was created, no reservation is taken
+ * for the contiguous frames here.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area  Pointer to the address space area.
+ * @param upage Faulting virtual page.
+ *
+ * @return True if the large page has been mapped.
+ *
+ */
+static bool anon_page_populate_large(as_area_t *area, uintptr_t upage)
+{
+	size_t size = page_mapping_large_size();
+	if (size == 0)
+		return false;
+	
+	if (area->flags & AS_AREA_LATE_RESERVE)
+		return false;
+	
+	uintptr_t base = ALIGN_DOWN(upage, size);
+	if ((base < area->base) ||
+	    (base + size > area->base + P2SZ(area->pages)))
+		return false;
+	
+	size_t count = size >> PAGE_WIDTH;
+	if (used_space_overlaps(area, base, count))
+		return false;
+	
+	mutex_lock(&area->sh_info->lock);
+	bool shared = area->sh_info->shared;
+	mutex_unlock(&area->sh_info->lock);
+	if (shared)
+		return false;
+	
+	/*
+	 * The frames come from the identity-mapped low memory so that they
+	 * can be cleared without creating a temporary mapping.
+	 */
+	uintptr_t frame = frame_alloc(count, FRAME_ATOMIC | FRAME_NO_RECLAIM |
+	    FRAME_NO_RESERVE | FRAME_LOWMEM, size - 1);
+	if (!frame)
+		return false;
+	
+	memsetb((void *) PA2KA(frame), size, 0);
+	
+	if (!page_mapping_insert_large(AS, base, frame,
+	    as_area_get_flags(area))) {
+		frame_free_noreserve(frame, count);
+		return false;
+	}
+	
+	if (!used_space_insert(area, base, count))
+		panic("Cannot insert used space.");
+	
+	return true;
+}
+
+/** Service a page fault in the anonymous memory address space area.
+ *
+ * If possible, the whole large page containing the faulting page is mapped.
+ * Otherwise, besides the faulting page, the pages of the fault-around window
+ * that are not mapped yet are populated as well. Failing to populate any of
+ * them is not an error, the remaining pages are simply left for later
+ * faults.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area Pointer to the address space area.
+ * @param upage Faulting virtual page.
+ * @param access Access mode that caused the fault (i.e. read/write/exec).
+ *
+ * @return AS_PF_FAULT on failure (i.e. page fault) or AS_PF_OK on success (i.e.
+ *     serviced).
+ */
+int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
+{
+	size_t count;
+	size_t i;
+	int rc;
+
+	assert(page_table_locked(AS));
+	assert(mutex_locked(&area->lock));
+	assert(IS_ALIGNED(upage, PAGE_SIZE));
+
+	if (!as_area_check_access(area, access))
+		return AS_PF_FAULT;
+
+	if (anon_page_populate_large(area, upage))
+		return AS_PF_OK;
+
+	count = as_area_fault_window(area, upage);
+
+	rc = anon_page_populate(area, upage);
+	if (rc != AS_PF_OK)
+		return rc;
+
+	for (i = 1; i < count; i++) {
+		uintptr_t page = upage + P2SZ(i);
+
+		if (as_area_page_present(area, page))
+			continue;
+		if (anon_page_populate(area, page) != AS_PF_OK)
+			break;
+		atomic_inc(&as_fault_around_pages);
+	}
+
+	return AS_PF_OK;
+}
+
 /** Free a frame that is backed by the anonymous memory backend.
  *
  * The address space area and page tables must be already locked.
@@ -44,6 +44,7 @@
 #include <mm/page.h>
 #include <mm/reserve.h>
 #include <mm/km.h>
+#include <mm/zpool.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
 #include <align.h>
@@ -236,19 +237,17 @@ bool elf_is_shareable(as_area_t *area)
 }
 
 
-/** Service a page fault in the ELF backend address space area.
+/** Populate and map one page of the ELF backend address space area.
  *
  * The address space area and page tables must be already locked.
  *
  * @param area		Pointer to the address space area.
- * @param upage		Faulting virtual page.
- * @param access	Access mode that caused the fault (i.e.
- * 			read/write/exec).
+ * @param upage		Virtual page to populate.
  *
- * @return		AS_PF_FAULT on failure (i.e. page fault) or AS_PF_OK
- * 			on success (i.e. serviced).
+ * @return		AS_PF_FAULT if the page lies outside of the segment,
+ * 			AS_PF_OK on success.
  */
-int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
+static int elf_page_populate(as_area_t *area, uintptr_t upage)
 {
 	elf_header_t *elf = area->backend_data.elf;
 	elf_segment_header_t *entry = area->backend_data.segment;
@@ -260,13 +259,6 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	size_t i;
 	bool dirty = false;
 
-	assert(page_table_locked(AS));
-	assert(mutex_locked(&area->lock));
-	assert(IS_ALIGNED(upage, PAGE_SIZE));
-
-	if (!as_area_check_access(area, access))
-		return AS_PF_FAULT;
-	
 	if (upage < ALIGN_DOWN(entry->p_vaddr, PAGE_SIZE))
 		return AS_PF_FAULT;
 	
@@ -356,9 +348,7 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		 * To resolve the situation, a frame must be allocated
 		 * and cleared.
 		 */
-		kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
-		memsetb((void *) kpage, PAGE_SIZE, 0);
-		km_temporary_page_put(kpage);
+		frame = zpool_frame_alloc(FRAME_NO_RESERVE);
 		dirty = true;
 	} else {
 		size_t pad_lo, pad_hi;
@@ -408,6 +398,54 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	return AS_PF_OK;
 }
 
+/** Service a page fault in the ELF backend address space area.
+ *
+ * Besides the faulting page, the pages of the fault-around window that
+ * are not mapped yet are populated as well, as long as they lie within
+ * the segment.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area		Pointer to the address space area.
+ * @param upage		Faulting virtual page.
+ * @param access	Access mode that caused the fault (i.e.
+ * 			read/write/exec).
+ *
+ * @return		AS_PF_FAULT on failure (i.e. page fault) or AS_PF_OK
+ * 			on success (i.e. serviced).
+ */
+int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
+{
+	size_t count;
+	size_t i;
+	int rc;
+
+	assert(page_table_locked(AS));
+	assert(mutex_locked(&area->lock));
+	assert(IS_ALIGNED(upage, PAGE_SIZE));
+
+	if (!as_area_check_access(area, access))
+		return AS_PF_FAULT;
+
+	count = as_area_fault_window(area, upage);
+
+	rc = elf_page_populate(area, upage);
+	if (rc != AS_PF_OK)
+		return rc;
+
+	for (i = 1; i < count; i++) {
+		uintptr_t page = upage + P2SZ(i);
+
+		if (as_area_page_present(area, page))
+			continue;
+		if (elf_page_populate(area, page) != AS_PF_OK)
+			break;
+		atomic_inc(&as_fault_around_pages);
+	}
+
+	return AS_PF_OK;
+}
+
 /** Free a frame that is backed by the ELF backend.
  *
  * The address space area and page tables must be already locked.
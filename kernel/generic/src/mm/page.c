@@ -77,6 +77,15 @@
 /** Virtual operations for page subsystem. */
 page_mapping_operations_t *page_mapping_operations = NULL;
 
+/** Whether the memory backends may map large pages. */
+bool page_large_enabled = true;
+
+/** Number of large page mappings created so far. */
+atomic_t page_large_mappings;
+
+/** Number of large page mappings split into regular pages so far. */
+atomic_t page_large_demotions;
+
 void page_init(void)
 {
 	page_arch_init();
@@ -189,6 +198,134 @@ void page_mapping_make_global(uintptr_t base, size_t size)
 	return page_mapping_operations->mapping_make_global(base, size);
 }
 
+/** Get the size of a large page.
+ *
+ * @return Size of a large page in bytes or zero if large page mappings are
+ *         not supported or have been disabled.
+ *
+ */
+size_t page_mapping_large_size(void)
+{
+	assert(page_mapping_operations);
+	
+	if ((!page_large_enabled) ||
+	    (!page_mapping_operations->mapping_insert_large))
+		return 0;
+	
+	return page_mapping_operations->large_page_size;
+}
+
+/** Insert a large page mapping.
+ *
+ * Map a whole large page using a single page table entry. The mapping
+ * behaves as page_mapping_large_size() / PAGE_SIZE regular mappings of
+ * consecutive frames and is transparently split into them as soon as any
+ * of them is removed.
+ *
+ * @param as    Address space to which the large page belongs.
+ * @param page  Virtual address of the large page, aligned to its size.
+ * @param frame Physical address of the first of the contiguous frames,
+ *              aligned to the size of the large page.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the mapping was inserted, false if there already are
+ *         some mappings in the range.
+ *
+ */
+NO_TRACE bool page_mapping_insert_large(as_t *as, uintptr_t page,
+    uintptr_t frame, unsigned int flags)
+{
+	assert(page_table_locked(as));
+	
+	assert(page_mapping_operations);
+	assert(page_mapping_operations->mapping_insert_large);
+	assert(IS_ALIGNED(page, page_mapping_operations->large_page_size));
+	assert(IS_ALIGNED(frame, page_mapping_operations->large_page_size));
+	
+	if (!page_mapping_operations->mapping_insert_large(as, page, frame,
+	    flags))
+		return false;
+	
+	atomic_inc(&page_large_mappings);
+	
+	/* Repel prefetched accesses to the old mapping. */
+	memory_barrier();
+	return true;
+}
+
+/** Split large page mappings crossing the boundaries of a range of pages.
+ *
+ * Removing a single page from a large page mapping requires splitting it,
+ * which needs to allocate a page table. Callers about to remove mappings
+ * within the TLB shootdown sequence, where blocking is forbidden, split the
+ * large pages covered by the range only partially beforehand. Large pages
+ * lying entirely inside the range are left intact, the callers remove them
+ * using page_mapping_remove_large().
+ *
+ * @param as    Address space to which the pages belong.
+ * @param page  First page of the range.
+ * @param count Number of pages in the range.
+ *
+ */
+void page_mapping_split(as_t *as, uintptr_t page, size_t count)
+{
+	assert(page_table_locked(as));
+	
+	assert(page_mapping_operations);
+	
+	if ((!page_mapping_operations->mapping_split) || (count == 0))
+		return;
+	
+	size_t size = page_mapping_operations->large_page_size;
+	uintptr_t end = page + P2SZ(count);
+	
+	if (!IS_ALIGNED(page, size))
+		page_mapping_operations->mapping_split(as, page);
+	
+	if ((!IS_ALIGNED(end, size)) &&
+	    (ALIGN_DOWN(end, size) != ALIGN_DOWN(page, size)))
+		page_mapping_operations->mapping_split(as, end);
+}
+
+/** Remove a large page mapping as a whole.
+ *
+ * Removing the regular pages of a large page mapping one by one would split
+ * it first. When all of them are to be removed, this removes the whole
+ * mapping at once instead.
+ *
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as         Address space to which the page belongs.
+ * @param page       Virtual address of the page.
+ * @param[out] frame Physical address of the first frame of the removed
+ *                   mapping.
+ *
+ * @return Number of regular pages covered by the removed mapping or zero
+ *         if page is not the first page of a large page mapping.
+ *
+ */
+NO_TRACE size_t page_mapping_remove_large(as_t *as, uintptr_t page,
+    uintptr_t *frame)
+{
+	assert(page_table_locked(as));
+	
+	assert(page_mapping_operations);
+	
+	if (!page_mapping_operations->mapping_remove_large)
+		return 0;
+	
+	size_t size = page_mapping_operations->large_page_size;
+	if (!IS_ALIGNED(page, size))
+		return 0;
+	
+	if (!page_mapping_operations->mapping_remove_large(as, page, frame))
+		return 0;
+	
+	/* Repel prefetched accesses to the old mapping. */
+	memory_barrier();
+	return size >> PAGE_WIDTH;
+}
+
 errno_t page_find_mapping(uintptr_t virt, uintptr_t *phys)
 {
 	page_table_lock(AS, true);
@@ -45,12 +45,18 @@
  *
  * Following features are not currently supported but would be easy to do:
  * @li cache coloring
- * @li dynamic magazine growing (different magazine sizes are already
- *     supported, but we would need to adjust allocation strategy)
  *
  * The slab allocator supports per-CPU caches ('magazines') to facilitate
  * good SMP scaling.
  *
+ * The size of the magazines adapts to the load of each cache. Every access
+ * to the list of full magazines (the 'depot') tries to take its lock
+ * without spinning first. When too many accesses within a window find the
+ * lock taken, the size of newly allocated magazines is doubled, so that
+ * the processors visit the depot less often. When the lock has not been
+ * contended for a number of windows or when memory is being reclaimed,
+ * the size is halved again.
+ *
  * When a new object is being allocated, it is first checked, if it is
  * available in a CPU-bound magazine. If it is not found there, it is
  * allocated from a CPU-shared slab - if a partially full one is found,
@@ -115,12 +121,24 @@
 #include <bitops.h>
 #include <macros.h>
 #include <cpu.h>
+#include <str.h>
 
 IRQ_SPINLOCK_STATIC_INITIALIZE(slab_cache_lock);
 static LIST_INITIALIZE(slab_cache_list);
 
-/** Magazine cache */
-static slab_cache_t mag_cache;
+/** Number of magazine sizes from SLAB_MAG_SIZE up to SLAB_MAG_SIZE_MAX */
+#define SLAB_MAG_CACHES  5
+
+/** Magazine caches, one for each magazine size */
+static slab_cache_t mag_caches[SLAB_MAG_CACHES];
+
+static const char *mag_names[] = {
+	"slab_magazine-4",
+	"slab_magazine-8",
+	"slab_magazine-16",
+	"slab_magazine-32",
+	"slab_magazine-64"
+};
 
 /** Cache for cache descriptors */
 static slab_cache_t slab_cache_cache;
@@ -350,6 +368,53 @@ NO_TRACE static void *slab_obj_create(slab_cache_t *cache, unsigned int flags)
 /* CPU-Cache slab functions */
 /****************************/
 
+/** Return the magazine cache for magazines of the given size
+ *
+ */
+NO_TRACE static slab_cache_t *mag_cache_get(size_t size)
+{
+	assert(ispwr2(size));
+	assert((size >= SLAB_MAG_SIZE) && (size <= SLAB_MAG_SIZE_MAX));
+	
+	return &mag_caches[fnzb(size) - fnzb(SLAB_MAG_SIZE)];
+}
+
+/** Lock the magazine list of a cache and adapt the magazine size
+ *
+ * The lock is tried without spinning first to find out whether it is
+ * contended. Interrupts are expected to be already disabled.
+ *
+ */
+NO_TRACE static void depot_lock(slab_cache_t *cache)
+{
+	bool contended = !irq_spinlock_trylock(&cache->maglock);
+	if (contended) {
+		irq_spinlock_lock(&cache->maglock, false);
+		cache->depot_contention++;
+		cache->tune_contended++;
+	}
+	
+	if (++cache->tune_accesses < SLAB_MAG_TUNE_WINDOW)
+		return;
+	
+	if (cache->tune_contended >= SLAB_MAG_GROW_CONTENTION) {
+		if (cache->mag_size < SLAB_MAG_SIZE_MAX)
+			cache->mag_size <<= 1;
+		
+		cache->tune_quiet = 0;
+	} else if (cache->tune_contended == 0) {
+		if ((++cache->tune_quiet >= SLAB_MAG_SHRINK_WINDOWS) &&
+		    (cache->mag_size > SLAB_MAG_SIZE)) {
+			cache->mag_size >>= 1;
+			cache->tune_quiet = 0;
+		}
+	} else
+		cache->tune_quiet = 0;
+	
+	cache->tune_accesses = 0;
+	cache->tune_contended = 0;
+}
+
 /** Find a full magazine in cache, take it from list and return it
  *
  * @param first If true, return first, else last mag.
@@ -361,7 +426,8 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 	slab_magazine_t *mag = NULL;
 	link_t *cur;
 	
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = interrupts_disable();
+	depot_lock(cache);
 	if (!list_empty(&cache->magazines)) {
 		if (first)
 			cur = list_first(&cache->magazines);
@@ -371,8 +437,10 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 		mag = list_get_instance(cur, slab_magazine_t, link);
 		list_remove(&mag->link);
 		atomic_dec(&cache->magazine_counter);
+		cache->depot_gets++;
 	}
-	irq_spinlock_unlock(&cache->maglock, true);
+	irq_spinlock_unlock(&cache->maglock, false);
+	interrupts_restore(ipl);
 
 	return mag;
 }
@@ -383,12 +451,15 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 NO_TRACE static void put_mag_to_cache(slab_cache_t *cache,
     slab_magazine_t *mag)
 {
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = interrupts_disable();
+	depot_lock(cache);
 	
 	list_prepend(&mag->link, &cache->magazines);
 	atomic_inc(&cache->magazine_counter);
+	cache->depot_puts++;
 	
-	irq_spinlock_unlock(&cache->maglock, true);
+	irq_spinlock_unlock(&cache->maglock, false);
+	interrupts_restore(ipl);
 }
 
 /** Free all objects in magazine and free memory associated with magazine
@@ -407,7 +478,7 @@ NO_TRACE static size_t magazine_destroy(slab_cache_t *cache,
 		atomic_dec(&cache->cached_objs);
 	}
 	
-	slab_free(&mag_cache, mag);
+	slab_free(mag_cache_get(mag->size), mag);
 	
 	return frames;
 }
@@ -466,6 +537,7 @@ NO_TRACE static void *magazine_obj_get(slab_cache_t *cache)
 	}
 	
 	void *obj = mag->objs[--mag->busy];
+	cache->mag_cache[CPU->id].hits++;
 	irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 	
 	atomic_dec(&cache->cached_objs);
@@ -508,12 +580,13 @@ NO_TRACE static slab_magazine_t *make_empty_current_mag(slab_cache_t *cache)
 	 * this would deadlock.
 	 *
 	 */
-	slab_magazine_t *newmag = slab_alloc(&mag_cache,
+	size_t size = cache->mag_size;
+	slab_magazine_t *newmag = slab_alloc(mag_cache_get(size),
 	    FRAME_ATOMIC | FRAME_NO_RECLAIM);
 	if (!newmag)
 		return NULL;
 	
-	newmag->size = SLAB_MAG_SIZE;
+	newmag->size = size;
 	newmag->busy = 0;
 	
 	/* Flush last to magazine list */
@@ -616,6 +689,8 @@ NO_TRACE static void _slab_cache_create(slab_cache_t *cache, const char *name,
 	
 	memsetb(cache, sizeof(*cache), 0);
 	cache->name = name;
+	cache->objsize = size;
+	cache->mag_size = SLAB_MAG_SIZE;
 	
 	if (align < sizeof(sysarg_t))
 		align = sizeof(sysarg_t);
@@ -721,6 +796,20 @@ NO_TRACE static size_t _slab_reclaim(slab_cache_t *cache, unsigned int flags)
 		}
 	}
 	
+	/* Memory is short, let the processors cache fewer objects */
+	irq_spinlock_lock(&cache->maglock, true);
+	
+	if (flags & SLAB_RECLAIM_ALL)
+		cache->mag_size = SLAB_MAG_SIZE;
+	else if (cache->mag_size > SLAB_MAG_SIZE)
+		cache->mag_size >>= 1;
+	
+	cache->tune_accesses = 0;
+	cache->tune_contended = 0;
+	cache->tune_quiet = 0;
+	
+	irq_spinlock_unlock(&cache->maglock, true);
+	
 	return frames;
 }
 
@@ -775,10 +864,13 @@ void slab_cache_destroy(slab_cache_t *cache)
 	slab_free(&slab_cache_cache, cache);
 }
 
-/** Allocate new object from cache - if no flags given, always returns memory
+/** Allocate new object from cache and account for the requested size
+ *
+ * @param size Number of bytes actually requested by the caller.
  *
  */
-void *slab_alloc(slab_cache_t *cache, unsigned int flags)
+NO_TRACE static void *_slab_alloc(slab_cache_t *cache, unsigned int flags,
+    size_t size)
 {
 	/* Disable interrupts to avoid deadlocks with interrupt handlers */
 	ipl_t ipl = interrupts_disable();
@@ -791,6 +883,11 @@ void *slab_alloc(slab_cache_t *cache, unsigned int flags)
 	if (!result)
 		result = slab_obj_create(cache, flags);
 	
+	if ((result) && (!(cache->flags & SLAB_CACHE_NOMAGAZINE)) && (CPU)) {
+		cache->mag_cache[CPU->id].allocs++;
+		cache->mag_cache[CPU->id].requested += size;
+	}
+	
 	interrupts_restore(ipl);
 	
 	if (result)
@@ -799,6 +896,14 @@ void *slab_alloc(slab_cache_t *cache, unsigned int flags)
 	return result;
 }
 
+/** Allocate new object from cache - if no flags given, always returns memory
+ *
+ */
+void *slab_alloc(slab_cache_t *cache, unsigned int flags)
+{
+	return _slab_alloc(cache, flags, cache->objsize);
+}
+
 /** Return slab object to cache
  *
  */
@@ -888,13 +993,117 @@ void slab_print_list(void)
 	}
 }
 
+/** Gather statistics of a slab cache
+ *
+ */
+NO_TRACE static void slab_cache_stats(slab_cache_t *cache,
+    stats_slab_t *stats)
+{
+	memsetb(stats, sizeof(*stats), 0);
+	
+	str_cpy(stats->name, SLAB_NAME_BUFLEN, cache->name);
+	stats->size = cache->size;
+	stats->objsize = cache->objsize;
+	stats->frames = cache->frames;
+	stats->objects = cache->objects;
+	stats->allocated_slabs = atomic_get(&cache->allocated_slabs);
+	stats->allocated_objs = atomic_get(&cache->allocated_objs);
+	stats->cached_objs = atomic_get(&cache->cached_objs);
+	stats->mag_size = cache->mag_size;
+	stats->depot_gets = cache->depot_gets;
+	stats->depot_puts = cache->depot_puts;
+	stats->depot_contention = cache->depot_contention;
+	
+	if (cache->flags & SLAB_CACHE_NOMAGAZINE)
+		return;
+	
+	/* The counters are only read, a slightly stale value will do. */
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		stats->allocs += cache->mag_cache[i].allocs;
+		stats->hits += cache->mag_cache[i].hits;
+		stats->requested += cache->mag_cache[i].requested;
+	}
+}
+
+/** Gather statistics of all slab caches
+ *
+ * @param stats Array to be filled in.
+ * @param count Number of entries in the array.
+ *
+ * @return Number of slab caches in the system. This can be
+ *         more than count, the rest is not filled in then.
+ *
+ */
+size_t slab_get_stats(stats_slab_t *stats, size_t count)
+{
+	irq_spinlock_lock(&slab_cache_lock, true);
+	
+	size_t caches = 0;
+	list_foreach(slab_cache_list, link, slab_cache_t, cache) {
+		if (caches < count)
+			slab_cache_stats(cache, &stats[caches]);
+		
+		caches++;
+	}
+	
+	irq_spinlock_unlock(&slab_cache_lock, true);
+	
+	return caches;
+}
+
+/** Print percentage of a part of a whole or a dash if undefined */
+NO_TRACE static void print_percent(uint64_t part, uint64_t whole)
+{
+	if (whole == 0)
+		printf(" %6s", "-");
+	else
+		printf(" %5" PRIu64 "%%", part * 100 / whole);
+}
+
+/* Print magazine and fragmentation statistics of caches */
+void slab_print_stats(void)
+{
+	/*
+	 * Gather the statistics first, we must not hold the
+	 * slab_cache_lock spinlock when printing them.
+	 */
+	size_t count = slab_get_stats(NULL, 0);
+	stats_slab_t *stats = malloc(sizeof(stats_slab_t) * count, 0);
+	count = min(count, slab_get_stats(stats, count));
+	
+	printf("[cache name      ] [mag] [allocs      ] [hits ]"
+	    " [gets    ] [puts    ] [contend ] [frag ]\n");
+	
+	for (size_t i = 0; i < count; i++) {
+		printf("%-18s %5" PRIu64 " %14" PRIu64, stats[i].name,
+		    stats[i].mag_size, stats[i].allocs);
+		print_percent(stats[i].hits, stats[i].allocs);
+		printf(" %10" PRIu64 " %10" PRIu64 " %10" PRIu64,
+		    stats[i].depot_gets, stats[i].depot_puts,
+		    stats[i].depot_contention);
+		print_percent(stats[i].allocs * stats[i].size -
+		    stats[i].requested, stats[i].allocs * stats[i].size);
+		printf("\n");
+	}
+	
+	free(stats);
+}
+
 void slab_cache_init(void)
 {
-	/* Initialize magazine cache */
-	_slab_cache_create(&mag_cache, "slab_magazine_t",
-	    sizeof(slab_magazine_t) + SLAB_MAG_SIZE * sizeof(void *),
-	    sizeof(uintptr_t), NULL, NULL, SLAB_CACHE_NOMAGAZINE |
-	    SLAB_CACHE_SLINSIDE);
+	/* Initialize magazine caches */
+	size_t i;
+	size_t size;
+	
+	assert((SLAB_MAG_SIZE << (SLAB_MAG_CACHES - 1)) == SLAB_MAG_SIZE_MAX);
+	
+	for (i = 0, size = SLAB_MAG_SIZE; i < SLAB_MAG_CACHES;
+	    i++, size <<= 1) {
+		_slab_cache_create(&mag_caches[i], mag_names[i],
+		    sizeof(slab_magazine_t) + size * sizeof(void *),
+		    sizeof(uintptr_t), NULL, NULL, SLAB_CACHE_NOMAGAZINE |
+		    SLAB_CACHE_SLINSIDE);
+	}
 	
 	/* Initialize slab_cache cache */
 	_slab_cache_create(&slab_cache_cache, "slab_cache_cache",
@@ -906,9 +1115,6 @@ void slab_cache_init(void)
 	    NULL, NULL, SLAB_CACHE_SLINSIDE | SLAB_CACHE_MAGDEFERRED);
 	
 	/* Initialize structures for malloc */
-	size_t i;
-	size_t size;
-	
 	for (i = 0, size = (1 << SLAB_MIN_MALLOC_W);
 	    i < (SLAB_MAX_MALLOC_W - SLAB_MIN_MALLOC_W + 1);
 	    i++, size <<= 1) {
@@ -957,12 +1163,13 @@ void *malloc(size_t size, unsigned int flags)
 	assert(_slab_initialized);
 	assert(size <= (1 << SLAB_MAX_MALLOC_W));
 	
-	if (size < (1 << SLAB_MIN_MALLOC_W))
-		size = (1 << SLAB_MIN_MALLOC_W);
+	size_t csize = size;
+	if (csize < (1 << SLAB_MIN_MALLOC_W))
+		csize = (1 << SLAB_MIN_MALLOC_W);
 	
-	uint8_t idx = fnzb(size - 1) - SLAB_MIN_MALLOC_W + 1;
+	uint8_t idx = fnzb(csize - 1) - SLAB_MIN_MALLOC_W + 1;
 	
-	return slab_alloc(malloc_caches[idx], flags);
+	return _slab_alloc(malloc_caches[idx], flags, size);
 }
 
 void *realloc(void *ptr, size_t size, unsigned int flags)
@@ -973,11 +1180,12 @@ void *realloc(void *ptr, size_t size, unsigned int flags)
 	void *new_ptr;
 	
 	if (size > 0) {
-		if (size < (1 << SLAB_MIN_MALLOC_W))
-			size = (1 << SLAB_MIN_MALLOC_W);
-		uint8_t idx = fnzb(size - 1) - SLAB_MIN_MALLOC_W + 1;
+		size_t csize = size;
+		if (csize < (1 << SLAB_MIN_MALLOC_W))
+			csize = (1 << SLAB_MIN_MALLOC_W);
+		uint8_t idx = fnzb(csize - 1) - SLAB_MIN_MALLOC_W + 1;
 		
-		new_ptr = slab_alloc(malloc_caches[idx], flags);
+		new_ptr = _slab_alloc(malloc_caches[idx], flags, size);
 	} else
 		new_ptr = NULL;
 	
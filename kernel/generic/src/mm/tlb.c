@@ -35,8 +35,11 @@
  * @brief Generic TLB shootdown algorithm.
  *
  * The algorithm implemented here is based on the CMU TLB shootdown
- * algorithm and is further simplified (e.g. all CPUs receive all TLB
- * shootdown messages).
+ * algorithm and is further simplified. Messages concerning an address
+ * space are delivered only to the processors which have ever run it, the
+ * others cannot have cached any of its translations. Messages queued for
+ * one processor are merged when possible and a processor which has not
+ * handled its previous TLB shootdown IPI yet does not receive another one.
  */
 
 #include <mm/tlb.h>
@@ -51,6 +54,18 @@
 #include <arch.h>
 #include <panic.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
+#include <mm/page.h>
+#include <macros.h>
+
+/** Number of TLB shootdown sequences started. */
+atomic_t tlb_shootdowns;
+
+/** Number of TLB shootdown IPIs sent. */
+atomic_t tlb_shootdown_ipis;
+
+/** Number of TLB shootdown IPIs saved by reusing a pending one. */
+atomic_t tlb_shootdown_ipis_coalesced;
 
 void tlb_init(void)
 {
@@ -67,62 +82,178 @@ void tlb_init(void)
  */
 IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
 
-/** Send TLB shootdown message.
+/** Try to merge a TLB shootdown message with one already queued.
  *
- * This function attempts to deliver TLB shootdown message
- * to all other processors.
+ * @param msg   Queued message.
+ * @param type  Type describing scope of the new shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ * @return True if the queued message now covers the new one as well.
  *
+ */
+static bool tlb_message_merge(tlb_shootdown_msg_t *msg,
+    tlb_invalidate_type_t type, asid_t asid, uintptr_t page, size_t count)
+{
+	if (msg->type == TLB_INVL_ALL)
+		return true;
+	
+	if ((type == TLB_INVL_ALL) || (msg->asid != asid))
+		return false;
+	
+	if (msg->type == TLB_INVL_ASID)
+		return true;
+	
+	if (type == TLB_INVL_ASID) {
+		msg->type = TLB_INVL_ASID;
+		msg->page = 0;
+		msg->count = 0;
+		return true;
+	}
+	
+	/* Both messages invalidate pages, merge touching ranges. */
+	uintptr_t msg_end = msg->page + P2SZ(msg->count);
+	uintptr_t end = page + P2SZ(count);
+	if ((page > msg_end) || (msg->page > end))
+		return false;
+	
+	msg->page = min(msg->page, page);
+	msg->count = (max(msg_end, end) - msg->page) >> PAGE_WIDTH;
+	return true;
+}
+
+/** Queue a TLB shootdown message for a processor.
+ *
+ * @param cpu   Target processor, its lock must be held.
  * @param type  Type describing scope of shootdown.
  * @param asid  Address space, if required by type.
  * @param page  Virtual page address, if required by type.
  * @param count Number of pages, if required by type.
  *
+ */
+static void tlb_message_enqueue(cpu_t *cpu, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
+{
+	for (size_t i = 0; i < cpu->tlb_messages_count; i++) {
+		if (tlb_message_merge(&cpu->tlb_messages[i], type, asid, page,
+		    count))
+			return;
+	}
+	
+	if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
+		/*
+		 * The message queue is full.
+		 * Erase the queue and store one TLB_INVL_ALL message.
+		 */
+		cpu->tlb_messages_count = 1;
+		cpu->tlb_messages[0].type = TLB_INVL_ALL;
+		cpu->tlb_messages[0].asid = ASID_INVALID;
+		cpu->tlb_messages[0].page = 0;
+		cpu->tlb_messages[0].count = 0;
+	} else {
+		/*
+		 * Enqueue the message.
+		 */
+		size_t idx = cpu->tlb_messages_count++;
+		cpu->tlb_messages[idx].type = type;
+		cpu->tlb_messages[idx].asid = asid;
+		cpu->tlb_messages[idx].page = page;
+		cpu->tlb_messages[idx].count = count;
+	}
+}
+
+/** Check whether a processor is a target of TLB shootdown.
+ *
+ * @param targets Processors which need to be notified or NULL for all.
+ * @param i       Processor ID.
+ *
+ * @return True if the processor is another processor in the set.
+ *
+ */
+static inline bool tlb_shootdown_target(cpu_mask_t *targets, unsigned int i)
+{
+	return (i != CPU->id) &&
+	    ((targets == NULL) || (cpu_mask_is_set(targets, i)));
+}
+
+/** Send TLB shootdown message.
+ *
+ * This function attempts to deliver TLB shootdown message
+ * to all other processors in the target set.
+ *
+ * @param targets Processors which may hold the translations being
+ *                invalidated or NULL for all processors. The set can be
+ *                extended only by tlb_shootdown_track() and so it does not
+ *                change until the sequence is finalized.
+ * @param type    Type describing scope of shootdown.
+ * @param asid    Address space, if required by type.
+ * @param page    Virtual page address, if required by type.
+ * @param count   Number of pages, if required by type.
+ *
  * @return The interrupt priority level as it existed prior to this call.
  *
  */
-ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
-    uintptr_t page, size_t count)
+ipl_t tlb_shootdown_start(cpu_mask_t *targets, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
 {
 	ipl_t ipl = interrupts_disable();
 	CPU->tlb_active = false;
 	irq_spinlock_lock(&tlblock, false);
 	
+	atomic_inc(&tlb_shootdowns);
+	
+	/*
+	 * Queue the message and find out which of the targets still need
+	 * to be interrupted.
+	 */
+	size_t notify = 0;
 	size_t i;
 	for (i = 0; i < config.cpu_count; i++) {
-		if (i == CPU->id)
+		if (!tlb_shootdown_target(targets, i))
 			continue;
 		
 		cpu_t *cpu = &cpus[i];
 		
 		irq_spinlock_lock(&cpu->lock, false);
-		if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
-			/*
-			 * The message queue is full.
-			 * Erase the queue and store one TLB_INVL_ALL message.
-			 */
-			cpu->tlb_messages_count = 1;
-			cpu->tlb_messages[0].type = TLB_INVL_ALL;
-			cpu->tlb_messages[0].asid = ASID_INVALID;
-			cpu->tlb_messages[0].page = 0;
-			cpu->tlb_messages[0].count = 0;
-		} else {
+		tlb_message_enqueue(cpu, type, asid, page, count);
+		if (!cpu->tlb_ipi_pending)
+			notify++;
+		irq_spinlock_unlock(&cpu->lock, false);
+	}
+	
+	if ((notify > 0) && (notify == config.cpu_count - 1)) {
+		for (i = 0; i < config.cpu_count; i++) {
+			if (i != CPU->id) {
+				cpus[i].tlb_ipi_pending = true;
+				atomic_inc(&tlb_shootdown_ipis);
+			}
+		}
+		
+		tlb_shootdown_ipi_send();
+	} else {
+		for (i = 0; i < config.cpu_count; i++) {
+			if (!tlb_shootdown_target(targets, i))
+				continue;
+			
 			/*
-			 * Enqueue the message.
+			 * The flag is cleared only by the target processor
+			 * while holding tlblock, so it cannot change now.
 			 */
-			size_t idx = cpu->tlb_messages_count++;
-			cpu->tlb_messages[idx].type = type;
-			cpu->tlb_messages[idx].asid = asid;
-			cpu->tlb_messages[idx].page = page;
-			cpu->tlb_messages[idx].count = count;
+			if (cpus[i].tlb_ipi_pending) {
+				atomic_inc(&tlb_shootdown_ipis_coalesced);
+				continue;
+			}
+			
+			cpus[i].tlb_ipi_pending = true;
+			ipi_unicast(i, VECTOR_TLB_SHOOTDOWN_IPI);
+			atomic_inc(&tlb_shootdown_ipis);
 		}
-		irq_spinlock_unlock(&cpu->lock, false);
 	}
 	
-	tlb_shootdown_ipi_send();
-	
 busy_wait:
 	for (i = 0; i < config.cpu_count; i++) {
-		if (cpus[i].tlb_active)
+		if ((tlb_shootdown_target(targets, i)) && (cpus[i].tlb_active))
 			goto busy_wait;
 	}
 	
@@ -146,6 +277,33 @@ void tlb_shootdown_ipi_send(void)
 	ipi_broadcast(VECTOR_TLB_SHOOTDOWN_IPI);
 }
 
+/** Add the current processor to a set of TLB shootdown targets.
+ *
+ * Must be called before the current processor starts using an address
+ * space. Joining the set is serialized with the TLB shootdown sequences
+ * so that none of them can miss the processor while it is modifying the
+ * page tables of the address space.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param targets Set of processors which have run the address space.
+ *
+ */
+void tlb_shootdown_track(cpu_mask_t *targets)
+{
+	assert(interrupts_disabled());
+	
+	if (cpu_mask_is_set(targets, CPU->id))
+		return;
+	
+	/* Let a concurrent sender finish without waiting for us. */
+	CPU->tlb_active = false;
+	irq_spinlock_lock(&tlblock, false);
+	cpu_mask_set(targets, CPU->id);
+	irq_spinlock_unlock(&tlblock, false);
+	CPU->tlb_active = true;
+}
+
 /** Receive TLB shootdown message.
  *
  */
@@ -155,9 +313,15 @@ void tlb_shootdown_ipi_recv(void)
 	
 	CPU->tlb_active = false;
 	irq_spinlock_lock(&tlblock, false);
-	irq_spinlock_unlock(&tlblock, false);
 	
+	/*
+	 * Take over the queue before another sender can add messages which
+	 * would have to be processed only after its sequence is finalized.
+	 */
 	irq_spinlock_lock(&CPU->lock, false);
+	CPU->tlb_ipi_pending = false;
+	irq_spinlock_unlock(&tlblock, false);
+	
 	assert(CPU->tlb_messages_count <= TLB_MESSAGE_QUEUE_LEN);
 	
 	size_t i;
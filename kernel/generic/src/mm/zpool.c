@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup genericmm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Pool of pre-zeroed frames.
+ *
+ * The kzpool thread clears frames while its processor has nothing else
+ * to run and keeps them in a small pool. The page fault handlers take
+ * zero-filled frames from the pool instead of clearing them on the
+ * faulting thread and fall back to synchronous clearing when the pool
+ * is empty.
+ *
+ * Frames in the pool are accounted as reserved memory, so filling the
+ * pool never overcommits.
+ */
+
+#include <assert.h>
+#include <mm/zpool.h>
+#include <mm/frame.h>
+#include <mm/km.h>
+#include <mm/reserve.h>
+#include <synch/spinlock.h>
+#include <synch/waitq.h>
+#include <proc/thread.h>
+#include <sysinfo/sysinfo.h>
+#include <atomic.h>
+#include <cpu.h>
+#include <macros.h>
+#include <mem.h>
+#include <arch.h>
+
+/** Time to sleep when the pool is full or memory is short (us). */
+#define ZPOOL_SLEEP      100000
+
+/** Time to back off when other threads are ready to run (us). */
+#define ZPOOL_BACKOFF    10000
+
+/** Number of frames the pool is refilled up to. */
+size_t zpool_watermark = ZPOOL_WATERMARK_DEFAULT;
+
+SPINLOCK_STATIC_INITIALIZE_NAME(zpool_lock, "zpool_lock");
+static uintptr_t zpool_frames[ZPOOL_CAPACITY];
+static size_t zpool_count = 0;
+
+/** Wait queue the kzpool thread sleeps in when there is nothing to do. */
+static waitq_t zpool_wq;
+
+static atomic_t zpool_hits;
+static atomic_t zpool_misses;
+
+static sysarg_t get_zpool_frames(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) zpool_count;
+}
+
+static sysarg_t get_zpool_watermark(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) zpool_watermark;
+}
+
+static sysarg_t get_zpool_hits(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&zpool_hits);
+}
+
+static sysarg_t get_zpool_misses(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&zpool_misses);
+}
+
+/** Get the pool hit rate in percent. */
+static sysarg_t get_zpool_hit_rate(struct sysinfo_item *item, void *data)
+{
+	uint64_t hits = atomic_get(&zpool_hits);
+	uint64_t total = hits + atomic_get(&zpool_misses);
+	
+	if (total == 0)
+		return 0;
+	
+	return (sysarg_t) (hits * 100 / total);
+}
+
+/** Initialize the pool of pre-zeroed frames.
+ *
+ */
+void zpool_init(void)
+{
+	waitq_initialize(&zpool_wq);
+	
+	sysinfo_set_item_gen_val("mm.zero_pool.frames", NULL,
+	    get_zpool_frames, NULL);
+	sysinfo_set_item_gen_val("mm.zero_pool.watermark", NULL,
+	    get_zpool_watermark, NULL);
+	sysinfo_set_item_gen_val("mm.zero_pool.hits", NULL,
+	    get_zpool_hits, NULL);
+	sysinfo_set_item_gen_val("mm.zero_pool.misses", NULL,
+	    get_zpool_misses, NULL);
+	sysinfo_set_item_gen_val("mm.zero_pool.hit_rate", NULL,
+	    get_zpool_hit_rate, NULL);
+}
+
+/** Allocate a zero-filled frame.
+ *
+ * The frame is taken from the pool of pre-zeroed frames if possible,
+ * otherwise it is allocated and cleared synchronously. The function
+ * blocks until a frame is available.
+ *
+ * @param flags Only FRAME_NO_RESERVE is allowed, with the same meaning
+ *              as in frame_alloc().
+ *
+ * @return Physical address of the frame.
+ *
+ */
+uintptr_t zpool_frame_alloc(frame_flags_t flags)
+{
+	uintptr_t frame;
+	bool hit = false;
+	bool low = false;
+	
+	assert(!(flags & ~FRAME_NO_RESERVE));
+	
+	spinlock_lock(&zpool_lock);
+	if (zpool_count > 0) {
+		frame = zpool_frames[--zpool_count];
+		hit = true;
+		low = (zpool_count == zpool_watermark / 2);
+	}
+	spinlock_unlock(&zpool_lock);
+	
+	if (hit) {
+		atomic_inc(&zpool_hits);
+		
+		/*
+		 * The pool holds a reservation for each of its frames.
+		 * Drop it if the caller has already reserved the memory.
+		 */
+		if (flags & FRAME_NO_RESERVE)
+			reserve_free(1);
+		
+		if (low)
+			waitq_wakeup(&zpool_wq, WAKEUP_FIRST);
+		
+		return frame;
+	}
+	
+	atomic_inc(&zpool_misses);
+	
+	uintptr_t kpage = km_temporary_page_get(&frame, flags);
+	memsetb((void *) kpage, PAGE_SIZE, 0);
+	km_temporary_page_put(kpage);
+	
+	return frame;
+}
+
+/** Clear one frame and add it to the pool.
+ *
+ * @return True if a frame was added, false if the pool is full
+ *         or there is not enough free memory.
+ *
+ */
+static bool zpool_fill_one(void)
+{
+	uintptr_t frame;
+	
+	spinlock_lock(&zpool_lock);
+	bool full = (zpool_count >= min(zpool_watermark, ZPOOL_CAPACITY));
+	spinlock_unlock(&zpool_lock);
+	
+	if (full)
+		return false;
+	
+	if (!reserve_try_alloc(1))
+		return false;
+	
+	uintptr_t kpage = km_temporary_page_get(&frame,
+	    FRAME_NO_RESERVE | FRAME_ATOMIC);
+	if (!kpage) {
+		reserve_free(1);
+		return false;
+	}
+	
+	memsetb((void *) kpage, PAGE_SIZE, 0);
+	km_temporary_page_put(kpage);
+	
+	spinlock_lock(&zpool_lock);
+	if (zpool_count < ZPOOL_CAPACITY) {
+		zpool_frames[zpool_count++] = frame;
+		spinlock_unlock(&zpool_lock);
+		return true;
+	}
+	spinlock_unlock(&zpool_lock);
+	
+	/* Only a single kzpool thread fills the pool, but be defensive */
+	frame_free(frame, 1);
+	return false;
+}
+
+/** Kernel thread filling the pool of pre-zeroed frames.
+ *
+ * Frames are only cleared while no other thread is ready to run
+ * on the current processor.
+ *
+ * @param arg Not used.
+ *
+ */
+void kzpool(void *arg)
+{
+	thread_detach(THREAD);
+	
+	while (true) {
+		if (atomic_get(&CPU->nrdy) > 0) {
+			thread_usleep(ZPOOL_BACKOFF);
+			continue;
+		}
+		
+		if (!zpool_fill_one()) {
+			(void) waitq_sleep_timeout(&zpool_wq, ZPOOL_SLEEP,
+			    SYNCH_FLAGS_NON_BLOCKING, NULL);
+		}
+	}
+}
+
+/** @}
+ */
@@ -65,6 +65,8 @@
 #include <print.h>
 #include <log.h>
 #include <stacktrace.h>
+#include <tracepoint.h>
+#include <sysinfo/stats.h>
 
 static void scheduler_separated_stack(void);
 
@@ -210,6 +212,10 @@ loop:
 		 * This improves energy saving and hyperthreading.
 		 */
 		irq_spinlock_lock(&CPU->lock, false);
+		
+		/* No thread runs while idle, the event carries thread ID 0 */
+		TRACEPOINT(TP_SCHED_SWITCH, 0, 0);
+		
 		CPU->idle = true;
 		irq_spinlock_unlock(&CPU->lock, false);
 		interrupts_enable();
@@ -333,6 +339,8 @@ void scheduler(void)
 		
 		/* Update thread kernel accounting */
 		THREAD->kcycles += get_cycle() - THREAD->last_cycle;
+		stats_thread_changed(&THREAD->stats_changes);
+		stats_task_changed(&TASK->stats_changes);
 		
 #if (defined CONFIG_FPU) && (!defined CONFIG_FPU_LAZY)
 		fpu_context_save(THREAD->saved_fpu_context);
@@ -524,6 +532,9 @@ repeat:
 	
 	irq_spinlock_lock(&THREAD->lock, false);
 	THREAD->state = Running;
+	stats_thread_changed(&THREAD->stats_changes);
+	
+	TRACEPOINT(TP_SCHED_SWITCH, THREAD->priority, THREAD->ticks);
 	
 #ifdef SCHEDULER_VERBOSE
 	log(LF_OTHER, LVL_DEBUG,
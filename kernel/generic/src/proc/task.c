@@ -59,6 +59,7 @@
 #include <str.h>
 #include <syscall/copy.h>
 #include <macros.h>
+#include <sysinfo/stats.h>
 
 /** Spinlock protecting the tasks_tree AVL tree. */
 IRQ_SPINLOCK_INITIALIZE(tasks_lock);
@@ -219,6 +220,8 @@ task_t *task_create(as_t *as, const char *name)
 	task->perms = 0;
 	task->ucycles = 0;
 	task->kcycles = 0;
+	atomic_set(&task->page_faults, 0);
+	stats_changes_initialize(&task->stats_changes);
 
 	caps_task_init(task);
 
@@ -271,6 +274,7 @@ task_t *task_create(as_t *as, const char *name)
 	avltree_node_initialize(&task->tasks_tree_node);
 	task->tasks_tree_node.key = task->taskid;
 	avltree_insert(&tasks_tree, &task->tasks_tree_node);
+	stats_task_created(task);
 	
 	irq_spinlock_unlock(&tasks_lock, true);
 	
@@ -289,6 +293,7 @@ void task_destroy(task_t *task)
 	 */
 	irq_spinlock_lock(&tasks_lock, true);
 	avltree_delete(&tasks_tree, &task->tasks_tree_node);
+	stats_task_exited(task);
 	irq_spinlock_unlock(&tasks_lock, true);
 	
 	/*
@@ -67,6 +67,7 @@
 #include <main/uinit.h>
 #include <syscall/copy.h>
 #include <errno.h>
+#include <sysinfo/stats.h>
 
 /** Thread states */
 const char *thread_states[] = {
@@ -306,6 +307,7 @@ void thread_ready(thread_t *thread)
 	}
 	
 	thread->state = Ready;
+	stats_thread_changed(&thread->stats_changes);
 	
 	irq_spinlock_pass(&thread->lock, &(cpu->rq[i].lock));
 	
@@ -370,6 +372,7 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task,
 	thread->kcycles = 0;
 	thread->uncounted =
 	    ((flags & THREAD_FLAG_UNCOUNTED) == THREAD_FLAG_UNCOUNTED);
+	stats_changes_initialize(&thread->stats_changes);
 	thread->priority = -1;          /* Start in rq[0] */
 	thread->cpu = NULL;
 	thread->wired = false;
@@ -388,6 +391,8 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task,
 	thread->in_copy_from_uspace = false;
 	thread->in_copy_to_uspace = false;
 	
+	thread->istate = NULL;
+	
 	thread->interrupted = false;
 	thread->detached = false;
 	waitq_initialize(&thread->join_wq);
@@ -443,6 +448,7 @@ void thread_destroy(thread_t *thread, bool irq_res)
 	irq_spinlock_pass(&thread->lock, &threads_lock);
 	
 	avltree_delete(&threads_tree, &thread->threads_tree_node);
+	stats_thread_exited(thread);
 	
 	irq_spinlock_pass(&threads_lock, &thread->task->lock);
 	
@@ -450,6 +456,7 @@ void thread_destroy(thread_t *thread, bool irq_res)
 	 * Detach from the containing task.
 	 */
 	list_remove(&thread->th_link);
+	stats_task_changed(&thread->task->stats_changes);
 	irq_spinlock_unlock(&thread->task->lock, irq_res);
 	
 	/*
@@ -483,6 +490,7 @@ void thread_attach(thread_t *thread, task_t *task)
 		atomic_inc(&task->lifecount);
 	
 	list_append(&thread->th_link, &task->threads);
+	stats_task_changed(&task->stats_changes);
 	
 	irq_spinlock_pass(&task->lock, &threads_lock);
 	
@@ -490,6 +498,7 @@ void thread_attach(thread_t *thread, task_t *task)
 	 * Register this thread in the system-wide list.
 	 */
 	avltree_insert(&threads_tree, &thread->threads_tree_node);
+	stats_thread_attached(thread);
 	irq_spinlock_unlock(&threads_lock, true);
 }
 
@@ -39,6 +39,8 @@
 
 #include <smp/ipi.h>
 #include <config.h>
+#include <assert.h>
+#include <cpu.h>
 
 /** Broadcast IPI message
  *
@@ -59,6 +61,20 @@ void ipi_broadcast(int ipi)
 		ipi_broadcast_arch(ipi);
 }
 
+/** Send IPI message to one CPU
+ *
+ * @param cpu_id Destination CPU ID. Must not be the current CPU.
+ * @param ipi    Message to send.
+ *
+ */
+void ipi_unicast(unsigned int cpu_id, int ipi)
+{
+	assert(cpu_id < config.cpu_count);
+	assert(cpu_id != CPU->id);
+	
+	ipi_unicast_arch(cpu_id, ipi);
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
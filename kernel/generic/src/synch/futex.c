@@ -80,6 +80,7 @@
 #include <align.h>
 #include <panic.h>
 #include <errno.h>
+#include <tracepoint.h>
 
 /** Task specific pointer to a global kernel futex object. */
 typedef struct futex_ptr {
@@ -94,6 +95,9 @@ typedef struct futex_ptr {
 } futex_ptr_t;
 
 
+/** Slab for futex_t objects. */
+static slab_cache_t *futex_cache;
+
 static void destroy_task_cache(work_t *work);
 
 static void futex_initialize(futex_t *futex, uintptr_t paddr);
@@ -150,6 +154,8 @@ static cht_ops_t task_futex_ht_ops = {
 void futex_init(void)
 {
 	hash_table_create(&futex_ht, 0, 0, &futex_ht_ops);
+	futex_cache = slab_cache_create("futex_t", sizeof(futex_t), 0,
+	    NULL, NULL, 0);
 }
 
 /** Initializes the futex structures for the new task. */
@@ -338,7 +344,7 @@ static futex_t *find_cached_futex(uintptr_t uaddr)
  */
 static futex_t *get_and_cache_futex(uintptr_t phys_addr, uintptr_t uaddr)
 {
-	futex_t *futex = malloc(sizeof(futex_t), 0);
+	futex_t *futex = slab_alloc(futex_cache, 0);
 	
 	/*
 	 * Find the futex object in the global futex table (or insert it
@@ -349,7 +355,7 @@ static futex_t *get_and_cache_futex(uintptr_t phys_addr, uintptr_t uaddr)
 	ht_link_t *fut_link = hash_table_find(&futex_ht, &phys_addr);
 	
 	if (fut_link) {
-		free(futex);
+		slab_free(futex_cache, futex);
 		futex = member_to_inst(fut_link, futex_t, ht_link);
 		futex_add_ref(futex);
 	} else {
@@ -403,6 +409,8 @@ sys_errno_t sys_futex_sleep(uintptr_t uaddr)
 	
 	if (!futex)
 		return (sys_errno_t) ENOENT;
+	
+	TRACEPOINT(TP_FUTEX_SLEEP, uaddr, 0);
 
 #ifdef CONFIG_UDEBUG
 	udebug_stoppable_begin();
@@ -429,6 +437,7 @@ sys_errno_t sys_futex_wakeup(uintptr_t uaddr)
 	futex_t *futex = get_futex(uaddr);
 	
 	if (futex) {
+		TRACEPOINT(TP_FUTEX_WAKEUP, uaddr, 0);
 		waitq_wakeup(&futex->wq, WAKEUP_FIRST);
 		return EOK;
 	} else {
@@ -468,7 +477,7 @@ void futex_ht_remove_callback(ht_link_t *item)
 	futex_t *futex;
 
 	futex = hash_table_get_inst(item, futex_t, ht_link);
-	free(futex);
+	slab_free(futex_cache, futex);
 }
 
 /*
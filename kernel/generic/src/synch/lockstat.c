@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup sync
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Spinlock contention statistics.
+ *
+ * Locks are grouped into classes by their names. The class of a lock is
+ * looked up when the lock is acquired for the first time and cached in
+ * the lock. The counters are kept per processor so that gathering the
+ * statistics does not introduce any new shared cache lines on the lock
+ * paths. They are summed up only when printed.
+ *
+ * Lock names are expected to be string literals as the classes keep
+ * referencing them after the locks are gone.
+ */
+
+#include <synch/lockstat.h>
+#include <synch/spinlock.h>
+#include <arch/asm.h>
+#include <atomic.h>
+#include <config.h>
+#include <cpu.h>
+#include <mem.h>
+#include <mm/slab.h>
+#include <print.h>
+#include <str.h>
+
+/** Lock names of the classes, NULL for unused classes */
+static const char *lockstat_names[LOCKSTAT_CLASSES];
+
+/** Number of acquisitions not accounted for because of too many classes */
+static atomic_t lockstat_overflows;
+
+static size_t lockstat_hash(const char *name)
+{
+	size_t hash = 0;
+	
+	while (*name != 0)
+		hash = hash * 31 + (uint8_t) *name++;
+	
+	return hash;
+}
+
+/** Find or allocate the class of a lock name
+ *
+ * Classes are allocated without any lock as this is called from the
+ * spinlock code itself.
+ *
+ * @param name Lock name.
+ *
+ * @return Class index plus one or zero if there is no free class left.
+ *
+ */
+static unsigned int lockstat_class(const char *name)
+{
+	size_t start = lockstat_hash(name) % LOCKSTAT_CLASSES;
+	
+	for (size_t i = 0; i < LOCKSTAT_CLASSES; i++) {
+		size_t idx = (start + i) % LOCKSTAT_CLASSES;
+		const char *cur = __atomic_load_n(&lockstat_names[idx],
+		    __ATOMIC_ACQUIRE);
+		
+		if (cur == NULL) {
+			if (__atomic_compare_exchange_n(&lockstat_names[idx],
+			    &cur, name, false, __ATOMIC_ACQ_REL,
+			    __ATOMIC_ACQUIRE))
+				return idx + 1;
+			
+			/* Lost the race, cur now holds the winner's name. */
+		}
+		
+		if ((cur == name) || (str_cmp(cur, name) == 0))
+			return idx + 1;
+	}
+	
+	return 0;
+}
+
+/** Account for an acquisition of a spinlock
+ *
+ * Must be called by the holder of the lock.
+ *
+ * @param lock      Acquired spinlock.
+ * @param contended True if the lock had to be waited for.
+ * @param cycles    Cycles spent waiting for the lock.
+ *
+ */
+void lockstat_acquired(spinlock_t *lock, bool contended, uint64_t cycles)
+{
+	/* Locks taken before the processor is initialized are left out. */
+	if ((CPU == NULL) || (lock->name == NULL))
+		return;
+	
+	unsigned int class = lock->lockstat;
+	if (class == 0) {
+		class = lockstat_class(lock->name);
+		if (class == 0) {
+			atomic_inc(&lockstat_overflows);
+			return;
+		}
+		
+		lock->lockstat = class;
+	}
+	
+	/* Interrupts could otherwise update the same counters meanwhile. */
+	ipl_t ipl = interrupts_disable();
+	
+	lockstat_counters_t *counters = &CPU->lockstat[class - 1];
+	counters->acquisitions++;
+	if (contended) {
+		counters->contentions++;
+		counters->spin_cycles += cycles;
+		if (cycles > counters->max_spin_cycles)
+			counters->max_spin_cycles = cycles;
+	}
+	
+	interrupts_restore(ipl);
+}
+
+/** Print lock statistics
+ *
+ * The classes are printed sorted by the time spent waiting for their
+ * locks, the most contended first.
+ *
+ */
+void lockstat_print(void)
+{
+	lockstat_counters_t *totals = malloc(sizeof(lockstat_counters_t) *
+	    LOCKSTAT_CLASSES, FRAME_ATOMIC);
+	if (totals == NULL) {
+		printf("Not enough memory.\n");
+		return;
+	}
+	
+	memsetb(totals, sizeof(lockstat_counters_t) * LOCKSTAT_CLASSES, 0);
+	
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].active)
+			continue;
+		
+		for (size_t j = 0; j < LOCKSTAT_CLASSES; j++) {
+			lockstat_counters_t *counters = &cpus[i].lockstat[j];
+			
+			totals[j].acquisitions += counters->acquisitions;
+			totals[j].contentions += counters->contentions;
+			totals[j].spin_cycles += counters->spin_cycles;
+			if (counters->max_spin_cycles >
+			    totals[j].max_spin_cycles)
+				totals[j].max_spin_cycles =
+				    counters->max_spin_cycles;
+		}
+	}
+	
+	printf("[lock name               ] [acquired   ] [contended  ]"
+	    " [avg spin ] [max spin   ]\n");
+	
+	while (true) {
+		size_t max = LOCKSTAT_CLASSES;
+		
+		for (size_t j = 0; j < LOCKSTAT_CLASSES; j++) {
+			if (totals[j].acquisitions == 0)
+				continue;
+			
+			if ((max == LOCKSTAT_CLASSES) ||
+			    (totals[j].spin_cycles > totals[max].spin_cycles))
+				max = j;
+		}
+		
+		if (max == LOCKSTAT_CLASSES)
+			break;
+		
+		lockstat_counters_t *total = &totals[max];
+		uint64_t avg = (total->contentions != 0) ?
+		    total->spin_cycles / total->contentions : 0;
+		
+		printf("%-26s %13" PRIu64 " %13" PRIu64 " %11" PRIu64
+		    " %13" PRIu64 "\n", lockstat_names[max],
+		    total->acquisitions, total->contentions, avg,
+		    total->max_spin_cycles);
+		
+		total->acquisitions = 0;
+	}
+	
+	atomic_count_t overflows = atomic_get(&lockstat_overflows);
+	if (overflows != 0)
+		printf("%zu acquisitions left out, no free lock class.\n",
+		    (size_t) overflows);
+	
+	free(totals);
+}
+
+/** Reset lock statistics
+ *
+ * The counters are cleared without synchronizing with the processors
+ * updating them, so a few concurrent updates may get lost.
+ *
+ */
+void lockstat_reset(void)
+{
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].active)
+			continue;
+		
+		memsetb(cpus[i].lockstat, sizeof(cpus[i].lockstat), 0);
+	}
+	
+	atomic_set(&lockstat_overflows, 0);
+}
+
+/** @}
+ */
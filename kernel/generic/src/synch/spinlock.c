@@ -45,6 +45,9 @@
 #include <symtab.h>
 #include <stacktrace.h>
 #include <cpu.h>
+#include <arch/asm.h>
+#include <arch/cycle.h>
+#include <synch/lockstat.h>
 
 #ifdef CONFIG_SMP
 
@@ -55,30 +58,59 @@
  */
 void spinlock_initialize(spinlock_t *lock, const char *name)
 {
+#ifdef CONFIG_SPINLOCK_TICKET
+	atomic_set(&lock->next, 0);
+	atomic_set(&lock->owner, 0);
+#else
 	atomic_set(&lock->val, 0);
-#ifdef CONFIG_DEBUG_SPINLOCK
+#endif
+#ifdef SPINLOCK_NAMED
 	lock->name = name;
 #endif
+#ifdef CONFIG_LOCKSTAT
+	lock->lockstat = 0;
+#endif
 }
 
-#ifdef CONFIG_DEBUG_SPINLOCK
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
 
 /** Lock spinlock
  *
  * Lock spinlock.
  * This version has limitted ability to report
- * possible occurence of deadlock.
+ * possible occurence of deadlock and it gathers
+ * the lock statistics if they are enabled.
  *
  * @param lock Pointer to spinlock_t structure.
  *
  */
 void spinlock_lock_debug(spinlock_t *lock)
 {
+#ifdef CONFIG_DEBUG_SPINLOCK
 	size_t i = 0;
 	bool deadlock_reported = false;
+#endif
+#ifdef CONFIG_LOCKSTAT
+	bool contended = false;
+	uint64_t spin_start = 0;
+#endif
 	
 	preemption_disable();
+#ifdef CONFIG_SPINLOCK_TICKET
+	atomic_count_t ticket = atomic_postinc(&lock->next);
+	while (atomic_get(&lock->owner) != ticket) {
+#else
 	while (test_and_set(&lock->val)) {
+#endif
+#ifdef CONFIG_LOCKSTAT
+		if (!contended) {
+			contended = true;
+			spin_start = get_cycle();
+		}
+#endif
+		cpu_spin_hint();
+		
+#ifdef CONFIG_DEBUG_SPINLOCK
 		/*
 		 * We need to be careful about particular locks
 		 * which are directly used to report deadlocks
@@ -110,15 +142,23 @@ void spinlock_lock_debug(spinlock_t *lock)
 			i = 0;
 			deadlock_reported = true;
 		}
+#endif
 	}
 	
+#ifdef CONFIG_DEBUG_SPINLOCK
 	if (deadlock_reported)
 		printf("cpu%u: not deadlocked\n", CPU->id);
+#endif
 	
 	/*
 	 * Prevent critical section code from bleeding out this way up.
 	 */
 	CS_ENTER_BARRIER();
+	
+#ifdef CONFIG_LOCKSTAT
+	lockstat_acquired(lock, contended,
+	    contended ? get_cycle() - spin_start : 0);
+#endif
 }
 
 /** Unlock spinlock
@@ -131,13 +171,7 @@ void spinlock_unlock_debug(spinlock_t *lock)
 {
 	ASSERT_SPINLOCK(spinlock_locked(lock), lock);
 	
-	/*
-	 * Prevent critical section code from bleeding out this way down.
-	 */
-	CS_LEAVE_BARRIER();
-	
-	atomic_set(&lock->val, 0);
-	preemption_enable();
+	spinlock_unlock_nondebug(lock);
 }
 
 #endif
@@ -155,7 +189,17 @@ void spinlock_unlock_debug(spinlock_t *lock)
 bool spinlock_trylock(spinlock_t *lock)
 {
 	preemption_disable();
+#ifdef CONFIG_SPINLOCK_TICKET
+	/*
+	 * The lock is free only if the next ticket is the one being
+	 * served. Take it only if nobody else took it meanwhile.
+	 */
+	atomic_count_t ticket = atomic_get(&lock->owner);
+	bool ret = __atomic_compare_exchange_n(&lock->next.count, &ticket,
+	    ticket + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#else
 	bool ret = !test_and_set(&lock->val);
+#endif
 	
 	/*
 	 * Prevent critical section code from bleeding out this way up.
@@ -164,6 +208,10 @@ bool spinlock_trylock(spinlock_t *lock)
 	
 	if (!ret)
 		preemption_enable();
+#ifdef CONFIG_LOCKSTAT
+	else
+		lockstat_acquired(lock, false, 0);
+#endif
 	
 	return ret;
 }
@@ -175,7 +223,11 @@ bool spinlock_trylock(spinlock_t *lock)
  */
 bool spinlock_locked(spinlock_t *lock)
 {
+#ifdef CONFIG_SPINLOCK_TICKET
+	return atomic_get(&lock->next) != atomic_get(&lock->owner);
+#else
 	return atomic_get(&lock->val) != 0;
+#endif
 }
 
 #endif
@@ -56,6 +56,8 @@
 #include <console/console.h>
 #include <udebug/udebug.h>
 #include <log.h>
+#include <prof.h>
+#include <tracepoint.h>
 
 /** Dispatch system call */
 sysarg_t syscall_handler(sysarg_t a1, sysarg_t a2, sysarg_t a3,
@@ -195,6 +197,12 @@ syshandler_t syscall_table[SYSCALL_END] = {
 	[SYS_DEBUG_CONSOLE] = (syshandler_t) sys_debug_console,
 	
 	[SYS_KLOG] = (syshandler_t) sys_klog,
+	
+	/* Sampling profiler syscalls. */
+	[SYS_PROF] = (syshandler_t) sys_prof,
+	
+	/* Tracepoint syscalls. */
+	[SYS_TRACEPOINT] = (syshandler_t) sys_tracepoint,
 };
 
 /** @}
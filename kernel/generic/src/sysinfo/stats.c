@@ -41,12 +41,17 @@
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
 #include <time/clock.h>
+#include <mm/as.h>
 #include <mm/frame.h>
+#include <mm/page.h>
+#include <mm/tlb.h>
+#include <mm/slab.h>
 #include <proc/task.h>
 #include <proc/thread.h>
 #include <interrupt.h>
 #include <stdbool.h>
 #include <str.h>
+#include <macros.h>
 #include <errno.h>
 #include <cpu.h>
 #include <arch.h>
@@ -81,6 +86,47 @@ static load_t avenrdy[LOAD_STEPS] = {0, 0, 0};
 /** Load calculation lock */
 static mutex_t load_lock;
 
+/** Tasks or threads which exited recently */
+typedef struct {
+	struct {
+		/** Task or thread ID */
+		uint64_t id;
+		/** Generation in which the task or thread exited */
+		atomic_count_t generation;
+	} records[STATS_EXITED_RECORDS];
+	
+	/** Number of exits recorded so far */
+	size_t count;
+	
+	/** Generation of the newest overwritten record */
+	atomic_count_t lost;
+} stats_exited_t;
+
+/** Produce statistics of a changed task or thread */
+typedef void (*stats_changes_produce_t)(stats_changes_t *, void *);
+
+/** Current generation of the statistics, zero requests everything */
+atomic_t stats_generation = {1};
+
+/** Lock protecting the lists of changed tasks and threads
+ *
+ * The lock is the innermost one, no other lock is taken while it is held.
+ *
+ */
+IRQ_SPINLOCK_STATIC_INITIALIZE(stats_changes_lock);
+
+/** Tasks ordered by the generation of their last change */
+LIST_INITIALIZE(stats_tasks_changed);
+
+/** Threads ordered by the generation of their last change */
+LIST_INITIALIZE(stats_threads_changed);
+
+/** Recently exited tasks, protected by tasks_lock */
+static stats_exited_t tasks_exited;
+
+/** Recently exited threads, protected by threads_lock */
+static stats_exited_t threads_exited;
+
 /** Get statistics of all CPUs
  *
  * @param item    Sysinfo item (unused).
@@ -140,87 +186,6 @@ static bool avl_count_walker(avltree_node_t *node, void *arg)
 	return true;
 }
 
-/** Get the size of a virtual address space
- *
- * @param as Address space.
- *
- * @return Size of the mapped virtual address space (bytes).
- *
- */
-static size_t get_task_virtmem(as_t *as)
-{
-	/*
-	 * We are holding spinlocks here and therefore are not allowed to
-	 * block. Only attempt to lock the address space and address space
-	 * area mutexes conditionally. If it is not possible to lock either
-	 * object, return inexact statistics by skipping the respective object.
-	 */
-	
-	if (mutex_trylock(&as->lock) != EOK)
-		return 0;
-	
-	size_t pages = 0;
-	
-	/* Walk the B+ tree and count pages */
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		unsigned int i;
-		for (i = 0; i < node->keys; i++) {
-			as_area_t *area = node->value[i];
-			
-			if (mutex_trylock(&area->lock) != EOK)
-				continue;
-			
-			pages += area->pages;
-			mutex_unlock(&area->lock);
-		}
-	}
-	
-	mutex_unlock(&as->lock);
-	
-	return (pages << PAGE_WIDTH);
-}
-
-/** Get the resident (used) size of a virtual address space
- *
- * @param as Address space.
- *
- * @return Size of the resident (used) virtual address space (bytes).
- *
- */
-static size_t get_task_resmem(as_t *as)
-{
-	/*
-	 * We are holding spinlocks here and therefore are not allowed to
-	 * block. Only attempt to lock the address space and address space
-	 * area mutexes conditionally. If it is not possible to lock either
-	 * object, return inexact statistics by skipping the respective object.
-	 */
-	
-	if (mutex_trylock(&as->lock) != EOK)
-		return 0;
-	
-	size_t pages = 0;
-	
-	/* Walk the B+ tree and count pages */
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t, node) {
-		unsigned int i;
-		for (i = 0; i < node->keys; i++) {
-			as_area_t *area = node->value[i];
-			
-			if (mutex_trylock(&area->lock) != EOK)
-				continue;
-			
-			pages += area->resident;
-			mutex_unlock(&area->lock);
-		}
-	}
-	
-	mutex_unlock(&as->lock);
-	
-	return (pages << PAGE_WIDTH);
-}
-
 /* Produce task statistics
  *
  * Summarize task information into task statistics.
@@ -236,11 +201,12 @@ static void produce_stats_task(task_t *task, stats_task_t *stats_task)
 	
 	stats_task->task_id = task->taskid;
 	str_cpy(stats_task->name, TASK_NAME_BUFLEN, task->name);
-	stats_task->virtmem = get_task_virtmem(task->as);
-	stats_task->resmem = get_task_resmem(task->as);
+	stats_task->virtmem = task->as->pages << PAGE_WIDTH;
+	stats_task->resmem = task->as->resident << PAGE_WIDTH;
 	stats_task->threads = atomic_get(&task->refcount);
 	task_get_accounting(task, &(stats_task->ucycles),
 	    &(stats_task->kcycles));
+	stats_task->page_faults = atomic_get(&task->page_faults);
 	stats_task->ipc_info = task->ipc_info;
 }
 
@@ -571,6 +537,446 @@ static sysinfo_return_t get_stats_thread(const char *name, bool dry_run,
 	return ret;
 }
 
+/** Remember a task or thread which exited
+ *
+ * @param exited Recently exited tasks or threads.
+ * @param id     Task or thread ID.
+ *
+ */
+static void stats_exited_record(stats_exited_t *exited, uint64_t id)
+{
+	size_t i = exited->count % STATS_EXITED_RECORDS;
+	
+	if (exited->count >= STATS_EXITED_RECORDS)
+		exited->lost = exited->records[i].generation;
+	
+	exited->records[i].id = id;
+	exited->records[i].generation = atomic_get(&stats_generation);
+	exited->count++;
+}
+
+/** Initialize changes of the statistics of a task or thread
+ *
+ * The task or thread is not tracked until it is inserted into
+ * its tree.
+ *
+ * @param changes Changes of the statistics.
+ *
+ */
+void stats_changes_initialize(stats_changes_t *changes)
+{
+	changes->generation = 0;
+	link_initialize(&changes->link);
+}
+
+/** Move a changed task or thread to the tail of its list
+ *
+ * @param changes Changes of the statistics of the task or thread.
+ * @param list    List of changed tasks or threads.
+ *
+ */
+void stats_changes_move(stats_changes_t *changes, list_t *list)
+{
+	irq_spinlock_lock(&stats_changes_lock, true);
+	
+	/* Tasks and threads are not tracked before creation and after exit */
+	if (link_in_use(&changes->link)) {
+		list_remove(&changes->link);
+		changes->generation = atomic_get(&stats_generation);
+		list_append(&changes->link, list);
+	}
+	
+	irq_spinlock_unlock(&stats_changes_lock, true);
+}
+
+/** Move the task owning a changed address space to the tail of its list
+ *
+ * @param as Address space.
+ *
+ */
+void stats_as_changes_move(as_t *as)
+{
+	irq_spinlock_lock(&stats_changes_lock, true);
+	
+	as->stats_generation = atomic_get(&stats_generation);
+	
+	stats_changes_t *changes = as->stats_owner;
+	if ((changes != NULL) &&
+	    (changes->generation != as->stats_generation)) {
+		list_remove(&changes->link);
+		changes->generation = as->stats_generation;
+		list_append(&changes->link, &stats_tasks_changed);
+	}
+	
+	irq_spinlock_unlock(&stats_changes_lock, true);
+}
+
+/** Start tracking the changes of a new task
+ *
+ * @param task Task inserted into the task tree.
+ *
+ */
+void stats_task_created(task_t *task)
+{
+	assert(irq_spinlock_locked(&tasks_lock));
+	
+	irq_spinlock_lock(&stats_changes_lock, false);
+	
+	task->stats_changes.generation = atomic_get(&stats_generation);
+	list_append(&task->stats_changes.link, &stats_tasks_changed);
+	
+	if (task->as->stats_owner == NULL)
+		task->as->stats_owner = &task->stats_changes;
+	
+	irq_spinlock_unlock(&stats_changes_lock, false);
+}
+
+/** Remember a task which exited
+ *
+ * @param task Task removed from the task tree.
+ *
+ */
+void stats_task_exited(task_t *task)
+{
+	assert(irq_spinlock_locked(&tasks_lock));
+	
+	stats_exited_record(&tasks_exited, task->taskid);
+	
+	irq_spinlock_lock(&stats_changes_lock, false);
+	
+	list_remove(&task->stats_changes.link);
+	
+	if (task->as->stats_owner == &task->stats_changes)
+		task->as->stats_owner = NULL;
+	
+	irq_spinlock_unlock(&stats_changes_lock, false);
+}
+
+/** Start tracking the changes of a new thread
+ *
+ * @param thread Thread inserted into the thread tree.
+ *
+ */
+void stats_thread_attached(thread_t *thread)
+{
+	assert(irq_spinlock_locked(&threads_lock));
+	
+	irq_spinlock_lock(&stats_changes_lock, false);
+	
+	thread->stats_changes.generation = atomic_get(&stats_generation);
+	list_append(&thread->stats_changes.link, &stats_threads_changed);
+	
+	irq_spinlock_unlock(&stats_changes_lock, false);
+}
+
+/** Remember a thread which exited
+ *
+ * @param thread Thread removed from the thread tree.
+ *
+ */
+void stats_thread_exited(thread_t *thread)
+{
+	assert(irq_spinlock_locked(&threads_lock));
+	
+	stats_exited_record(&threads_exited, thread->tid);
+	
+	irq_spinlock_lock(&stats_changes_lock, false);
+	list_remove(&thread->stats_changes.link);
+	irq_spinlock_unlock(&stats_changes_lock, false);
+}
+
+/** Check whether exits since a generation were forgotten
+ *
+ * @param exited Recently exited tasks or threads.
+ * @param since  Generation.
+ *
+ * @return True if a complete snapshot must be produced instead of a delta.
+ *
+ */
+static bool stats_exited_lost(stats_exited_t *exited, atomic_count_t since)
+{
+	return (since == 0) || (since <= exited->lost);
+}
+
+/** Gather IDs of tasks or threads which exited since a generation
+ *
+ * @param exited Recently exited tasks or threads.
+ * @param since  Generation.
+ * @param ids    Array to fill or NULL to only count the IDs.
+ *
+ * @return Number of the IDs.
+ *
+ */
+static size_t stats_exited_gather(stats_exited_t *exited,
+    atomic_count_t since, uint64_t *ids)
+{
+	size_t first = (exited->count > STATS_EXITED_RECORDS) ?
+	    exited->count - STATS_EXITED_RECORDS : 0;
+	size_t count = 0;
+	
+	for (size_t i = first; i < exited->count; i++) {
+		size_t j = i % STATS_EXITED_RECORDS;
+		
+		if (exited->records[j].generation < since)
+			continue;
+		
+		if (ids != NULL)
+			ids[count] = exited->records[j].id;
+		
+		count++;
+	}
+	
+	return count;
+}
+
+/** Produce statistics of a changed task
+ *
+ * @param changes Changes of the statistics of the task.
+ * @param entry   Record to fill.
+ *
+ */
+static void task_delta_produce(stats_changes_t *changes, void *entry)
+{
+	task_t *task = member_to_inst(changes, task_t, stats_changes);
+	
+	/* Interrupts are already disabled */
+	irq_spinlock_lock(&task->lock, false);
+	produce_stats_task(task, (stats_task_t *) entry);
+	irq_spinlock_unlock(&task->lock, false);
+}
+
+/** Produce statistics of a changed thread
+ *
+ * @param changes Changes of the statistics of the thread.
+ * @param entry   Record to fill.
+ *
+ */
+static void thread_delta_produce(stats_changes_t *changes, void *entry)
+{
+	thread_t *thread = member_to_inst(changes, thread_t, stats_changes);
+	
+	/* Interrupts are already disabled */
+	irq_spinlock_lock(&thread->lock, false);
+	produce_stats_thread(thread, (stats_thread_t *) entry);
+	irq_spinlock_unlock(&thread->lock, false);
+}
+
+/** Gather tasks or threads changed in a range of generations
+ *
+ * The list is ordered by the generation, so only its tail is visited.
+ * The caller holds stats_changes_lock.
+ *
+ * @param list    List of changed tasks or threads.
+ * @param since   First generation.
+ * @param until   Last generation.
+ * @param changes Array to fill or NULL to only count the objects.
+ * @param max     Capacity of the array.
+ *
+ * @return Number of the objects.
+ *
+ */
+static size_t stats_changes_gather(list_t *list, atomic_count_t since,
+    atomic_count_t until, stats_changes_t **changes, size_t max)
+{
+	size_t count = 0;
+	
+	list_foreach_rev(*list, link, stats_changes_t, cur) {
+		if (cur->generation < since)
+			break;
+		
+		if (cur->generation > until)
+			continue;
+		
+		if (changes != NULL) {
+			if (count == max)
+				break;
+			
+			changes[count] = cur;
+		}
+		
+		count++;
+	}
+	
+	return count;
+}
+
+/** Produce a delta snapshot of tasks or threads
+ *
+ * The caller holds the lock protecting the tree and the exited records,
+ * so no task or thread is created or destroyed meanwhile. Only the list
+ * of changed objects is visited. Every snapshot which is not a dry run
+ * starts a new generation. Objects changed in the generation returned in
+ * the snapshot header are listed again in the next delta, so that no
+ * change racing with the snapshot is missed.
+ *
+ * @param list       List of changed tasks or threads.
+ * @param produce    Function producing the record of an object.
+ * @param exited     Recently exited tasks or threads.
+ * @param entry_size Size of a record of a task or thread.
+ * @param since      Requested generation.
+ * @param dry_run    Do not get the data, just calculate the size.
+ *
+ * @return Sysinfo return holder as in get_stats_task().
+ *
+ */
+static sysinfo_return_t produce_stats_delta(list_t *list,
+    stats_changes_produce_t produce, stats_exited_t *exited,
+    size_t entry_size, uint64_t since, bool dry_run)
+{
+	sysinfo_return_t ret;
+	ret.tag = SYSINFO_VAL_UNDEFINED;
+	
+	bool full = stats_exited_lost(exited, since);
+	if (full)
+		since = 0;
+	
+	/*
+	 * Objects changing after the new generation is started are left for
+	 * the next delta. A complete snapshot includes all the objects.
+	 */
+	irq_spinlock_lock(&stats_changes_lock, false);
+	
+	atomic_count_t generation = dry_run ?
+	    (atomic_count_t) atomic_get(&stats_generation) :
+	    atomic_postinc(&stats_generation);
+	atomic_count_t until = full ? (atomic_count_t) -1 : generation;
+	size_t count = stats_changes_gather(list, since, until, NULL, 0);
+	
+	irq_spinlock_unlock(&stats_changes_lock, false);
+	
+	size_t exited_count = full ? 0 :
+	    stats_exited_gather(exited, since, NULL);
+	
+	if (dry_run) {
+		ret.tag = SYSINFO_VAL_FUNCTION_DATA;
+		ret.data.data = NULL;
+		ret.data.size = sizeof(stats_delta_t) + count * entry_size +
+		    exited_count * sizeof(uint64_t);
+		return ret;
+	}
+	
+	stats_changes_t **changes = NULL;
+	if (count > 0) {
+		changes = (stats_changes_t **)
+		    malloc(count * sizeof(stats_changes_t *), FRAME_ATOMIC);
+		if (changes == NULL)
+			return ret;
+	}
+	
+	/*
+	 * Objects only leave the range of generations meanwhile,
+	 * so the array is large enough.
+	 */
+	irq_spinlock_lock(&stats_changes_lock, false);
+	count = stats_changes_gather(list, since, until, changes, count);
+	irq_spinlock_unlock(&stats_changes_lock, false);
+	
+	size_t size = sizeof(stats_delta_t) + count * entry_size +
+	    exited_count * sizeof(uint64_t);
+	
+	stats_delta_t *delta = (stats_delta_t *) malloc(size, FRAME_ATOMIC);
+	if (delta == NULL) {
+		if (changes != NULL)
+			free(changes);
+		
+		return ret;
+	}
+	
+	delta->generation = generation;
+	delta->full = full;
+	delta->count = count;
+	delta->exited = exited_count;
+	
+	/* The objects cannot be destroyed while the caller holds the lock */
+	uint8_t *entries = (uint8_t *) (delta + 1);
+	for (size_t i = 0; i < count; i++)
+		produce(changes[i], entries + i * entry_size);
+	
+	if (!full)
+		stats_exited_gather(exited, since,
+		    (uint64_t *) (entries + count * entry_size));
+	
+	if (changes != NULL)
+		free(changes);
+	
+	ret.tag = SYSINFO_VAL_FUNCTION_DATA;
+	ret.data.data = (void *) delta;
+	ret.data.size = size;
+	
+	return ret;
+}
+
+/** Get statistics of tasks changed since a generation
+ *
+ * The generation is passed as a string. Zero requests all tasks.
+ *
+ * @param name    Generation (string-encoded number).
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Sysinfo return holder. The data start with stats_delta_t
+ *         followed by stats_task_t structures and task IDs.
+ *
+ */
+static sysinfo_return_t get_stats_tasks_delta(const char *name,
+    bool dry_run, void *data)
+{
+	/* Initially no return value */
+	sysinfo_return_t ret;
+	ret.tag = SYSINFO_VAL_UNDEFINED;
+	
+	/* Parse the generation */
+	uint64_t since;
+	if (str_uint64_t(name, NULL, 0, true, &since) != EOK)
+		return ret;
+	
+	/* Messing with task structures, avoid deadlock */
+	irq_spinlock_lock(&tasks_lock, true);
+	
+	ret = produce_stats_delta(&stats_tasks_changed, task_delta_produce,
+	    &tasks_exited, sizeof(stats_task_t), since, dry_run);
+	
+	irq_spinlock_unlock(&tasks_lock, true);
+	
+	return ret;
+}
+
+/** Get statistics of threads changed since a generation
+ *
+ * The generation is passed as a string. Zero requests all threads.
+ *
+ * @param name    Generation (string-encoded number).
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Sysinfo return holder. The data start with stats_delta_t
+ *         followed by stats_thread_t structures and thread IDs.
+ *
+ */
+static sysinfo_return_t get_stats_threads_delta(const char *name,
+    bool dry_run, void *data)
+{
+	/* Initially no return value */
+	sysinfo_return_t ret;
+	ret.tag = SYSINFO_VAL_UNDEFINED;
+	
+	/* Parse the generation */
+	uint64_t since;
+	if (str_uint64_t(name, NULL, 0, true, &since) != EOK)
+		return ret;
+	
+	/* Messing with threads structures, avoid deadlock */
+	irq_spinlock_lock(&threads_lock, true);
+	
+	ret = produce_stats_delta(&stats_threads_changed,
+	    thread_delta_produce, &threads_exited, sizeof(stats_thread_t),
+	    since, dry_run);
+	
+	irq_spinlock_unlock(&threads_lock, true);
+	
+	return ret;
+}
+
 /** Get exceptions statistics
  *
  * @param item    Sysinfo item (unused).
@@ -617,6 +1023,41 @@ static void *get_stats_exceptions(struct sysinfo_item *item, size_t *size,
 	return ((void *) stats_exceptions);
 }
 
+/** Get slab cache statistics
+ *
+ * @param item    Sysinfo item (unused).
+ * @param size    Size of the returned data.
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Data containing several stats_slab_t structures.
+ *         If the return value is not NULL, it should be freed
+ *         in the context of the sysinfo request.
+ */
+static void *get_stats_slabs(struct sysinfo_item *item, size_t *size,
+    bool dry_run, void *data)
+{
+	size_t count = slab_get_stats(NULL, 0);
+	*size = sizeof(stats_slab_t) * count;
+	
+	if (dry_run)
+		return NULL;
+	
+	stats_slab_t *stats_slabs =
+	    (stats_slab_t *) malloc(*size, FRAME_ATOMIC);
+	if (stats_slabs == NULL) {
+		/* No free space for allocation */
+		*size = 0;
+		return NULL;
+	}
+	
+	/* Caches created meanwhile are left out */
+	count = min(count, slab_get_stats(stats_slabs, count));
+	*size = sizeof(stats_slab_t) * count;
+	
+	return ((void *) stats_slabs);
+}
+
 /** Get exception statistics
  *
  * Get statistics of a given exception. The exception number
@@ -724,6 +1165,131 @@ static void *get_stats_physmem(struct sysinfo_item *item, size_t *size,
 	return ((void *) stats_physmem);
 }
 
+/** Get the number of serviced page faults
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of page faults serviced by the memory backends.
+ *
+ */
+static sysarg_t get_stats_page_faults(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&as_page_faults);
+}
+
+/** Get the number of pages populated by fault-around
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of pages populated ahead of the faulting page.
+ *
+ */
+static sysarg_t get_stats_fault_around_pages(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) atomic_get(&as_fault_around_pages);
+}
+
+/** Get the current fault-around limit
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Maximum number of pages populated by a single page fault.
+ *
+ */
+static sysarg_t get_stats_fault_around_max(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) fault_around_max;
+}
+
+/** Get the size of large pages used for anonymous memory
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Size of a large page in bytes, zero if not in use.
+ *
+ */
+static sysarg_t get_stats_large_pages_size(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) page_mapping_large_size();
+}
+
+/** Get the number of large page mappings created
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of large page mappings created so far.
+ *
+ */
+static sysarg_t get_stats_large_pages_mapped(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) atomic_get(&page_large_mappings);
+}
+
+/** Get the number of large page mappings split
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of large page mappings split into regular pages so far.
+ *
+ */
+static sysarg_t get_stats_large_pages_demoted(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) atomic_get(&page_large_demotions);
+}
+
+/** Get the number of TLB shootdowns
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of TLB shootdown sequences started so far.
+ *
+ */
+static sysarg_t get_stats_tlb_shootdowns(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) atomic_get(&tlb_shootdowns);
+}
+
+/** Get the number of TLB shootdown IPIs
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of TLB shootdown IPIs sent so far.
+ *
+ */
+static sysarg_t get_stats_tlb_ipis(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get(&tlb_shootdown_ipis);
+}
+
+/** Get the number of coalesced TLB shootdown IPIs
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Unused.
+ *
+ * @return Number of TLB shootdown IPIs which were not needed because
+ *         the target processor still had one pending.
+ *
+ */
+static sysarg_t get_stats_tlb_ipis_coalesced(struct sysinfo_item *item,
+    void *data)
+{
+	return (sysarg_t) atomic_get(&tlb_shootdown_ipis_coalesced);
+}
+
 /** Get system load
  *
  * @param item    Sysinfo item (unused).
@@ -811,8 +1377,30 @@ void stats_init(void)
 	sysinfo_set_item_gen_data("system.tasks", NULL, get_stats_tasks, NULL);
 	sysinfo_set_item_gen_data("system.threads", NULL, get_stats_threads, NULL);
 	sysinfo_set_item_gen_data("system.exceptions", NULL, get_stats_exceptions, NULL);
+	sysinfo_set_item_gen_data("system.slabs", NULL, get_stats_slabs, NULL);
+	sysinfo_set_item_gen_val("mm.page_faults", NULL, get_stats_page_faults,
+	    NULL);
+	sysinfo_set_item_gen_val("mm.fault_around.pages", NULL,
+	    get_stats_fault_around_pages, NULL);
+	sysinfo_set_item_gen_val("mm.fault_around.max", NULL,
+	    get_stats_fault_around_max, NULL);
+	sysinfo_set_item_gen_val("mm.large_pages.size", NULL,
+	    get_stats_large_pages_size, NULL);
+	sysinfo_set_item_gen_val("mm.large_pages.mapped", NULL,
+	    get_stats_large_pages_mapped, NULL);
+	sysinfo_set_item_gen_val("mm.large_pages.demoted", NULL,
+	    get_stats_large_pages_demoted, NULL);
+	sysinfo_set_item_gen_val("tlb.shootdowns", NULL,
+	    get_stats_tlb_shootdowns, NULL);
+	sysinfo_set_item_gen_val("tlb.ipis", NULL, get_stats_tlb_ipis, NULL);
+	sysinfo_set_item_gen_val("tlb.ipis_coalesced", NULL,
+	    get_stats_tlb_ipis_coalesced, NULL);
 	sysinfo_set_subtree_fn("system.tasks", NULL, get_stats_task, NULL);
 	sysinfo_set_subtree_fn("system.threads", NULL, get_stats_thread, NULL);
+	sysinfo_set_subtree_fn("system.tasks_delta", NULL,
+	    get_stats_tasks_delta, NULL);
+	sysinfo_set_subtree_fn("system.threads_delta", NULL,
+	    get_stats_threads_delta, NULL);
 	sysinfo_set_subtree_fn("system.exceptions", NULL, get_stats_exception, NULL);
 }
 
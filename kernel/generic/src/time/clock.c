@@ -57,6 +57,7 @@
 #include <mm/frame.h>
 #include <ddi/ddi.h>
 #include <arch/cycle.h>
+#include <prof.h>
 
 /* Pointer to variable with uptime */
 uptime_t *uptime;
@@ -93,6 +94,7 @@ void clock_counter_init(void)
 	clock_parea.pbase = faddr;
 	clock_parea.frames = 1;
 	clock_parea.unpriv = true;
+	clock_parea.readonly = false;
 	clock_parea.mapped = false;
 	ddi_parea_register(&clock_parea);
 	
@@ -149,6 +151,9 @@ void clock(void)
 	/* Account CPU usage */
 	cpu_update_accounting();
 	
+	/* Sample the interrupted code for the profiler */
+	prof_tick();
+	
 	/*
 	 * To avoid lock ordering problems,
 	 * run all expired timeouts as you visit them.
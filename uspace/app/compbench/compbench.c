@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup compbench
+ * @{
+ */
+/** @file Compression benchmark.
+ *
+ * Measures decompression throughput of a gzip file: with the bit-by-bit
+ * reference decoder libcompress used before, with the table-driven
+ * inflate() and with the gzip stream fed in small chunks.
+ *
+ * With -c, measures compression throughput and ratio of a file at the
+ * store, fast, default and best levels and with the gzip compression
+ * stream, checking that the result inflates back.
+ */
+
+#include <deflate.h>
+#include <errno.h>
+#include <gzip.h>
+#include <inflate.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+
+#include "ref_inflate.h"
+
+#define NAME  "compbench"
+
+#define DEFAULT_ITERATIONS  5
+
+/** Input chunk size for the stream benchmark */
+#define STREAM_IN_CHUNK   4096
+/** Output chunk size for the stream benchmark */
+#define STREAM_OUT_CHUNK  16384
+
+#define GZIP_FLAG_FHCRC     (1 << 1)
+#define GZIP_FLAG_FEXTRA    (1 << 2)
+#define GZIP_FLAG_FNAME     (1 << 3)
+#define GZIP_FLAG_FCOMMENT  (1 << 4)
+
+static void syntax_print(void)
+{
+	printf("syntax: %s [-n <iterations>] <file.gz>\n", NAME);
+	printf("        %s -c [-n <iterations>] <file>\n", NAME);
+}
+
+/** Locate the compressed data in a gzip file.
+ *
+ * @return EOK on success, EINVAL if the file is not a gzip file.
+ */
+static errno_t gzip_locate(uint8_t *data, size_t size, size_t *start,
+    size_t *length, size_t *dsize)
+{
+	if ((size < 18) || (data[0] != 0x1f) || (data[1] != 0x8b))
+		return EINVAL;
+
+	uint8_t flags = data[3];
+	size_t pos = 10;
+
+	if ((flags & GZIP_FLAG_FEXTRA) != 0)
+		pos += 2 + (data[pos] | (data[pos + 1] << 8));
+
+	if ((flags & GZIP_FLAG_FNAME) != 0) {
+		while ((pos < size) && (data[pos] != 0))
+			pos++;
+		pos++;
+	}
+
+	if ((flags & GZIP_FLAG_FCOMMENT) != 0) {
+		while ((pos < size) && (data[pos] != 0))
+			pos++;
+		pos++;
+	}
+
+	if ((flags & GZIP_FLAG_FHCRC) != 0)
+		pos += 2;
+
+	if (pos + 8 > size)
+		return EINVAL;
+
+	*start = pos;
+	*length = size - pos - 8;
+	*dsize = data[size - 4] | (data[size - 3] << 8) |
+	    (data[size - 2] << 16) | ((size_t) data[size - 1] << 24);
+	return EOK;
+}
+
+static errno_t stream_expand(uint8_t *data, size_t size, uint8_t *out,
+    size_t outsize)
+{
+	gzip_stream_t *stream;
+	size_t pos = 0;
+	size_t done = 0;
+
+	errno_t rc = gzip_stream_create(&stream);
+	if (rc != EOK)
+		return rc;
+
+	while (true) {
+		size_t len = min(STREAM_OUT_CHUNK, outsize - done);
+		size_t nread;
+
+		rc = gzip_stream_drain(stream, out + done, len, &nread);
+		if (rc != EOK)
+			break;
+
+		done += nread;
+		if (nread > 0)
+			continue;
+
+		if (gzip_stream_done(stream))
+			break;
+
+		if (pos == size) {
+			rc = ELIMIT;
+			break;
+		}
+
+		len = min(STREAM_IN_CHUNK, size - pos);
+		gzip_stream_feed(stream, data + pos, len);
+		pos += len;
+	}
+
+	gzip_stream_destroy(stream);
+
+	if ((rc == EOK) && (done != outsize))
+		rc = EINVAL;
+
+	return rc;
+}
+
+static errno_t stream_compress(uint8_t *data, size_t size, int level,
+    uint8_t *out, size_t outsize, size_t *csize)
+{
+	gzip_compress_stream_t *stream;
+	size_t pos = 0;
+	size_t done = 0;
+
+	errno_t rc = gzip_compress_stream_create(level, &stream);
+	if (rc != EOK)
+		return rc;
+
+	while (true) {
+		size_t len = min(STREAM_OUT_CHUNK, outsize - done);
+		size_t nread;
+
+		rc = gzip_compress_stream_drain(stream, out + done, len, &nread);
+		if (rc != EOK)
+			break;
+
+		done += nread;
+		if (nread == len) {
+			if (done == outsize) {
+				rc = ENOMEM;
+				break;
+			}
+
+			continue;
+		}
+
+		if (gzip_compress_stream_done(stream))
+			break;
+
+		len = min(STREAM_IN_CHUNK, size - pos);
+		gzip_compress_stream_feed(stream, data + pos, len);
+		pos += len;
+
+		if (pos == size)
+			gzip_compress_stream_finish(stream);
+	}
+
+	gzip_compress_stream_destroy(stream);
+	*csize = done;
+	return rc;
+}
+
+static void report(const char *name, size_t size, unsigned int iterations,
+    suseconds_t usec)
+{
+	if (usec == 0)
+		usec = 1;
+
+	uint64_t kbps = (uint64_t) size * iterations * 1000000 / 1024 / usec;
+	printf("%-10s %8lld us per iteration, %8" PRIu64 " KiB/s\n", name,
+	    (long long) (usec / iterations), kbps);
+}
+
+static void report_ratio(size_t size, size_t csize)
+{
+	uint64_t permille = (size > 0) ? (uint64_t) csize * 1000 / size : 0;
+	printf("%-10s %8zu bytes, %3" PRIu64 ".%" PRIu64 " %% of input\n", "",
+	    csize, permille / 10, permille % 10);
+}
+
+/** Benchmark compression of uncompressed data */
+static int bench_compress(uint8_t *data, size_t size, unsigned int iterations)
+{
+	static const struct {
+		const char *name;
+		int level;
+	} levels[] = {
+		{ "store", DEFLATE_LEVEL_STORE },
+		{ "fast", DEFLATE_LEVEL_FAST },
+		{ "default", DEFLATE_LEVEL_DEFAULT },
+		{ "best", DEFLATE_LEVEL_BEST }
+	};
+
+	struct timeval start, end;
+	size_t bound = deflate_bound(size) + 32;
+	uint8_t *comp = malloc(bound);
+	uint8_t *out = malloc(size);
+	size_t csize = 0;
+
+	if ((comp == NULL) || ((out == NULL) && (size > 0))) {
+		printf("%s: Out of memory\n", NAME);
+		return 1;
+	}
+
+	printf("%zu bytes, %u iterations\n", size, iterations);
+
+	for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+		getuptime(&start);
+		for (unsigned int it = 0; it < iterations; it++) {
+			errno_t rc = deflate(data, size, comp, bound,
+			    levels[l].level, &csize);
+			if (rc != EOK) {
+				printf("%s: deflate() failed (%s)\n", NAME,
+				    str_error(rc));
+				return 1;
+			}
+		}
+		getuptime(&end);
+		report(levels[l].name, size, iterations,
+		    tv_sub_diff(&end, &start));
+		report_ratio(size, csize);
+
+		if ((inflate(comp, csize, out, size) != EOK) ||
+		    (memcmp(data, out, size) != 0)) {
+			printf("%s: Compressed data does not inflate back\n",
+			    NAME);
+			return 1;
+		}
+	}
+
+	getuptime(&start);
+	for (unsigned int it = 0; it < iterations; it++) {
+		errno_t rc = stream_compress(data, size, DEFLATE_LEVEL_DEFAULT,
+		    comp, bound, &csize);
+		if (rc != EOK) {
+			printf("%s: gzip stream failed (%s)\n", NAME,
+			    str_error(rc));
+			return 1;
+		}
+	}
+	getuptime(&end);
+	report("stream", size, iterations, tv_sub_diff(&end, &start));
+	report_ratio(size, csize);
+
+	void *exp;
+	size_t esize;
+	if ((gzip_expand(comp, csize, &exp, &esize) != EOK) ||
+	    (esize != size) || (memcmp(data, exp, size) != 0)) {
+		printf("%s: gzip stream output does not expand back\n", NAME);
+		return 1;
+	}
+
+	free(exp);
+	free(comp);
+	free(out);
+	free(data);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = DEFAULT_ITERATIONS;
+	struct timeval start, end;
+	bool compress = false;
+	int i = 1;
+
+	if ((argc > i) && (str_cmp(argv[i], "-c") == 0)) {
+		compress = true;
+		i++;
+	}
+
+	if ((argc > i + 1) && (str_cmp(argv[i], "-n") == 0)) {
+		iterations = strtoul(argv[i + 1], NULL, 10);
+		if (iterations == 0) {
+			syntax_print();
+			return 1;
+		}
+		i += 2;
+	}
+
+	if (argc != i + 1) {
+		syntax_print();
+		return 1;
+	}
+
+	FILE *f = fopen(argv[i], "rb");
+	if (f == NULL) {
+		printf("%s: Error opening '%s'\n", NAME, argv[i]);
+		return 1;
+	}
+
+	if (fseek(f, 0, SEEK_END) < 0) {
+		printf("%s: Error determining size of '%s'\n", NAME, argv[i]);
+		fclose(f);
+		return 1;
+	}
+
+	long len = ftell(f);
+	if ((len < 0) || (fseek(f, 0, SEEK_SET) < 0)) {
+		printf("%s: Error determining size of '%s'\n", NAME, argv[i]);
+		fclose(f);
+		return 1;
+	}
+
+	size_t size = (size_t) len;
+	uint8_t *data = malloc(size);
+	if (data == NULL) {
+		printf("%s: Out of memory\n", NAME);
+		fclose(f);
+		return 1;
+	}
+
+	if (fread(data, 1, size, f) != size) {
+		printf("%s: Error reading '%s'\n", NAME, argv[i]);
+		fclose(f);
+		return 1;
+	}
+
+	fclose(f);
+
+	if (compress)
+		return bench_compress(data, size, iterations);
+
+	size_t start_pos, length, dsize;
+	if (gzip_locate(data, size, &start_pos, &length, &dsize) != EOK) {
+		printf("%s: '%s' is not a gzip file\n", NAME, argv[i]);
+		return 1;
+	}
+
+	uint8_t *ref = malloc(dsize);
+	uint8_t *out = malloc(dsize);
+	if ((ref == NULL) || (out == NULL)) {
+		printf("%s: Out of memory\n", NAME);
+		return 1;
+	}
+
+	printf("%zu bytes compressed, %zu bytes expanded, %u iterations\n",
+	    length, dsize, iterations);
+
+	getuptime(&start);
+	for (unsigned int it = 0; it < iterations; it++) {
+		if (ref_inflate(data + start_pos, length, ref, dsize) != EOK) {
+			printf("%s: Reference decoder failed\n", NAME);
+			return 1;
+		}
+	}
+	getuptime(&end);
+	report("reference", dsize, iterations, tv_sub_diff(&end, &start));
+
+	getuptime(&start);
+	for (unsigned int it = 0; it < iterations; it++) {
+		if (inflate(data + start_pos, length, out, dsize) != EOK) {
+			printf("%s: inflate() failed\n", NAME);
+			return 1;
+		}
+	}
+	getuptime(&end);
+	report("inflate", dsize, iterations, tv_sub_diff(&end, &start));
+
+	if (memcmp(ref, out, dsize) != 0) {
+		printf("%s: inflate() output differs\n", NAME);
+		return 1;
+	}
+
+	memset(out, 0, dsize);
+
+	getuptime(&start);
+	for (unsigned int it = 0; it < iterations; it++) {
+		errno_t rc = stream_expand(data, size, out, dsize);
+		if (rc != EOK) {
+			printf("%s: gzip stream failed (%s)\n", NAME,
+			    str_error(rc));
+			return 1;
+		}
+	}
+	getuptime(&end);
+	report("stream", dsize, iterations, tv_sub_diff(&end, &start));
+
+	if (memcmp(ref, out, dsize) != 0) {
+		printf("%s: gzip stream output differs\n", NAME);
+		return 1;
+	}
+
+	free(ref);
+	free(out);
+	free(data);
+	return 0;
+}
+
+/** @}
+ */
@@ -36,11 +36,16 @@
  */
 
 #include <dlfcn.h>
+#include <errno.h>
 #include <libdltest.h>
+#include <rtld/rtld.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+#include <task.h>
 
 /** libdltest library handle */
 static void *handle;
@@ -945,17 +950,129 @@ static int test_lnk(void)
 
 #endif /* DLTEST_LINKED */
 
+/** Print the symbol binding statistics of this task.
+ *
+ * Used in startup-only mode, so the numbers describe the work done
+ * while loading dltest and running it up to main().
+ */
+static void print_startup_stats(void)
+{
+	if (runtime_env == NULL) {
+		printf("Not dynamically linked\n");
+		return;
+	}
+
+	printf("Symbol lookups: %zu, cache hits: %zu\n",
+	    runtime_env->sym_lookups, runtime_env->sym_cache_hits);
+	printf("PLT entries: %zu left for lazy binding, %zu bound so far\n",
+	    runtime_env->plt_lazy_slots, runtime_env->plt_lazy_binds);
+}
+
+/** Spawn dltest in startup-only mode and wait for it to finish.
+ *
+ * @param mode Startup-only mode switch to pass
+ * @return EOK on success or an error code
+ */
+static errno_t run_startup(const char *mode)
+{
+	task_id_t id;
+	task_wait_t wait;
+	task_exit_t texit;
+	int retval;
+	errno_t rc;
+
+	rc = task_spawnl(&id, &wait, "/app/dltest", "/app/dltest", mode,
+	    NULL);
+	if (rc != EOK) {
+		printf("FAILED to spawn dltest: %s\n", str_error(rc));
+		return rc;
+	}
+
+	rc = task_wait(&wait, &texit, &retval);
+	if (rc != EOK || texit != TASK_EXIT_NORMAL || retval != 0) {
+		printf("FAILED: dltest did not exit normally\n");
+		return EIO;
+	}
+
+	return EOK;
+}
+
+/** Measure startup time of a dynamically linked program.
+ *
+ * Repeatedly spawn dltest in startup-only mode and wait for it to
+ * finish. This covers loading, relocation and symbol binding. One more
+ * instance is then spawned to print its own binding statistics, which
+ * are the same for every run.
+ *
+ * There is no switch for eager binding, so only lazy binding is timed.
+ * The number of PLT entries left for lazy binding is the number of
+ * symbol lookups eager binding would have added to the startup.
+ *
+ * @param count Number of runs
+ * @return EOK on success or an error code
+ */
+static errno_t bench_startup(unsigned count)
+{
+	struct timeval start;
+	struct timeval end;
+	unsigned i;
+	errno_t rc;
+
+	printf("Measuring startup time (%u runs)...\n", count);
+
+	getuptime(&start);
+	for (i = 0; i < count; i++) {
+		rc = run_startup("-s");
+		if (rc != EOK)
+			return rc;
+	}
+	getuptime(&end);
+
+	printf("Average startup time: %ld us\n",
+	    (long) (tv_sub_diff(&end, &start) / count));
+
+	return run_startup("-c");
+}
+
 static void print_syntax(void)
 {
-	fprintf(stderr, "syntax: dltest [-n]\n");
+	fprintf(stderr, "syntax: dltest [-n | -b <count>]\n");
 	fprintf(stderr, "\t-n Do not run dlfcn tests\n");
+	fprintf(stderr, "\t-b Measure program startup time over <count> runs\n");
 }
 
 int main(int argc, char *argv[])
 {
+	unsigned count;
+	char *endptr;
+
+	/* Startup-only modes used by the startup benchmark */
+	if (argc == 2 && str_cmp(argv[1], "-s") == 0)
+		return 0;
+
+	if (argc == 2 && str_cmp(argv[1], "-c") == 0) {
+		print_startup_stats();
+		return 0;
+	}
+
 	printf("Dynamic linking test\n");
 
 	if (argc > 1) {
+		if (str_cmp(argv[1], "-b") == 0) {
+			if (argc != 3) {
+				print_syntax();
+				return 1;
+			}
+
+			count = strtoul(argv[2], &endptr, 10);
+			if (*endptr != '\0' || count == 0) {
+				print_syntax();
+				return 1;
+			}
+
+			return bench_startup(count) == EOK ? 0 : 1;
+		}
+
 		if (argc > 2) {
 			print_syntax();
 			return 1;
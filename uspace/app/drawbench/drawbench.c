@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup drawbench
+ * @{
+ */
+/** @file Compositing benchmark.
+ *
+ * Measures frame times of transferring a translucent, transformed window
+ * onto a full HD screen, once pixel by pixel the way libdraw used to do
+ * it and once through drawctx_transfer() using the span renderer.
+ */
+
+#include <errno.h>
+#include <io/pixel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+
+#include <compose.h>
+#include <drawctx.h>
+#include <filter.h>
+#include <source.h>
+#include <surface.h>
+#include <transform.h>
+
+#define NAME  "drawbench"
+
+#define SCREEN_WIDTH   1920
+#define SCREEN_HEIGHT  1080
+#define WINDOW_WIDTH   800
+#define WINDOW_HEIGHT  600
+
+#define DEFAULT_FRAMES  10
+
+typedef struct {
+	const char *name;
+	filter_t filter;
+	uint8_t opacity;
+	double angle;
+	double scale;
+} bench_case_t;
+
+static bench_case_t cases[] = {
+	{ "fade", filter_nearest, 160, 0, 1 },
+	{ "fade-bilinear", filter_bilinear, 160, 0, 1 },
+	{ "rotate", filter_nearest, 255, 0.3, 1 },
+	{ "rotate-bilinear", filter_bilinear, 255, 0.3, 1 },
+	{ "zoom-bilinear", filter_bilinear, 220, 0, 1.5 }
+};
+
+static const pixel_t bg_color = PIXEL(255, 69, 51, 103);
+
+static void paint_window(surface_t *win)
+{
+	for (sysarg_t y = 0; y < WINDOW_HEIGHT; y++) {
+		for (sysarg_t x = 0; x < WINDOW_WIDTH; x++) {
+			/* Opaque body with a translucent frame */
+			uint8_t a = (x < 16 || y < 16 || x >= WINDOW_WIDTH - 16 ||
+			    y >= WINDOW_HEIGHT - 16) ? 128 : 255;
+			surface_put_pixel(win, x, y,
+			    PIXEL(a, x & 0xff, y & 0xff, (x ^ y) & 0xff));
+		}
+	}
+}
+
+static void clear_screen(surface_t *screen)
+{
+	pixel_t *pixel = surface_direct_access(screen);
+	for (size_t i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+		pixel[i] = bg_color;
+}
+
+/** Transfer the source pixel by pixel, as libdraw used to. */
+static void transfer_pixels(surface_t *screen, source_t *source)
+{
+	for (sysarg_t y = 0; y < SCREEN_HEIGHT; y++) {
+		for (sysarg_t x = 0; x < SCREEN_WIDTH; x++) {
+			pixel_t p_src = source_determine_pixel(source, x, y);
+			pixel_t p_dst = surface_get_pixel(screen, x, y);
+			surface_put_pixel(screen, x, y, compose_over(p_src, p_dst));
+		}
+	}
+}
+
+/** Compare two screens, return the largest difference in a channel. */
+static unsigned screen_diff(surface_t *a, surface_t *b)
+{
+	pixel_t *pa = surface_direct_access(a);
+	pixel_t *pb = surface_direct_access(b);
+	unsigned max = 0;
+
+	for (size_t i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+		for (unsigned shift = 0; shift < 32; shift += 8) {
+			int ca = (pa[i] >> shift) & 0xff;
+			int cb = (pb[i] >> shift) & 0xff;
+			unsigned d = ca > cb ? ca - cb : cb - ca;
+			if (d > max)
+				max = d;
+		}
+	}
+
+	return max;
+}
+
+static void run_case(bench_case_t *bc, surface_t *win, surface_t *ref,
+    surface_t *screen, unsigned frames)
+{
+	struct timeval start, end;
+	transform_t transform;
+	source_t source;
+	drawctx_t context;
+	suseconds_t t_pixel, t_span;
+
+	/* Center the window on the screen */
+	transform_identity(&transform);
+	transform_translate(&transform, -WINDOW_WIDTH / 2.0,
+	    -WINDOW_HEIGHT / 2.0);
+	transform_scale(&transform, bc->scale, bc->scale);
+	transform_rotate(&transform, bc->angle);
+	transform_translate(&transform, SCREEN_WIDTH / 2.0,
+	    SCREEN_HEIGHT / 2.0);
+
+	source_init(&source);
+	source_set_filter(&source, bc->filter);
+	source_set_transform(&source, transform);
+	source_set_texture(&source, win, PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+	source_set_alpha(&source, PIXEL(bc->opacity, 0, 0, 0));
+
+	getuptime(&start);
+	for (unsigned i = 0; i < frames; i++) {
+		clear_screen(ref);
+		transfer_pixels(ref, &source);
+	}
+	getuptime(&end);
+	t_pixel = tv_sub_diff(&end, &start) / frames;
+
+	drawctx_init(&context, screen);
+	drawctx_set_compose(&context, compose_over);
+	drawctx_set_source(&context, &source);
+
+	getuptime(&start);
+	for (unsigned i = 0; i < frames; i++) {
+		clear_screen(screen);
+		drawctx_transfer(&context, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+	}
+	getuptime(&end);
+	t_span = tv_sub_diff(&end, &start) / frames;
+
+	printf("%-16s %10ld %10ld %7ld.%02ld %9u\n", bc->name,
+	    (long) t_pixel / 1000, (long) t_span / 1000,
+	    (long) (t_span > 0 ? t_pixel / t_span : 0),
+	    (long) (t_span > 0 ? (t_pixel * 100 / t_span) % 100 : 0),
+	    screen_diff(ref, screen));
+}
+
+static void print_syntax(void)
+{
+	printf("Syntax: %s [<frames>]\n", NAME);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned frames = DEFAULT_FRAMES;
+	surface_t *win = NULL;
+	surface_t *ref = NULL;
+	surface_t *screen = NULL;
+	char *endptr;
+
+	if (argc > 2) {
+		print_syntax();
+		return 1;
+	}
+
+	if (argc == 2) {
+		frames = strtoul(argv[1], &endptr, 10);
+		if (*endptr != '\0' || frames == 0) {
+			print_syntax();
+			return 1;
+		}
+	}
+
+	win = surface_create(WINDOW_WIDTH, WINDOW_HEIGHT, NULL, 0);
+	ref = surface_create(SCREEN_WIDTH, SCREEN_HEIGHT, NULL, 0);
+	screen = surface_create(SCREEN_WIDTH, SCREEN_HEIGHT, NULL, 0);
+	if (win == NULL || ref == NULL || screen == NULL) {
+		printf("%s: Out of memory.\n", NAME);
+		goto error;
+	}
+
+	paint_window(win);
+
+	printf("%ux%u screen, %ux%u window, %u frames per case\n",
+	    SCREEN_WIDTH, SCREEN_HEIGHT, WINDOW_WIDTH, WINDOW_HEIGHT, frames);
+	printf("%-16s %10s %10s %10s %9s\n", "case", "pixel[ms]", "span[ms]",
+	    "speedup", "max diff");
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+		run_case(&cases[i], win, ref, screen, frames);
+
+	surface_destroy(win);
+	surface_destroy(ref);
+	surface_destroy(screen);
+	return 0;
+
+error:
+	if (win != NULL)
+		surface_destroy(win);
+	if (ref != NULL)
+		surface_destroy(ref);
+	if (screen != NULL)
+		surface_destroy(screen);
+	return 2;
+}
+
+/** @}
+ */
@@ -37,13 +37,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/** Size of the input and output buffers */
+#define BUFFER_SIZE  65536
+
 int main(int argc, char *argv[])
 {
 	errno_t rc;
+	gzip_stream_t *stream;
 	void *data, *ddata;
-	size_t size, dsize;
-	size_t nread, nwr;
-	long len;
+	size_t nread, dsize, nwr;
 	FILE *f, *wf;
 
 	if (argc != 3) {
@@ -51,74 +53,80 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	f = fopen(argv[1], "rb");
-	if (f == NULL) {
-		printf("Error opening '%s'\n", argv[1]);
-		return 1;
-	}
-
-	if (fseek(f, 0, SEEK_END) < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	len = ftell(f);
-	if (len < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
+	data = malloc(BUFFER_SIZE);
+	ddata = malloc(BUFFER_SIZE);
+	if ((data == NULL) || (ddata == NULL)) {
+		printf("Error allocating buffers.\n");
 		return 1;
 	}
 
-	if (fseek(f, 0, SEEK_SET) < 0) {
-		printf ("Error rewinding '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	data = malloc(len);
-	if (data == NULL) {
-		printf("Error allocating %ld bytes.\n", len);
-		fclose(f);
-		return 1;
-	}
-
-	nread = fread(data, 1, len, f);
-	if (nread != (size_t)len) {
-		printf("Error reading '%s'\n", argv[1]);
-		fclose(f);
+	rc = gzip_stream_create(&stream);
+	if (rc != EOK) {
+		printf("Error creating decompression stream.\n");
 		return 1;
 	}
 
-	fclose(f);
-
-	size = (size_t) len;
-
-	rc = gzip_expand(data, size, &ddata, &dsize);
-	if (rc != EOK) {
-		printf("Error decompressing data.\n");
+	f = fopen(argv[1], "rb");
+	if (f == NULL) {
+		printf("Error opening '%s'\n", argv[1]);
 		return 1;
 	}
 
 	wf = fopen(argv[2], "wb");
 	if (wf == NULL) {
 		printf("Error creating file '%s'\n", argv[2]);
+		fclose(f);
 		return 1;
 	}
 
-	nwr = fwrite(ddata, 1, dsize, wf);
-	if (nwr != dsize) {
-		printf("Error writing '%s'\n", argv[2]);
-		fclose(wf);
-		return 1;
+	/* Decompress the data as it is read */
+	while (true) {
+		rc = gzip_stream_drain(stream, ddata, BUFFER_SIZE, &dsize);
+		if (rc != EOK) {
+			printf("Error decompressing data.\n");
+			goto error;
+		}
+
+		if (dsize > 0) {
+			nwr = fwrite(ddata, 1, dsize, wf);
+			if (nwr != dsize) {
+				printf("Error writing '%s'\n", argv[2]);
+				goto error;
+			}
+
+			continue;
+		}
+
+		if (gzip_stream_done(stream))
+			break;
+
+		/* More input is needed */
+		nread = fread(data, 1, BUFFER_SIZE, f);
+		if (nread == 0) {
+			if (ferror(f))
+				printf("Error reading '%s'\n", argv[1]);
+			else
+				printf("Unexpected end of '%s'\n", argv[1]);
+			goto error;
+		}
+
+		gzip_stream_feed(stream, data, nread);
 	}
 
+	fclose(f);
+	gzip_stream_destroy(stream);
+
 	if (fclose(wf) != 0) {
 		printf("Error writing '%s'\n", argv[2]);
 		return 1;
 	}
 
 	return 0;
+error:
+	fclose(f);
+	fclose(wf);
+	gzip_stream_destroy(stream);
+	return 1;
 }
 
 /** @}
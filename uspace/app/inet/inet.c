@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <inet/addr.h>
 #include <inet/inetcfg.h>
+#include <inttypes.h>
 #include <io/table.h>
 #include <loc.h>
 #include <stdio.h>
@@ -58,6 +59,7 @@ static void print_syntax(void)
 	printf("  %s create-sr <dest-addr>/<width> <router-addr> <route-name>\n", NAME);
 	printf("  %s delete-sr <route-name>\n", NAME);
 	printf("  %s list-link\n", NAME);
+	printf("  %s link-stats\n", NAME);
 }
 
 static errno_t addr_create_static(int argc, char *argv[])
@@ -395,6 +397,79 @@ out:
 	return rc;
 }
 
+static errno_t link_stats(void)
+{
+	sysarg_t *link_list = NULL;
+	inet_link_info_t linfo;
+	inet_link_stats_t lstats;
+	table_t *table = NULL;
+
+	size_t count;
+	size_t i;
+	errno_t rc;
+
+	rc = inetcfg_get_link_list(&link_list, &count);
+	if (rc != EOK) {
+		printf(NAME ": Failed getting link list.\n");
+		return rc;
+	}
+
+	rc = table_create(&table);
+	if (rc != EOK) {
+		printf("Memory allocation failed.\n");
+		goto out;
+	}
+
+	table_header_row(table);
+	table_printf(table, "Link-Name\t" "Frames\t" "Batches\t" "Frm/Batch\t"
+	    "Link-Bytes\t" "Packets\t" "Bytes\t" "Errors\n");
+
+	for (i = 0; i < count; i++) {
+		rc = inetcfg_link_get(link_list[i], &linfo);
+		if (rc != EOK) {
+			printf("Failed getting properties of link %zu.\n",
+			    (size_t)link_list[i]);
+			continue;
+		}
+
+		rc = inetcfg_link_get_stats(link_list[i], &lstats);
+		if (rc != EOK) {
+			printf("Failed getting statistics of link %zu.\n",
+			    (size_t)link_list[i]);
+			free(linfo.name);
+			continue;
+		}
+
+		uint64_t per_batch = lstats.link_rx_batches != 0 ?
+		    lstats.link_rx_frames / lstats.link_rx_batches : 0;
+
+		table_printf(table, "%s\t" "%" PRIu64 "\t" "%" PRIu64 "\t"
+		    "%" PRIu64 "\t" "%" PRIu64 "\t" "%" PRIu64 "\t"
+		    "%" PRIu64 "\t" "%" PRIu64 "\n", linfo.name,
+		    lstats.link_rx_frames, lstats.link_rx_batches, per_batch,
+		    lstats.link_rx_bytes, lstats.rx_packets, lstats.rx_bytes,
+		    lstats.rx_errors);
+
+		free(linfo.name);
+		linfo.name = NULL;
+	}
+
+	if (count != 0) {
+		rc = table_print_out(table, stdout);
+		if (rc != EOK) {
+			printf("Error printing table.\n");
+			goto out;
+		}
+	}
+
+	rc = EOK;
+out:
+	table_destroy(table);
+	free(link_list);
+
+	return rc;
+}
+
 static errno_t sroute_list(void)
 {
 	sysarg_t *sroute_list = NULL;
@@ -526,6 +601,10 @@ int main(int argc, char *argv[])
 		rc = link_list();
 		if (rc != EOK)
 			return 1;
+	} else if (str_cmp(argv[1], "link-stats") == 0) {
+		rc = link_stats();
+		if (rc != EOK)
+			return 1;
 	} else {
 		printf(NAME ": Unknown command '%s'.\n", argv[1]);
 		print_syntax();
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup loadgen
+ * @{
+ */
+/** @file HTTP load generator.
+ *
+ * Opens a number of connections to a web server and sends GET requests
+ * over each of them, reusing the connection and optionally pipelining
+ * several requests, then reports the achieved request rate.
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <http/http.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+
+#define NAME  "loadgen"
+
+#define DEFAULT_PORT  8080
+#define DEFAULT_CONNS  4
+#define DEFAULT_REQUESTS  1000
+#define DEFAULT_DEPTH  1
+
+/** Limits for receiving response headers */
+#define HEADER_SIZE_MAX  (16 * 1024)
+#define HEADER_COUNT_MAX  32
+
+/** Buffer for discarding response bodies */
+#define BODY_BUFFER_SIZE  4096
+
+static const char *host;
+static uint16_t port = DEFAULT_PORT;
+static const char *path = "/";
+static unsigned int nconns = DEFAULT_CONNS;
+static unsigned int nrequests = DEFAULT_REQUESTS;
+static unsigned int depth = DEFAULT_DEPTH;
+
+static FIBRIL_MUTEX_INITIALIZE(done_lock);
+static FIBRIL_CONDVAR_INITIALIZE(done_cv);
+static unsigned int running;
+
+/** Totals over all connections, protected by done_lock */
+static uint64_t total_requests;
+static uint64_t total_bytes;
+static unsigned int total_errors;
+
+static void syntax_print(void)
+{
+	printf("syntax: %s [-c <connections>] [-n <requests>] [-d <depth>]\n"
+	    "    [-p <port>] <host> [<path>]\n", NAME);
+	printf("\n"
+	    "    -c  Number of concurrent connections (default %u)\n"
+	    "    -n  Requests sent over each connection (default %u)\n"
+	    "    -d  Requests in flight on a connection (default %u)\n"
+	    "    -p  Server port (default %u)\n",
+	    DEFAULT_CONNS, DEFAULT_REQUESTS, DEFAULT_DEPTH, DEFAULT_PORT);
+}
+
+/** Receive one response and discard its body.
+ *
+ * @param http Connection
+ * @param buf Buffer for the body
+ * @param rbytes Place to store the size of the body
+ * @return EOK on success or an error code
+ */
+static errno_t response_receive(http_t *http, char *buf, uint64_t *rbytes)
+{
+	http_response_t *resp = NULL;
+	char *value;
+	uint64_t length;
+
+	errno_t rc = http_receive_response(&http->recv_buffer, &resp,
+	    HEADER_SIZE_MAX, HEADER_COUNT_MAX);
+	if (rc != EOK)
+		return rc;
+
+	if (resp->status != 200) {
+		rc = EIO;
+		goto out;
+	}
+
+	/* Without a length the body could not be delimited */
+	rc = http_headers_get(&resp->headers, "Content-Length", &value);
+	if (rc != EOK)
+		goto out;
+
+	rc = str_uint64_t(value, NULL, 10, true, &length);
+	if (rc != EOK)
+		goto out;
+
+	*rbytes = length;
+	while (length > 0) {
+		size_t nrecv;
+		rc = recv_buffer(&http->recv_buffer, buf,
+		    min(length, BODY_BUFFER_SIZE), &nrecv);
+		if (rc != EOK)
+			goto out;
+
+		if (nrecv == 0) {
+			rc = EIO;
+			goto out;
+		}
+
+		length -= nrecv;
+	}
+
+out:
+	http_response_destroy(resp);
+	return rc;
+}
+
+/** Run the requests of one connection. */
+static errno_t conn_run(http_t *http, uint64_t *rrequests, uint64_t *rbytes)
+{
+	char *buf = NULL;
+	http_request_t *req = NULL;
+	unsigned int sent = 0;
+	unsigned int received = 0;
+	errno_t rc;
+
+	buf = malloc(BODY_BUFFER_SIZE);
+	req = http_request_create("GET", path);
+	if (buf == NULL || req == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = http_headers_append(&req->headers, "Host", host);
+	if (rc != EOK)
+		goto out;
+
+	rc = http_connect(http);
+	if (rc != EOK)
+		goto out;
+
+	while (received < nrequests) {
+		/* Keep up to depth requests in flight */
+		while (sent < nrequests && sent - received < depth) {
+			rc = http_send_request(http, req);
+			if (rc != EOK)
+				goto out;
+			sent++;
+		}
+
+		uint64_t bytes;
+		rc = response_receive(http, buf, &bytes);
+		if (rc != EOK)
+			goto out;
+
+		received++;
+		*rbytes += bytes;
+	}
+
+out:
+	*rrequests = received;
+	if (req != NULL)
+		http_request_destroy(req);
+	free(buf);
+	return rc;
+}
+
+static errno_t conn_fibril(void *arg)
+{
+	uint64_t requests = 0;
+	uint64_t bytes = 0;
+	errno_t rc;
+
+	http_t *http = http_create(host, port);
+	if (http != NULL) {
+		rc = conn_run(http, &requests, &bytes);
+		http_destroy(http);
+	} else {
+		rc = ENOMEM;
+	}
+
+	if (rc != EOK)
+		printf("%s: Connection failed: %s\n", NAME, str_error(rc));
+
+	fibril_mutex_lock(&done_lock);
+	total_requests += requests;
+	total_bytes += bytes;
+	if (rc != EOK)
+		total_errors++;
+	running--;
+	fibril_condvar_broadcast(&done_cv);
+	fibril_mutex_unlock(&done_lock);
+
+	return rc;
+}
+
+static errno_t parse_uint(int argc, char *argv[], int *i, unsigned int *value)
+{
+	if (*i + 1 >= argc)
+		return EINVAL;
+
+	(*i)++;
+	errno_t rc = str_uint32_t(argv[*i], NULL, 10, true, value);
+	if (rc != EOK || *value == 0)
+		return EINVAL;
+
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timeval start, end;
+	unsigned int value;
+	errno_t rc;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		switch (argv[i][1]) {
+		case 'c':
+			rc = parse_uint(argc, argv, &i, &nconns);
+			break;
+		case 'n':
+			rc = parse_uint(argc, argv, &i, &nrequests);
+			break;
+		case 'd':
+			rc = parse_uint(argc, argv, &i, &depth);
+			break;
+		case 'p':
+			rc = parse_uint(argc, argv, &i, &value);
+			if (rc == EOK && value > UINT16_MAX)
+				rc = EINVAL;
+			port = value;
+			break;
+		default:
+			rc = EINVAL;
+			break;
+		}
+
+		if (rc != EOK) {
+			syntax_print();
+			return 1;
+		}
+	}
+
+	if (i >= argc || argc - i > 2) {
+		syntax_print();
+		return 1;
+	}
+
+	host = argv[i];
+	if (argc - i == 2)
+		path = argv[i + 1];
+
+	printf("%u connections, %u requests each, %u in flight\n",
+	    nconns, nrequests, depth);
+
+	getuptime(&start);
+
+	fibril_mutex_lock(&done_lock);
+	for (unsigned int c = 0; c < nconns; c++) {
+		fid_t fid = fibril_create(conn_fibril, NULL);
+		if (fid == 0) {
+			printf("%s: Out of memory\n", NAME);
+			break;
+		}
+
+		running++;
+		fibril_add_ready(fid);
+	}
+
+	while (running > 0)
+		fibril_condvar_wait(&done_cv, &done_lock);
+	fibril_mutex_unlock(&done_lock);
+
+	getuptime(&end);
+
+	suseconds_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+
+	printf("%" PRIu64 " requests, %" PRIu64 " bytes in %lld ms, "
+	    "%u failed connections\n", total_requests, total_bytes,
+	    (long long) usec / 1000, total_errors);
+	printf("%" PRIu64 " requests/s, %" PRIu64 " KiB/s\n",
+	    total_requests * 1000000 / usec,
+	    total_bytes * 1000000 / usec / 1024);
+
+	return (total_errors == 0) ? 0 : 1;
+}
+
+/** @}
+ */
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup mixbench
+ * @{
+ */
+/** @file Audio mixing benchmark.
+ *
+ * Measures pcm_format_convert_and_mix() for the format pairs hound
+ * commonly mixes, against the float based reference it replaced.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pcm/format.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+
+#include "ref_mix.h"
+
+#define NAME  "mixbench"
+
+#define DEFAULT_ITERATIONS  1000
+
+/** Frames per mixed buffer */
+#define BUFFER_FRAMES  4096
+
+typedef struct {
+	const char *name;
+	pcm_format_t src;
+	pcm_format_t dst;
+	/** The result is comparable with the reference */
+	bool compare;
+} bench_case_t;
+
+#define FORMAT(ch, fmt)  { .channels = (ch), .sampling_rate = 44100, \
+	.sample_format = (fmt) }
+
+static bench_case_t cases[] = {
+	{ "s16 -> s16", FORMAT(2, PCM_SAMPLE_SINT16_LE),
+	    FORMAT(2, PCM_SAMPLE_SINT16_LE), true },
+	{ "s16 mono -> stereo", FORMAT(1, PCM_SAMPLE_SINT16_LE),
+	    FORMAT(2, PCM_SAMPLE_SINT16_LE), false },
+	{ "s16 stereo -> mono", FORMAT(2, PCM_SAMPLE_SINT16_LE),
+	    FORMAT(1, PCM_SAMPLE_SINT16_LE), false },
+	{ "s16 -> s32", FORMAT(2, PCM_SAMPLE_SINT16_LE),
+	    FORMAT(2, PCM_SAMPLE_SINT32_LE), true },
+	{ "s32 -> s16", FORMAT(2, PCM_SAMPLE_SINT32_LE),
+	    FORMAT(2, PCM_SAMPLE_SINT16_LE), true },
+	{ "u8 -> s16", FORMAT(2, PCM_SAMPLE_UINT8),
+	    FORMAT(2, PCM_SAMPLE_SINT16_LE), true },
+	{ "s16 -> u16", FORMAT(2, PCM_SAMPLE_SINT16_LE),
+	    FORMAT(2, PCM_SAMPLE_UINT16_LE), true },
+};
+
+static void syntax_print(void)
+{
+	printf("syntax: %s [-n <iterations>]\n", NAME);
+}
+
+/** Fill a buffer with a pseudo-random signal of about half amplitude. */
+static void fill_signal(uint8_t *buf, size_t size, uint32_t seed)
+{
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+		/* Keep the most significant byte of each sample moderate */
+		if ((i & 1) != 0)
+			buf[i] = (buf[i] & 0x7f) - 0x40;
+	}
+}
+
+/** Largest difference of destination samples, in 16-bit units. */
+static uint32_t max_diff(const void *a, const void *b, size_t size,
+    pcm_sample_format_t fmt)
+{
+	uint32_t diff = 0;
+
+	for (size_t i = 0; i < size / pcm_sample_format_size(fmt); i++) {
+		int64_t x, y;
+
+		switch (fmt) {
+		case PCM_SAMPLE_SINT16_LE:
+			x = ((const int16_t *) a)[i];
+			y = ((const int16_t *) b)[i];
+			break;
+		case PCM_SAMPLE_UINT16_LE:
+			x = ((const uint16_t *) a)[i];
+			y = ((const uint16_t *) b)[i];
+			break;
+		case PCM_SAMPLE_SINT32_LE:
+			x = ((const int32_t *) a)[i] / 65536;
+			y = ((const int32_t *) b)[i] / 65536;
+			break;
+		default:
+			return 0;
+		}
+
+		uint32_t d = (x > y) ? x - y : y - x;
+		if (d > diff)
+			diff = d;
+	}
+
+	return diff;
+}
+
+typedef errno_t (*mix_fn_t)(void *, size_t, const void *, size_t,
+    const pcm_format_t *, const pcm_format_t *);
+
+static errno_t run(mix_fn_t mix, bench_case_t *bc, uint8_t *dst,
+    size_t dst_size, const uint8_t *src, size_t src_size,
+    unsigned int iterations, suseconds_t *usec)
+{
+	struct timeval start, end;
+
+	getuptime(&start);
+	for (unsigned int it = 0; it < iterations; it++) {
+		pcm_format_silence(dst, dst_size, &bc->dst);
+		errno_t rc = mix(dst, dst_size, src, src_size, &bc->src,
+		    &bc->dst);
+		if (rc != EOK)
+			return rc;
+		rc = mix(dst, dst_size, src, src_size, &bc->src, &bc->dst);
+		if (rc != EOK)
+			return rc;
+	}
+	getuptime(&end);
+
+	*usec = tv_sub_diff(&end, &start);
+	if (*usec == 0)
+		*usec = 1;
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = DEFAULT_ITERATIONS;
+
+	if ((argc == 3) && (str_cmp(argv[1], "-n") == 0)) {
+		iterations = strtoul(argv[2], NULL, 10);
+		if (iterations == 0) {
+			syntax_print();
+			return 1;
+		}
+	} else if (argc != 1) {
+		syntax_print();
+		return 1;
+	}
+
+	/* Large enough for the widest frame of all cases */
+	const size_t max_size = BUFFER_FRAMES * 2 * sizeof(int32_t);
+	uint8_t *src = malloc(max_size);
+	uint8_t *dst = malloc(max_size);
+	uint8_t *ref = malloc(max_size);
+	if ((src == NULL) || (dst == NULL) || (ref == NULL)) {
+		printf("%s: Out of memory\n", NAME);
+		return 1;
+	}
+
+	printf("%u frames per buffer, two sources mixed, %u iterations\n",
+	    BUFFER_FRAMES, iterations);
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		bench_case_t *bc = &cases[i];
+		const size_t src_size = BUFFER_FRAMES *
+		    pcm_format_frame_size(&bc->src);
+		const size_t dst_size = BUFFER_FRAMES *
+		    pcm_format_frame_size(&bc->dst);
+		suseconds_t ref_usec, usec;
+
+		fill_signal(src, src_size, i + 1);
+
+		errno_t rc = run(ref_mix, bc, ref, dst_size, src, src_size,
+		    iterations, &ref_usec);
+		if (rc == EOK) {
+			rc = run(pcm_format_convert_and_mix, bc, dst, dst_size,
+			    src, src_size, iterations, &usec);
+		}
+
+		if (rc != EOK) {
+			printf("%-20s failed: %s\n", bc->name, str_error(rc));
+			continue;
+		}
+
+		if (usec == 0)
+			usec = 1;
+
+		printf("%-20s %8lld us reference, %8lld us mix, %3lld.%lldx",
+		    bc->name, (long long) ref_usec, (long long) usec,
+		    (long long) (ref_usec / usec),
+		    (long long) (ref_usec * 10 / usec % 10));
+
+		if (bc->compare) {
+			printf(", max diff %" PRIu32,
+			    max_diff(ref, dst, dst_size,
+			    bc->dst.sample_format));
+		}
+
+		printf("\n");
+	}
+
+	free(src);
+	free(dst);
+	free(ref);
+	return 0;
+}
+
+/** @}
+ */
@@ -68,6 +68,7 @@ static void print_syntax(void)
 	printf("\tunicast <block|default|list|promisc> - set unicast receive filtering\n");
 	printf("\tmulticast <block|list|promisc> - set multicast receive filtering\n");
 	printf("\tbroadcast <block|allow> - block or allow incoming broadcast frames\n");
+	printf("\tstats - print device statistics\n");
 }
 
 static async_sess_t *get_nic_by_index(size_t i)
@@ -409,6 +410,45 @@ static errno_t nic_set_autoneg(int i)
 	return EOK;
 }
 
+static errno_t nic_print_stats(int i)
+{
+	async_sess_t *sess;
+	nic_device_stats_t stats;
+	errno_t rc;
+
+	sess = get_nic_by_index(i);
+	if (sess == NULL) {
+		printf("Specified NIC doesn't exist or cannot connect to it.\n");
+		return EINVAL;
+	}
+
+	rc = nic_get_stats(sess, &stats);
+	if (rc != EOK) {
+		printf("Error getting NIC statistics.\n");
+		return EIO;
+	}
+
+	printf("\tReceived packets: %lu\n", stats.receive_packets);
+	printf("\tReceived bytes: %lu\n", stats.receive_bytes);
+	printf("\tReceive notifications: %lu", stats.receive_batches);
+	if (stats.receive_batches != 0) {
+		printf(" (%lu frames per notification)",
+		    stats.receive_packets / stats.receive_batches);
+	}
+	printf("\n");
+	printf("\tReceive errors: %lu\n", stats.receive_errors);
+	printf("\tReceive dropped: %lu\n", stats.receive_dropped);
+	printf("\tFiltered (unicast/multicast/broadcast): %lu/%lu/%lu\n",
+	    stats.receive_filtered_unicast, stats.receive_filtered_multicast,
+	    stats.receive_filtered_broadcast);
+	printf("\tSent packets: %lu\n", stats.send_packets);
+	printf("\tSent bytes: %lu\n", stats.send_bytes);
+	printf("\tSend errors: %lu\n", stats.send_errors);
+	printf("\tCollisions: %lu\n", stats.collisions);
+
+	return EOK;
+}
+
 static errno_t nic_set_addr(int i, char *str)
 {
 	async_sess_t *sess;
@@ -555,6 +595,9 @@ int main(int argc, char *argv[])
 		if (!str_cmp(argv[2], "auto"))
 			return nic_set_autoneg(index);
 
+		if (!str_cmp(argv[2], "stats"))
+			return nic_print_stats(index);
+
 		if (!str_cmp(argv[2], "unicast"))
 			return nic_set_rx_unicast(index, argv[3]);
 
@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup perf
+ * @brief Sampling profiler.
+ * @{
+ */
+/**
+ * @file
+ *
+ * Runs the kernel sampling profiler for a while and reports in which
+ * tasks and functions the processors spent their time. Kernel addresses
+ * are resolved by the kernel symbol table, uspace addresses by the symbol
+ * table of the executable of the task.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <str.h>
+#include <str_error.h>
+#include <getopt.h>
+#include <sysinfo.h>
+#include <prof.h>
+#include <elf/elf_symtab.h>
+#include <adt/list.h>
+#include <collect.h>
+
+#define NAME  "perf"
+
+/** Default profiling duration (seconds) */
+#define DEFAULT_DURATION  5
+
+/** Default number of functions listed */
+#define DEFAULT_TOP  20
+
+/** Number of samples read at once */
+#define READ_SAMPLES  256
+
+/** Size of the buffer for kernel symbol names */
+#define SYMBOL_BUFLEN  64
+
+/** Task seen in the samples */
+typedef struct {
+	collect_task_t base;
+	
+	/** Symbol table of the executable or NULL if not found */
+	symtab_t *symtab;
+	bool symtab_tried;
+	
+	/** Samples taken in uspace and in the kernel */
+	size_t user;
+	size_t kernel;
+} perf_task_t;
+
+/** Function seen in the samples */
+typedef struct {
+	/** Task the function belongs to, NULL for the kernel */
+	perf_task_t *task;
+	char *name;
+	
+	/** Samples with the function on top of the stack */
+	size_t self;
+	
+	/** Samples with the function anywhere on the stack */
+	size_t total;
+} perf_func_t;
+
+/** Stack frame recorded in a sample */
+typedef struct {
+	/** Task the frame belongs to, NULL for the kernel */
+	perf_task_t *task;
+	uintptr_t pc;
+	size_t sample;
+	bool leaf;
+	
+	/** Index of the function the frame belongs to */
+	size_t func;
+} perf_frame_t;
+
+static collect_t collect;
+
+static prof_sample_t *samples = NULL;
+static size_t samples_count = 0;
+static size_t idle_samples = 0;
+
+static perf_func_t *funcs = NULL;
+static size_t funcs_count = 0;
+
+static struct option const long_options[] = {
+	{ "help", no_argument, 0, 'h' },
+	{ "duration", required_argument, 0, 'd' },
+	{ "interval", required_argument, 0, 'i' },
+	{ "top", required_argument, 0, 'n' },
+	{ 0, 0, 0, 0 }
+};
+
+static void print_usage(void)
+{
+	printf("Usage: %s [-d seconds] [-i ticks] [-n count]\n\n"
+	    "\t-d\n\t--duration\n\t\tProfile for the given number of "
+	    "seconds (default %u)\n\n"
+	    "\t-i\n\t--interval\n\t\tTake a sample every given number "
+	    "of clock ticks (default 1)\n\n"
+	    "\t-n\n\t--top\n\t\tList the given number of functions "
+	    "(default %u)\n\n"
+	    "\t-h\n\t--help\n\t\tPrint this usage information\n",
+	    NAME, DEFAULT_DURATION, DEFAULT_TOP);
+}
+
+/** Find a task or start tracking it. */
+static perf_task_t *task_get(task_id_t id)
+{
+	return (perf_task_t *) collect_task_get(&collect, id);
+}
+
+/** Load the symbol table of the executable of a task. */
+static symtab_t *task_symtab(perf_task_t *task)
+{
+	static const char *paths[] = { "/app/%s", "/srv/%s", "/drv/%s/%s" };
+	
+	if (task->symtab_tried)
+		return task->symtab;
+	
+	task->symtab_tried = true;
+	if (task->base.name == NULL)
+		return NULL;
+	
+	for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+		char *file_name;
+		if (asprintf(&file_name, paths[i], task->base.name,
+		    task->base.name) < 0)
+			return NULL;
+		
+		errno_t rc = symtab_load(file_name, &task->symtab);
+		free(file_name);
+		
+		if (rc == EOK)
+			break;
+	}
+	
+	return task->symtab;
+}
+
+/** Resolve an address to the name of a function.
+ *
+ * @param task  Task the address belongs to, NULL for the kernel.
+ * @param pc    The address.
+ * @param start Place to store the start address of the function.
+ *
+ * @return Newly allocated name or NULL if out of memory.
+ *
+ */
+static char *symbol_get(perf_task_t *task, uintptr_t pc, uintptr_t *start)
+{
+	size_t offset;
+	char *name;
+	
+	if (task == NULL) {
+		char buf[SYMBOL_BUFLEN];
+		
+		if (prof_symbol(pc, buf, sizeof(buf), &offset) == EOK) {
+			*start = pc - offset;
+			return str_dup(buf);
+		}
+	} else {
+		symtab_t *symtab = task_symtab(task);
+		
+		if ((symtab != NULL) &&
+		    (symtab_addr_to_name(symtab, pc, &name, &offset) == EOK)) {
+			*start = pc - offset;
+			return str_dup(name);
+		}
+	}
+	
+	*start = pc;
+	if (asprintf(&name, "%p", (void *) pc) < 0)
+		return NULL;
+	
+	return name;
+}
+
+static errno_t samples_read(void *buf, size_t max, size_t *count)
+{
+	return prof_read(buf, max, count);
+}
+
+static task_id_t sample_task(const void *sample)
+{
+	return ((const prof_sample_t *) sample)->task_id;
+}
+
+/** Run the profiler and collect the samples. */
+static errno_t samples_collect(unsigned int duration, unsigned int interval)
+{
+	collect_init(&collect, sizeof(prof_sample_t), READ_SAMPLES,
+	    samples_read, sample_task, sizeof(perf_task_t));
+	
+	errno_t rc = prof_start(interval);
+	if (rc != EOK)
+		return rc;
+	
+	rc = collect_run(&collect, duration, prof_stop);
+	
+	samples = collect.records;
+	samples_count = collect.count;
+	return rc;
+}
+
+static int frame_cmp_pc(const void *a, const void *b)
+{
+	const perf_frame_t *fa = a;
+	const perf_frame_t *fb = b;
+	
+	if (fa->task != fb->task)
+		return ((uintptr_t) fa->task < (uintptr_t) fb->task) ? -1 : 1;
+	
+	if (fa->pc != fb->pc)
+		return (fa->pc < fb->pc) ? -1 : 1;
+	
+	return 0;
+}
+
+static int frame_cmp_func(const void *a, const void *b)
+{
+	const perf_frame_t *fa = a;
+	const perf_frame_t *fb = b;
+	
+	if (fa->func != fb->func)
+		return (fa->func < fb->func) ? -1 : 1;
+	
+	if (fa->sample != fb->sample)
+		return (fa->sample < fb->sample) ? -1 : 1;
+	
+	return 0;
+}
+
+/** Resolve the recorded frames and count samples per task and function. */
+static errno_t samples_analyze(void)
+{
+	size_t frames_count = 0;
+	for (size_t i = 0; i < samples_count; i++)
+		frames_count += samples[i].depth;
+	
+	perf_frame_t *frames = calloc(frames_count, sizeof(perf_frame_t));
+	funcs = calloc(frames_count, sizeof(perf_func_t));
+	if (((frames == NULL) || (funcs == NULL)) && (frames_count > 0)) {
+		free(frames);
+		return ENOMEM;
+	}
+	
+	size_t n = 0;
+	for (size_t i = 0; i < samples_count; i++) {
+		if ((samples[i].flags & PROF_SAMPLE_IDLE) != 0) {
+			idle_samples++;
+			continue;
+		}
+		
+		perf_task_t *task = task_get(samples[i].task_id);
+		bool uspace = ((samples[i].flags & PROF_SAMPLE_USPACE) != 0);
+		
+		if (uspace)
+			task->user++;
+		else
+			task->kernel++;
+		
+		for (size_t d = 0; d < samples[i].depth; d++) {
+			frames[n].task = uspace ? task : NULL;
+			frames[n].pc = samples[i].pc[d];
+			frames[n].sample = i;
+			frames[n].leaf = (d == 0);
+			n++;
+		}
+	}
+	
+	/* Frames of one function end up next to each other */
+	qsort(frames, n, sizeof(perf_frame_t), frame_cmp_pc);
+	
+	uintptr_t func_start = 0;
+	for (size_t j = 0; j < n; j++) {
+		if ((j == 0) ||
+		    (frame_cmp_pc(&frames[j - 1], &frames[j]) != 0)) {
+			uintptr_t start;
+			char *name = symbol_get(frames[j].task, frames[j].pc,
+			    &start);
+			if (name == NULL) {
+				free(frames);
+				return ENOMEM;
+			}
+			
+			if ((funcs_count == 0) ||
+			    (funcs[funcs_count - 1].task != frames[j].task) ||
+			    (start != func_start)) {
+				funcs[funcs_count].task = frames[j].task;
+				funcs[funcs_count].name = name;
+				funcs_count++;
+				func_start = start;
+			} else
+				free(name);
+		}
+		
+		frames[j].func = funcs_count - 1;
+	}
+	
+	/* Count each function only once per sample, even if recursive */
+	qsort(frames, n, sizeof(perf_frame_t), frame_cmp_func);
+	
+	for (size_t j = 0; j < n; j++) {
+		perf_func_t *func = &funcs[frames[j].func];
+		
+		if (frames[j].leaf)
+			func->self++;
+		
+		if ((j == 0) ||
+		    (frame_cmp_func(&frames[j - 1], &frames[j]) != 0))
+			func->total++;
+	}
+	
+	free(frames);
+	return EOK;
+}
+
+static int task_cmp(const void *a, const void *b)
+{
+	const perf_task_t *ta = *(const perf_task_t **) a;
+	const perf_task_t *tb = *(const perf_task_t **) b;
+	size_t sa = ta->user + ta->kernel;
+	size_t sb = tb->user + tb->kernel;
+	
+	if (sa != sb)
+		return (sa > sb) ? -1 : 1;
+	
+	return 0;
+}
+
+static int func_cmp(const void *a, const void *b)
+{
+	const perf_func_t *fa = a;
+	const perf_func_t *fb = b;
+	
+	if (fa->self != fb->self)
+		return (fa->self > fb->self) ? -1 : 1;
+	
+	if (fa->total != fb->total)
+		return (fa->total > fb->total) ? -1 : 1;
+	
+	return 0;
+}
+
+static const char *task_name(perf_task_t *task)
+{
+	if (task == NULL)
+		return "[kernel]";
+	
+	if (task->base.name == NULL)
+		return "[exited]";
+	
+	return task->base.name;
+}
+
+static void print_percent(size_t part, size_t whole)
+{
+	size_t permille = (whole > 0) ? part * 1000 / whole : 0;
+	printf(" %3zu.%zu%%", permille / 10, permille % 10);
+}
+
+static void print_tasks(void)
+{
+	size_t count = list_count(&collect.tasks);
+	perf_task_t **sorted = calloc(count, sizeof(perf_task_t *));
+	if ((sorted == NULL) && (count > 0))
+		return;
+	
+	size_t i = 0;
+	list_foreach(collect.tasks, base.link, perf_task_t, task)
+		sorted[i++] = task;
+	
+	qsort(sorted, count, sizeof(perf_task_t *), task_cmp);
+	
+	printf("[taskid] [name              ] [samples] [ user ] [kernel]\n");
+	for (i = 0; i < count; i++) {
+		printf("%8" PRIu64 " %-20s %9zu", sorted[i]->base.id,
+		    task_name(sorted[i]), sorted[i]->user + sorted[i]->kernel);
+		print_percent(sorted[i]->user, samples_count);
+		print_percent(sorted[i]->kernel, samples_count);
+		printf("\n");
+	}
+	
+	free(sorted);
+}
+
+static void print_funcs(size_t top)
+{
+	qsort(funcs, funcs_count, sizeof(perf_func_t), func_cmp);
+	
+	printf("[ self ] [ total] [task              ] [function]\n");
+	for (size_t i = 0; (i < funcs_count) && (i < top); i++) {
+		print_percent(funcs[i].self, samples_count);
+		print_percent(funcs[i].total, samples_count);
+		printf(" %-20s %s\n", task_name(funcs[i].task), funcs[i].name);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t duration = DEFAULT_DURATION;
+	uint32_t interval = 1;
+	uint32_t top = DEFAULT_TOP;
+	uint32_t *value;
+	errno_t rc;
+	int c;
+	
+	for (c = 0, optind = 0; c != -1;) {
+		c = getopt_long(argc, argv, "hd:i:n:", long_options, NULL);
+		switch (c) {
+		case 'h':
+			print_usage();
+			return 0;
+		case 'd':
+			value = &duration;
+			break;
+		case 'i':
+			value = &interval;
+			break;
+		case 'n':
+			value = &top;
+			break;
+		case -1:
+			continue;
+		default:
+			print_usage();
+			return 1;
+		}
+		
+		if (str_uint32_t(optarg, NULL, 10, true, value) != EOK) {
+			fprintf(stderr, "%s: Invalid value '%s'\n", NAME,
+			    optarg);
+			return 1;
+		}
+	}
+	
+	if (optind < argc) {
+		print_usage();
+		return 1;
+	}
+	
+	printf("%s: Profiling for %" PRIu32 " s...\n", NAME, duration);
+	
+	rc = samples_collect(duration, interval);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Profiling failed: %s\n", NAME,
+		    str_error(rc));
+		return 1;
+	}
+	
+	rc = samples_analyze();
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Analysis failed: %s\n", NAME,
+		    str_error(rc));
+		return 1;
+	}
+	
+	sysarg_t dropped = 0;
+	(void) sysinfo_get_value("prof.dropped", &dropped);
+	
+	printf("%zu samples, %zu idle, %" PRIun " dropped\n\n",
+	    samples_count, idle_samples, dropped);
+	print_tasks();
+	printf("\n");
+	print_funcs(top);
+	
+	return 0;
+}
+
+/** @}
+ */
@@ -46,6 +46,9 @@
 #include <stdbool.h>
 #include <str.h>
 #include <arg_parse.h>
+#include <sysinfo.h>
+#include <async.h>
+#include <sys/time.h>
 
 #define NAME  "stats"
 
@@ -53,6 +56,16 @@
 #define HOUR    3600
 #define MINUTE  60
 
+/** Interval over which TLB shootdown rates are measured (usec) */
+#define TLB_RATE_INTERVAL  1000000
+
+typedef struct {
+	sysarg_t shootdowns;
+	sysarg_t ipis;
+	sysarg_t coalesced;
+	struct timeval time;
+} tlb_sample_t;
+
 static void list_tasks(void)
 {
 	size_t count;
@@ -163,6 +176,50 @@ static void list_cpus(void)
 	free(cpus);
 }
 
+static void list_slabs(void)
+{
+	size_t count;
+	stats_slab_t *slabs = stats_get_slabs(&count);
+	
+	if (slabs == NULL) {
+		fprintf(stderr, "%s: Unable to get slab cache statistics\n",
+		    NAME);
+		return;
+	}
+	
+	printf("[cache name        ] [size  ] [mag] [allocs      ] [hits]"
+	    " [depot gets ] [contended ] [frag]\n");
+	
+	size_t i;
+	for (i = 0; i < count; i++) {
+		uint64_t allocs;
+		uint64_t gets;
+		char asuffix;
+		char gsuffix;
+		
+		order_suffix(slabs[i].allocs, &allocs, &asuffix);
+		order_suffix(slabs[i].depot_gets, &gets, &gsuffix);
+		
+		printf("%-20s %8" PRIu64 " %5" PRIu64 " %13" PRIu64 "%c",
+		    slabs[i].name, slabs[i].size, slabs[i].mag_size,
+		    allocs, asuffix);
+		
+		if (slabs[i].allocs != 0) {
+			uint64_t bytes = slabs[i].allocs * slabs[i].size;
+			
+			printf(" %5" PRIu64 "%%",
+			    slabs[i].hits * 100 / slabs[i].allocs);
+			printf(" %12" PRIu64 "%c %12" PRIu64, gets, gsuffix,
+			    slabs[i].depot_contention);
+			printf(" %5" PRIu64 "%%\n",
+			    (bytes - slabs[i].requested) * 100 / bytes);
+		} else
+			printf(" %6s %13s %12s %6s\n", "-", "-", "-", "-");
+	}
+	
+	free(slabs);
+}
+
 static void print_load(void)
 {
 	size_t count;
@@ -198,10 +255,56 @@ static void print_uptime(void)
 	    (uptime.tv_sec % HOUR) / MINUTE, uptime.tv_sec % MINUTE);
 }
 
+static errno_t tlb_sample(tlb_sample_t *sample)
+{
+	errno_t rc = sysinfo_get_value("tlb.shootdowns", &sample->shootdowns);
+	if (rc == EOK)
+		rc = sysinfo_get_value("tlb.ipis", &sample->ipis);
+	if (rc == EOK)
+		rc = sysinfo_get_value("tlb.ipis_coalesced",
+		    &sample->coalesced);
+	
+	getuptime(&sample->time);
+	return rc;
+}
+
+static void print_tlb_rates(void)
+{
+	tlb_sample_t start;
+	tlb_sample_t end;
+	
+	if (tlb_sample(&start) != EOK) {
+		fprintf(stderr, "%s: Unable to get TLB shootdown statistics\n",
+		    NAME);
+		return;
+	}
+	
+	async_usleep(TLB_RATE_INTERVAL);
+	
+	if (tlb_sample(&end) != EOK) {
+		fprintf(stderr, "%s: Unable to get TLB shootdown statistics\n",
+		    NAME);
+		return;
+	}
+	
+	uint64_t usecs = tv_sub_diff(&end.time, &start.time);
+	if (usecs == 0)
+		usecs = 1;
+	
+	printf("%s: TLB shootdowns: %" PRIu64 "/s, IPIs: %" PRIu64 "/s, "
+	    "IPIs coalesced: %" PRIu64 "/s\n", NAME,
+	    (uint64_t) (end.shootdowns - start.shootdowns) * 1000000 / usecs,
+	    (uint64_t) (end.ipis - start.ipis) * 1000000 / usecs,
+	    (uint64_t) (end.coalesced - start.coalesced) * 1000000 / usecs);
+	printf("%s: Total: %" PRIun " shootdowns, %" PRIun " IPIs, "
+	    "%" PRIun " IPIs coalesced\n", NAME, end.shootdowns, end.ipis,
+	    end.coalesced);
+}
+
 static void usage(const char *name)
 {
 	printf(
-	    "Usage: %s [-t task_id] [-a] [-c] [-l] [-u]\n" \
+	    "Usage: %s [-t task_id] [-a] [-c] [-l] [-u] [-s] [-m]\n" \
 	    "\n" \
 	    "Options:\n" \
 	    "\t-t task_id\n" \
@@ -224,6 +327,14 @@ static void usage(const char *name)
 	    "\t--uptime\n" \
 	    "\t\tPrint system uptime\n" \
 	    "\n" \
+	    "\t-s\n" \
+	    "\t--shootdowns\n" \
+	    "\t\tPrint TLB shootdown and IPI rates\n" \
+	    "\n" \
+	    "\t-m\n" \
+	    "\t--slabs\n" \
+	    "\t\tList kernel slab caches with magazine statistics\n" \
+	    "\n" \
 	    "\t-h\n" \
 	    "\t--help\n" \
 	    "\t\tPrint this usage information\n"
@@ -241,6 +352,8 @@ int main(int argc, char *argv[])
 	bool toggle_cpus = false;
 	bool toggle_load = false;
 	bool toggle_uptime = false;
+	bool toggle_shootdowns = false;
+	bool toggle_slabs = false;
 	
 	task_id_t task_id = 0;
 	
@@ -299,6 +412,21 @@ int main(int argc, char *argv[])
 			toggle_uptime = true;
 			continue;
 		}
+		
+		/* TLB shootdowns */
+		if ((off = arg_parse_short_long(argv[i], "-s",
+		    "--shootdowns")) != -1) {
+			toggle_tasks = false;
+			toggle_shootdowns = true;
+			continue;
+		}
+		
+		/* Slab caches */
+		if ((off = arg_parse_short_long(argv[i], "-m", "--slabs")) != -1) {
+			toggle_tasks = false;
+			toggle_slabs = true;
+			continue;
+		}
 	}
 	
 	if (toggle_tasks)
@@ -316,6 +444,12 @@ int main(int argc, char *argv[])
 	if (toggle_uptime)
 		print_uptime();
 	
+	if (toggle_shootdowns)
+		print_tlb_rates();
+	
+	if (toggle_slabs)
+		list_slabs();
+	
 	return 0;
 }
 
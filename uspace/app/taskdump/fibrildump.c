@@ -38,7 +38,7 @@
 #include <stacktrace.h>
 #include <stdio.h>
 #include <stdbool.h>
-#include <symtab.h>
+#include <elf/elf_symtab.h>
 #include <taskdump.h>
 #include <udebug.h>
 
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <as.h>
+#include <errno.h>
+#include <sysinfo.h>
+#include <sys/time.h>
+#include "../tester.h"
+
+#define AREA_SIZE  (16 * 1024 * 1024)
+
+/** Stride of the scattered pass in pages */
+#define SCATTER_STRIDE  7
+
+typedef struct {
+	sysarg_t faults;
+	sysarg_t around;
+	struct timeval time;
+} fa_sample_t;
+
+static const char *fa_sample(fa_sample_t *sample)
+{
+	if (sysinfo_get_value("mm.page_faults", &sample->faults) != EOK)
+		return "Cannot read mm.page_faults";
+	if (sysinfo_get_value("mm.fault_around.pages", &sample->around) != EOK)
+		return "Cannot read mm.fault_around.pages";
+	
+	getuptime(&sample->time);
+	return NULL;
+}
+
+static void fa_report(const char *name, fa_sample_t *start, fa_sample_t *end,
+    size_t touched)
+{
+	size_t mib = AREA_SIZE / (1024 * 1024);
+	sysarg_t faults = end->faults - start->faults;
+	sysarg_t around = end->around - start->around;
+	suseconds_t usecs = tv_sub_diff(&end->time, &start->time);
+	
+	TPRINTF("%s: %zu pages touched, %" PRIun " faults (%" PRIun " per MiB), "
+	    "%" PRIun " pages faulted around, %lld us (%lld us per MiB)\n",
+	    name, touched, faults, faults / mib, around,
+	    (long long) usecs, (long long) usecs / mib);
+}
+
+static void *fa_area_create(void)
+{
+	void *area = as_area_create(AS_AREA_ANY, AREA_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (area == AS_MAP_FAILED)
+		return NULL;
+	
+	return area;
+}
+
+/** Touch every page of a fresh area in ascending order. */
+static const char *fa_sequential(void)
+{
+	fa_sample_t start, end;
+	const char *err;
+	
+	volatile uint8_t *area = fa_area_create();
+	if (area == NULL)
+		return "Cannot create address space area";
+	
+	err = fa_sample(&start);
+	if (err != NULL)
+		goto out;
+	
+	size_t pages = AREA_SIZE / PAGE_SIZE;
+	for (size_t i = 0; i < pages; i++)
+		area[i * PAGE_SIZE] = 1;
+	
+	err = fa_sample(&end);
+	if (err != NULL)
+		goto out;
+	
+	fa_report("sequential", &start, &end, pages);
+	
+	/* Pages mapped ahead of the faults must have been cleared */
+	for (size_t i = 0; i < pages; i++) {
+		if (area[i * PAGE_SIZE + 1] != 0) {
+			err = "Page populated by fault-around is not zeroed";
+			goto out;
+		}
+	}
+	
+out:
+	as_area_destroy((void *) area);
+	return err;
+}
+
+/** Touch the pages of a fresh area with a stride that defeats fault-around. */
+static const char *fa_scattered(void)
+{
+	fa_sample_t start, end;
+	const char *err;
+	
+	volatile uint8_t *area = fa_area_create();
+	if (area == NULL)
+		return "Cannot create address space area";
+	
+	err = fa_sample(&start);
+	if (err != NULL)
+		goto out;
+	
+	size_t pages = AREA_SIZE / PAGE_SIZE;
+	size_t touched = 0;
+	for (size_t first = 0; first < SCATTER_STRIDE; first++) {
+		for (size_t i = first; i < pages; i += SCATTER_STRIDE) {
+			area[i * PAGE_SIZE] = 1;
+			touched++;
+		}
+	}
+	
+	err = fa_sample(&end);
+	if (err != NULL)
+		goto out;
+	
+	fa_report("scattered", &start, &end, touched);
+	
+out:
+	as_area_destroy((void *) area);
+	return err;
+}
+
+const char *test_faultaround1(void)
+{
+	sysarg_t max;
+	
+	if (sysinfo_get_value("mm.fault_around.max", &max) != EOK)
+		return "Cannot read mm.fault_around.max";
+	
+	TPRINTF("Fault-around limit: %" PRIun " pages, area size: %d MiB\n",
+	    max, AREA_SIZE / (1024 * 1024));
+	
+	const char *err = fa_sequential();
+	if (err != NULL)
+		return err;
+	
+	return fa_scattered();
+}
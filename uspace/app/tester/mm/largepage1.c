@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <as.h>
+#include <align.h>
+#include <errno.h>
+#include <sysinfo.h>
+#include <sys/time.h>
+#include "../tester.h"
+
+#define AREA_SIZE  (32 * 1024 * 1024)
+
+/** Number of random accesses of the TLB-bound pass */
+#define ACCESSES  (4 * 1024 * 1024)
+
+typedef struct {
+	sysarg_t mapped;
+	sysarg_t demoted;
+	struct timeval time;
+} lp_sample_t;
+
+static const char *lp_sample(lp_sample_t *sample)
+{
+	if (sysinfo_get_value("mm.large_pages.mapped", &sample->mapped) != EOK)
+		return "Cannot read mm.large_pages.mapped";
+	if (sysinfo_get_value("mm.large_pages.demoted",
+	    &sample->demoted) != EOK)
+		return "Cannot read mm.large_pages.demoted";
+	
+	getuptime(&sample->time);
+	return NULL;
+}
+
+/** Read the area at pseudo-random page-granular offsets.
+ *
+ * Each access most likely hits a different page, so with regular pages
+ * nearly every access misses in the TLB.
+ */
+static uint8_t lp_random_reads(volatile uint8_t *area)
+{
+	uint32_t seed = 1;
+	uint8_t sum = 0;
+	
+	for (size_t i = 0; i < ACCESSES; i++) {
+		seed = seed * 1103515245 + 12345;
+		sum += area[(seed >> 4) % AREA_SIZE];
+	}
+	
+	return sum;
+}
+
+/** Populate an area and measure random accesses to it.
+ *
+ * @param name  Name of the pass.
+ * @param flags Additional flags of the area.
+ * @param large Size of a large page or zero.
+ *
+ * @return Error message or NULL on success.
+ */
+static const char *lp_pass(const char *name, unsigned int flags, size_t large)
+{
+	lp_sample_t start, populated, end;
+	const char *err;
+	
+	volatile uint8_t *area = as_area_create(AS_AREA_ANY, AREA_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE | flags,
+	    AS_AREA_UNPAGED);
+	if (area == AS_MAP_FAILED)
+		return "Cannot create address space area";
+	
+	err = lp_sample(&start);
+	if (err != NULL)
+		goto out;
+	
+	size_t pages = AREA_SIZE / PAGE_SIZE;
+	for (size_t i = 0; i < pages; i++)
+		area[i * PAGE_SIZE] = (uint8_t) i;
+	
+	err = lp_sample(&populated);
+	if (err != NULL)
+		goto out;
+	
+	uint8_t sum = lp_random_reads(area);
+	
+	err = lp_sample(&end);
+	if (err != NULL)
+		goto out;
+	
+	TPRINTF("%s: %" PRIun " large pages, populated in %lld us, "
+	    "%d random reads in %lld us (checksum %u)\n", name,
+	    populated.mapped - start.mapped,
+	    (long long) tv_sub_diff(&populated.time, &start.time), ACCESSES,
+	    (long long) tv_sub_diff(&end.time, &populated.time),
+	    (unsigned) sum);
+	
+	/*
+	 * Unmapping the last page of the last large page that fits into
+	 * the area splits it, the rest of the area must stay intact.
+	 */
+	uintptr_t base = (uintptr_t) area;
+	size_t size = AREA_SIZE - PAGE_SIZE;
+	uintptr_t large_end = (large != 0) ?
+	    ALIGN_DOWN(base + AREA_SIZE, large) : 0;
+	if ((large != 0) && (large_end >= base + large))
+		size = large_end - PAGE_SIZE - base;
+	
+	if (as_area_resize((void *) area, size, 0) != EOK) {
+		err = "Cannot shrink address space area";
+		goto out;
+	}
+	
+	err = lp_sample(&start);
+	if (err != NULL)
+		goto out;
+	
+	TPRINTF("%s: %" PRIun " large pages split by shrinking the area\n",
+	    name, start.demoted - end.demoted);
+	
+	for (size_t i = 0; i < size / PAGE_SIZE; i++) {
+		if (area[i * PAGE_SIZE] != (uint8_t) i) {
+			err = "Page content lost";
+			goto out;
+		}
+		if (area[i * PAGE_SIZE + 1] != 0) {
+			err = "Page is not zeroed";
+			goto out;
+		}
+	}
+	
+out:
+	as_area_destroy((void *) area);
+	return err;
+}
+
+const char *test_largepage1(void)
+{
+	sysarg_t size;
+	
+	if (sysinfo_get_value("mm.large_pages.size", &size) != EOK)
+		return "Cannot read mm.large_pages.size";
+	
+	if (size != 0) {
+		TPRINTF("Large page size: %" PRIun " KiB, area size: %d MiB\n",
+		    size / 1024, AREA_SIZE / (1024 * 1024));
+	} else {
+		TPRINTF("Large pages are not in use, area size: %d MiB\n",
+		    AREA_SIZE / (1024 * 1024));
+	}
+	
+	/* Late reservation makes the kernel populate the area page by page */
+	const char *err = lp_pass("regular pages", AS_AREA_LATE_RESERVE,
+	    size);
+	if (err != NULL)
+		return err;
+	
+	return lp_pass("large pages", 0, size);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2016 Jakub Jermar
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vfs/vfs.h>
+#include <as.h>
+#include <errno.h>
+#include "../tester.h"
+
+#define TEST_FILE	"/tmp/testfile2"
+#define TEST_PAGES	20
+
+static uint8_t pattern(size_t pos)
+{
+	return (uint8_t) ((pos / PAGE_SIZE) * 7 + pos);
+}
+
+static const char *create_file(int *fd)
+{
+	size_t size = TEST_PAGES * PAGE_SIZE;
+	uint8_t *buf = malloc(size);
+	if (buf == NULL)
+		return "Cannot allocate memory";
+	
+	for (size_t i = 0; i < size; i++)
+		buf[i] = pattern(i);
+	
+	errno_t rc = vfs_lookup_open(TEST_FILE, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_READ | MODE_WRITE, fd);
+	if (rc != EOK) {
+		free(buf);
+		return "Cannot create temporary file";
+	}
+	(void) vfs_unlink_path(TEST_FILE);
+	
+	size_t nwr;
+	rc = vfs_write(*fd, (aoff64_t []) {0}, buf, size, &nwr);
+	free(buf);
+	if ((rc != EOK) || (nwr != size)) {
+		vfs_put(*fd);
+		return "Cannot write temporary file";
+	}
+	
+	return NULL;
+}
+
+static const char *check_area(uint8_t *area, size_t first, size_t pages)
+{
+	for (size_t i = 0; i < pages * PAGE_SIZE; i++) {
+		if (area[i] != pattern(first * PAGE_SIZE + i))
+			return "Mapped data differ from the file";
+	}
+	
+	return NULL;
+}
+
+const char *test_pager2(void)
+{
+	int fd;
+	const char *err = create_file(&fd);
+	if (err != NULL)
+		return err;
+	
+	TPRINTF("Mapping the whole file read-only...\n");
+	
+	void *ro = AS_AREA_ANY;
+	errno_t rc = vfs_mmap(fd, 0, TEST_PAGES * PAGE_SIZE,
+	    AS_AREA_READ | AS_AREA_CACHEABLE, &ro);
+	if (rc != EOK) {
+		vfs_put(fd);
+		return "Cannot map file";
+	}
+	
+	TPRINTF("Mapping the file privately at an offset...\n");
+	
+	void *priv = AS_AREA_ANY;
+	rc = vfs_mmap(fd, 2 * PAGE_SIZE, (TEST_PAGES - 2) * PAGE_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, &priv);
+	
+	/* The mappings do not need the file handle anymore. */
+	vfs_put(fd);
+	
+	if (rc != EOK) {
+		vfs_munmap(ro);
+		return "Cannot map file";
+	}
+	
+	TPRINTF("Checking the private mapping...\n");
+	
+	err = check_area(priv, 2, TEST_PAGES - 2);
+	if (err != NULL)
+		goto out;
+	
+	TPRINTF("Modifying the private mapping...\n");
+	
+	for (size_t i = 0; i < (TEST_PAGES - 2) * PAGE_SIZE; i++)
+		((uint8_t *) priv)[i] = ~pattern(2 * PAGE_SIZE + i);
+	
+	TPRINTF("Checking the read-only mapping...\n");
+	
+	err = check_area(ro, 0, TEST_PAGES);
+	
+out:
+	vfs_munmap(priv);
+	vfs_munmap(ro);
+	return err;
+}
@@ -73,7 +73,10 @@ test_t tests[] = {
 #include "mm/malloc2.def"
 #include "mm/malloc3.def"
 #include "mm/mapping1.def"
+#include "mm/faultaround1.def"
+#include "mm/largepage1.def"
 #include "mm/pager1.def"
+#include "mm/pager2.def"
 #include "hw/serial/serial1.def"
 #include "chardev/chardev1.def"
 	{NULL, NULL, NULL, false}
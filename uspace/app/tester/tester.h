@@ -105,7 +105,10 @@ extern const char *test_malloc1(void);
 extern const char *test_malloc2(void);
 extern const char *test_malloc3(void);
 extern const char *test_mapping1(void);
+extern const char *test_faultaround1(void);
+extern const char *test_largepage1(void);
 extern const char *test_pager1(void);
+extern const char *test_pager2(void);
 extern const char *test_serial1(void);
 extern const char *test_devman1(void);
 extern const char *test_devman2(void);
@@ -43,6 +43,9 @@
 #include <errno.h>
 #include <gsort.h>
 #include <str.h>
+#include <mem.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include "screen.h"
 #include "top.h"
 
@@ -50,6 +53,9 @@
 
 #define UPDATE_INTERVAL  1
 
+/** Number of attempts to get a delta snapshot which is not truncated */
+#define DELTA_ATTEMPTS  3
+
 #define DAY     86400
 #define HOUR    3600
 #define MINUTE  60
@@ -69,6 +75,7 @@ static const column_t task_columns[] = {
 	{"%virt",    'V',  7},
 	{"%user",    'U',  7},
 	{"%kern",    'K',  7},
+	{"faults",   'f',  9},
 	{"name",     'd',  0},
 };
 
@@ -81,6 +88,7 @@ enum {
 	TASK_COL_PERCENT_VIRTUAL,
 	TASK_COL_PERCENT_USER,
 	TASK_COL_PERCENT_KERNEL,
+	TASK_COL_FAULTS,
 	TASK_COL_NAME,
 	TASK_NUM_COLUMNS,
 };
@@ -125,14 +133,275 @@ enum {
 	EXCEPTION_NUM_COLUMNS,
 };
 
+/** Tasks or threads kept up to date by delta snapshots */
+typedef struct {
+	/** Generation to request the next delta with, zero for all */
+	uint64_t generation;
+	
+	/** Size of a record of a task or thread */
+	size_t entry_size;
+	
+	/** Get the ID of a task or thread from its record */
+	uint64_t (*entry_id)(const void *);
+	
+	size_t count;
+	size_t capacity;
+	void *entries;
+	
+	/** Index of the records by the ID of the task or thread */
+	hash_table_t index;
+	bool indexed;
+} delta_cache_t;
+
+/** Index node of a record in the cache */
+typedef struct {
+	ht_link_t link;
+	
+	/** Task or thread ID */
+	uint64_t id;
+	
+	/** Index of the record */
+	size_t index;
+} cache_node_t;
+
+static uint64_t task_entry_id(const void *entry)
+{
+	return ((const stats_task_t *) entry)->task_id;
+}
+
+static uint64_t thread_entry_id(const void *entry)
+{
+	return ((const stats_thread_t *) entry)->thread_id;
+}
+
+static delta_cache_t task_cache = {
+	.generation = 0,
+	.entry_size = sizeof(stats_task_t),
+	.entry_id = task_entry_id,
+	.count = 0,
+	.capacity = 0,
+	.entries = NULL,
+	.indexed = false
+};
+
+static delta_cache_t thread_cache = {
+	.generation = 0,
+	.entry_size = sizeof(stats_thread_t),
+	.entry_id = thread_entry_id,
+	.count = 0,
+	.capacity = 0,
+	.entries = NULL,
+	.indexed = false
+};
+
 screen_mode_t screen_mode = SCREEN_TABLE;
 static op_mode_t op_mode = OP_TASKS;
 static size_t sort_column = TASK_COL_PERCENT_USER;
 static int sort_reverse = -1;
 static bool excs_all = false;
 
+static void *cache_entry(delta_cache_t *cache, size_t i)
+{
+	return (uint8_t *) cache->entries + i * cache->entry_size;
+}
+
+static size_t cache_node_hash(const ht_link_t *item)
+{
+	cache_node_t *node = hash_table_get_inst(item, cache_node_t, link);
+	return (size_t) hash_mix64(node->id);
+}
+
+static size_t cache_node_key_hash(void *key)
+{
+	return (size_t) hash_mix64(*(uint64_t *) key);
+}
+
+static bool cache_node_key_equal(void *key, const ht_link_t *item)
+{
+	cache_node_t *node = hash_table_get_inst(item, cache_node_t, link);
+	return node->id == *(uint64_t *) key;
+}
+
+static void cache_node_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, cache_node_t, link));
+}
+
+static hash_table_ops_t cache_index_ops = {
+	.hash = cache_node_hash,
+	.key_hash = cache_node_key_hash,
+	.key_equal = cache_node_key_equal,
+	.equal = NULL,
+	.remove_callback = cache_node_remove_callback
+};
+
+/** Find a task or thread in the cache.
+ *
+ * @return Index node of the record or NULL if not found.
+ *
+ */
+static cache_node_t *cache_find(delta_cache_t *cache, uint64_t id)
+{
+	ht_link_t *item = hash_table_find(&cache->index, &id);
+	if (item == NULL)
+		return NULL;
+	
+	return hash_table_get_inst(item, cache_node_t, link);
+}
+
+/** Apply a delta snapshot to the cache.
+ *
+ * @param cache   Cache of tasks or threads.
+ * @param delta   Header of the snapshot.
+ * @param entries Records of the changed tasks or threads.
+ * @param exited  IDs of the exited tasks or threads.
+ *
+ * @return EOK on success or ENOMEM.
+ *
+ */
+static errno_t cache_update(delta_cache_t *cache, stats_delta_t *delta,
+    const void *entries, const uint64_t *exited)
+{
+	if (!cache->indexed) {
+		if (!hash_table_create(&cache->index, 0, 0, &cache_index_ops))
+			return ENOMEM;
+		
+		cache->indexed = true;
+	}
+	
+	if (delta->full) {
+		hash_table_clear(&cache->index);
+		cache->count = 0;
+	}
+	
+	for (uint64_t i = 0; i < delta->exited; i++) {
+		cache_node_t *node = cache_find(cache, exited[i]);
+		if (node == NULL)
+			continue;
+		
+		size_t j = node->index;
+		hash_table_remove_item(&cache->index, &node->link);
+		
+		/* Order does not matter, move the last record to the hole */
+		cache->count--;
+		if (j != cache->count) {
+			memcpy(cache_entry(cache, j),
+			    cache_entry(cache, cache->count),
+			    cache->entry_size);
+			
+			node = cache_find(cache,
+			    cache->entry_id(cache_entry(cache, j)));
+			node->index = j;
+		}
+	}
+	
+	for (uint64_t i = 0; i < delta->count; i++) {
+		const void *entry =
+		    (const uint8_t *) entries + i * cache->entry_size;
+		uint64_t id = cache->entry_id(entry);
+		cache_node_t *node = cache_find(cache, id);
+		
+		if (node == NULL) {
+			if (cache->count == cache->capacity) {
+				size_t capacity = 2 * cache->capacity + 16;
+				void *grown = realloc(cache->entries,
+				    capacity * cache->entry_size);
+				if (grown == NULL)
+					return ENOMEM;
+				
+				cache->entries = grown;
+				cache->capacity = capacity;
+			}
+			
+			node = malloc(sizeof(cache_node_t));
+			if (node == NULL)
+				return ENOMEM;
+			
+			node->id = id;
+			node->index = cache->count++;
+			hash_table_insert(&cache->index, &node->link);
+		}
+		
+		memcpy(cache_entry(cache, node->index), entry,
+		    cache->entry_size);
+	}
+	
+	cache->generation = delta->generation;
+	return EOK;
+}
+
+/** Copy the records of the cache.
+ *
+ * @return Array of the records or NULL if out of memory.
+ *
+ */
+static void *cache_copy(delta_cache_t *cache, size_t *count)
+{
+	void *entries = calloc(cache->count, cache->entry_size);
+	if (entries == NULL)
+		return NULL;
+	
+	memcpy(entries, cache->entries, cache->count * cache->entry_size);
+	*count = cache->count;
+	return entries;
+}
+
+/** Bring the task cache up to date and copy it. */
+static const char *read_tasks(data_t *target)
+{
+	stats_delta_t *delta = NULL;
+	stats_task_t *tasks;
+	task_id_t *exited;
+	
+	for (unsigned int i = 0; (delta == NULL) && (i < DELTA_ATTEMPTS); i++)
+		delta = stats_get_tasks_delta(task_cache.generation, &tasks,
+		    &exited);
+	
+	if (delta == NULL)
+		return "Cannot get tasks";
+	
+	errno_t rc = cache_update(&task_cache, delta, tasks, exited);
+	free(delta);
+	if (rc != EOK)
+		return "Not enough memory for tasks";
+	
+	target->tasks = cache_copy(&task_cache, &target->tasks_count);
+	if (target->tasks == NULL)
+		return "Not enough memory for tasks";
+	
+	return NULL;
+}
+
+/** Bring the thread cache up to date and copy it. */
+static const char *read_threads(data_t *target)
+{
+	stats_delta_t *delta = NULL;
+	stats_thread_t *threads;
+	thread_id_t *exited;
+	
+	for (unsigned int i = 0; (delta == NULL) && (i < DELTA_ATTEMPTS); i++)
+		delta = stats_get_threads_delta(thread_cache.generation,
+		    &threads, &exited);
+	
+	if (delta == NULL)
+		return "Cannot get threads";
+	
+	errno_t rc = cache_update(&thread_cache, delta, threads, exited);
+	free(delta);
+	if (rc != EOK)
+		return "Not enough memory for threads";
+	
+	target->threads = cache_copy(&thread_cache, &target->threads_count);
+	if (target->threads == NULL)
+		return "Not enough memory for threads";
+	
+	return NULL;
+}
+
 static const char *read_data(data_t *target)
 {
+	const char *ret;
+	
 	/* Initialize data */
 	target->load = NULL;
 	target->cpus = NULL;
@@ -186,9 +455,9 @@ static const char *read_data(data_t *target)
 		return "Not enough memory for CPU utilization";
 	
 	/* Get tasks */
-	target->tasks = stats_get_tasks(&(target->tasks_count));
-	if (target->tasks == NULL)
-		return "Cannot get tasks";
+	ret = read_tasks(target);
+	if (ret != NULL)
+		return ret;
 	
 	target->tasks_perc =
 	    (perc_task_t *) calloc(target->tasks_count, sizeof(perc_task_t));
@@ -196,9 +465,9 @@ static const char *read_data(data_t *target)
 		return "Not enough memory for task utilization";
 	
 	/* Get threads */
-	target->threads = stats_get_threads(&(target->threads_count));
-	if (target->threads == NULL)
-		return "Cannot get threads";
+	ret = read_threads(target);
+	if (ret != NULL)
+		return ret;
 	
 	/* Get Exceptions */
 	target->exceptions = stats_get_exceptions(&(target->exceptions_count));
@@ -436,6 +705,8 @@ static const char *fill_task_table(data_t *data)
 		field[TASK_COL_PERCENT_USER].fixed = perc->ucycles;
 		field[TASK_COL_PERCENT_KERNEL].type = FIELD_PERCENT;
 		field[TASK_COL_PERCENT_KERNEL].fixed = perc->kcycles;
+		field[TASK_COL_FAULTS].type = FIELD_UINT_SUFFIX_DEC;
+		field[TASK_COL_FAULTS].uint = task->page_faults;
 		field[TASK_COL_NAME].type = FIELD_STRING;
 		field[TASK_COL_NAME].string = task->name;
 		field += TASK_NUM_COLUMNS;
@@ -675,6 +946,8 @@ int main(int argc, char *argv[])
 out:
 	screen_done();
 	free_data(&data);
+	free(task_cache.entries);
+	free(thread_cache.entries);
 	
 	if (ret != NULL) {
 		fprintf(stderr, "%s: %s\n", NAME, ret);
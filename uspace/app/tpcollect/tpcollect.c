@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tpcollect
+ * @brief Tracepoint event collector.
+ * @{
+ */
+/**
+ * @file
+ *
+ * Enables the selected tracepoints for a while, collects the recorded
+ * events and writes them as a timeline in the Chrome trace event format.
+ * Each event becomes an instant event of the thread which hit the
+ * tracepoint. Consecutive scheduler switches on a processor delimit the
+ * slices in which the threads were running.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <macros.h>
+#include <str.h>
+#include <str_error.h>
+#include <getopt.h>
+#include <stats.h>
+#include <sysinfo.h>
+#include <tracepoint.h>
+#include <adt/list.h>
+#include <collect.h>
+
+#define NAME  "tpcollect"
+
+/** Default tracing duration (seconds) */
+#define DEFAULT_DURATION  5
+
+/** Default output file */
+#define DEFAULT_OUTPUT  "/tmp/trace.json"
+
+/** Number of events read at once */
+#define READ_EVENTS  512
+
+static const char *tp_names[TP_COUNT] = {
+	[TP_SCHED_SWITCH] = "sched_switch",
+	[TP_IPC_CALL] = "ipc_call",
+	[TP_IPC_ANSWER] = "ipc_answer",
+	[TP_PAGE_FAULT] = "page_fault",
+	[TP_FUTEX_SLEEP] = "futex_sleep",
+	[TP_FUTEX_WAKEUP] = "futex_wakeup",
+	[TP_BLOCK_READ] = "block_read",
+	[TP_BLOCK_WRITE] = "block_write"
+};
+
+static collect_t collect;
+
+static tracepoint_event_t *events = NULL;
+static size_t events_count = 0;
+
+/** Processor frequencies in MHz indexed by processor ID */
+static uint16_t *cpu_mhz = NULL;
+static size_t cpu_count = 0;
+
+static struct option const long_options[] = {
+	{ "help", no_argument, 0, 'h' },
+	{ "duration", required_argument, 0, 'd' },
+	{ "events", required_argument, 0, 'e' },
+	{ "output", required_argument, 0, 'o' },
+	{ 0, 0, 0, 0 }
+};
+
+static void print_usage(void)
+{
+	printf("Usage: %s [-d seconds] [-e event[,event...]] [-o file]\n\n"
+	    "\t-d\n\t--duration\n\t\tTrace for the given number of "
+	    "seconds (default %u)\n\n"
+	    "\t-e\n\t--events\n\t\tEnable only the given events "
+	    "(default all)\n\n"
+	    "\t-o\n\t--output\n\t\tWrite the trace to the given file "
+	    "(default %s)\n\n"
+	    "\t-h\n\t--help\n\t\tPrint this usage information\n\n"
+	    "Events:", NAME, DEFAULT_DURATION, DEFAULT_OUTPUT);
+	
+	for (unsigned int i = 0; i < TP_COUNT; i++)
+		printf(" %s", tp_names[i]);
+	
+	printf("\n");
+}
+
+/** Parse a comma separated list of event names.
+ *
+ * @param list List of event names. It is modified by the parsing.
+ * @param mask Place to store the mask of the tracepoints.
+ *
+ * @return EOK on success, EINVAL if an event name is not known.
+ *
+ */
+static errno_t events_parse(char *list, uint32_t *mask)
+{
+	char *next;
+	
+	*mask = 0;
+	
+	for (char *name = str_tok(list, ",", &next); name != NULL;
+	    name = str_tok(next, ",", &next)) {
+		unsigned int i;
+		for (i = 0; i < TP_COUNT; i++) {
+			if (str_cmp(name, tp_names[i]) == 0)
+				break;
+		}
+		
+		if (i == TP_COUNT) {
+			fprintf(stderr, "%s: Unknown event '%s'\n", NAME, name);
+			return EINVAL;
+		}
+		
+		*mask |= TP_MASK(i);
+	}
+	
+	return EOK;
+}
+
+static errno_t events_read(void *buf, size_t max, size_t *count)
+{
+	return tracepoint_read(buf, max, count);
+}
+
+static task_id_t event_task(const void *event)
+{
+	return ((const tracepoint_event_t *) event)->task_id;
+}
+
+static errno_t events_disable(void)
+{
+	return tracepoint_enable(0);
+}
+
+/** Enable the tracepoints and collect the events. */
+static errno_t events_collect(unsigned int duration, uint32_t mask)
+{
+	collect_init(&collect, sizeof(tracepoint_event_t), READ_EVENTS,
+	    events_read, event_task, sizeof(collect_task_t));
+	
+	errno_t rc = tracepoint_enable(mask);
+	if (rc != EOK)
+		return rc;
+	
+	rc = collect_run(&collect, duration, events_disable);
+	
+	events = collect.records;
+	events_count = collect.count;
+	return rc;
+}
+
+/** Look up the frequencies of the processors. */
+static errno_t cpus_get(void)
+{
+	size_t count;
+	stats_cpu_t *cpus = stats_get_cpus(&count);
+	if (cpus == NULL)
+		return ENOMEM;
+	
+	for (size_t i = 0; i < count; i++)
+		cpu_count = max(cpu_count, cpus[i].id + 1);
+	
+	cpu_mhz = calloc(cpu_count, sizeof(uint16_t));
+	if (cpu_mhz == NULL) {
+		free(cpus);
+		return ENOMEM;
+	}
+	
+	for (size_t i = 0; i < count; i++)
+		cpu_mhz[cpus[i].id] = cpus[i].frequency_mhz;
+	
+	free(cpus);
+	return EOK;
+}
+
+/** Convert the cycle counter value of an event to nanoseconds.
+ *
+ * The cycle counters of the processors are assumed to run in sync.
+ *
+ */
+static uint64_t event_ns(const tracepoint_event_t *event)
+{
+	uint64_t mhz = 0;
+	
+	if (event->cpu < cpu_count)
+		mhz = cpu_mhz[event->cpu];
+	
+	if (mhz == 0)
+		mhz = 1;
+	
+	return event->cycle * 1000 / mhz;
+}
+
+static int event_cmp(const void *a, const void *b)
+{
+	const tracepoint_event_t *ea = a;
+	const tracepoint_event_t *eb = b;
+	
+	if (ea->cpu != eb->cpu)
+		return (ea->cpu < eb->cpu) ? -1 : 1;
+	
+	if (ea->cycle != eb->cycle)
+		return (ea->cycle < eb->cycle) ? -1 : 1;
+	
+	return 0;
+}
+
+/** Write a string as a JSON string literal. */
+static void json_string(FILE *file, const char *str)
+{
+	fputc('"', file);
+	
+	for (; *str != '\0'; str++) {
+		if ((*str == '"') || (*str == '\\'))
+			fputc('\\', file);
+		
+		if ((unsigned char) *str >= ' ')
+			fputc(*str, file);
+	}
+	
+	fputc('"', file);
+}
+
+/** Write a time in microseconds with nanosecond precision. */
+static void json_time(FILE *file, uint64_t ns)
+{
+	fprintf(file, "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+}
+
+/** Write the names of the tasks as metadata events. */
+static void trace_write_tasks(FILE *file, bool *first)
+{
+	list_foreach(collect.tasks, link, collect_task_t, task) {
+		fprintf(file, "%s\n{\"name\":\"process_name\",\"ph\":\"M\","
+		    "\"pid\":%" PRIu64 ",\"args\":{\"name\":",
+		    *first ? "" : ",", task->id);
+		json_string(file, (task->name != NULL) ? task->name :
+		    "[exited]");
+		fprintf(file, "}}");
+		*first = false;
+	}
+}
+
+/** Write the events and the running slices of the threads.
+ *
+ * The events must be sorted by processor and time.
+ *
+ */
+static void trace_write_events(FILE *file, bool *first, uint64_t base)
+{
+	for (size_t i = 0; i < events_count; i++) {
+		tracepoint_event_t *event = &events[i];
+		uint64_t ns = event_ns(event) - base;
+		
+		fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+		    "\"ts\":", *first ? "" : ",", tp_names[event->tracepoint]);
+		json_time(file, ns);
+		fprintf(file, ",\"pid\":%" PRIu64 ",\"tid\":%" PRIu64 ","
+		    "\"args\":{\"cpu\":%" PRIu32 ",\"arg0\":%" PRIu64 ","
+		    "\"arg1\":%" PRIu64 "}}", event->task_id,
+		    event->thread_id, event->cpu, event->arg[0],
+		    event->arg[1]);
+		*first = false;
+		
+		if ((event->tracepoint != TP_SCHED_SWITCH) ||
+		    (event->thread_id == 0))
+			continue;
+		
+		/* The thread runs until the next switch on the processor */
+		size_t next;
+		for (next = i + 1; next < events_count; next++) {
+			if ((events[next].cpu != event->cpu) ||
+			    (events[next].tracepoint == TP_SCHED_SWITCH))
+				break;
+		}
+		
+		if ((next == events_count) || (events[next].cpu != event->cpu))
+			continue;
+		
+		fprintf(file, ",\n{\"name\":\"running\",\"ph\":\"X\",\"ts\":");
+		json_time(file, ns);
+		fprintf(file, ",\"dur\":");
+		json_time(file, event_ns(&events[next]) - base - ns);
+		fprintf(file, ",\"pid\":%" PRIu64 ",\"tid\":%" PRIu64 ","
+		    "\"args\":{\"cpu\":%" PRIu32 "}}", event->task_id,
+		    event->thread_id, event->cpu);
+	}
+}
+
+/** Write the collected events to a file. */
+static errno_t trace_write(const char *path)
+{
+	qsort(events, events_count, sizeof(tracepoint_event_t), event_cmp);
+	
+	uint64_t base = UINT64_MAX;
+	for (size_t i = 0; i < events_count; i++)
+		base = min(base, event_ns(&events[i]));
+	
+	FILE *file = fopen(path, "w");
+	if (file == NULL)
+		return errno;
+	
+	bool first = true;
+	
+	fprintf(file, "{\"traceEvents\":[");
+	trace_write_tasks(file, &first);
+	trace_write_events(file, &first, base);
+	fprintf(file, "\n]}\n");
+	
+	if (ferror(file)) {
+		fclose(file);
+		return EIO;
+	}
+	
+	if (fclose(file) != 0)
+		return EIO;
+	
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t duration = DEFAULT_DURATION;
+	uint32_t mask = TP_MASK_ALL;
+	const char *output = DEFAULT_OUTPUT;
+	errno_t rc;
+	int c;
+	
+	for (c = 0, optind = 0; c != -1;) {
+		c = getopt_long(argc, argv, "hd:e:o:", long_options, NULL);
+		switch (c) {
+		case 'h':
+			print_usage();
+			return 0;
+		case 'd':
+			if (str_uint32_t(optarg, NULL, 10, true,
+			    &duration) != EOK) {
+				fprintf(stderr, "%s: Invalid value '%s'\n",
+				    NAME, optarg);
+				return 1;
+			}
+			break;
+		case 'e':
+			if (events_parse(optarg, &mask) != EOK)
+				return 1;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case -1:
+			continue;
+		default:
+			print_usage();
+			return 1;
+		}
+	}
+	
+	if ((optind < argc) || (mask == 0)) {
+		print_usage();
+		return 1;
+	}
+	
+	rc = cpus_get();
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Cannot get processor information: %s\n",
+		    NAME, str_error(rc));
+		return 1;
+	}
+	
+	printf("%s: Tracing for %" PRIu32 " s...\n", NAME, duration);
+	
+	rc = events_collect(duration, mask);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Tracing failed: %s\n", NAME,
+		    str_error(rc));
+		return 1;
+	}
+	
+	rc = trace_write(output);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Cannot write '%s': %s\n", NAME, output,
+		    str_error(rc));
+		return 1;
+	}
+	
+	sysarg_t dropped = 0;
+	(void) sysinfo_get_value("tracepoint.dropped", &dropped);
+	
+	printf("%zu events, %" PRIun " dropped, written to %s\n",
+	    events_count, dropped, output);
+	
+	return 0;
+}
+
+/** @}
+ */
@@ -49,6 +49,7 @@
 
 #define READ_SIZE   (32 * 1024)
 #define STREAM_BUFFER_SIZE   (64 * 1024)
+#define RING_PERIODS   4
 
 /**
  * Play audio file using a new stream on provided context.
@@ -112,12 +113,66 @@ static errno_t hplay_ctx(hound_context_t *ctx, const char *filename)
 	return ret;
 }
 
+/**
+ * Play the rest of an audio file using a shared ring stream.
+ * @param hound Connected playback context.
+ * @param format Audio data format.
+ * @param source Opened file positioned after the header.
+ * @param period_ms Ring period length in milliseconds.
+ * @return Error code.
+ *
+ * Prints latency statistics measured by the sound server when done.
+ */
+static errno_t hplay_ring(hound_context_t *hound, pcm_format_t format,
+    FILE *source, unsigned period_ms)
+{
+	const size_t frame_size = pcm_format_frame_size(&format);
+	size_t period = format.sampling_rate * period_ms / 1000 * frame_size;
+	if (period == 0)
+		period = frame_size;
+
+	hound_stream_t *stream = hound_stream_create_ring(hound,
+	    HOUND_STREAM_DRAIN_ON_EXIT, format, period, RING_PERIODS);
+	if (!stream) {
+		printf("Failed to create shared ring stream\n");
+		return ENOMEM;
+	}
+	printf("Shared ring: %u periods of %zu bytes\n", RING_PERIODS, period);
+
+	/* Read and play */
+	static char buffer[READ_SIZE];
+	errno_t ret = EOK;
+	size_t read;
+	while ((read = fread(buffer, sizeof(char), READ_SIZE, source)) > 0) {
+		ret = hound_stream_write(stream, buffer, read);
+		if (ret != EOK) {
+			printf("Failed to write to hound stream: %s\n",
+			    str_error(ret));
+			break;
+		}
+	}
+
+	hound_stream_drain(stream);
+	hound_stream_stats_t stats;
+	if (hound_stream_get_stats(stream, &stats) == EOK) {
+		printf("Latency over %u periods: write to mix "
+		    "%ld/%ld/%ld us (min/avg/max), device lead %ld us, "
+		    "end-to-end ~%ld us, %u underruns\n", stats.periods,
+		    (long) stats.min, (long) stats.avg, (long) stats.max,
+		    (long) stats.lead, (long) (stats.avg + stats.lead),
+		    stats.underruns);
+	}
+	hound_stream_destroy(stream);
+	return ret;
+}
+
 /**
  * Play audio file via hound server.
  * @param filename File to play.
+ * @param period_ms Period length of a shared ring, 0 to send data over IPC.
  * @return Error code
  */
-static errno_t hplay(const char *filename)
+static errno_t hplay(const char *filename, unsigned period_ms)
 {
 	printf("Hound playback: %s\n", filename);
 	FILE *source = fopen(filename, "rb");
@@ -165,6 +220,13 @@ static errno_t hplay(const char *filename)
 		return ret;
 	}
 
+	if (period_ms > 0) {
+		ret = hplay_ring(hound, format, source, period_ms);
+		hound_context_destroy(hound);
+		fclose(source);
+		return ret;
+	}
+
 	/* Read and play */
 	static char buffer[READ_SIZE];
 	while ((read = fread(buffer, sizeof(char), READ_SIZE, source)) > 0) {
@@ -213,6 +275,7 @@ static const struct option opts[] = {
 	{"device", required_argument, 0, 'd'},
 	{"parallel", no_argument, 0, 'p'},
 	{"record", no_argument, 0, 'r'},
+	{"shared", required_argument, 0, 's'},
 	{"help", no_argument, 0, 'h'},
 	{0, 0, 0, 0}
 };
@@ -232,6 +295,9 @@ static void print_help(const char* name)
 	    "service. Use location path or a special device `default'\n");
 	printf("\t -p, --parallel\t Play given files in parallel instead of "
 	    "sequentially (does not work with -d).\n");
+	printf("\t -s, --shared\t Pass data to the sound server in a shared "
+	    "ring with periods of given length (ms) and print latency "
+	    "statistics (does not work with -d or -p).\n");
 }
 
 int main(int argc, char *argv[])
@@ -239,12 +305,13 @@ int main(int argc, char *argv[])
 	const char *device = "default";
 	int idx = 0;
 	bool direct = false, record = false, parallel = false;
+	unsigned period_ms = 0;
 	optind = 0;
 	int ret = 0;
 
 	/* Parse command line options */
 	while (ret != -1) {
-		ret = getopt_long(argc, argv, "d:prh", opts, &idx);
+		ret = getopt_long(argc, argv, "d:prs:h", opts, &idx);
 		switch (ret) {
 		case 'd':
 			direct = true;
@@ -256,6 +323,13 @@ int main(int argc, char *argv[])
 		case 'p':
 			parallel = true;
 			break;
+		case 's':
+			period_ms = strtoul(optarg, NULL, 10);
+			if (period_ms == 0) {
+				print_help(*argv);
+				return 1;
+			}
+			break;
 		case 'h':
 			print_help(*argv);
 			return 0;
@@ -269,6 +343,13 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	if (period_ms > 0 && (parallel || direct)) {
+		printf("Shared ring playback is available only for sequential "
+		    "playback via sound server (no -d or -p)\n");
+		print_help(*argv);
+		return 1;
+	}
+
 	if (optind == argc) {
 		printf("Not enough arguments.\n");
 		print_help(*argv);
@@ -333,7 +414,7 @@ int main(int argc, char *argv[])
 				atomic_inc(&playcount);
 				fibril_add_ready(fid);
 			} else {
-				hplay(file);
+				hplay(file, period_ms);
 			}
 		}
 	}
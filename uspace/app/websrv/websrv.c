@@ -33,8 +33,11 @@
  * @file Skeletal web server.
  */
 
+
 #include <errno.h>
 #include <assert.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -44,6 +47,8 @@
 
 #include <vfs/vfs.h>
 
+#include <http/http.h>
+#include <http/receive-buffer.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 #include <inet/tcp.h>
@@ -59,9 +64,28 @@
 
 #define WEB_ROOT  "/data/web"
 
-/** Buffer for receiving the request. */
+/** Buffer for copying file data when not using send-file. */
 #define BUFFER_SIZE  1024
 
+/** Buffer for receiving requests. */
+#define RECV_BUFFER_SIZE  4096
+
+/** Maximum size of a single request header. */
+#define HEADER_SIZE_MAX  1024
+
+/** Maximum number of request headers. */
+#define HEADER_COUNT_MAX  32
+
+/** Number of open files kept in the file cache. */
+#define FCACHE_SIZE  16
+
+/** Connection buffer sizes in TCP service. */
+#define SND_BUF_SIZE  (64 * 1024)
+#define RCV_BUF_SIZE  (16 * 1024)
+
+/** Size of memory shared with TCP service in each direction. */
+#define RING_SIZE  (64 * 1024)
+
 static void websrv_new_conn(tcp_listener_t *, tcp_conn_t *);
 
 static tcp_listen_cb_t listen_cb = {
@@ -74,28 +98,37 @@ static tcp_cb_t conn_cb = {
 
 static uint16_t port = DEFAULT_PORT;
 
-typedef struct {
-	tcp_conn_t *conn;
-
-	char rbuf[BUFFER_SIZE];
-	size_t rbuf_out;
-	size_t rbuf_in;
-
-	char lbuf[BUFFER_SIZE + 1];
-	size_t lbuf_used;
-} recv_t;
-
 static bool verbose = false;
 
-/** Responses to send to client. */
+/** Keep recently served files open */
+static bool use_fcache = true;
 
-static const char *msg_ok =
-    "HTTP/1.0 200 OK\r\n"
-    "\r\n";
+/** Let the TCP service read file data instead of copying them here */
+static bool use_send_file = true;
+
+/** Open file, possibly shared by several responses. */
+typedef struct {
+	/** File name, NULL if the cache entry is free */
+	char *name;
+	/** Open file handle */
+	int fd;
+	/** File size */
+	aoff64_t size;
+	/** Number of responses using the file */
+	unsigned refcnt;
+	/** Time of the last use, for replacement */
+	unsigned long last_use;
+	/** True if the entry is in the cache */
+	bool cached;
+} fcache_entry_t;
+
+static FIBRIL_MUTEX_INITIALIZE(fcache_lock);
+static fcache_entry_t fcache[FCACHE_SIZE];
+static unsigned long fcache_clock;
+
+/** Bodies of responses to send to client. */
 
 static const char *msg_bad_request =
-    "HTTP/1.0 400 Bad Request\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>400 Bad Request</title>\r\n"
@@ -107,8 +140,6 @@ static const char *msg_bad_request =
     "</html>\r\n";
 
 static const char *msg_not_found =
-    "HTTP/1.0 404 Not Found\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>404 Not Found</title>\r\n"
@@ -120,8 +151,6 @@ static const char *msg_not_found =
     "</html>\r\n";
 
 static const char *msg_not_implemented =
-    "HTTP/1.0 501 Not Implemented\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>501 Not Implemented</title>\r\n"
@@ -132,78 +161,145 @@ static const char *msg_not_implemented =
     "</body>\r\n"
     "</html>\r\n";
 
-
-static errno_t recv_create(tcp_conn_t *conn, recv_t **rrecv)
+static errno_t websrv_recv(void *arg, void *buf, size_t size, size_t *nrecv)
 {
-	recv_t *recv;
+	tcp_conn_t *conn = arg;
 	
-	recv = calloc(1, sizeof(recv_t));
-	if (recv == NULL)
-		return ENOMEM;
-	
-	recv->conn = conn;
-	recv->rbuf_out = 0;
-	recv->rbuf_in = 0;
-	recv->lbuf_used = 0;
-	
-	*rrecv = recv;
-	return EOK;
+	return tcp_conn_recv_wait(conn, buf, size, nrecv);
 }
 
-static void recv_destroy(recv_t *recv)
+/** Open a file and determine its size. */
+static errno_t file_open(const char *fname, int *rfd, aoff64_t *rsize)
 {
-	free(recv);
+	int fd;
+	errno_t rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ, &fd);
+	if (rc != EOK)
+		return rc;
+	
+	vfs_stat_t st;
+	rc = vfs_stat(fd, &st);
+	if (rc != EOK) {
+		vfs_put(fd);
+		return rc;
+	}
+	
+	*rfd = fd;
+	*rsize = st.size;
+	return EOK;
 }
 
-/** Receive one character (with buffering) */
-static errno_t recv_char(recv_t *recv, char *c)
+/** Get an open file, from the cache if possible.
+ *
+ * Cached files stay open between requests, so their size is the one
+ * seen when the file was first served.
+ *
+ * @param fname File name
+ * @param rentry Place to store the file, release it with fcache_put()
+ * @return EOK on success or an error code
+ */
+static errno_t fcache_get(const char *fname, fcache_entry_t **rentry)
 {
-	size_t nrecv;
-	errno_t rc;
+	fcache_entry_t *entry;
+	int fd;
+	aoff64_t size;
+	
+	if (use_fcache) {
+		fibril_mutex_lock(&fcache_lock);
+		for (size_t i = 0; i < FCACHE_SIZE; i++) {
+			entry = &fcache[i];
+			if (entry->name != NULL &&
+			    str_cmp(entry->name, fname) == 0) {
+				entry->refcnt++;
+				entry->last_use = ++fcache_clock;
+				fibril_mutex_unlock(&fcache_lock);
+				*rentry = entry;
+				return EOK;
+			}
+		}
+		fibril_mutex_unlock(&fcache_lock);
+	}
 	
-	if (recv->rbuf_out == recv->rbuf_in) {
-		recv->rbuf_out = 0;
-		recv->rbuf_in = 0;
+	/* Open the file without holding the lock */
+	errno_t rc = file_open(fname, &fd, &size);
+	if (rc != EOK)
+		return rc;
+	
+	if (use_fcache) {
+		fibril_mutex_lock(&fcache_lock);
 		
-		rc = tcp_conn_recv_wait(recv->conn, recv->rbuf, BUFFER_SIZE, &nrecv);
-		if (rc != EOK) {
-			fprintf(stderr, "tcp_conn_recv() failed: %s\n", str_error(rc));
-			return rc;
+		/* Find a free entry or the least recently used idle one */
+		fcache_entry_t *victim = NULL;
+		for (size_t i = 0; i < FCACHE_SIZE; i++) {
+			entry = &fcache[i];
+			if (entry->name != NULL &&
+			    str_cmp(entry->name, fname) == 0) {
+				/* Opened by someone else in the meantime */
+				entry->refcnt++;
+				entry->last_use = ++fcache_clock;
+				fibril_mutex_unlock(&fcache_lock);
+				vfs_put(fd);
+				*rentry = entry;
+				return EOK;
+			}
+			
+			if (entry->refcnt > 0)
+				continue;
+			if (victim == NULL || entry->name == NULL ||
+			    (victim->name != NULL &&
+			    entry->last_use < victim->last_use))
+				victim = entry;
 		}
 		
-		recv->rbuf_in = nrecv;
+		char *name = str_dup(fname);
+		if (victim != NULL && name != NULL) {
+			if (victim->name != NULL) {
+				vfs_put(victim->fd);
+				free(victim->name);
+			}
+			
+			victim->name = name;
+			victim->fd = fd;
+			victim->size = size;
+			victim->refcnt = 1;
+			victim->last_use = ++fcache_clock;
+			victim->cached = true;
+			fibril_mutex_unlock(&fcache_lock);
+			*rentry = victim;
+			return EOK;
+		}
+		
+		fibril_mutex_unlock(&fcache_lock);
+		free(name);
 	}
 	
-	*c = recv->rbuf[recv->rbuf_out++];
+	/* Not cached */
+	entry = calloc(1, sizeof(fcache_entry_t));
+	if (entry == NULL) {
+		vfs_put(fd);
+		return ENOMEM;
+	}
+	
+	entry->fd = fd;
+	entry->size = size;
+	entry->refcnt = 1;
+	entry->cached = false;
+	*rentry = entry;
 	return EOK;
 }
 
-/** Receive one line with length limit */
-static errno_t recv_line(recv_t *recv, char **rbuf)
+/** Release a file obtained with fcache_get(). */
+static void fcache_put(fcache_entry_t *entry)
 {
-	char *bp = recv->lbuf;
-	char c = '\0';
-	
-	while (bp < recv->lbuf + BUFFER_SIZE) {
-		char prev = c;
-		errno_t rc = recv_char(recv, &c);
-		
-		if (rc != EOK)
-			return rc;
-		
-		*bp++ = c;
-		if ((prev == '\r') && (c == '\n'))
-			break;
+	if (!entry->cached) {
+		vfs_put(entry->fd);
+		free(entry);
+		return;
 	}
 	
-	recv->lbuf_used = bp - recv->lbuf;
-	*bp = '\0';
-	
-	if (bp == recv->lbuf + BUFFER_SIZE)
-		return ELIMIT;
-	
-	*rbuf = recv->lbuf;
-	return EOK;
+	fibril_mutex_lock(&fcache_lock);
+	assert(entry->refcnt > 0);
+	entry->refcnt--;
+	fibril_mutex_unlock(&fcache_lock);
 }
 
 static bool uri_is_valid(char *uri)
@@ -225,14 +321,41 @@ static bool uri_is_valid(char *uri)
 	return true;
 }
 
-static errno_t send_response(tcp_conn_t *conn, const char *msg)
+/** Send response status line and headers. */
+static errno_t send_header(tcp_conn_t *conn, const char *status,
+    aoff64_t length, bool keep_alive)
 {
-	size_t response_size = str_size(msg);
+	char *header;
 	
 	if (verbose)
-	    fprintf(stderr, "Sending response\n");
+		fprintf(stderr, "Sending response %s\n", status);
+	
+	int len = asprintf(&header, "HTTP/1.1 %s\r\n"
+	    "Content-Length: %" PRIu64 "\r\n"
+	    "%s\r\n", status, length,
+	    keep_alive ? "" : "Connection: close\r\n");
+	if (len < 0)
+		return ENOMEM;
+	
+	errno_t rc = tcp_conn_send(conn, header, len);
+	if (rc != EOK)
+		fprintf(stderr, "tcp_conn_send() failed\n");
 	
-	errno_t rc = tcp_conn_send(conn, (void *) msg, response_size);
+	free(header);
+	return rc;
+}
+
+/** Send response with a short body. */
+static errno_t send_response(tcp_conn_t *conn, const char *status,
+    const char *msg, bool keep_alive)
+{
+	size_t response_size = str_size(msg);
+	
+	errno_t rc = send_header(conn, status, response_size, keep_alive);
+	if (rc != EOK)
+		return rc;
+	
+	rc = tcp_conn_send(conn, (void *) msg, response_size);
 	if (rc != EOK) {
 		fprintf(stderr, "tcp_conn_send() failed\n");
 		return rc;
@@ -241,101 +364,128 @@ static errno_t send_response(tcp_conn_t *conn, const char *msg)
 	return EOK;
 }
 
-static errno_t uri_get(const char *uri, tcp_conn_t *conn)
+/** Send file data by copying them through a local buffer. */
+static errno_t send_file_copy(tcp_conn_t *conn, fcache_entry_t *file)
 {
-	char *fbuf = NULL;
-	char *fname = NULL;
-	errno_t rc;
-	size_t nr;
-	int fd = -1;
+	char *fbuf = malloc(BUFFER_SIZE);
+	if (fbuf == NULL)
+		return ENOMEM;
 	
-	fbuf = calloc(BUFFER_SIZE, 1);
-	if (fbuf == NULL) {
-		rc = ENOMEM;
-		goto out;
+	errno_t rc = EOK;
+	aoff64_t pos = 0;
+	while (pos < file->size) {
+		size_t nr;
+		rc = vfs_read(file->fd, &pos, fbuf,
+		    min(file->size - pos, BUFFER_SIZE), &nr);
+		if (rc != EOK)
+			break;
+		
+		/* The file shrunk, the promised length cannot be met */
+		if (nr == 0) {
+			rc = EIO;
+			break;
+		}
+		
+		rc = tcp_conn_send(conn, fbuf, nr);
+		if (rc != EOK) {
+			fprintf(stderr, "tcp_conn_send() failed\n");
+			break;
+		}
 	}
 	
+	free(fbuf);
+	return rc;
+}
+
+static errno_t uri_get(const char *uri, tcp_conn_t *conn, bool keep_alive)
+{
+	char *fname = NULL;
+	fcache_entry_t *file = NULL;
+	errno_t rc;
+	
 	if (str_cmp(uri, "/") == 0)
 		uri = "/index.html";
 	
-	if (asprintf(&fname, "%s%s", WEB_ROOT, uri) < 0) {
-		rc = ENOMEM;
-		goto out;
-	}
-	
-	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ, &fd);
-	if (rc != EOK) {
-		rc = send_response(conn, msg_not_found);
-		goto out;
-	}
+	if (asprintf(&fname, "%s%s", WEB_ROOT, uri) < 0)
+		return ENOMEM;
 	
+	rc = fcache_get(fname, &file);
 	free(fname);
-	fname = NULL;
+	if (rc != EOK)
+		return send_response(conn, "404 Not Found", msg_not_found,
+		    keep_alive);
 	
-	rc = send_response(conn, msg_ok);
+	rc = send_header(conn, "200 OK", file->size, keep_alive);
 	if (rc != EOK)
 		goto out;
 	
-	aoff64_t pos = 0;
-	while (true) {
-		rc = vfs_read(fd, &pos, fbuf, BUFFER_SIZE, &nr);
+	if (use_send_file) {
+		size_t nsent;
+		rc = tcp_conn_send_file(conn, file->fd, 0, file->size, &nsent);
+		if (rc == EOK && nsent < file->size)
+			rc = EIO;
 		if (rc != EOK)
-			goto out;
-		
-		if (nr == 0)
-			break;
-		
-		rc = tcp_conn_send(conn, fbuf, nr);
-		if (rc != EOK) {
-			fprintf(stderr, "tcp_conn_send() failed\n");
-			goto out;
-		}
+			fprintf(stderr, "tcp_conn_send_file() failed\n");
+	} else {
+		rc = send_file_copy(conn, file);
 	}
 	
-	rc = EOK;
 out:
-	if (fd >= 0)
-		vfs_put(fd);
-	free(fname);
-	free(fbuf);
+	fcache_put(file);
 	return rc;
 }
 
-static errno_t req_process(tcp_conn_t *conn, recv_t *recv)
+/** Receive and answer one request.
+ *
+ * @param conn Connection
+ * @param rb Receive buffer of the connection
+ * @param keep_alive Place to store whether the connection persists
+ * @return EOK on success, EEMPTY if the client closed the connection
+ *         or another error code
+ */
+static errno_t req_process(tcp_conn_t *conn, receive_buffer_t *rb,
+    bool *keep_alive)
 {
-	char *reqline = NULL;
-
-	errno_t rc = recv_line(recv, &reqline);
-	if (rc != EOK) {
-		fprintf(stderr, "recv_line() failed\n");
-		return rc;
+	http_request_t *req = NULL;
+	
+	errno_t rc = http_receive_request(rb, &req, HEADER_SIZE_MAX,
+	    HEADER_COUNT_MAX);
+	if (rc == HTTP_EPARSE || rc == ELIMIT) {
+		*keep_alive = false;
+		return send_response(conn, "400 Bad Request",
+		    msg_bad_request, false);
 	}
 	
-	if (verbose)
-		fprintf(stderr, "Request: %s", reqline);
-	
-	if (str_lcmp(reqline, "GET ", 4) != 0) {
-		rc = send_response(conn, msg_not_implemented);
+	if (rc != EOK) {
+		if (rc != EEMPTY)
+			fprintf(stderr, "http_receive_request() failed\n");
 		return rc;
 	}
 	
-	char *uri = reqline + 4;
-	char *end_uri = str_chr(uri, ' ');
-	if (end_uri == NULL) {
-		end_uri = reqline + str_size(reqline) - 2;
-		assert(*end_uri == '\r');
+	if (verbose) {
+		fprintf(stderr, "Request: %s %s HTTP/%u.%u\n", req->method,
+		    req->path, req->version.major, req->version.minor);
 	}
 	
-	*end_uri = '\0';
-	if (verbose)
-		fprintf(stderr, "Requested URI: %s\n", uri);
-	
-	if (!uri_is_valid(uri)) {
-		rc = send_response(conn, msg_bad_request);
-		return rc;
+	/*
+	 * The body of a rejected request is not read, so the connection
+	 * cannot be used for another request.
+	 */
+	if (str_cmp(req->method, "GET") != 0) {
+		*keep_alive = false;
+		rc = send_response(conn, "501 Not Implemented",
+		    msg_not_implemented, false);
+	} else if (!uri_is_valid(req->path)) {
+		*keep_alive = false;
+		rc = send_response(conn, "400 Bad Request", msg_bad_request,
+		    false);
+	} else {
+		*keep_alive = http_request_keep_alive(req);
+		rc = uri_get(req->path, conn, *keep_alive);
 	}
 	
-	return uri_get(uri, conn);
+	http_request_destroy(req);
+	return rc;
 }
 
 static void usage(void)
@@ -348,6 +498,11 @@ static void usage(void)
 	    "-p port_number | --port=port_number\n"
 	    "\tListening port (default " STRING(DEFAULT_PORT) ").\n"
 	    "\n"
+	    "-c | --no-cache\n"
+	    "\tDo not keep served files open between requests.\n"
+	    "-b | --bounce\n"
+	    "\tCopy file data through the server instead of letting the TCP\n"
+	    "\tservice read them directly.\n"
 	    "-h | --help\n"
 	    "\tShow this application help.\n"
 	    "-v | --verbose\n"
@@ -360,6 +515,12 @@ static errno_t parse_option(int argc, char *argv[], int *index)
 	errno_t rc;
 	
 	switch (argv[*index][1]) {
+	case 'b':
+		use_send_file = false;
+		break;
+	case 'c':
+		use_fcache = false;
+		break;
 	case 'h':
 		usage();
 		exit(0);
@@ -385,6 +546,10 @@ static errno_t parse_option(int argc, char *argv[], int *index)
 				return rc;
 			
 			port = (uint16_t) value;
+		} else if (str_cmp(argv[*index] + 2, "no-cache") == 0) {
+			use_fcache = false;
+		} else if (str_cmp(argv[*index] + 2, "bounce") == 0) {
+			use_send_file = false;
 		} else if (str_cmp(argv[*index] +2, "verbose") == 0) {
 			verbose = true;
 		} else {
@@ -400,22 +565,40 @@ static errno_t parse_option(int argc, char *argv[], int *index)
 	return EOK;
 }
 
+/** Serve a connection.
+ *
+ * Each connection runs in its own fibril. Requests are answered in order
+ * until the client closes the connection or asks for it to be closed, so
+ * pipelined requests are simply read from the receive buffer.
+ */
 static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 {
+	receive_buffer_t rb;
+	bool keep_alive = true;
 	errno_t rc;
-	recv_t *recv = NULL;
 	
 	if (verbose)
 		fprintf(stderr, "New connection, waiting for request\n");
 	
-	rc = recv_create(conn, &recv);
+	/* Only speeds up large transfers, the connection works without it */
+	(void) tcp_conn_set_bufsize(conn, SND_BUF_SIZE, RCV_BUF_SIZE);
+	(void) tcp_conn_ring_create(conn, RING_SIZE);
+	
+	rc = recv_buffer_init(&rb, RECV_BUFFER_SIZE, websrv_recv, conn);
 	if (rc != EOK) {
 		fprintf(stderr, "Out of memory.\n");
 		goto error;
 	}
 	
-	rc = req_process(conn, recv);
-	if (rc != EOK) {
+	while (keep_alive) {
+		rc = req_process(conn, &rb, &keep_alive);
+		if (rc != EOK)
+			break;
+	}
+	
+	recv_buffer_fini(&rb);
+	
+	if (rc != EOK && rc != EEMPTY) {
 		fprintf(stderr, "Error processing request (%s)\n",
 		    str_error(rc));
 		goto error;
@@ -427,14 +610,11 @@ static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 		goto error;
 	}
 
-	recv_destroy(recv);
 	return;
 error:
 	rc = tcp_conn_reset(conn);
 	if (rc != EOK)
 		fprintf(stderr, "Error resetting connection.\n");
-	
-	recv_destroy(recv);
 }
 
 int main(int argc, char *argv[])
@@ -35,8 +35,10 @@
  * @brief ATA disk driver
  *
  * This driver supports CHS, 28-bit and 48-bit LBA addressing, as well as
- * PACKET devices. It only uses PIO transfers. There is no support DMA
- * or any other fancy features such as S.M.A.R.T, removable devices, etc.
+ * PACKET devices. Register devices are accessed using PCI IDE bus master
+ * DMA if the controller provides the bus master registers and an interrupt,
+ * otherwise PIO transfers are used. There is no support for any other fancy
+ * features such as S.M.A.R.T, removable devices, etc.
  *
  * This driver is based on the ATA-1, ATA-2, ATA-3 and ATA/ATAPI-4 through 7
  * standards, as published by the ANSI, NCITS and INCITS standards bodies,
@@ -48,7 +50,9 @@
  */
 
 #include <ddi.h>
+#include <ddf/interrupt.h>
 #include <ddf/log.h>
+#include <device/hw_res.h>
 #include <async.h>
 #include <as.h>
 #include <bd_srv.h>
@@ -83,6 +87,9 @@ static const size_t identify_data_size = 512;
 
 static errno_t ata_bd_init_io(ata_ctrl_t *ctrl);
 static void ata_bd_fini_io(ata_ctrl_t *ctrl);
+static errno_t ata_bd_init_dma(ata_ctrl_t *ctrl);
+static void ata_bd_fini_dma(ata_ctrl_t *ctrl);
+static void ata_irq_handler(ipc_call_t *call, ddf_dev_t *dev);
 
 static errno_t ata_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t ata_bd_close(bd_srv_t *);
@@ -120,6 +127,46 @@ static void coord_sc_program(ata_ctrl_t *ctrl, const block_coord_t *bc,
 static errno_t wait_status(ata_ctrl_t *ctrl, unsigned set, unsigned n_reset,
     uint8_t *pstatus, unsigned timeout);
 
+/** IRQ pseudocode template.
+ *
+ * The addresses of the bus master status register (commands 0 and 3)
+ * and of the ATA status register (command 4) are filled in by
+ * @c ata_bd_init_dma(). Reading the ATA status register acknowledges
+ * the interrupt to the device.
+ */
+static const irq_cmd_t ata_irq_cmds[ATA_IRQ_CMDS] = {
+	{
+		.cmd = CMD_PIO_READ_8,
+		.addr = NULL,
+		.dstarg = 1
+	},
+	{
+		.cmd = CMD_AND,
+		.value = BMS_INTR,
+		.srcarg = 1,
+		.dstarg = 2
+	},
+	{
+		.cmd = CMD_PREDICATE,
+		.value = 3,
+		.srcarg = 2
+	},
+	{
+		/* Write back INTR and ERR to clear them. */
+		.cmd = CMD_PIO_WRITE_A_8,
+		.addr = NULL,
+		.srcarg = 1
+	},
+	{
+		.cmd = CMD_PIO_READ_8,
+		.addr = NULL,
+		.dstarg = 3
+	},
+	{
+		.cmd = CMD_ACCEPT
+	}
+};
+
 bd_ops_t ata_bd_ops = {
 	.open = ata_bd_open,
 	.close = ata_bd_close,
@@ -151,8 +198,12 @@ errno_t ata_ctrl_init(ata_ctrl_t *ctrl, ata_base_t *res)
 	ddf_msg(LVL_DEBUG, "ata_ctrl_init()");
 
 	fibril_mutex_initialize(&ctrl->lock);
+	fibril_condvar_initialize(&ctrl->irq_cv);
 	ctrl->cmd_physical = res->cmd;
 	ctrl->ctl_physical = res->ctl;
+	ctrl->bmi_physical = res->bmi;
+	ctrl->irq = res->irq;
+	ctrl->bmi = NULL;
 
 	ddf_msg(LVL_NOTE, "I/O address %p/%p", (void *) ctrl->cmd_physical,
 	    (void *) ctrl->ctl_physical);
@@ -161,6 +212,9 @@ errno_t ata_ctrl_init(ata_ctrl_t *ctrl, ata_base_t *res)
 	if (rc != EOK)
 		return rc;
 
+	/* Fall back to PIO if DMA cannot be used. */
+	(void) ata_bd_init_dma(ctrl);
+
 	for (i = 0; i < MAX_DISKS; i++) {
 		ddf_msg(LVL_NOTE, "Identify drive %d...", i);
 
@@ -299,8 +353,8 @@ static void disk_print_summary(disk_t *d)
 		}
 	}
 
-	ddf_msg(LVL_NOTE, "%s: %s %" PRIu64 " blocks%s", d->model, atype,
-	    d->blocks, cap);
+	ddf_msg(LVL_NOTE, "%s: %s %" PRIu64 " blocks%s%s", d->model, atype,
+	    d->blocks, cap, d->dma ? " (DMA)" : "");
 cleanup:
 	free(atype);
 	free(cap);
@@ -334,10 +388,148 @@ static errno_t ata_bd_init_io(ata_ctrl_t *ctrl)
 /** Clean up device I/O. */
 static void ata_bd_fini_io(ata_ctrl_t *ctrl)
 {
-	(void) ctrl;
+	ata_bd_fini_dma(ctrl);
 	/* XXX TODO */
 }
 
+/** Set up bus master DMA.
+ *
+ * Maps the bus master registers, allocates the PRD table and the bounce
+ * buffer and registers the completion interrupt handler.
+ *
+ * @param ctrl		Controller
+ *
+ * @return		EOK on success, ENOTSUP if the controller has no bus
+ *			master registers or interrupt, other error code
+ *			if setting up DMA failed.
+ */
+static errno_t ata_bd_init_dma(ata_ctrl_t *ctrl)
+{
+	ata_bm_t *bmi_phys = (ata_bm_t *) ctrl->bmi_physical;
+	ata_cmd_t *cmd_phys = (ata_cmd_t *) ctrl->cmd_physical;
+	irq_code_t irq_code;
+	ata_bm_t *bmi = NULL;
+	void *vaddr;
+	errno_t rc;
+
+	ctrl->prdt = NULL;
+	ctrl->dma_buf = NULL;
+
+	if (ctrl->bmi_physical == 0 || ctrl->irq < 0) {
+		ddf_msg(LVL_NOTE, "No bus master DMA resources, using PIO.");
+		return ENOTSUP;
+	}
+
+	rc = pio_enable((void *) ctrl->bmi_physical, sizeof(ata_bm_t), &vaddr);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot initialize bus master I/O space.");
+		goto error;
+	}
+
+	bmi = vaddr;
+
+	vaddr = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(DMA_MAX_PRD * sizeof(ata_prd_t),
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl->prdt_phys,
+	    &vaddr);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot allocate PRD table.");
+		goto error;
+	}
+
+	ctrl->prdt = vaddr;
+
+	vaddr = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(DMA_BUF_SIZE, DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl->dma_buf_phys, &vaddr);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot allocate DMA buffer.");
+		goto error;
+	}
+
+	ctrl->dma_buf = vaddr;
+
+	ctrl->irq_ranges[0].base = ctrl->bmi_physical;
+	ctrl->irq_ranges[0].size = sizeof(ata_bm_t);
+	ctrl->irq_ranges[1].base = ctrl->cmd_physical;
+	ctrl->irq_ranges[1].size = sizeof(ata_cmd_t);
+
+	memcpy(ctrl->irq_cmds, ata_irq_cmds, sizeof(ata_irq_cmds));
+	ctrl->irq_cmds[0].addr = (void *) &bmi_phys->status;
+	ctrl->irq_cmds[3].addr = (void *) &bmi_phys->status;
+	ctrl->irq_cmds[4].addr = (void *) &cmd_phys->status;
+
+	irq_code.rangecount = sizeof(ctrl->irq_ranges) /
+	    sizeof(irq_pio_range_t);
+	irq_code.ranges = ctrl->irq_ranges;
+	irq_code.cmdcount = sizeof(ctrl->irq_cmds) / sizeof(irq_cmd_t);
+	irq_code.cmds = ctrl->irq_cmds;
+
+	rc = register_interrupt_handler(ctrl->dev, ctrl->irq, ata_irq_handler,
+	    &irq_code, &ctrl->irq_cap);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed to register interrupt handler.");
+		goto error;
+	}
+
+	rc = hw_res_enable_interrupt(ddf_dev_parent_sess_get(ctrl->dev),
+	    ctrl->irq);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed to enable interrupt.");
+		unregister_interrupt_handler(ctrl->dev, ctrl->irq_cap);
+		goto error;
+	}
+
+	/* Make sure the devices assert the interrupt. */
+	pio_write_8(&ctrl->ctl->device_control, 0);
+
+	ctrl->bmi = bmi;
+
+	ddf_msg(LVL_NOTE, "Bus master DMA at %p using interrupt %d.",
+	    (void *) ctrl->bmi_physical, ctrl->irq);
+	return EOK;
+error:
+	if (ctrl->dma_buf != NULL)
+		dmamem_unmap_anonymous(ctrl->dma_buf);
+	if (ctrl->prdt != NULL)
+		dmamem_unmap_anonymous(ctrl->prdt);
+	if (bmi != NULL)
+		pio_disable(bmi, sizeof(ata_bm_t));
+
+	ctrl->dma_buf = NULL;
+	ctrl->prdt = NULL;
+	ddf_msg(LVL_WARN, "Falling back to PIO.");
+	return rc;
+}
+
+/** Clean up bus master DMA. */
+static void ata_bd_fini_dma(ata_ctrl_t *ctrl)
+{
+	if (ctrl->bmi == NULL)
+		return;
+
+	unregister_interrupt_handler(ctrl->dev, ctrl->irq_cap);
+	dmamem_unmap_anonymous(ctrl->dma_buf);
+	dmamem_unmap_anonymous(ctrl->prdt);
+	pio_disable(ctrl->bmi, sizeof(ata_bm_t));
+
+	ctrl->dma_buf = NULL;
+	ctrl->prdt = NULL;
+	ctrl->bmi = NULL;
+}
+
+/** DMA completion interrupt handler. */
+static void ata_irq_handler(ipc_call_t *call, ddf_dev_t *dev)
+{
+	ata_ctrl_t *ctrl = (ata_ctrl_t *) ddf_dev_data_get(dev);
+
+	fibril_mutex_lock(&ctrl->lock);
+	ctrl->irq_bm_status = IPC_GET_ARG1(*call);
+	ctrl->irq_fired = true;
+	fibril_condvar_broadcast(&ctrl->irq_cv);
+	fibril_mutex_unlock(&ctrl->lock);
+}
+
 /** Initialize a disk.
  *
  * Probes for a disk, determines its parameters and initializes
@@ -361,6 +553,7 @@ static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id)
 	d->ctrl = ctrl;
 	d->disk_id = disk_id;
 	d->present = false;
+	d->dma = false;
 	d->afun = NULL;
 
 	/* Try identify command. */
@@ -491,6 +684,9 @@ static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id)
 	} else {
 		/* Assume register Read always uses 512-byte blocks. */
 		d->block_size = 512;
+
+		/* Use DMA if both the controller and the device support it. */
+		d->dma = ctrl->bmi != NULL && (idata.caps & rd_cap_dma) != 0;
 	}
 
 	d->present = true;
@@ -507,19 +703,38 @@ static errno_t ata_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
+/** Determine number of blocks to transfer using a single command.
+ *
+ * @param disk		Disk
+ * @param cnt		Number of blocks remaining
+ *
+ * @return		Number of blocks for the next command
+ */
+static size_t ata_disk_xfer_blocks(disk_t *disk, size_t cnt)
+{
+	/* XXX PIO transfers are only done one block at a time */
+	if (!disk->dma)
+		return 1;
+
+	return min(cnt, DMA_BUF_SIZE / disk->block_size);
+}
+
 /** Read multiple blocks from the device. */
 static errno_t ata_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     void *buf, size_t size)
 {
 	disk_t *disk = bd_srv_disk(bd);
+	size_t nb;
 	errno_t rc;
 
 	if (size < cnt * disk->block_size)
 		return EINVAL;
 
 	while (cnt > 0) {
+		nb = ata_disk_xfer_blocks(disk, cnt);
+
 		if (disk->dev_type == ata_reg_dev) {
-			rc = ata_rcmd_read(disk, ba, 1, buf);
+			rc = ata_rcmd_read(disk, ba, nb, buf);
 		} else {
 			rc = ata_pcmd_read_12(disk, ba, 1, buf,
 			    disk->block_size);
@@ -528,9 +743,9 @@ static errno_t ata_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		if (rc != EOK)
 			return rc;
 
-		++ba;
-		--cnt;
-		buf += disk->block_size;
+		ba += nb;
+		cnt -= nb;
+		buf += nb * disk->block_size;
 	}
 
 	return EOK;
@@ -549,6 +764,7 @@ static errno_t ata_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
 	disk_t *disk = bd_srv_disk(bd);
+	size_t nb;
 	errno_t rc;
 
 	if (disk->dev_type != ata_reg_dev)
@@ -558,13 +774,15 @@ static errno_t ata_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		return EINVAL;
 
 	while (cnt > 0) {
-		rc = ata_rcmd_write(disk, ba, 1, buf);
+		nb = ata_disk_xfer_blocks(disk, cnt);
+
+		rc = ata_rcmd_write(disk, ba, nb, buf);
 		if (rc != EOK)
 			return rc;
 
-		++ba;
-		--cnt;
-		buf += disk->block_size;
+		ba += nb;
+		cnt -= nb;
+		buf += nb * disk->block_size;
 	}
 
 	return EOK;
@@ -660,6 +878,98 @@ static errno_t ata_pio_data_out(disk_t *disk, const void *buf, size_t buf_size,
 	return EOK;
 }
 
+/** Program the bus master for a DMA transfer.
+ *
+ * Fills in the PRD table describing the first @a size bytes of the DMA
+ * bounce buffer and sets up the bus master registers. The transfer is
+ * started by @c ata_dma_proto().
+ *
+ * @param ctrl		Controller
+ * @param size		Number of bytes to transfer
+ * @param read		@c true to transfer from the device to memory
+ */
+static void ata_dma_setup(ata_ctrl_t *ctrl, size_t size, bool read)
+{
+	uintptr_t pa = ctrl->dma_buf_phys;
+	size_t chunk;
+	uint8_t status;
+	unsigned i;
+
+	assert(size > 0);
+	assert(size <= DMA_BUF_SIZE);
+
+	/* Split the buffer at 64 KiB boundaries. */
+	i = 0;
+	while (size > 0) {
+		assert(i < DMA_MAX_PRD);
+
+		chunk = min(size, PRD_BOUNDARY - (pa % PRD_BOUNDARY));
+		ctrl->prdt[i].base = host2uint32_t_le(pa);
+		ctrl->prdt[i].count = host2uint16_t_le(chunk % PRD_BOUNDARY);
+		ctrl->prdt[i].flags = 0;
+
+		pa += chunk;
+		size -= chunk;
+		++i;
+	}
+
+	ctrl->prdt[i - 1].flags = host2uint16_t_le(PRD_EOT);
+
+	pio_write_32(&ctrl->bmi->prdt_addr, ctrl->prdt_phys);
+	pio_write_8(&ctrl->bmi->command, read ? BMC_READ : 0);
+
+	/* Clear INTR and ERR, preserve the drive DMA capable bits. */
+	status = pio_read_8(&ctrl->bmi->status);
+	pio_write_8(&ctrl->bmi->status, (status & (BMS_DRV0_DMA |
+	    BMS_DRV1_DMA)) | BMS_INTR | BMS_ERR);
+
+	ctrl->irq_fired = false;
+}
+
+/** Bus master DMA command protocol.
+ *
+ * The bus master must have been programmed using @c ata_dma_setup() and
+ * the command must have already been written to the device. Starts the
+ * bus master and waits for the completion interrupt.
+ *
+ * The caller must hold the controller lock.
+ */
+static errno_t ata_dma_proto(disk_t *disk)
+{
+	ata_ctrl_t *ctrl = disk->ctrl;
+	uint8_t bm_cmd;
+	uint8_t status;
+	errno_t rc;
+
+	bm_cmd = pio_read_8(&ctrl->bmi->command);
+	pio_write_8(&ctrl->bmi->command, bm_cmd | BMC_START);
+
+	rc = EOK;
+	while (!ctrl->irq_fired && rc == EOK) {
+		rc = fibril_condvar_wait_timeout(&ctrl->irq_cv, &ctrl->lock,
+		    TIMEOUT_DMA * 10000);
+	}
+
+	/* Stop the bus master. */
+	pio_write_8(&ctrl->bmi->command, bm_cmd & ~BMC_START);
+
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "DMA transfer timed out.");
+		return EIO;
+	}
+
+	if (wait_status(ctrl, 0, ~SR_BSY, &status, TIMEOUT_BSY) != EOK)
+		return EIO;
+
+	if ((ctrl->irq_bm_status & BMS_ERR) != 0)
+		return EIO;
+
+	if ((status & (SR_ERR | SR_DWF)) != 0)
+		return EIO;
+
+	return EOK;
+}
+
 /** PIO non-data command protocol. */
 static errno_t ata_pio_nondata(disk_t *disk)
 {
@@ -1015,6 +1325,9 @@ static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t blk_cnt,
 	if (coord_calc(disk, ba, &bc) != EOK)
 		return EINVAL;
 
+	if (blk_cnt > disk->blocks - ba)
+		return EINVAL;
+
 	/* New value for Drive/Head register */
 	drv_head =
 	    ((disk_dev_idx(disk) != 0) ? DHR_DRV : 0) |
@@ -1037,14 +1350,26 @@ static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t blk_cnt,
 		return EIO;
 	}
 
+	if (disk->dma)
+		ata_dma_setup(ctrl, blk_cnt * disk->block_size, true);
+
 	/* Program block coordinates into the device. */
-	coord_sc_program(ctrl, &bc, 1);
+	coord_sc_program(ctrl, &bc, blk_cnt);
 
-	pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
-	    CMD_READ_SECTORS_EXT : CMD_READ_SECTORS);
+	if (disk->dma) {
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_READ_DMA_EXT : CMD_READ_DMA);
+
+		rc = ata_dma_proto(disk);
+		if (rc == EOK)
+			memcpy(buf, ctrl->dma_buf, blk_cnt * disk->block_size);
+	} else {
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_READ_SECTORS_EXT : CMD_READ_SECTORS);
 
-	rc = ata_pio_data_in(disk, buf, blk_cnt * disk->block_size,
-	    disk->block_size, blk_cnt);
+		rc = ata_pio_data_in(disk, buf, blk_cnt * disk->block_size,
+		    disk->block_size, blk_cnt);
+	}
 
 	fibril_mutex_unlock(&ctrl->lock);
 
@@ -1075,6 +1400,9 @@ static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
 	if (coord_calc(disk, ba, &bc) != EOK)
 		return EINVAL;
 
+	if (cnt > disk->blocks - ba)
+		return EINVAL;
+
 	/* New value for Drive/Head register */
 	drv_head =
 	    ((disk_dev_idx(disk) != 0) ? DHR_DRV : 0) |
@@ -1097,14 +1425,26 @@ static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
 		return EIO;
 	}
 
+	if (disk->dma) {
+		memcpy(ctrl->dma_buf, buf, cnt * disk->block_size);
+		ata_dma_setup(ctrl, cnt * disk->block_size, false);
+	}
+
 	/* Program block coordinates into the device. */
-	coord_sc_program(ctrl, &bc, 1);
+	coord_sc_program(ctrl, &bc, cnt);
+
+	if (disk->dma) {
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_WRITE_DMA_EXT : CMD_WRITE_DMA);
 
-	pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
-	    CMD_WRITE_SECTORS_EXT : CMD_WRITE_SECTORS);
+		rc = ata_dma_proto(disk);
+	} else {
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_WRITE_SECTORS_EXT : CMD_WRITE_SECTORS);
 
-	rc = ata_pio_data_out(disk, buf, cnt * disk->block_size,
-	    disk->block_size, cnt);
+		rc = ata_pio_data_out(disk, buf, cnt * disk->block_size,
+		    disk->block_size, cnt);
+	}
 
 	fibril_mutex_unlock(&ctrl->lock);
 	return rc;
@@ -38,6 +38,7 @@
 #include <async.h>
 #include <bd_srv.h>
 #include <ddf/driver.h>
+#include <ddi.h>
 #include <fibril_synch.h>
 #include <str.h>
 #include <stdint.h>
@@ -50,13 +51,25 @@
 typedef struct {
 	uintptr_t cmd;	/**< Command block base address. */
 	uintptr_t ctl;	/**< Control block base address. */
+	uintptr_t bmi;	/**< Bus master block base address or 0 if none. */
+	int irq;	/**< Interrupt number or -1 if none. */
 } ata_base_t;
 
 /** Timeout definitions. Unit is 10 ms. */
 enum ata_timeout {
 	TIMEOUT_PROBE	=  100, /*  1 s */
 	TIMEOUT_BSY	=  100, /*  1 s */
-	TIMEOUT_DRDY	= 1000  /* 10 s */
+	TIMEOUT_DRDY	= 1000, /* 10 s */
+	TIMEOUT_DMA	= 1000  /* 10 s */
+};
+
+enum {
+	/** Size of the DMA bounce buffer in bytes. */
+	DMA_BUF_SIZE	= 128 * 1024,
+	/** Maximum number of PRD table entries. */
+	DMA_MAX_PRD	= DMA_BUF_SIZE / PRD_BOUNDARY + 1,
+	/** Number of IRQ pseudocode commands. */
+	ATA_IRQ_CMDS	= 6
 };
 
 enum ata_dev_type {
@@ -109,6 +122,9 @@ typedef struct {
 	/** Addressing mode to use (if register device) */
 	enum rd_addr_mode amode;
 
+	/** Use bus master DMA transfers (if register device) */
+	bool dma;
+
 	/*
 	 * Geometry. Only valid if operating in CHS mode.
 	 */
@@ -140,6 +156,35 @@ typedef struct ata_ctrl {
 	/** Control registers */
 	ata_ctl_t *ctl;
 
+	/** I/O base address of the bus master registers or 0 if none */
+	uintptr_t bmi_physical;
+	/** Bus master registers or @c NULL if DMA is not available */
+	ata_bm_t *bmi;
+	/** Interrupt number or -1 if none */
+	int irq;
+	/** Interrupt capability handle */
+	cap_handle_t irq_cap;
+	/** IRQ pseudocode ranges */
+	irq_pio_range_t irq_ranges[2];
+	/** IRQ pseudocode commands */
+	irq_cmd_t irq_cmds[ATA_IRQ_CMDS];
+
+	/** Physical region descriptor table */
+	ata_prd_t *prdt;
+	/** Physical address of the PRD table */
+	uintptr_t prdt_phys;
+	/** DMA bounce buffer */
+	void *dma_buf;
+	/** Physical address of the DMA bounce buffer */
+	uintptr_t dma_buf_phys;
+
+	/** Signalled when a DMA completion interrupt arrives */
+	fibril_condvar_t irq_cv;
+	/** Interrupt has arrived since the last DMA command was issued */
+	bool irq_fired;
+	/** Bus master status recorded by the interrupt handler */
+	uint8_t irq_bm_status;
+
 	/** Per-disk state. */
 	disk_t disk[MAX_DISKS];
 
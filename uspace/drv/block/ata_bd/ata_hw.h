@@ -96,6 +96,47 @@ typedef union {
 	};
 } ata_ctl_t;
 
+/** PCI IDE Bus Master Registers (one channel). */
+typedef struct {
+	uint8_t command;
+	uint8_t pad0;
+	uint8_t status;
+	uint8_t pad1;
+	uint32_t prdt_addr;	/**< Physical address of the PRD table */
+} ata_bm_t;
+
+enum bm_command_bits {
+	BMC_READ	= 0x08, /**< Transfer direction is device to memory */
+	BMC_START	= 0x01  /**< Start/stop bus master */
+};
+
+enum bm_status_bits {
+	BMS_DRV1_DMA	= 0x40, /**< Device 1 DMA capable */
+	BMS_DRV0_DMA	= 0x20, /**< Device 0 DMA capable */
+	BMS_INTR	= 0x04, /**< Interrupt (write 1 to clear) */
+	BMS_ERR		= 0x02, /**< Error (write 1 to clear) */
+	BMS_ACTIVE	= 0x01  /**< Bus master active */
+};
+
+/** Physical Region Descriptor */
+typedef struct {
+	/** Physical base address of the memory region (word-aligned) */
+	uint32_t base;
+	/** Byte count of the region, zero means 64 KiB */
+	uint16_t count;
+	/** Flags (only PRD_EOT is defined) */
+	uint16_t flags;
+} __attribute__((packed)) ata_prd_t;
+
+enum prd_flags_bits {
+	PRD_EOT		= 0x8000 /**< End of table */
+};
+
+enum {
+	/** A PRD region must not cross a 64 KiB boundary. */
+	PRD_BOUNDARY	= 0x10000
+};
+
 enum devctl_bits {
 	DCR_SRST	= 0x04, /**< Software Reset */
 	DCR_nIEN	= 0x02  /**< Interrupt Enable (negated) */
@@ -131,10 +172,14 @@ enum error_bits {
 enum ata_command {
 	CMD_READ_SECTORS	= 0x20,
 	CMD_READ_SECTORS_EXT	= 0x24,
+	CMD_READ_DMA_EXT	= 0x25,
 	CMD_WRITE_SECTORS	= 0x30,
 	CMD_WRITE_SECTORS_EXT	= 0x34,
+	CMD_WRITE_DMA_EXT	= 0x35,
 	CMD_PACKET		= 0xA0,
 	CMD_IDENTIFY_PKT_DEV	= 0xA1,
+	CMD_READ_DMA		= 0xC8,
+	CMD_WRITE_DMA		= 0xCA,
 	CMD_IDENTIFY_DRIVE	= 0xEC,
 	CMD_FLUSH_CACHE		= 0xE7
 };
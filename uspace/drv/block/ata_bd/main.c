@@ -76,7 +76,13 @@ static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
 	if (rc != EOK)
 		return rc;
 
-	if (hw_res.io_ranges.count != 2) {
+	/*
+	 * The command and control blocks are mandatory. Channels of PCI IDE
+	 * controllers (see pciide) also have a third I/O range holding the
+	 * bus master IDE registers which, together with an interrupt, allow
+	 * using DMA transfers.
+	 */
+	if (hw_res.io_ranges.count != 2 && hw_res.io_ranges.count != 3) {
 		rc = EINVAL;
 		goto error;
 	}
@@ -85,6 +91,8 @@ static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
 	addr_range_t *ctl_rng = &hw_res.io_ranges.ranges[1];
 	ata_res->cmd = RNGABS(*cmd_rng);
 	ata_res->ctl = RNGABS(*ctl_rng);
+	ata_res->bmi = 0;
+	ata_res->irq = -1;
 
 	if (RNGSZ(*ctl_rng) < sizeof(ata_ctl_t)) {
 		rc = EINVAL;
@@ -96,7 +104,21 @@ static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
 		goto error;
 	}
 
-	return EOK;
+	if (hw_res.io_ranges.count == 3) {
+		addr_range_t *bmi_rng = &hw_res.io_ranges.ranges[2];
+
+		if (RNGSZ(*bmi_rng) < sizeof(ata_bm_t)) {
+			rc = EINVAL;
+			goto error;
+		}
+
+		ata_res->bmi = RNGABS(*bmi_rng);
+	}
+
+	if (hw_res.irqs.count > 0)
+		ata_res->irq = hw_res.irqs.irqs[0];
+
+	rc = EOK;
 error:
 	hw_res_list_parsed_clean(&hw_res);
 	return rc;
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @defgroup pciide PCI IDE controller driver.
+ * @brief HelenOS PCI IDE controller driver.
+ * @{
+ */
+
+/** @file
+ *
+ * Exposes the channels of a PCI IDE function operating in compatibility
+ * mode as separate functions. Each channel gets the legacy command and
+ * control blocks, its half of the bus master IDE registers (BAR 4) and
+ * its legacy ISA interrupt, so that the ATA driver can use bus master DMA.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <irc.h>
+
+#include <ddf/driver.h>
+#include <ddf/log.h>
+#include <ops/hw_res.h>
+#include <ops/pio_window.h>
+
+#include <device/hw_res_parsed.h>
+#include <device/pio_window.h>
+
+#include <pci_dev_iface.h>
+
+#define NAME "pciide"
+
+#define PCI_COMMAND	0x04
+#define PCI_PROG_IF	0x09
+
+/** Bus master enable bit of the PCI command register */
+#define PCI_COMMAND_MASTER	0x04
+
+/** Size of the bus master IDE register block (BAR 4) */
+#define BMIDE_SIZE	16
+
+/** Size of the bus master IDE registers of one channel */
+#define BMIDE_CHAN_SIZE	8
+
+#define PCIIDE_CHANNELS	2
+#define PCIIDE_MAX_HW_RES	4
+
+/** Legacy resources of a channel in compatibility mode */
+typedef struct {
+	/** Function name */
+	const char *name;
+	/** Command block base address */
+	uint16_t cmd;
+	/** Control block base address */
+	uint16_t ctl;
+	/** ISA interrupt */
+	int irq;
+	/** Programming interface bit selecting native mode */
+	uint8_t native;
+} pciide_legacy_t;
+
+static const pciide_legacy_t pciide_legacy[PCIIDE_CHANNELS] = {
+	{
+		.name = "ata-c1",
+		.cmd = 0x1f0,
+		.ctl = 0x3f0,
+		.irq = 14,
+		.native = 0x01
+	},
+	{
+		.name = "ata-c2",
+		.cmd = 0x170,
+		.ctl = 0x370,
+		.irq = 15,
+		.native = 0x04
+	}
+};
+
+/** PCI IDE controller */
+typedef struct {
+	ddf_dev_t *dev;
+	pio_window_t pio_win;
+} pciide_ctrl_t;
+
+/** PCI IDE channel */
+typedef struct {
+	ddf_fun_t *fnode;
+	hw_resource_t resources[PCIIDE_MAX_HW_RES];
+	hw_resource_list_t hw_resources;
+} pciide_chan_t;
+
+static errno_t pciide_dev_add(ddf_dev_t *dev);
+
+static driver_ops_t driver_ops = {
+	.dev_add = &pciide_dev_add
+};
+
+static driver_t pciide_driver = {
+	.name = NAME,
+	.driver_ops = &driver_ops
+};
+
+/** Obtain soft-state from function node */
+static pciide_chan_t *pciide_chan(ddf_fun_t *fun)
+{
+	return ddf_fun_data_get(fun);
+}
+
+static hw_resource_list_t *pciide_get_resources(ddf_fun_t *fnode)
+{
+	return &pciide_chan(fnode)->hw_resources;
+}
+
+static bool pciide_owns_interrupt(pciide_chan_t *chan, int irq)
+{
+	const hw_resource_list_t *res = &chan->hw_resources;
+
+	for (size_t i = 0; i < res->count; ++i) {
+		if (res->resources[i].type == INTERRUPT &&
+		    res->resources[i].res.interrupt.irq == irq) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * In compatibility mode the channels use the legacy ISA interrupts rather
+ * than the PCI interrupt pin, so they are controlled directly like those
+ * of ISA devices.
+ */
+
+static errno_t pciide_enable_interrupt(ddf_fun_t *fnode, int irq)
+{
+	if (!pciide_owns_interrupt(pciide_chan(fnode), irq))
+		return EINVAL;
+
+	return irc_enable_interrupt(irq);
+}
+
+static errno_t pciide_disable_interrupt(ddf_fun_t *fnode, int irq)
+{
+	if (!pciide_owns_interrupt(pciide_chan(fnode), irq))
+		return EINVAL;
+
+	return irc_disable_interrupt(irq);
+}
+
+static errno_t pciide_clear_interrupt(ddf_fun_t *fnode, int irq)
+{
+	if (!pciide_owns_interrupt(pciide_chan(fnode), irq))
+		return EINVAL;
+
+	return irc_clear_interrupt(irq);
+}
+
+static hw_res_ops_t pciide_hw_res_ops = {
+	.get_resource_list = pciide_get_resources,
+	.enable_interrupt = pciide_enable_interrupt,
+	.disable_interrupt = pciide_disable_interrupt,
+	.clear_interrupt = pciide_clear_interrupt
+};
+
+static pio_window_t *pciide_get_pio_window(ddf_fun_t *fnode)
+{
+	pciide_ctrl_t *ctrl = ddf_dev_data_get(ddf_fun_get_dev(fnode));
+
+	return &ctrl->pio_win;
+}
+
+static pio_window_ops_t pciide_pio_window_ops = {
+	.get_pio_window = pciide_get_pio_window
+};
+
+static ddf_dev_ops_t pciide_fun_ops = {
+	.interfaces[HW_RES_DEV_IFACE] = &pciide_hw_res_ops,
+	.interfaces[PIO_WINDOW_DEV_IFACE] = &pciide_pio_window_ops
+};
+
+/** Add an absolute I/O range to a channel. */
+static void pciide_add_io_range(pciide_chan_t *chan, uintptr_t addr,
+    size_t size)
+{
+	hw_resource_t *res = &chan->resources[chan->hw_resources.count];
+
+	assert(chan->hw_resources.count < PCIIDE_MAX_HW_RES);
+
+	res->type = IO_RANGE;
+	res->res.io_range.address = addr;
+	res->res.io_range.size = size;
+	res->res.io_range.relative = false;
+	res->res.io_range.endianness = LITTLE_ENDIAN;
+	chan->hw_resources.count++;
+}
+
+/** Create and bind the function for one channel.
+ *
+ * @param ctrl		Controller
+ * @param legacy	Legacy resources of the channel
+ * @param bmi		Absolute address of the channel's bus master
+ *			registers or 0 if none
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t pciide_chan_add(pciide_ctrl_t *ctrl,
+    const pciide_legacy_t *legacy, uintptr_t bmi)
+{
+	ddf_fun_t *fnode;
+	pciide_chan_t *chan;
+	errno_t rc;
+
+	fnode = ddf_fun_create(ctrl->dev, fun_inner, legacy->name);
+	if (fnode == NULL)
+		return ENOMEM;
+
+	chan = ddf_fun_data_alloc(fnode, sizeof(pciide_chan_t));
+	if (chan == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	chan->fnode = fnode;
+	chan->hw_resources.count = 0;
+	chan->hw_resources.resources = chan->resources;
+
+	pciide_add_io_range(chan, ctrl->pio_win.io.base + legacy->cmd, 8);
+	pciide_add_io_range(chan, ctrl->pio_win.io.base + legacy->ctl, 8);
+
+	/* Without the bus master registers the channel can only do PIO. */
+	if (bmi != 0) {
+		pciide_add_io_range(chan, bmi, BMIDE_CHAN_SIZE);
+
+		hw_resource_t *res = &chan->resources[chan->hw_resources.count];
+		res->type = INTERRUPT;
+		res->res.interrupt.irq = legacy->irq;
+		chan->hw_resources.count++;
+	}
+
+	rc = ddf_fun_add_match_id(fnode, "pciide/ata_bd", 100);
+	if (rc != EOK)
+		goto error;
+
+	ddf_fun_set_ops(fnode, &pciide_fun_ops);
+
+	rc = ddf_fun_bind(fnode);
+	if (rc != EOK)
+		goto error;
+
+	return EOK;
+error:
+	ddf_fun_destroy(fnode);
+	return rc;
+}
+
+/** Find the bus master IDE registers among the function's resources.
+ *
+ * @param sess		Session to the parent PCI function
+ * @param bmi		Place to store the absolute address of the registers
+ *			or 0 if they are not present
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t pciide_get_bmi(async_sess_t *sess, uintptr_t *bmi)
+{
+	hw_res_list_parsed_t hw_res;
+	uint16_t command;
+	errno_t rc;
+
+	*bmi = 0;
+
+	hw_res_list_parsed_init(&hw_res);
+	rc = hw_res_get_list_parsed(sess, &hw_res, 0);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * In compatibility mode BAR 4 is the only 16-byte I/O range. The
+	 * command and control blocks of native mode channels are 8 and 4
+	 * bytes long, respectively.
+	 */
+	for (size_t i = 0; i < hw_res.io_ranges.count; i++) {
+		if (RNGSZ(hw_res.io_ranges.ranges[i]) == BMIDE_SIZE) {
+			*bmi = RNGABS(hw_res.io_ranges.ranges[i]);
+			break;
+		}
+	}
+
+	hw_res_list_parsed_clean(&hw_res);
+
+	if (*bmi == 0)
+		return EOK;
+
+	/* Allow the function to initiate bus master transfers. */
+	rc = pci_config_space_read_16(sess, PCI_COMMAND, &command);
+	if (rc == EOK && (command & PCI_COMMAND_MASTER) == 0) {
+		rc = pci_config_space_write_16(sess, PCI_COMMAND,
+		    command | PCI_COMMAND_MASTER);
+	}
+
+	if (rc != EOK) {
+		ddf_msg(LVL_WARN, "Cannot enable bus mastering.");
+		*bmi = 0;
+	}
+
+	return EOK;
+}
+
+static errno_t pciide_dev_add(ddf_dev_t *dev)
+{
+	pciide_ctrl_t *ctrl;
+	async_sess_t *sess;
+	uintptr_t bmi;
+	uint8_t progif;
+	unsigned nchan;
+	errno_t rc;
+
+	ddf_msg(LVL_DEBUG, "pciide_dev_add()");
+
+	ctrl = ddf_dev_data_alloc(dev, sizeof(pciide_ctrl_t));
+	if (ctrl == NULL)
+		return ENOMEM;
+
+	ctrl->dev = dev;
+
+	sess = ddf_dev_parent_sess_get(dev);
+	if (sess == NULL)
+		return ENOENT;
+
+	rc = pio_window_get(sess, &ctrl->pio_win);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot get PIO window.");
+		return rc;
+	}
+
+	rc = pci_config_space_read_8(sess, PCI_PROG_IF, &progif);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot read programming interface.");
+		return rc;
+	}
+
+	rc = pciide_get_bmi(sess, &bmi);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot get hardware resources.");
+		return rc;
+	}
+
+	if (bmi == 0)
+		ddf_msg(LVL_NOTE, "No bus master registers, channels use PIO.");
+
+	nchan = 0;
+	for (unsigned i = 0; i < PCIIDE_CHANNELS; i++) {
+		const pciide_legacy_t *legacy = &pciide_legacy[i];
+
+		/* XXX Native mode channels are not supported */
+		if ((progif & legacy->native) != 0) {
+			ddf_msg(LVL_NOTE, "Channel %s is in native mode, "
+			    "skipping.", legacy->name);
+			continue;
+		}
+
+		rc = pciide_chan_add(ctrl, legacy,
+		    bmi != 0 ? bmi + i * BMIDE_CHAN_SIZE : 0);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "Failed adding channel %s.",
+			    legacy->name);
+			continue;
+		}
+
+		nchan++;
+	}
+
+	return nchan > 0 ? EOK : ENOENT;
+}
+
+int main(int argc, char *argv[])
+{
+	printf(NAME ": HelenOS PCI IDE controller driver\n");
+	ddf_log_init(NAME);
+	return ddf_driver_main(&pciide_driver);
+}
+
+/**
+ * @}
+ */
@@ -1168,6 +1168,10 @@ static void e1000_receive_frames(nic_t *nic)
 {
 	e1000_t *e1000 = DRIVER_DATA_NIC(nic);
 	
+	nic_frame_list_t *frames = nic_alloc_frame_list();
+	if (frames == NULL)
+		ddf_msg(LVL_ERROR, "Can not allocate frame list for received frames.");
+	
 	fibril_mutex_lock(&e1000->rx_lock);
 	
 	uint32_t *tail_addr = E1000_REG_ADDR(e1000, E1000_RDT);
@@ -1182,7 +1186,10 @@ static void e1000_receive_frames(nic_t *nic)
 		nic_frame_t *frame = nic_alloc_frame(nic, frame_size);
 		if (frame != NULL) {
 			memcpy(frame->data, e1000->rx_frame_virt[next_tail], frame_size);
-			nic_received_frame(nic, frame);
+			if (frames != NULL)
+				nic_frame_list_append(frames, frame);
+			else
+				nic_received_frame(nic, frame);
 		} else {
 			ddf_msg(LVL_ERROR, "Memory allocation failed. Frame dropped.");
 		}
@@ -1197,6 +1204,10 @@ static void e1000_receive_frames(nic_t *nic)
 	}
 	
 	fibril_mutex_unlock(&e1000->rx_lock);
+	
+	/* Pass the frames up in batches outside of the rx_lock */
+	if (frames != NULL)
+		nic_received_frame_list(nic, frames);
 }
 
 /** Enable E1000 interupts
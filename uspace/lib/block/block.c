@@ -54,6 +54,7 @@
 #include <str_error.h>
 #include <offset.h>
 #include <inttypes.h>
+#include <tracepoint.h>
 #include "block.h"
 
 #define MAX_WRITE_RETRIES 10
@@ -909,6 +910,181 @@ errno_t block_read_toc(service_id_t service_id, uint8_t session, void *buf,
 	return bd_read_toc(devcon->bd, session, buf, bufsize);
 }
 
+/** Initialize an empty block scatter list.
+ *
+ * @param biov		Scatter list.
+ */
+void block_iov_init(block_iov_t *biov)
+{
+	biov->cnt = 0;
+	biov->size = 0;
+}
+
+/** Determine whether a block scatter list has room for another entry.
+ *
+ * @param biov		Scatter list.
+ *
+ * @return		True if no more entries can be added.
+ */
+bool block_iov_full(block_iov_t *biov)
+{
+	return biov->cnt >= BLOCK_IOV_MAX;
+}
+
+/** Append a part of a cached block to a block scatter list.
+ *
+ * The scatter list takes over the caller's reference to the block. It is
+ * released by block_iov_finalize() or block_iov_fini(). The caller must
+ * not modify the block contents in the meantime.
+ *
+ * @param biov		Scatter list.
+ * @param block		Block obtained using block_get().
+ * @param off		Offset of the data within the block.
+ * @param size		Number of bytes.
+ *
+ * @return		EOK on success, ELIMIT if the scatter list is full.
+ */
+errno_t block_iov_add_block(block_iov_t *biov, block_t *block, size_t off,
+    size_t size)
+{
+	assert(off + size <= block->size);
+
+	if (block_iov_full(biov))
+		return ELIMIT;
+
+	biov->iov[biov->cnt].base = block->data + off;
+	biov->iov[biov->cnt].size = size;
+	biov->block[biov->cnt] = block;
+	biov->buf[biov->cnt] = NULL;
+	biov->cnt++;
+	biov->size += size;
+
+	return EOK;
+}
+
+/** Read blocks directly from device (bypass cache) into a scatter list.
+ *
+ * @param biov		Scatter list.
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ *
+ * @return		EOK on success, ELIMIT if the scatter list is full,
+ *			ENOMEM if out of memory or an error code from
+ *			block_read_direct().
+ */
+errno_t block_iov_add_direct(block_iov_t *biov, service_id_t service_id,
+    aoff64_t ba, size_t cnt)
+{
+	devcon_t *devcon;
+	void *buf;
+	size_t size;
+	errno_t rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	if (block_iov_full(biov))
+		return ELIMIT;
+
+	size = devcon->pblock_size * cnt;
+	buf = malloc(size);
+	if (buf == NULL)
+		return ENOMEM;
+
+	rc = read_blocks(devcon, ba, cnt, buf, size);
+	if (rc != EOK) {
+		free(buf);
+		return rc;
+	}
+
+	biov->iov[biov->cnt].base = buf;
+	biov->iov[biov->cnt].size = size;
+	biov->block[biov->cnt] = NULL;
+	biov->buf[biov->cnt] = buf;
+	biov->cnt++;
+	biov->size += size;
+
+	return EOK;
+}
+
+/** Append a caller-owned buffer to a block scatter list.
+ *
+ * The buffer must stay valid until the scatter list is finalized.
+ *
+ * @param biov		Scatter list.
+ * @param data		Buffer.
+ * @param size		Number of bytes.
+ *
+ * @return		EOK on success, ELIMIT if the scatter list is full.
+ */
+errno_t block_iov_add_buf(block_iov_t *biov, const void *data, size_t size)
+{
+	if (block_iov_full(biov))
+		return ELIMIT;
+
+	biov->iov[biov->cnt].base = (void *) data;
+	biov->iov[biov->cnt].size = size;
+	biov->block[biov->cnt] = NULL;
+	biov->buf[biov->cnt] = NULL;
+	biov->cnt++;
+	biov->size += size;
+
+	return EOK;
+}
+
+/** Answer a data read request from a block scatter list.
+ *
+ * The data described by the scatter list is delivered to the client in
+ * a single answer. Afterwards, the scatter list is released using
+ * block_iov_fini().
+ *
+ * @param biov		Scatter list.
+ * @param chandle	Handle of the IPC_M_DATA_READ call to answer.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_iov_finalize(block_iov_t *biov, cap_handle_t chandle)
+{
+	errno_t rc;
+	errno_t rc2;
+
+	rc = async_data_read_finalize_iov(chandle, biov->iov, biov->cnt);
+	rc2 = block_iov_fini(biov);
+
+	return rc != EOK ? rc : rc2;
+}
+
+/** Release all resources held by a block scatter list.
+ *
+ * Puts all blocks and frees all buffers allocated by the scatter list.
+ * The scatter list is left empty.
+ *
+ * @param biov		Scatter list.
+ *
+ * @return		EOK on success or the first error returned by
+ *			block_put().
+ */
+errno_t block_iov_fini(block_iov_t *biov)
+{
+	errno_t rc = EOK;
+	errno_t rc2;
+	size_t i;
+
+	for (i = 0; i < biov->cnt; i++) {
+		if (biov->block[i] != NULL) {
+			rc2 = block_put(biov->block[i]);
+			if (rc == EOK)
+				rc = rc2;
+		}
+
+		free(biov->buf[i]);
+	}
+
+	block_iov_init(biov);
+	return rc;
+}
+
 /** Read blocks from block device.
  *
  * @param devcon	Device connection.
@@ -923,6 +1099,8 @@ static errno_t read_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *buf,
 {
 	assert(devcon);
 	
+	TRACEPOINT(TP_BLOCK_READ, ba, cnt);
+	
 	errno_t rc = bd_read_blocks(devcon->bd, ba, cnt, buf, size);
 	if (rc != EOK) {
 		printf("Error %s reading %zu blocks starting at block %" PRIuOFF64
@@ -950,6 +1128,8 @@ static errno_t write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *dat
 {
 	assert(devcon);
 	
+	TRACEPOINT(TP_BLOCK_WRITE, ba, cnt);
+	
 	errno_t rc = bd_write_blocks(devcon->bd, ba, cnt, data, size);
 	if (rc != EOK) {
 		printf("Error %s writing %zu blocks starting at block %" PRIuOFF64
@@ -90,6 +90,28 @@ typedef struct block {
 	void *data;
 } block_t;
 
+/** Maximum number of buffers in a block scatter list. */
+#define BLOCK_IOV_MAX	DATA_XFER_IOV_MAX
+
+/** Scatter list for answering a data read from several buffers.
+ *
+ * Collects cached blocks, direct-read ranges and other buffers so that
+ * a single IPC_M_DATA_READ request can be answered from all of them
+ * at once using block_iov_finalize().
+ */
+typedef struct {
+	/** Number of used entries. */
+	size_t cnt;
+	/** Total number of bytes described by the list. */
+	size_t size;
+	/** Buffers passed to async_data_read_finalize_iov(). */
+	ipc_iov_t iov[BLOCK_IOV_MAX];
+	/** Block reference held by each entry or @c NULL. */
+	block_t *block[BLOCK_IOV_MAX];
+	/** Buffer allocated for each entry or @c NULL. */
+	void *buf[BLOCK_IOV_MAX];
+} block_iov_t;
+
 /** Caching mode */
 enum cache_mode {
 	/** Write-Through */
@@ -121,6 +143,15 @@ extern errno_t block_read_bytes_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_write_direct(service_id_t, aoff64_t, size_t, const void *);
 extern errno_t block_sync_cache(service_id_t, aoff64_t, size_t);
 
+extern void block_iov_init(block_iov_t *);
+extern bool block_iov_full(block_iov_t *);
+extern errno_t block_iov_add_block(block_iov_t *, block_t *, size_t, size_t);
+extern errno_t block_iov_add_direct(block_iov_t *, service_id_t, aoff64_t,
+    size_t);
+extern errno_t block_iov_add_buf(block_iov_t *, const void *, size_t);
+extern errno_t block_iov_finalize(block_iov_t *, cap_handle_t);
+extern errno_t block_iov_fini(block_iov_t *);
+
 #endif
 
 /** @}
@@ -98,6 +98,10 @@ void rel_table_process(module_t *m, elf_rel_t *rt, size_t rt_size)
 		rel_type = ELF32_R_TYPE(r_info);
 		r_ptr = (uint32_t *)(r_offset + m->bias);
 
+		/* Jump slots of lazily bound modules are set up separately */
+		if (rel_type == R_386_JUMP_SLOT && m->lazy)
+			continue;
+
 		if (sym->st_name != 0) {
 //			DPRINTF("rel_type: %x, rel_offset: 0x%x\n", rel_type, r_offset);
 			sym_def = symbol_def_find(str_tab + sym->st_name,
@@ -209,5 +213,82 @@ void rela_table_process(module_t *m, elf_rela_t *rt, size_t rt_size)
 	(void)m; (void)rt; (void)rt_size;
 }
 
+/** Prepare the PLT of a module for lazy binding.
+ *
+ * GOT[1] gets the module pointer and GOT[2] the lazy binding entry point
+ * which PLT0 pushes and jumps to, respectively. The jump slots initially
+ * point back into their PLT entries, they only need to be biased.
+ *
+ * @param m	Module
+ * @param entry	Address of the lazy binding entry point
+ * @return	@c true on success, @c false if the PLT must be bound eagerly
+ */
+bool plt_lazy_setup(module_t *m, void *entry)
+{
+	elf_rel_t *rt = m->dyn.jmp_rel;
+	size_t rt_entries;
+	uint32_t *got;
+	size_t i;
+
+	if (m->dyn.plt_rel != DT_REL)
+		return false;
+
+	rt_entries = m->dyn.plt_rel_sz / sizeof(elf_rel_t);
+	for (i = 0; i < rt_entries; ++i) {
+		if (ELF32_R_TYPE(rt[i].r_info) != R_386_JUMP_SLOT)
+			return false;
+	}
+
+	got = m->dyn.plt_got;
+	got[1] = (uint32_t) m;
+	got[2] = (uint32_t) entry;
+
+	for (i = 0; i < rt_entries; ++i)
+		*(uint32_t *)(rt[i].r_offset + m->bias) += m->bias;
+
+	m->rtld->plt_lazy_slots += rt_entries;
+
+	DPRINTF("%zu PLT entries of '%s' bound lazily\n", rt_entries,
+	    m->dyn.soname);
+	return true;
+}
+
+/** Bind a PLT entry on its first call.
+ *
+ * Called from the lazy binding entry point.
+ *
+ * @param m		Module whose PLT entry is being called
+ * @param reloc_off	Offset of the jump slot relocation in the PLT
+ *			relocation table
+ * @return		Address of the function to call
+ */
+void *__rtld_plt_resolve(module_t *m, size_t reloc_off)
+{
+	elf_rel_t *rel;
+	elf_symbol_t *sym;
+	elf_symbol_t *sym_def;
+	module_t *dest;
+	uint32_t *r_ptr;
+	void *sym_addr;
+
+	rel = (elf_rel_t *)((uint8_t *) m->dyn.jmp_rel + reloc_off);
+	sym = &((elf_symbol_t *) m->dyn.sym_tab)[ELF32_R_SYM(rel->r_info)];
+	r_ptr = (uint32_t *)(rel->r_offset + m->bias);
+
+	sym_def = symbol_def_find(m->dyn.str_tab + sym->st_name, m,
+	    ssf_none, &dest);
+	if (sym_def == NULL) {
+		printf("Definition of '%s' not found.\n",
+		    m->dyn.str_tab + sym->st_name);
+		exit(1);
+	}
+
+	sym_addr = symbol_get_addr(sym_def, dest, NULL);
+	*r_ptr = (uint32_t) sym_addr;
+	++m->rtld->plt_lazy_binds;
+
+	return sym_addr;
+}
+
 /** @}
  */
@@ -2852,6 +2852,37 @@ errno_t async_data_read_finalize(cap_handle_t chandle, const void *src, size_t s
 	return ipc_answer_2(chandle, EOK, (sysarg_t) src, (sysarg_t) size);
 }
 
+/** Wrapper for answering the IPC_M_DATA_READ calls from multiple buffers.
+ *
+ * The data is gathered by the kernel from the buffers in the order they
+ * appear in @a iov and delivered to the sender as a contiguous block.
+ * This allows answering a read request from several non-contiguous
+ * buffers (e.g. cache blocks) using a single answer.
+ *
+ * @param chandle  Handle of the IPC_M_DATA_READ call to answer.
+ * @param iov      Array of source buffers. It need only be valid for the
+ *                 duration of this call.
+ * @param iovcnt   Number of elements in @a iov, at most DATA_XFER_IOV_MAX.
+ *
+ * @return  Zero on success or a value from @ref errno.h on failure.
+ *
+ */
+errno_t async_data_read_finalize_iov(cap_handle_t chandle,
+    const ipc_iov_t *iov, size_t iovcnt)
+{
+	size_t size = 0;
+	size_t i;
+	
+	if (iovcnt > DATA_XFER_IOV_MAX)
+		return ELIMIT;
+	
+	for (i = 0; i < iovcnt; i++)
+		size += iov[i].size;
+	
+	return ipc_answer_3(chandle, EOK, (sysarg_t) iov, (sysarg_t) size,
+	    (sysarg_t) iovcnt);
+}
+
 /** Wrapper for forwarding any read request
  *
  */
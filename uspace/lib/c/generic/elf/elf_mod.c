@@ -39,8 +39,9 @@
  * This module allows loading ELF binaries (both executables and
  * shared objects) from VFS. The current implementation allocates
  * anonymous memory, fills it with segment data and then adjusts
- * the memory areas' flags to the final value. In the future,
- * the segments will be mapped directly from the file.
+ * the memory areas' flags to the final value. With ELDF_SHARE,
+ * read-only segments are instead mapped directly from the file
+ * so that their pages are shared by all tasks using the file.
  */
 
 #include <errno.h>
@@ -60,6 +61,10 @@
 
 #include <elf/elf_load.h>
 
+#ifdef CONFIG_RTLD
+#include <rtld/elf_dyn.h>
+#endif
+
 #define DPRINTF(...)
 
 static const char *error_codes[] = {
@@ -76,6 +81,7 @@ static unsigned int elf_load_module(elf_ld_t *elf, size_t so_bias);
 static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry);
 static int section_header(elf_ld_t *elf, elf_section_header_t *entry);
 static int load_segment(elf_ld_t *elf, elf_segment_header_t *entry);
+static bool elf_has_text_rel(elf_ld_t *elf);
 
 /** Load ELF binary from a file.
  *
@@ -203,6 +209,14 @@ static unsigned int elf_load_module(elf_ld_t *elf, size_t so_bias)
 	elf->info->interp = NULL;
 	elf->info->dynamic = NULL;
 
+	/*
+	 * Segments that need to be modified by the caller cannot be shared
+	 * with other tasks.
+	 */
+	if ((elf->flags & ELDF_SHARE) != 0 && (elf->flags & ELDF_RW) != 0 &&
+	    elf_has_text_rel(elf))
+		elf->flags &= ~ELDF_SHARE;
+
 	/* Walk through all segment headers and process them. */
 	for (i = 0; i < header->e_phnum; i++) {
 		elf_segment_header_t segment_hdr;
@@ -247,6 +261,62 @@ static unsigned int elf_load_module(elf_ld_t *elf, size_t so_bias)
 	return EE_OK;
 }
 
+/** Check whether the module has relocations in read-only segments.
+ *
+ * @param elf	Pointer to loader state buffer.
+ *
+ * @return True if the dynamic section contains DT_TEXTREL or it cannot
+ *         be read.
+ */
+static bool elf_has_text_rel(elf_ld_t *elf)
+{
+#ifdef CONFIG_RTLD
+	elf_segment_header_t segment_hdr;
+	aoff64_t pos;
+	size_t nr;
+	errno_t rc;
+	int i;
+
+	for (i = 0; i < elf->header->e_phnum; i++) {
+		pos = elf->header->e_phoff + i * sizeof(elf_segment_header_t);
+		rc = vfs_read(elf->fd, &pos, &segment_hdr,
+		    sizeof(elf_segment_header_t), &nr);
+		if (rc != EOK || nr != sizeof(elf_segment_header_t))
+			return true;
+
+		if (segment_hdr.p_type == PT_DYNAMIC)
+			break;
+	}
+
+	if (i == elf->header->e_phnum)
+		return false;
+
+	elf_dyn_t *dyn = malloc(segment_hdr.p_filesz);
+	if (dyn == NULL)
+		return true;
+
+	pos = segment_hdr.p_offset;
+	rc = vfs_read(elf->fd, &pos, dyn, segment_hdr.p_filesz, &nr);
+	if (rc != EOK || nr != segment_hdr.p_filesz) {
+		free(dyn);
+		return true;
+	}
+
+	bool text_rel = false;
+	for (size_t j = 0; j < nr / sizeof(elf_dyn_t); j++) {
+		if (dyn[j].d_tag == DT_NULL)
+			break;
+		if (dyn[j].d_tag == DT_TEXTREL)
+			text_rel = true;
+	}
+
+	free(dyn);
+	return text_rel;
+#else
+	return false;
+#endif
+}
+
 /** Print error message according to error code.
  *
  * @param rc Return code returned by elf_load().
@@ -379,6 +449,32 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	    (void *) (entry->p_vaddr + bias +
 	    ALIGN_UP(entry->p_memsz, PAGE_SIZE)));
 
+	/*
+	 * Read-only segments which are entirely backed by the file can be
+	 * mapped from it. The VFS pager then shares their pages among all
+	 * tasks mapping the same file. Fall back to reading the segment if
+	 * the mapping fails.
+	 */
+	if ((elf->flags & ELDF_SHARE) != 0 && (entry->p_flags & PF_W) == 0 &&
+	    entry->p_filesz == entry->p_memsz &&
+	    (entry->p_offset % PAGE_SIZE) == (seg_addr % PAGE_SIZE)) {
+		a = (uint8_t *) base + bias;
+		rc = vfs_mmap(elf->fd, ALIGN_DOWN(entry->p_offset, PAGE_SIZE),
+		    mem_sz, flags, &a);
+		if (rc == EOK) {
+			DPRINTF("vfs_mmap(%p, %#zx, %d) -> %p\n",
+			    (void *) (base + bias), mem_sz, flags, (void *) a);
+
+			if (flags & AS_AREA_EXEC) {
+				/* Enforce SMC coherence for the segment */
+				if (smc_coherence(seg_ptr, entry->p_filesz))
+					return EE_MEMORY;
+			}
+
+			return EE_OK;
+		}
+	}
+
 	/*
 	 * For the course of loading, the area needs to be readable
 	 * and writeable.
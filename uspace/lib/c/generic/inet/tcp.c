@@ -32,13 +32,18 @@
 /** @file TCP API
  */
 
+#include <as.h>
+#include <assert.h>
 #include <errno.h>
 #include <fibril.h>
 #include <inet/endpoint.h>
 #include <inet/tcp.h>
 #include <ipc/services.h>
 #include <ipc/tcp.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
+#include <vfs/vfs.h>
 
 static void tcp_cb_conn(ipc_callid_t, ipc_call_t *, void *);
 static errno_t tcp_conn_fibril(void *);
@@ -172,6 +177,7 @@ static errno_t tcp_conn_new(tcp_t *tcp, sysarg_t id, tcp_cb_t *cb, void *arg,
 	conn->data_avail = false;
 	fibril_mutex_initialize(&conn->lock);
 	fibril_condvar_initialize(&conn->cv);
+	fibril_mutex_initialize(&conn->tx_lock);
 
 	conn->tcp = tcp;
 	conn->id = id;
@@ -262,6 +268,9 @@ void tcp_conn_destroy(tcp_conn_t *conn)
 	errno_t rc = async_req_1_0(exch, TCP_CONN_DESTROY, conn->id);
 	async_exchange_end(exch);
 
+	if (conn->ring != NULL)
+		as_area_destroy(conn->ring);
+
 	free(conn);
 	(void) rc;
 }
@@ -439,6 +448,68 @@ errno_t tcp_conn_wait_connected(tcp_conn_t *conn)
 	}
 }
 
+/** Send data over TCP connection through the shared memory.
+ *
+ * The transmit part of the shared memory is used as two alternating
+ * halves, so that the next chunk of data can be copied in while the TCP
+ * service is still queueing the previous one.
+ *
+ * @param conn  Connection
+ * @param data  Data
+ * @param bytes Data size in bytes
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_send_ring(tcp_conn_t *conn, const void *data,
+    size_t bytes)
+{
+	async_exch_t *exch;
+	const size_t half = conn->ring_size / 2;
+	aid_t req[2];
+	bool pending[2] = { false, false };
+	unsigned int slot = 0;
+	errno_t rc = EOK;
+	errno_t retval;
+
+	fibril_mutex_lock(&conn->tx_lock);
+
+	while (bytes > 0) {
+		/* Wait until the service is done with this half */
+		if (pending[slot]) {
+			async_wait_for(req[slot], &retval);
+			pending[slot] = false;
+			if (retval != EOK) {
+				rc = retval;
+				break;
+			}
+		}
+
+		size_t xfer_size = min(bytes, half);
+		memcpy(conn->ring + slot * half, data, xfer_size);
+
+		exch = async_exchange_begin(conn->tcp->sess);
+		req[slot] = async_send_3(exch, TCP_CONN_RING_SEND, conn->id,
+		    slot * half, xfer_size, NULL);
+		async_exchange_end(exch);
+
+		pending[slot] = true;
+		data += xfer_size;
+		bytes -= xfer_size;
+		slot = 1 - slot;
+	}
+
+	for (slot = 0; slot < 2; slot++) {
+		if (pending[slot]) {
+			async_wait_for(req[slot], &retval);
+			if (retval != EOK && rc == EOK)
+				rc = retval;
+		}
+	}
+
+	fibril_mutex_unlock(&conn->tx_lock);
+	return rc;
+}
+
 /** Send data over TCP connection.
  *
  * @param conn  Connection
@@ -452,6 +523,9 @@ errno_t tcp_conn_send(tcp_conn_t *conn, const void *data, size_t bytes)
 	async_exch_t *exch;
 	errno_t rc;
 
+	if (conn->ring != NULL)
+		return tcp_conn_send_ring(conn, data, bytes);
+
 	exch = async_exchange_begin(conn->tcp->sess);
 	aid_t req = async_send_1(exch, TCP_CONN_SEND, conn->id, NULL);
 
@@ -472,6 +546,49 @@ errno_t tcp_conn_send(tcp_conn_t *conn, const void *data, size_t bytes)
 	return rc;
 }
 
+/** Send file contents over TCP connection.
+ *
+ * The file handle is passed to the TCP service, which reads the data from
+ * the file system and queues them for sending. The data are never copied
+ * through the caller's address space.
+ *
+ * @param conn  Connection
+ * @param file  Open file handle
+ * @param pos   Position in the file to start at
+ * @param bytes Number of bytes to send
+ * @param nsent Place to store the number of bytes actually sent (less than
+ *              @a bytes if the end of file was reached) or @c NULL
+ *
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_send_file(tcp_conn_t *conn, int file, aoff64_t pos,
+    size_t bytes, size_t *nsent)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+	errno_t rc;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_4(exch, TCP_CONN_SEND_FILE, conn->id,
+	    LOWER32(pos), UPPER32(pos), bytes, &answer);
+
+	async_exch_t *vfs_exch = vfs_exchange_begin();
+	rc = vfs_pass_handle(vfs_exch, file, exch);
+	vfs_exchange_end(vfs_exch);
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	async_wait_for(req, &rc);
+	if (nsent != NULL)
+		*nsent = (rc == EOK) ? IPC_GET_ARG1(answer) : 0;
+	return rc;
+}
+
 /** Send FIN.
  *
  * Send FIN, indicating no more data will be send over the connection.
@@ -522,6 +639,57 @@ errno_t tcp_conn_reset(tcp_conn_t *conn)
 	return rc;
 }
 
+/** Copy data received into the shared memory to user buffer.
+ *
+ * @param conn Connection
+ * @param buf  Buffer
+ * @param bsize Buffer size
+ * @param nrecv Place to store actual number of received bytes
+ */
+static void tcp_conn_ring_copy(tcp_conn_t *conn, void *buf, size_t bsize,
+    size_t *nrecv)
+{
+	size_t xfer_size = min(bsize, conn->rx_in - conn->rx_out);
+
+	memcpy(buf, conn->ring + conn->ring_size + conn->rx_out, xfer_size);
+	conn->rx_out += xfer_size;
+	*nrecv = xfer_size;
+}
+
+/** Receive data into the shared memory.
+ *
+ * The TCP service fills as much of the receive part as it has data for,
+ * later reads are then satisfied without contacting the service.
+ * Must be called with the connection locked and the receive part empty.
+ *
+ * @param conn Connection
+ *
+ * @return EOK on success (no data received means the connection was
+ *         closed by the peer), EAGAIN if no data is pending or other
+ *         error code
+ */
+static errno_t tcp_conn_ring_fill(tcp_conn_t *conn)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+	errno_t retval;
+
+	assert(conn->rx_out == conn->rx_in);
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_2(exch, TCP_CONN_RING_RECV, conn->id,
+	    conn->ring_size, &answer);
+	async_exchange_end(exch);
+
+	async_wait_for(req, &retval);
+	if (retval != EOK)
+		return retval;
+
+	conn->rx_out = 0;
+	conn->rx_in = min(IPC_GET_ARG1(answer), conn->ring_size);
+	return EOK;
+}
+
 /** Read received data from connection without blocking.
  *
  * If any received data is pending on the connection, up to @a bsize bytes
@@ -545,11 +713,25 @@ errno_t tcp_conn_recv(tcp_conn_t *conn, void *buf, size_t bsize, size_t *nrecv)
 	ipc_call_t answer;
 
 	fibril_mutex_lock(&conn->lock);
+	if (conn->ring != NULL && conn->rx_out != conn->rx_in) {
+		tcp_conn_ring_copy(conn, buf, bsize, nrecv);
+		fibril_mutex_unlock(&conn->lock);
+		return EOK;
+	}
+
 	if (!conn->data_avail) {
 		fibril_mutex_unlock(&conn->lock);
 		return EAGAIN;
 	}
 
+	if (conn->ring != NULL) {
+		errno_t rc = tcp_conn_ring_fill(conn);
+		if (rc == EOK)
+			tcp_conn_ring_copy(conn, buf, bsize, nrecv);
+		fibril_mutex_unlock(&conn->lock);
+		return rc;
+	}
+
 	exch = async_exchange_begin(conn->tcp->sess);
 	aid_t req = async_send_1(exch, TCP_CONN_RECV, conn->id, &answer);
 	errno_t rc = async_data_read_start(exch, buf, bsize);
@@ -595,10 +777,30 @@ errno_t tcp_conn_recv_wait(tcp_conn_t *conn, void *buf, size_t bsize,
 
 again:
 	fibril_mutex_lock(&conn->lock);
+	if (conn->ring != NULL && conn->rx_out != conn->rx_in) {
+		tcp_conn_ring_copy(conn, buf, bsize, nrecv);
+		fibril_mutex_unlock(&conn->lock);
+		return EOK;
+	}
+
 	while (!conn->data_avail) {
 		fibril_condvar_wait(&conn->cv, &conn->lock);
 	}
 
+	if (conn->ring != NULL) {
+		errno_t rc = tcp_conn_ring_fill(conn);
+		if (rc == EAGAIN) {
+			conn->data_avail = false;
+			fibril_mutex_unlock(&conn->lock);
+			goto again;
+		}
+
+		if (rc == EOK)
+			tcp_conn_ring_copy(conn, buf, bsize, nrecv);
+		fibril_mutex_unlock(&conn->lock);
+		return rc;
+	}
+
 	exch = async_exchange_begin(conn->tcp->sess);
 	aid_t req = async_send_1(exch, TCP_CONN_RECV_WAIT, conn->id, &answer);
 	errno_t rc = async_data_read_start(exch, buf, bsize);
@@ -630,6 +832,91 @@ again:
 	return EOK;
 }
 
+/** Set buffer sizes of TCP connection.
+ *
+ * Larger buffers let more data be in flight, the receive window
+ * offered to the peer is limited to 64 KiB nevertheless.
+ *
+ * @param conn     Connection
+ * @param snd_size Size of the send buffer in bytes
+ * @param rcv_size Size of the receive buffer in bytes
+ *
+ * @return EOK on success, EINVAL if a size is out of range or smaller
+ *         than the buffer contents, or other error code
+ */
+errno_t tcp_conn_set_bufsize(tcp_conn_t *conn, size_t snd_size,
+    size_t rcv_size)
+{
+	async_exch_t *exch = async_exchange_begin(conn->tcp->sess);
+	errno_t rc = async_req_3_0(exch, TCP_CONN_SET_BUFSIZE, conn->id,
+	    snd_size, rcv_size);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+/** Set up memory shared with TCP service for data transfers.
+ *
+ * Afterwards tcp_conn_send() and tcp_conn_recv() pass data through the
+ * shared memory instead of copying it in IPC calls. Received data are
+ * read ahead, so that a sequence of small reads needs a single call to
+ * the service.
+ *
+ * @param conn Connection
+ * @param size Size of the transmit and of the receive part in bytes
+ *
+ * @return EOK on success, EBUSY if already set up or other error code
+ */
+errno_t tcp_conn_ring_create(tcp_conn_t *conn, size_t size)
+{
+	async_exch_t *exch;
+	errno_t rc;
+	errno_t retval;
+
+	if (size < 2 || size > TCP_RING_SIZE_MAX)
+		return EINVAL;
+
+	fibril_mutex_lock(&conn->tx_lock);
+	fibril_mutex_lock(&conn->lock);
+
+	if (conn->ring != NULL) {
+		rc = EBUSY;
+		goto out;
+	}
+
+	uint8_t *ring = as_area_create(AS_AREA_ANY, 2 * size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (ring == AS_MAP_FAILED) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_2(exch, TCP_CONN_RING_CREATE, conn->id, size,
+	    NULL);
+	rc = async_share_out_start(exch, ring, AS_AREA_READ | AS_AREA_WRITE);
+	async_exchange_end(exch);
+
+	async_wait_for(req, &retval);
+	if (rc == EOK)
+		rc = retval;
+
+	if (rc != EOK) {
+		as_area_destroy(ring);
+		goto out;
+	}
+
+	conn->ring = ring;
+	conn->ring_size = size;
+	conn->rx_out = 0;
+	conn->rx_in = 0;
+out:
+	fibril_mutex_unlock(&conn->lock);
+	fibril_mutex_unlock(&conn->tx_lock);
+	return rc;
+}
+
 /** Connection established event.
  *
  * @param tcp TCP client
@@ -314,6 +314,27 @@ errno_t inetcfg_link_get(sysarg_t link_id, inet_link_info_t *linfo)
 	return EOK;
 }
 
+errno_t inetcfg_link_get_stats(sysarg_t link_id, inet_link_stats_t *stats)
+{
+	async_exch_t *exch = async_exchange_begin(inetcfg_sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, INETCFG_LINK_GET_STATS, link_id, &answer);
+	errno_t rc = async_data_read_start(exch, stats, sizeof(inet_link_stats_t));
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return retval;
+}
+
 errno_t inetcfg_link_remove(sysarg_t link_id)
 {
 	async_exch_t *exch = async_exchange_begin(inetcfg_sess);
@@ -49,6 +49,22 @@ errno_t win_register(async_sess_t *sess, window_flags_t flags, service_id_t *in,
 	return ret;
 }
 
+/** Get compositor frame statistics.
+ *
+ * @param sess Session to the compositor window registration service
+ * @param stats Place to store the statistics
+ * @return EOK on success or an error code
+ */
+errno_t win_get_stats(async_sess_t *sess, compositor_stats_t *stats)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	errno_t ret = async_req_0_4(exch, WINDOW_GET_STATS, &stats->frames,
+	    &stats->pixels, &stats->frame_rate, &stats->pixel_rate);
+	async_exchange_end(exch);
+
+	return ret;
+}
+
 errno_t win_get_event(async_sess_t *sess, window_event_t *event)
 {
 	async_exch_t *exch = async_exchange_begin(sess);
@@ -174,6 +174,28 @@ errno_t iplink_get_mac48(iplink_t *iplink, addr48_t *mac)
 	return retval;
 }
 
+errno_t iplink_get_stats(iplink_t *iplink, iplink_stats_t *stats)
+{
+	async_exch_t *exch = async_exchange_begin(iplink->sess);
+	
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, IPLINK_GET_STATS, &answer);
+	
+	errno_t rc = async_data_read_start(exch, stats, sizeof(iplink_stats_t));
+	
+	async_exchange_end(exch);
+	
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+	
+	errno_t retval;
+	async_wait_for(req, &retval);
+	
+	return retval;
+}
+
 errno_t iplink_set_mac48(iplink_t *iplink, addr48_t mac)
 {
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
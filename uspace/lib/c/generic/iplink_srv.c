@@ -80,6 +80,44 @@ static void iplink_get_mac48_srv(iplink_srv_t *srv, ipc_callid_t iid,
 	async_answer_0(iid, rc);
 }
 
+static void iplink_get_stats_srv(iplink_srv_t *srv, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	ipc_callid_t callid;
+	size_t size;
+	if (!async_data_read_receive(&callid, &size)) {
+		async_answer_0(callid, EREFUSED);
+		async_answer_0(iid, EREFUSED);
+		return;
+	}
+	
+	if (size != sizeof(iplink_stats_t)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+	
+	if (srv->ops->get_stats == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		async_answer_0(iid, ENOTSUP);
+		return;
+	}
+	
+	iplink_stats_t stats;
+	errno_t rc = srv->ops->get_stats(srv, &stats);
+	if (rc != EOK) {
+		async_answer_0(callid, rc);
+		async_answer_0(iid, rc);
+		return;
+	}
+	
+	rc = async_data_read_finalize(callid, &stats, size);
+	if (rc != EOK)
+		async_answer_0(callid, rc);
+	
+	async_answer_0(iid, rc);
+}
+
 static void iplink_set_mac48_srv(iplink_srv_t *srv, ipc_callid_t iid,
     ipc_call_t *icall)
 {
@@ -292,6 +330,9 @@ errno_t iplink_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case IPLINK_ADDR_REMOVE:
 			iplink_addr_remove_srv(srv, callid, &call);
 			break;
+		case IPLINK_GET_STATS:
+			iplink_get_stats_srv(srv, callid, &call);
+			break;
 		default:
 			async_answer_0(callid, EINVAL);
 		}
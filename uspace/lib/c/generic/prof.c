@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#include <libc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <abi/prof.h>
+#include <prof.h>
+
+/** Start the kernel sampling profiler.
+ *
+ * Samples recorded previously are discarded.
+ *
+ * Caller of this function must have the PERM_PROFILE permission.
+ *
+ * @param interval Number of clock ticks between two samples.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t prof_start(unsigned int interval)
+{
+	return (errno_t) __SYSCALL5(SYS_PROF, PROF_START, interval, 0, 0, 0);
+}
+
+/** Stop the kernel sampling profiler.
+ *
+ * Caller of this function must have the PERM_PROFILE permission.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t prof_stop(void)
+{
+	return (errno_t) __SYSCALL5(SYS_PROF, PROF_STOP, 0, 0, 0, 0);
+}
+
+/** Read and remove samples recorded by the kernel sampling profiler.
+ *
+ * Caller of this function must have the PERM_PROFILE permission.
+ *
+ * @param samples Buffer for the samples.
+ * @param max     Capacity of the buffer in samples.
+ * @param count   Place to store the number of samples read.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t prof_read(prof_sample_t *samples, size_t max, size_t *count)
+{
+	sysarg_t nread;
+	errno_t rc = (errno_t) __SYSCALL5(SYS_PROF, PROF_READ, 0,
+	    (sysarg_t) samples, max * sizeof(prof_sample_t),
+	    (sysarg_t) &nread);
+	
+	if (rc == EOK)
+		*count = nread / sizeof(prof_sample_t);
+	
+	return rc;
+}
+
+/** Translate a kernel address to a symbol name.
+ *
+ * Caller of this function must have the PERM_PROFILE permission.
+ *
+ * @param addr   Kernel address.
+ * @param name   Buffer for the symbol name.
+ * @param size   Size of the buffer.
+ * @param offset Place to store the offset of the address in the symbol.
+ *
+ * @return EOK on success, ENOENT if there is no such symbol, ENOTSUP if
+ *         the kernel was built without a symbol table.
+ *
+ */
+errno_t prof_symbol(uintptr_t addr, char *name, size_t size, size_t *offset)
+{
+	sysarg_t offs;
+	errno_t rc = (errno_t) __SYSCALL5(SYS_PROF, PROF_SYMBOL, addr,
+	    (sysarg_t) name, size, (sysarg_t) &offs);
+	
+	if (rc == EOK)
+		*offset = offs;
+	
+	return rc;
+}
+
+/** @}
+ */
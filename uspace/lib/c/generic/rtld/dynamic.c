@@ -90,6 +90,7 @@ void dynamic_parse(elf_dyn_t *dyn_ptr, size_t bias, dyn_info_t *info)
 		case DT_TEXTREL:	info->text_rel = true; break;
 		case DT_JMPREL:		info->jmp_rel = d_ptr; break;
 		case DT_BIND_NOW:	info->bind_now = true; break;
+		case DT_GNU_HASH:	info->gnu_hash = d_ptr; break;
 
 		default:
 			if (dp->d_tag >= DT_LOPROC && dp->d_tag <= DT_HIPROC)
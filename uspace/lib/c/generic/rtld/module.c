@@ -47,6 +47,7 @@
 #include <rtld/dynamic.h>
 #include <rtld/rtld_arch.h>
 #include <rtld/module.h>
+#include <rtld/symbol.h>
 
 /** Create module for static executable.
  *
@@ -81,9 +82,38 @@ errno_t module_create_static_exec(rtld_t *rtld, module_t **rmodule)
 	return EOK;
 }
 
-/** (Eagerly) process all relocation tables in a module.
+/** Determine whether PLT entries of a module can be bound lazily.
  *
- * Currently works as if LD_BIND_NOW was specified.
+ * Lazy binding needs the PLT entry point from the C library. The module
+ * providing it must itself be bound eagerly, otherwise the resolver
+ * would recurse into the PLT. Modules asking for DT_BIND_NOW are bound
+ * eagerly, too.
+ */
+static bool module_lazy_bind_ok(module_t *m)
+{
+	rtld_t *rtld = m->rtld;
+	elf_symbol_t *sym;
+	module_t *dest;
+
+	if (m->dyn.bind_now || m->dyn.plt_got == NULL)
+		return false;
+
+	if (rtld->plt_entry == NULL) {
+		sym = symbol_def_find(RTLD_PLT_ENTRY, m, ssf_none, &dest);
+		if (sym == NULL)
+			return false;
+
+		rtld->plt_entry = symbol_get_addr(sym, dest, NULL);
+		rtld->plt_entry_mod = dest;
+	}
+
+	return m != rtld->plt_entry_mod;
+}
+
+/** Process all relocation tables in a module.
+ *
+ * PLT relocations are left for lazy binding when possible, all other
+ * relocations are processed eagerly.
  */
 void module_process_relocs(module_t *m)
 {
@@ -97,7 +127,11 @@ void module_process_relocs(module_t *m)
 	/* jmp_rel table */
 	if (m->dyn.jmp_rel != NULL) {
 		DPRINTF("jmp_rel table\n");
-		if (m->dyn.plt_rel == DT_REL) {
+		m->lazy = module_lazy_bind_ok(m) &&
+		    plt_lazy_setup(m, m->rtld->plt_entry);
+		if (m->lazy) {
+			DPRINTF("jmp_rel table bound lazily\n");
+		} else if (m->dyn.plt_rel == DT_REL) {
 			DPRINTF("jmp_rel table type DT_REL\n");
 			rel_table_process(m, m->dyn.jmp_rel, m->dyn.plt_rel_sz);
 		} else {
@@ -194,7 +228,8 @@ module_t *module_load(rtld_t *rtld, const char *name, mlflags_t flags)
 	DPRINTF("filename:'%s'\n", name_buf);
 	DPRINTF("load '%s' at 0x%zx\n", name_buf, m->bias);
 
-	rc = elf_load_file_name(name_buf, m->bias, ELDF_RW, &info);
+	rc = elf_load_file_name(name_buf, m->bias, ELDF_RW | ELDF_SHARE,
+	    &info);
 	if (rc != EE_OK) {
 		printf("Failed to load '%s'\n", name_buf);
 		exit(1);
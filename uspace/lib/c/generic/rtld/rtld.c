@@ -38,6 +38,7 @@
 #include <rtld/module.h>
 #include <rtld/rtld.h>
 #include <rtld/rtld_debug.h>
+#include <rtld/symbol.h>
 #include <stdlib.h>
 #include <str.h>
 
@@ -83,6 +84,7 @@ errno_t rtld_prog_process(elf_finfo_t *p_info, rtld_t **rre)
 		return ENOMEM;
 
 	env->next_id = 1;
+	symbol_cache_create(env);
 
 	prog = calloc(1, sizeof(module_t));
 	if (prog == NULL) {
@@ -34,6 +34,8 @@
  * @file
  */
 
+#include <futex.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
@@ -44,6 +46,15 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/symbol.h>
 
+/** Symbol name with precomputed hash values */
+typedef struct {
+	const char *name;
+	/** System V hash of @c name */
+	elf_word elf_hash;
+	/** GNU hash of @c name */
+	uint32_t gnu_hash;
+} sym_key_t;
+
 /*
  * Hash tables are 32-bit (elf_word) even for 64-bit ELF files.
  */
@@ -61,38 +72,122 @@ static elf_word elf_hash(const unsigned char *name)
 	return h;
 }
 
-static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
+/** GNU hash function (DJB hash) used in DT_GNU_HASH tables. */
+static uint32_t gnu_hash(const unsigned char *name)
+{
+	uint32_t h = 5381;
+
+	while (*name)
+		h = (h << 5) + h + *name++;
+
+	return h;
+}
+
+static void sym_key_init(sym_key_t *key, const char *name)
+{
+	key->name = name;
+	key->elf_hash = elf_hash((const unsigned char *) name);
+	key->gnu_hash = gnu_hash((const unsigned char *) name);
+}
+
+/** Look up a symbol using the System V hash table. */
+static elf_symbol_t *def_find_sysv(sym_key_t *key, module_t *m)
 {
 	elf_symbol_t *sym_table;
-	elf_symbol_t *s, *sym;
+	elf_symbol_t *s;
 	elf_word nbucket;
 	/*elf_word nchain;*/
 	elf_word i;
 	char *s_name;
 	elf_word bucket;
 
-	DPRINTF("def_find_in_module('%s', %s)\n", name, m->dyn.soname);
-
 	sym_table = m->dyn.sym_tab;
 	nbucket = m->dyn.hash[0];
 	/*nchain = m->dyn.hash[1]; XXX Use to check HT range*/
 
-	bucket = elf_hash((unsigned char *)name) % nbucket;
+	bucket = key->elf_hash % nbucket;
 	i = m->dyn.hash[2 + bucket];
 
-	sym = NULL;
 	while (i != STN_UNDEF) {
 		s = &sym_table[i];
 		s_name = m->dyn.str_tab + s->st_name;
 
-		if (str_cmp(name, s_name) == 0) {
-			sym = s;
-			break;
-		}
+		if (str_cmp(key->name, s_name) == 0)
+			return s;
 
 		i = m->dyn.hash[2 + nbucket + i];
 	}
 
+	return NULL;
+}
+
+/** Look up a symbol using the GNU hash table.
+ *
+ * The table consists of a header (nbuckets, symoffset, bloom_size,
+ * bloom_shift), a Bloom filter of bloom_size machine words, nbuckets
+ * buckets and a chain of hash values parallel to the symbol table
+ * starting at symoffset. The Bloom filter lets us reject most symbols
+ * a module does not define without touching the symbol table at all.
+ */
+static elf_symbol_t *def_find_gnu(sym_key_t *key, module_t *m)
+{
+	const size_t wbits = 8 * sizeof(uintptr_t);
+	uint32_t *ht = m->dyn.gnu_hash;
+	uint32_t nbuckets = ht[0];
+	uint32_t symoffset = ht[1];
+	uint32_t bloom_size = ht[2];
+	uint32_t bloom_shift = ht[3];
+	uintptr_t *bloom = (uintptr_t *) &ht[4];
+	uint32_t *buckets = (uint32_t *) &bloom[bloom_size];
+	uint32_t *chain = &buckets[nbuckets];
+	elf_symbol_t *sym_table = m->dyn.sym_tab;
+	uint32_t h = key->gnu_hash;
+	uintptr_t word;
+	uintptr_t mask;
+	uint32_t i;
+
+	if (nbuckets == 0 || bloom_size == 0)
+		return NULL;
+
+	word = bloom[(h / wbits) % bloom_size];
+	mask = ((uintptr_t) 1 << (h % wbits)) |
+	    ((uintptr_t) 1 << ((h >> bloom_shift) % wbits));
+	if ((word & mask) != mask)
+		return NULL;
+
+	i = buckets[h % nbuckets];
+	if (i < symoffset)
+		return NULL;
+
+	while (true) {
+		uint32_t h2 = chain[i - symoffset];
+
+		if ((h | 1) == (h2 | 1) && str_cmp(key->name,
+		    m->dyn.str_tab + sym_table[i].st_name) == 0)
+			return &sym_table[i];
+
+		/* The lowest bit marks the end of the chain */
+		if ((h2 & 1) != 0)
+			break;
+		++i;
+	}
+
+	return NULL;
+}
+
+static elf_symbol_t *def_find_in_module(sym_key_t *key, module_t *m)
+{
+	elf_symbol_t *sym;
+
+	DPRINTF("def_find_in_module('%s', %s)\n", key->name, m->dyn.soname);
+
+	if (m->dyn.gnu_hash != NULL)
+		sym = def_find_gnu(key, m);
+	else if (m->dyn.hash != NULL)
+		sym = def_find_sysv(key, m);
+	else
+		sym = NULL;
+
 	if (!sym)
 		return NULL;	/* Not found */
 
@@ -104,6 +199,55 @@ static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
 	return sym; /* Found */
 }
 
+/** Create the symbol resolution cache.
+ *
+ * The cache is never resized nor freed as it may be shared between
+ * the program loader and the program. If it cannot be allocated,
+ * lookups simply go uncached.
+ *
+ * @param rtld	Runtime environment
+ */
+void symbol_cache_create(rtld_t *rtld)
+{
+	futex_initialize(&rtld->sym_cache_futex, 1);
+	rtld->sym_cache = calloc(SYMBOL_CACHE_SIZE,
+	    sizeof(symbol_cache_entry_t));
+}
+
+static elf_symbol_t *symbol_cache_find(rtld_t *rtld, sym_key_t *key,
+    module_t **mod)
+{
+	symbol_cache_entry_t *e;
+	elf_symbol_t *sym = NULL;
+
+	futex_down(&rtld->sym_cache_futex);
+	++rtld->sym_lookups;
+	e = &rtld->sym_cache[key->gnu_hash & (SYMBOL_CACHE_SIZE - 1)];
+	if (e->sym != NULL && e->hash == key->gnu_hash &&
+	    str_cmp(e->name, key->name) == 0) {
+		sym = e->sym;
+		*mod = e->mod;
+		++rtld->sym_cache_hits;
+	}
+	futex_up(&rtld->sym_cache_futex);
+
+	return sym;
+}
+
+static void symbol_cache_insert(rtld_t *rtld, sym_key_t *key,
+    elf_symbol_t *sym, module_t *mod)
+{
+	symbol_cache_entry_t *e;
+
+	futex_down(&rtld->sym_cache_futex);
+	e = &rtld->sym_cache[key->gnu_hash & (SYMBOL_CACHE_SIZE - 1)];
+	e->name = mod->dyn.str_tab + sym->st_name;
+	e->hash = key->gnu_hash;
+	e->sym = sym;
+	e->mod = mod;
+	futex_up(&rtld->sym_cache_futex);
+}
+
 /** Find the definition of a symbol in a module and its deps.
  *
  * Search the module dependency graph is breadth-first, beginning
@@ -121,8 +265,11 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 	module_t *m, *dm;
 	elf_symbol_t *sym, *s;
 	list_t queue;
+	sym_key_t key;
 	size_t i;
 
+	sym_key_init(&key, name);
+
 	/*
 	 * Do a BFS using the queue_link and bfs_tag fields.
 	 * Vertices (modules) are tagged the moment they are inserted
@@ -148,7 +295,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 		list_remove(&m->queue_link);
 
 		/* If ssf_noroot is specified, do not look in start module */
-		s = def_find_in_module(name, m);
+		s = def_find_in_module(&key, m);
 		if (s != NULL) {
 			/* Symbol found */
 			sym = s;
@@ -188,6 +335,10 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
  * origin is searched first. Otherwise, search global modules in the default
  * order.
  *
+ * Results of searching the global modules are remembered in the symbol
+ * cache. Modules are only ever appended to the global list so a cached
+ * definition stays the first match when more modules get loaded.
+ *
  * @param name		Name of the symbol to search for.
  * @param origin	Module in which the dependency originates.
  * @param flags		@c ssf_none or @c ssf_noexec to not look for the symbol
@@ -198,7 +349,12 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
     symbol_search_flags_t flags, module_t **mod)
 {
+	rtld_t *rtld = origin->rtld;
 	elf_symbol_t *s;
+	sym_key_t key;
+	bool use_cache;
+
+	sym_key_init(&key, name);
 
 	DPRINTF("symbol_def_find('%s', origin='%s'\n",
 	    name, origin->dyn.soname);
@@ -208,7 +364,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 		 * Origin module has a DT_SYMBOLIC flag.
 		 * Try this module first
 		 */
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&key, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -218,13 +374,22 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 
 	/* Not DT_SYMBOLIC or no match. Now try other locations. */
 
-	list_foreach(origin->rtld->modules, modules_link, module_t, m) {
+	use_cache = rtld->sym_cache != NULL && flags == ssf_none;
+	if (use_cache) {
+		s = symbol_cache_find(rtld, &key, mod);
+		if (s != NULL)
+			return s;
+	}
+
+	list_foreach(rtld->modules, modules_link, module_t, m) {
 		DPRINTF("module '%s' local?\n", m->dyn.soname);
 		if (!m->local && (!m->exec || (flags & ssf_noexec) == 0)) {
 			DPRINTF("!local->find '%s' in module '%s'\n", name, m->dyn.soname);
-			s = def_find_in_module(name, m);
+			s = def_find_in_module(&key, m);
 			if (s != NULL) {
 				/* Found */
+				if (use_cache)
+					symbol_cache_insert(rtld, &key, s, m);
 				*mod = m;
 				return s;
 			}
@@ -237,7 +402,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 	    origin->dyn.soname);
 
 	if (!origin->exec || (flags & ssf_noexec) == 0) {
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&key, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
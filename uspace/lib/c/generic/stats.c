@@ -157,6 +157,64 @@ stats_task_t *stats_get_task(task_id_t task_id)
 	return stats_task;
 }
 
+/** Get a delta snapshot of tasks or threads.
+ *
+ * @param path       Sysinfo path of the delta snapshots.
+ * @param since      Generation returned in the previous snapshot or zero.
+ * @param entry_size Size of a record of a task or thread.
+ * @param entries    Place to store the pointer to the records.
+ * @param exited     Place to store the pointer to the exited IDs.
+ *
+ * @return Header of the snapshot or NULL on error.
+ *
+ */
+static stats_delta_t *stats_get_delta(const char *path, uint64_t since,
+    size_t entry_size, void **entries, uint64_t **exited)
+{
+	char name[SYSINFO_STATS_MAX_PATH];
+	snprintf(name, SYSINFO_STATS_MAX_PATH, "%s.%" PRIu64, path, since);
+	
+	size_t size = 0;
+	stats_delta_t *delta = (stats_delta_t *) sysinfo_get_data(name, &size);
+	
+	/* The snapshot is truncated if it grew since its size was read */
+	if ((size < sizeof(stats_delta_t)) ||
+	    (size != sizeof(stats_delta_t) + delta->count * entry_size +
+	    delta->exited * sizeof(uint64_t))) {
+		if (delta != NULL)
+			free(delta);
+		return NULL;
+	}
+	
+	*entries = (void *) (delta + 1);
+	*exited = (uint64_t *) ((uint8_t *) (delta + 1) +
+	    delta->count * entry_size);
+	return delta;
+}
+
+/** Get statistics of tasks changed since a generation.
+ *
+ * Tasks which changed in the returned generation may be listed again in
+ * the next snapshot. If the full flag is set in the returned header, all
+ * tasks are listed and no exited tasks are reported.
+ *
+ * @param since  Generation returned in the previous snapshot or zero
+ *               to get all tasks.
+ * @param tasks  Place to store the pointer to the changed tasks.
+ * @param exited Place to store the pointer to the IDs of exited tasks.
+ *
+ * @return Header of the snapshot containing the number of the changed
+ *         and the exited tasks. If non-NULL then it should be eventually
+ *         freed by free(), which also frees the arrays.
+ *
+ */
+stats_delta_t *stats_get_tasks_delta(uint64_t since, stats_task_t **tasks,
+    task_id_t **exited)
+{
+	return stats_get_delta("system.tasks_delta", since,
+	    sizeof(stats_task_t), (void **) tasks, exited);
+}
+
 /** Get thread statistics.
  *
  * @param count Number of records returned.
@@ -210,6 +268,29 @@ stats_thread_t *stats_get_thread(thread_id_t thread_id)
 	return stats_thread;
 }
 
+/** Get statistics of threads changed since a generation.
+ *
+ * Threads which changed in the returned generation may be listed again in
+ * the next snapshot. If the full flag is set in the returned header, all
+ * threads are listed and no exited threads are reported.
+ *
+ * @param since   Generation returned in the previous snapshot or zero
+ *                to get all threads.
+ * @param threads Place to store the pointer to the changed threads.
+ * @param exited  Place to store the pointer to the IDs of exited threads.
+ *
+ * @return Header of the snapshot containing the number of the changed
+ *         and the exited threads. If non-NULL then it should be
+ *         eventually freed by free(), which also frees the arrays.
+ *
+ */
+stats_delta_t *stats_get_threads_delta(uint64_t since,
+    stats_thread_t **threads, thread_id_t **exited)
+{
+	return stats_get_delta("system.threads_delta", since,
+	    sizeof(stats_thread_t), (void **) threads, exited);
+}
+
 /** Get exception statistics.
  *
  * @param count Number of records returned.
@@ -236,6 +317,32 @@ stats_exc_t *stats_get_exceptions(size_t *count)
 	return stats_exceptions;
 }
 
+/** Get slab cache statistics.
+ *
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_slab_t structures.
+ *         If non-NULL then it should be eventually freed
+ *         by free().
+ *
+ */
+stats_slab_t *stats_get_slabs(size_t *count)
+{
+	size_t size = 0;
+	stats_slab_t *stats_slabs =
+	    (stats_slab_t *) sysinfo_get_data("system.slabs", &size);
+	
+	if ((size % sizeof(stats_slab_t)) != 0) {
+		if (stats_slabs != NULL)
+			free(stats_slabs);
+		*count = 0;
+		return NULL;
+	}
+	
+	*count = size / sizeof(stats_slab_t);
+	return stats_slabs;
+}
+
 /** Get single exception statistics
  *
  * @param excn Exception number we are interested in.
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#include <libc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sysinfo.h>
+#include <as.h>
+#include <ddi.h>
+#include <abi/tracepoint.h>
+#include <tracepoint.h>
+
+/** Used when the page shared with the kernel cannot be mapped */
+static const tracepoint_page_t tracepoint_disabled = {
+	.mask = 0
+};
+
+/** Page with the mask of enabled tracepoints, mapped on first use */
+const tracepoint_page_t *__tracepoint_page = NULL;
+
+/** Map the page with the mask of enabled tracepoints.
+ *
+ * If the page cannot be mapped, all tracepoints of the task stay
+ * disabled.
+ *
+ * @return Page with the mask of enabled tracepoints.
+ *
+ */
+const tracepoint_page_t *__tracepoint_page_map(void)
+{
+	const tracepoint_page_t *page = &tracepoint_disabled;
+	
+	uintptr_t faddr;
+	errno_t rc = sysinfo_get_value("tracepoint.faddr", &faddr);
+	if (rc == EOK) {
+		void *addr = AS_AREA_ANY;
+		rc = physmem_map(faddr, 1, AS_AREA_READ | AS_AREA_CACHEABLE,
+		    &addr);
+		if (rc == EOK)
+			page = addr;
+	}
+	
+	__tracepoint_page = page;
+	return page;
+}
+
+/** Set the mask of enabled tracepoints.
+ *
+ * Events recorded previously are discarded when the tracepoints get
+ * enabled while all of them were disabled.
+ *
+ * Caller of this function must have the PERM_PROFILE permission.
+ *
+ * @param mask Mask of tracepoints to enable, zero to disable all.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t tracepoint_enable(uint32_t mask)
+{
+	return (errno_t) __SYSCALL5(SYS_TRACEPOINT, TRACEPOINT_ENABLE, mask,
+	    0, 0, 0);
+}
+
+/** Read and remove recorded tracepoint events.
+ *
+ * Caller of this function must have the PERM_PROFILE permission.
+ *
+ * @param events Buffer for the events.
+ * @param max    Capacity of the buffer in events.
+ * @param count  Place to store the number of events read.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t tracepoint_read(tracepoint_event_t *events, size_t max,
+    size_t *count)
+{
+	sysarg_t nread;
+	errno_t rc = (errno_t) __SYSCALL5(SYS_TRACEPOINT, TRACEPOINT_READ,
+	    (sysarg_t) events, max * sizeof(tracepoint_event_t), 0,
+	    (sysarg_t) &nread);
+	
+	if (rc == EOK)
+		*count = nread / sizeof(tracepoint_event_t);
+	
+	return rc;
+}
+
+/** Record an event of a uspace tracepoint.
+ *
+ * Use the TRACEPOINT() macro instead of calling this directly.
+ *
+ * @param tp Uspace tracepoint.
+ * @param a0 First tracepoint specific argument.
+ * @param a1 Second tracepoint specific argument.
+ *
+ */
+void tracepoint_hit(tracepoint_t tp, sysarg_t a0, sysarg_t a1)
+{
+	(void) __SYSCALL5(SYS_TRACEPOINT, TRACEPOINT_HIT, tp, a0, a1, 0);
+}
+
+/** @}
+ */
@@ -50,6 +50,8 @@
 #include <loc.h>
 #include <ipc/vfs.h>
 #include <ipc/loc.h>
+#include <libarch/config.h>
+#include <as.h>
 
 /*
  * This file contains the implementation of the native HelenOS file system API.
@@ -127,6 +129,19 @@ static size_t cwd_size = 0;
 static FIBRIL_MUTEX_INITIALIZE(root_mutex);
 static int root_fd = -1;
 
+/** File mapping created by vfs_mmap(). */
+typedef struct {
+	link_t link;
+	/** Address of the mapping */
+	void *addr;
+	/** File handle used by the pager to read the file */
+	int file;
+} vfs_mapping_t;
+
+static FIBRIL_MUTEX_INITIALIZE(mappings_mutex);
+static LIST_INITIALIZE(mappings);
+static async_sess_t *pager_sess = NULL;
+
 static errno_t get_parent_and_child(const char *path, int *parent, char **child)
 {
 	size_t size;
@@ -603,6 +618,74 @@ errno_t vfs_lookup_open(const char *path, int flags, int mode, int *handle)
 	return EOK;
 }
 
+/** Map a file into the address space
+ *
+ * The mapping is private: modifications of the mapped pages are never written
+ * back to the file and modifications of the file are not guaranteed to be
+ * visible in pages that have already been accessed. The pages are read from
+ * the file on demand by the VFS pager, which caches them so that read-only
+ * mappings of the same file share the same physical memory.
+ *
+ * @param file          File handle open for reading
+ * @param pos           Page-aligned position in the file where the mapping
+ *                      starts
+ * @param size          Size of the mapping
+ * @param flags         Flags of the mapping (AS_AREA_*)
+ * @param[in,out] addr  Requested address of the mapping or AS_AREA_ANY on
+ *                      input, address of the mapping on output
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_mmap(int file, aoff64_t pos, size_t size, unsigned int flags,
+    void **addr)
+{
+	if (pos % PAGE_SIZE != 0)
+		return EINVAL;
+	
+	vfs_mapping_t *mapping = malloc(sizeof(vfs_mapping_t));
+	if (mapping == NULL)
+		return ENOMEM;
+	
+	/*
+	 * The mapping holds its own file handle so that the caller is free to
+	 * put @a file.
+	 */
+	errno_t rc = vfs_clone(file, -1, true, &mapping->file);
+	if (rc != EOK) {
+		free(mapping);
+		return rc;
+	}
+	
+	fibril_mutex_lock(&mappings_mutex);
+	
+	if (pager_sess == NULL) {
+		pager_sess = service_connect_blocking(SERVICE_VFS,
+		    INTERFACE_PAGER, 0);
+		if (pager_sess == NULL) {
+			fibril_mutex_unlock(&mappings_mutex);
+			vfs_put(mapping->file);
+			free(mapping);
+			return ENOENT;
+		}
+	}
+	
+	mapping->addr = async_as_area_create(*addr, size, flags, pager_sess,
+	    mapping->file, pos / PAGE_SIZE,
+	    (flags & AS_AREA_WRITE) ? VFS_PAGER_COPY : 0);
+	if (mapping->addr == AS_MAP_FAILED) {
+		fibril_mutex_unlock(&mappings_mutex);
+		vfs_put(mapping->file);
+		free(mapping);
+		return ENOMEM;
+	}
+	
+	list_append(&mapping->link, &mappings);
+	fibril_mutex_unlock(&mappings_mutex);
+	
+	*addr = mapping->addr;
+	return EOK;
+}
+
 /** Mount a file system
  *
  * @param[in] mp                File handle representing the mount-point
@@ -745,6 +828,39 @@ errno_t vfs_mount_path(const char *mp, const char *fs_name, const char *fqsn,
 	return (errno_t) rc;
 }
 
+/** Unmap a file mapping created by vfs_mmap()
+ *
+ * @param addr  Address of the mapping
+ *
+ * @return      EOK on success, ENOENT if there is no file mapping at @a addr
+ *              or an error code
+ */
+errno_t vfs_munmap(void *addr)
+{
+	fibril_mutex_lock(&mappings_mutex);
+	
+	list_foreach(mappings, link, vfs_mapping_t, mapping) {
+		if (mapping->addr != addr)
+			continue;
+		
+		errno_t rc = as_area_destroy(addr);
+		if (rc != EOK) {
+			fibril_mutex_unlock(&mappings_mutex);
+			return rc;
+		}
+		
+		list_remove(&mapping->link);
+		fibril_mutex_unlock(&mappings_mutex);
+		
+		vfs_put(mapping->file);
+		free(mapping);
+		return EOK;
+	}
+	
+	fibril_mutex_unlock(&mappings_mutex);
+	return ENOENT;
+}
+
 
 /** Open a file handle for I/O
  *
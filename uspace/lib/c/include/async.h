@@ -425,6 +425,8 @@ extern errno_t async_data_read_start(async_exch_t *, void *, size_t);
 extern bool async_data_read_receive(cap_handle_t *, size_t *);
 extern bool async_data_read_receive_call(cap_handle_t *, ipc_call_t *, size_t *);
 extern errno_t async_data_read_finalize(cap_handle_t, const void *, size_t);
+extern errno_t async_data_read_finalize_iov(cap_handle_t, const ipc_iov_t *,
+    size_t);
 
 extern errno_t async_data_read_forward_fast(async_exch_t *, sysarg_t, sysarg_t,
     sysarg_t, sysarg_t, sysarg_t, ipc_call_t *);
@@ -56,7 +56,9 @@
 
 typedef enum {
 	/** Leave all segments in RW access mode. */
-	ELDF_RW = 1
+	ELDF_RW = 1,
+	/** Map read-only segments from the file, sharing them among tasks. */
+	ELDF_SHARE = 2
 } eld_flags_t;
 
 /** TLS info for a module */
@@ -26,14 +26,14 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-/** @addtogroup debug
+/** @addtogroup generic
  * @{
  */
 /** @file
  */
 
-#ifndef SYMTAB_H_
-#define SYMTAB_H_
+#ifndef ELF_SYMTAB_H_
+#define ELF_SYMTAB_H_
 
 #include <elf/elf.h>
 #include <stddef.h>
@@ -76,6 +76,16 @@ typedef struct {
 	size_t size;
 } iplink_recv_sdu_t;
 
+/** Internet link statistics */
+typedef struct {
+	/** Frames received from the device */
+	uint64_t rx_frames;
+	/** Receive notifications from the device (each carrying one or more frames) */
+	uint64_t rx_batches;
+	/** Bytes received from the device */
+	uint64_t rx_bytes;
+} iplink_stats_t;
+
 typedef struct iplink_ev_ops {
 	errno_t (*recv)(iplink_t *, iplink_recv_sdu_t *, ip_ver_t);
 	errno_t (*change_addr)(iplink_t *, addr48_t);
@@ -90,6 +100,7 @@ extern errno_t iplink_addr_remove(iplink_t *, inet_addr_t *);
 extern errno_t iplink_get_mtu(iplink_t *, size_t *);
 extern errno_t iplink_get_mac48(iplink_t *, addr48_t *);
 extern errno_t iplink_set_mac48(iplink_t *, addr48_t);
+extern errno_t iplink_get_stats(iplink_t *, iplink_stats_t *);
 extern void *iplink_get_userptr(iplink_t *);
 
 #endif
@@ -61,6 +61,7 @@ typedef struct iplink_ops {
 	errno_t (*set_mac48)(iplink_srv_t *, addr48_t *);
 	errno_t (*addr_add)(iplink_srv_t *, inet_addr_t *);
 	errno_t (*addr_remove)(iplink_srv_t *, inet_addr_t *);
+	errno_t (*get_stats)(iplink_srv_t *, iplink_stats_t *);
 } iplink_ops_t;
 
 extern void iplink_srv_init(iplink_srv_t *);
@@ -39,6 +39,7 @@
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 #include <inet/inet.h>
+#include <offset.h>
 
 /** TCP connection */
 typedef struct {
@@ -54,6 +55,17 @@ typedef struct {
 	bool connected;
 	bool conn_failed;
 	bool conn_reset;
+	/** Memory shared with TCP service, transmit part followed by receive
+	 * part, or @c NULL */
+	uint8_t *ring;
+	/** Size of each part of the shared memory */
+	size_t ring_size;
+	/** Serializes use of the transmit part */
+	fibril_mutex_t tx_lock;
+	/** Position of the first received byte not yet returned */
+	size_t rx_out;
+	/** Number of received bytes in the receive part */
+	size_t rx_in;
 } tcp_conn_t;
 
 /** TCP connection listener */
@@ -110,6 +122,8 @@ extern void *tcp_listener_userptr(tcp_listener_t *);
 
 extern errno_t tcp_conn_wait_connected(tcp_conn_t *);
 extern errno_t tcp_conn_send(tcp_conn_t *, const void *, size_t);
+extern errno_t tcp_conn_send_file(tcp_conn_t *, int, aoff64_t, size_t,
+    size_t *);
 extern errno_t tcp_conn_send_fin(tcp_conn_t *);
 extern errno_t tcp_conn_push(tcp_conn_t *);
 extern errno_t tcp_conn_reset(tcp_conn_t *);
@@ -117,6 +131,9 @@ extern errno_t tcp_conn_reset(tcp_conn_t *);
 extern errno_t tcp_conn_recv(tcp_conn_t *, void *, size_t, size_t *);
 extern errno_t tcp_conn_recv_wait(tcp_conn_t *, void *, size_t, size_t *);
 
+extern errno_t tcp_conn_set_bufsize(tcp_conn_t *, size_t, size_t);
+extern errno_t tcp_conn_ring_create(tcp_conn_t *, size_t);
+
 
 #endif
 
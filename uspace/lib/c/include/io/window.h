@@ -112,8 +112,21 @@ typedef struct {
 	window_event_data_t data;
 } window_event_t;
 
+/** Compositor frame statistics */
+typedef struct {
+	/** Number of composed frames */
+	sysarg_t frames;
+	/** Number of composed pixels */
+	sysarg_t pixels;
+	/** Frames composed per second */
+	sysarg_t frame_rate;
+	/** Pixels composed per second */
+	sysarg_t pixel_rate;
+} compositor_stats_t;
+
 extern errno_t win_register(async_sess_t *, window_flags_t, service_id_t *,
     service_id_t *);
+extern errno_t win_get_stats(async_sess_t *, compositor_stats_t *);
 
 extern errno_t win_get_event(async_sess_t *, window_event_t *);
 
@@ -37,6 +37,9 @@
 
 #include <ipc/common.h>
 
+/** Largest part of memory shared between a connection and TCP service */
+#define TCP_RING_SIZE_MAX  (1024 * 1024)
+
 typedef enum {
 	TCP_CALLBACK_CREATE = IPC_FIRST_USER_METHOD,
 	TCP_CONN_CREATE,
@@ -48,7 +51,12 @@ typedef enum {
 	TCP_CONN_PUSH,
 	TCP_CONN_RESET,
 	TCP_CONN_RECV,
-	TCP_CONN_RECV_WAIT
+	TCP_CONN_RECV_WAIT,
+	TCP_CONN_SEND_FILE,
+	TCP_CONN_SET_BUFSIZE,
+	TCP_CONN_RING_CREATE,
+	TCP_CONN_RING_SEND,
+	TCP_CONN_RING_RECV
 } tcp_request_t;
 
 typedef enum {
@@ -190,6 +190,14 @@ enum {
 	MODE_APPEND = 4,
 };
 
+/*
+ * VFS pager flags.
+ */
+enum {
+	/** Page-in requests are answered with private copies of the pages. */
+	VFS_PAGER_COPY = 1,
+};
+
 #endif
 
 /** @}
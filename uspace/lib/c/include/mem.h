@@ -49,6 +49,15 @@ extern void *memmove(void *, const void *, size_t)
 extern int memcmp(const void *, const void *, size_t)
     __attribute__((nonnull(1, 2)));
 
+/** Copy a small object of constant size to or from an unaligned address
+ *
+ * Uspace is built freestanding, so memcpy() is not expanded inline even
+ * for a constant size. The builtin compiles to a single load or store.
+ *
+ */
+#define memcpy_unaligned(dst, src, size) \
+	__builtin_memcpy((dst), (src), (size))
+
 #endif
 
 /** @}
@@ -222,6 +222,9 @@ typedef struct nic_device_stats {
 	unsigned long receive_compressed;
 	/** Total compressed packet transmitted. */
 	unsigned long send_compressed;
+
+	/** Receive notifications sent to the client (single frames or batches). */
+	unsigned long receive_batches;
 } nic_device_stats_t;
 
 /** Errors corresponding to those in the nic_device_stats_t */
@@ -36,6 +36,7 @@
 #define LIBC_RTLD_DYNAMIC_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <rtld/elf_dyn.h>
 #include <libarch/rtld/dynamic.h>
 
@@ -68,6 +69,8 @@ typedef struct dyn_info {
 
 	/** Hash table */
 	elf_word *hash;
+	/** GNU-style hash table with Bloom filter (optional) */
+	uint32_t *gnu_hash;
 
 	/** String table */
 	char *str_tab;
@@ -94,6 +94,7 @@ typedef struct elf32_rela elf_rela_t;
 #define DT_TEXTREL	22
 #define DT_JMPREL	23
 #define DT_BIND_NOW	24
+#define DT_GNU_HASH	0x6ffffef5
 #define DT_LOPROC	0x70000000
 #define DT_HIPROC	0x7fffffff
 
@@ -43,6 +43,12 @@ void module_process_pre_arch(module_t *m);
 void rel_table_process(module_t *m, elf_rel_t *rt, size_t rt_size);
 void rela_table_process(module_t *m, elf_rela_t *rt, size_t rt_size);
 
+/** Name of the lazy PLT binding entry point exported by the C library */
+#define RTLD_PLT_ENTRY "__rtld_plt_entry"
+
+bool plt_lazy_setup(module_t *m, void *entry);
+void *__rtld_plt_resolve(module_t *m, size_t reloc_off);
+
 void program_run(void *entry, pcb_t *pcb);
 
 #endif
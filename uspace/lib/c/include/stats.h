@@ -50,13 +50,19 @@ extern load_t *stats_get_load(size_t *);
 
 extern stats_task_t *stats_get_tasks(size_t *);
 extern stats_task_t *stats_get_task(task_id_t);
+extern stats_delta_t *stats_get_tasks_delta(uint64_t, stats_task_t **,
+    task_id_t **);
 
 extern stats_thread_t *stats_get_threads(size_t *);
 extern stats_thread_t *stats_get_thread(thread_id_t);
+extern stats_delta_t *stats_get_threads_delta(uint64_t, stats_thread_t **,
+    thread_id_t **);
 
 extern stats_exc_t *stats_get_exceptions(size_t *);
 extern stats_exc_t *stats_get_exception(unsigned int);
 
+extern stats_slab_t *stats_get_slabs(size_t *);
+
 extern void stats_print_load_fragment(load_t, unsigned int);
 extern const char *thread_get_state(state_t);
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#ifndef LIBC_TRACEPOINT_H_
+#define LIBC_TRACEPOINT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <types/common.h>
+#include <abi/tracepoint.h>
+
+/** Record an event if the tracepoint is enabled.
+ *
+ * While the tracepoint is disabled, this only tests a bit on the page
+ * shared with the kernel.
+ *
+ * @param tp Uspace tracepoint.
+ * @param a0 First tracepoint specific argument.
+ * @param a1 Second tracepoint specific argument.
+ *
+ */
+#define TRACEPOINT(tp, a0, a1) \
+	do { \
+		if (tracepoint_enabled(tp)) \
+			tracepoint_hit((tp), (sysarg_t) (a0), \
+			    (sysarg_t) (a1)); \
+	} while (0)
+
+extern const tracepoint_page_t *__tracepoint_page;
+extern const tracepoint_page_t *__tracepoint_page_map(void);
+
+/** Check whether a tracepoint is enabled.
+ *
+ * @param tp Tracepoint.
+ *
+ * @return True if events of the tracepoint are being recorded.
+ *
+ */
+static inline bool tracepoint_enabled(tracepoint_t tp)
+{
+	const tracepoint_page_t *page = __tracepoint_page;
+	
+	if (__builtin_expect(page == NULL, 0))
+		page = __tracepoint_page_map();
+	
+	return __builtin_expect((page->mask & TP_MASK(tp)) != 0, 0);
+}
+
+extern errno_t tracepoint_enable(uint32_t);
+extern errno_t tracepoint_read(tracepoint_event_t *, size_t, size_t *);
+extern void tracepoint_hit(tracepoint_t, sysarg_t, sysarg_t);
+
+#endif
+
+/** @}
+ */
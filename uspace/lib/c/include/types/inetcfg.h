@@ -58,6 +58,22 @@ typedef struct {
 	addr48_t mac_addr;
 } inet_link_info_t;
 
+/** IP link statistics */
+typedef struct {
+	/** Frames received by the link service from the device */
+	uint64_t link_rx_frames;
+	/** Receive notifications from the device (one or more frames each) */
+	uint64_t link_rx_batches;
+	/** Bytes received by the link service from the device */
+	uint64_t link_rx_bytes;
+	/** Packets received by the internet service from the link */
+	uint64_t rx_packets;
+	/** Bytes received by the internet service from the link */
+	uint64_t rx_bytes;
+	/** Received packets that could not be decoded */
+	uint64_t rx_errors;
+} inet_link_stats_t;
+
 /** Static route info */
 typedef struct {
 	/** Destination network address */
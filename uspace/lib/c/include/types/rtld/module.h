@@ -72,6 +72,8 @@ typedef struct module {
 
 	/** True iff relocations have already been processed in this module. */
 	bool relocated;
+	/** True iff PLT entries are bound on first call rather than at load. */
+	bool lazy;
 
 	/** Link to list of all modules in runtime environment */
 	link_t modules_link;
@@ -37,11 +37,27 @@
 
 #include <adt/list.h>
 #include <elf/elf_mod.h>
+#include <futex.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include <types/rtld/module.h>
 
+/** Number of entries in the symbol resolution cache (power of two) */
+#define SYMBOL_CACHE_SIZE  1024
+
+/** Symbol resolution cache entry */
+typedef struct {
+	/** Symbol name (points into the defining module's string table) */
+	const char *name;
+	/** GNU hash of the name */
+	uint32_t hash;
+	/** Symbol definition */
+	elf_symbol_t *sym;
+	/** Module containing the definition */
+	module_t *mod;
+} symbol_cache_entry_t;
+
 typedef struct rtld {
 	elf_dyn_t *rtld_dynamic;
 	module_t rtld;
@@ -62,6 +78,27 @@ typedef struct rtld {
 
 	/** Temporary hack to place each module at different address. */
 	uintptr_t next_bias;
+
+	/**
+	 * Direct-mapped cache of global symbol lookups. Allocated once
+	 * and never freed, @c NULL if caching is disabled.
+	 */
+	symbol_cache_entry_t *sym_cache;
+	/** Protects @c sym_cache */
+	futex_t sym_cache_futex;
+	/** Number of cached symbol lookups */
+	size_t sym_lookups;
+	/** Number of lookups answered from the cache */
+	size_t sym_cache_hits;
+
+	/** Lazy PLT binding entry point or @c NULL if not available */
+	void *plt_entry;
+	/** Module defining @c plt_entry */
+	module_t *plt_entry_mod;
+	/** Number of PLT entries left unbound at load time */
+	size_t plt_lazy_slots;
+	/** Number of PLT entries bound on their first call */
+	size_t plt_lazy_binds;
 } rtld_t;
 
 #endif
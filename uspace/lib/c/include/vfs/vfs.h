@@ -96,10 +96,12 @@ extern errno_t vfs_link(int, const char *, vfs_file_kind_t, int *);
 extern errno_t vfs_link_path(const char *, vfs_file_kind_t, int *);
 extern errno_t vfs_lookup(const char *, int, int *);
 extern errno_t vfs_lookup_open(const char *, int, int, int *);
+extern errno_t vfs_mmap(int, aoff64_t, size_t, unsigned int, void **);
 extern errno_t vfs_mount_path(const char *, const char *, const char *,
     const char *, unsigned int, unsigned int);
 extern errno_t vfs_mount(int, const char *, service_id_t, const char *, unsigned,
     unsigned, int *);
+extern errno_t vfs_munmap(void *);
 extern errno_t vfs_open(int, int);
 extern errno_t vfs_pass_handle(async_exch_t *, int, async_exch_t *);
 extern errno_t vfs_put(int);
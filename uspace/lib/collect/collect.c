@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libcollect
+ * @{
+ */
+/**
+ * @file Collecting records from the kernel buffers
+ *
+ * The kernel profiler and the tracepoints keep their records in small
+ * per-processor buffers. The buffers are drained periodically while
+ * the records are being produced, so that few of them are dropped.
+ * The tasks which produced the records are looked up right away, while
+ * they are still likely to exist.
+ */
+
+#include <async.h>
+#include <mem.h>
+#include <stats.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <str.h>
+#include "collect.h"
+
+/** Initialize a collection of records.
+ *
+ * @param collect     Collection to initialize.
+ * @param record_size Size of a record.
+ * @param read_count  Number of records read from the kernel at once.
+ * @param read        Function reading records from the kernel.
+ * @param record_task Function getting the task which produced a record.
+ * @param task_size   Size of the task structures, which start with
+ *                    collect_task_t.
+ */
+void collect_init(collect_t *collect, size_t record_size, size_t read_count,
+    collect_read_t read, collect_record_task_t record_task, size_t task_size)
+{
+	collect->record_size = record_size;
+	collect->read_count = read_count;
+	collect->read = read;
+	collect->record_task = record_task;
+	collect->task_size = task_size;
+	list_initialize(&collect->tasks);
+	collect->records = NULL;
+	collect->count = 0;
+	collect->capacity = 0;
+}
+
+/** Find a task or start tracking it.
+ *
+ * The task name is looked up while the task is still likely to exist.
+ *
+ * @param collect Collection of records.
+ * @param id      Task ID.
+ *
+ * @return Task or NULL if out of memory.
+ */
+collect_task_t *collect_task_get(collect_t *collect, task_id_t id)
+{
+	list_foreach(collect->tasks, link, collect_task_t, task) {
+		if (task->id == id)
+			return task;
+	}
+	
+	collect_task_t *task = calloc(1, collect->task_size);
+	if (task == NULL)
+		return NULL;
+	
+	task->id = id;
+	
+	stats_task_t *stats_task = stats_get_task(id);
+	if (stats_task != NULL) {
+		task->name = str_dup(stats_task->name);
+		free(stats_task);
+	}
+	
+	list_append(&task->link, &collect->tasks);
+	return task;
+}
+
+/** Move the records from the kernel buffers to the collection. */
+static errno_t collect_drain(collect_t *collect, uint8_t *buf)
+{
+	while (true) {
+		size_t count;
+		errno_t rc = collect->read(buf, collect->read_count, &count);
+		if (rc != EOK)
+			return rc;
+		
+		if (count == 0)
+			return EOK;
+		
+		if (collect->count + count > collect->capacity) {
+			size_t capacity = 2 * (collect->count + count);
+			void *grown = realloc(collect->records,
+			    capacity * collect->record_size);
+			if (grown == NULL)
+				return ENOMEM;
+			
+			collect->records = grown;
+			collect->capacity = capacity;
+		}
+		
+		for (size_t i = 0; i < count; i++) {
+			const uint8_t *record = buf + i * collect->record_size;
+			task_id_t task_id = collect->record_task(record);
+			
+			if ((task_id != 0) &&
+			    (collect_task_get(collect, task_id) == NULL))
+				return ENOMEM;
+			
+			memcpy((uint8_t *) collect->records +
+			    collect->count * collect->record_size, record,
+			    collect->record_size);
+			collect->count++;
+		}
+	}
+}
+
+/** Collect records while the kernel produces them.
+ *
+ * The caller starts producing the records before calling this function.
+ * Records left in the kernel buffers once the production stops are
+ * collected as well.
+ *
+ * @param collect  Collection of records.
+ * @param duration Number of seconds to collect the records for.
+ * @param stop     Function stopping the production of the records.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t collect_run(collect_t *collect, unsigned int duration,
+    errno_t (*stop)(void))
+{
+	uint8_t *buf = calloc(collect->read_count, collect->record_size);
+	if (buf == NULL) {
+		(void) stop();
+		return ENOMEM;
+	}
+	
+	errno_t rc = EOK;
+	
+	uint64_t periods = (uint64_t) duration * 1000000 / COLLECT_PERIOD;
+	for (uint64_t i = 0; i < periods; i++) {
+		async_usleep(COLLECT_PERIOD);
+		
+		rc = collect_drain(collect, buf);
+		if (rc != EOK)
+			break;
+	}
+	
+	errno_t rc_stop = stop();
+	if (rc == EOK)
+		rc = rc_stop;
+	
+	if (rc == EOK)
+		rc = collect_drain(collect, buf);
+	
+	free(buf);
+	return rc;
+}
+
+/** @}
+ */
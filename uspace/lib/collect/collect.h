@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libcollect
+ * @{
+ */
+/**
+ * @file Collecting records from the kernel buffers
+ */
+
+#ifndef LIBCOLLECT_COLLECT_H_
+#define LIBCOLLECT_COLLECT_H_
+
+#include <adt/list.h>
+#include <errno.h>
+#include <stddef.h>
+#include <task.h>
+
+/** Period of draining the kernel buffers (usec) */
+#define COLLECT_PERIOD  100000
+
+/** Task seen in the collected records */
+typedef struct {
+	link_t link;
+	task_id_t id;
+	
+	/** Task name or NULL if the task exited before it was looked up */
+	char *name;
+} collect_task_t;
+
+/** Read records from the kernel buffers */
+typedef errno_t (*collect_read_t)(void *, size_t, size_t *);
+
+/** Get the task which produced a record, zero for none */
+typedef task_id_t (*collect_record_task_t)(const void *);
+
+/** Records collected from the kernel buffers */
+typedef struct {
+	/** Size of a record */
+	size_t record_size;
+	
+	/** Number of records read from the kernel at once */
+	size_t read_count;
+	
+	collect_read_t read;
+	collect_record_task_t record_task;
+	
+	/** Size of the task structures, which start with collect_task_t */
+	size_t task_size;
+	
+	/** Tasks seen in the records */
+	list_t tasks;
+	
+	/** Collected records */
+	void *records;
+	size_t count;
+	size_t capacity;
+} collect_t;
+
+extern void collect_init(collect_t *, size_t, size_t, collect_read_t,
+    collect_record_task_t, size_t);
+extern collect_task_t *collect_task_get(collect_t *, task_id_t);
+extern errno_t collect_run(collect_t *, unsigned int, errno_t (*)(void));
+
+#endif
+
+/** @}
+ */
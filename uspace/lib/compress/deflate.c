@@ -0,0 +1,1371 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * @brief Implementation of deflate compression
+ *
+ * A deflate encoder (compression into the format described by RFC 1951)
+ * following the design of zlib. Matches are found by following chains
+ * of earlier positions with the same hash of the next three bytes in
+ * a 64 KiB sliding window. The fast levels emit the longest match found
+ * greedily, the other levels defer the decision by one byte to see
+ * whether the next position yields a longer match (lazy matching).
+ *
+ * Literals and matches are collected into a symbol buffer. When it is
+ * full (or when the window is about to slide past the start of the
+ * block), the block is emitted with length-limited Huffman codes built
+ * for it, with the fixed codes or stored, whichever is the shortest.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <mem.h>
+#include "deflate.h"
+#include "load.h"
+
+/** Size of the match distance window */
+#define WSIZE  32768
+#define WMASK  (WSIZE - 1)
+
+/** Minimum length of a match */
+#define MIN_MATCH  3
+/** Maximum length of a match */
+#define MAX_MATCH  258
+
+/** Minimum lookahead needed to find a match of maximum length */
+#define MIN_LOOKAHEAD  (MAX_MATCH + MIN_MATCH + 1)
+/** Maximum distance of a match */
+#define MAX_DIST  (WSIZE - MIN_LOOKAHEAD)
+/** Position at which the window is slid by WSIZE bytes */
+#define SLIDE_AT  (WSIZE + MAX_DIST)
+
+/** Matches of minimal length farther than this are not worth it */
+#define TOO_FAR  4096
+
+/** Number of hash chain heads */
+#define HASH_BITS  15
+#define HASH_SIZE  (1 << HASH_BITS)
+
+/** Number of symbols collected into a block */
+#define SYM_BUFSIZE  16384
+
+/** Size of the output buffer (enough for a block stored in full) */
+#define PENDING_SIZE  (2 * WSIZE + 64)
+
+/** Maximum payload of a stored block */
+#define MAX_STORED  65535
+
+/** Maximum bit length of literal/length and distance codes */
+#define MAX_BITS     15
+/** Maximum bit length of code length codes */
+#define MAX_CL_BITS  7
+
+/** Number of literal/length codes (including the unused ones) */
+#define LITLEN_CODES  288
+/** Number of distance codes (including the unused ones) */
+#define DIST_CODES    32
+/** Number of code length codes */
+#define CL_CODES      19
+
+/** End of block symbol */
+#define END_BLOCK  256
+
+/** Code length repeat codes */
+#define REP_3_6      16
+#define REPZ_3_10    17
+#define REPZ_11_138  18
+
+/** Compression level parameters */
+typedef struct {
+	/** Reduce the chain length if a match of this length was found */
+	uint16_t good_length;
+	/** Do not look for a better match above this length (lazy),
+	 *  do not hash positions of longer matches (greedy) */
+	uint16_t max_lazy;
+	/** Stop searching once a match of this length is found */
+	uint16_t nice_length;
+	/** Maximum number of hash chain entries examined */
+	uint16_t max_chain;
+	/** Use lazy matching */
+	bool lazy;
+} level_config_t;
+
+static const level_config_t level_config[] = {
+	{ 0, 0, 0, 0, false },
+	{ 4, 4, 8, 4, false },
+	{ 4, 5, 16, 8, false },
+	{ 4, 6, 32, 32, false },
+	{ 4, 4, 16, 16, true },
+	{ 8, 16, 32, 32, true },
+	{ 8, 16, 128, 128, true },
+	{ 8, 32, 128, 256, true },
+	{ 32, 128, 258, 1024, true },
+	{ 32, 258, 258, 4096, true }
+};
+
+/** Length bases (minus MIN_MATCH) of length codes 257..285 */
+static const uint8_t len_base[] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32, 40, 48,
+	56, 64, 80, 96, 112, 128, 160, 192, 224, 255
+};
+
+/** Extra bits of length codes 257..285 */
+static const uint8_t len_extra[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
+	4, 4, 5, 5, 5, 5, 0
+};
+
+/** Distance bases of distance codes 0..29 */
+static const uint16_t dist_base[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+	513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385,
+	24577
+};
+
+/** Extra bits of distance codes 0..29 */
+static const uint8_t dist_extra[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9,
+	10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/** Permutation of code length codes */
+static const uint8_t cl_order[CL_CODES] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/** Huffman code */
+typedef struct {
+	uint8_t len;    /**< Code length (0 for unused symbols) */
+	uint16_t code;  /**< Code bits in the order they are written */
+} huffman_code_t;
+
+/** Symbol of a Huffman code under construction */
+typedef struct {
+	uint32_t key;   /**< Frequency, later code length */
+	uint16_t sym;   /**< Symbol */
+} huffman_sym_t;
+
+/** Incremental deflate stream
+ *
+ */
+struct deflate_stream {
+	const level_config_t *config;  /**< Level parameters */
+	bool done;                     /**< Last block emitted */
+	bool finish;                   /**< No more input after src */
+	
+	const uint8_t *src;            /**< Input buffer */
+	size_t srclen;                 /**< Input buffer size */
+	size_t srccnt;                 /**< Position in the input buffer */
+	
+	size_t strstart;               /**< Current position in the window */
+	size_t lookahead;              /**< Bytes available at strstart */
+	size_t block_start;            /**< Window position of the block */
+	size_t match_start;            /**< Window position of the match */
+	size_t match_length;           /**< Length of the match at strstart */
+	size_t match_dist;             /**< Distance of the match at strstart */
+	size_t prev_length;            /**< Length of the previous match */
+	size_t prev_dist;              /**< Distance of the previous match */
+	bool match_available;          /**< Previous position not emitted */
+	
+	uint64_t bitbuf;               /**< Bits not written yet */
+	unsigned int bitcnt;           /**< Number of bits in bitbuf */
+	size_t pending_len;            /**< Bytes in the output buffer */
+	size_t pending_out;            /**< Bytes drained from the buffer */
+	
+	size_t sym_next;               /**< Symbols in the block */
+	uint32_t litlen_freq[LITLEN_CODES];
+	uint32_t dist_freq[DIST_CODES];
+	
+	/** Length code of a length (minus MIN_MATCH) */
+	uint8_t len_code[256];
+	/** Distance code of a distance (minus one, compressed above 256) */
+	uint8_t dist_code[512];
+	
+	huffman_code_t fixed_litlen[LITLEN_CODES];  /**< Fixed codes */
+	huffman_code_t fixed_dist[DIST_CODES];      /**< Fixed codes */
+	
+	uint16_t head[HASH_SIZE];      /**< Hash chain heads */
+	uint16_t prev[WSIZE];          /**< Hash chain links */
+	
+	uint16_t sym_dist[SYM_BUFSIZE];  /**< Match distances (0 for literals) */
+	uint8_t sym_lc[SYM_BUFSIZE];     /**< Literals or match lengths */
+	
+	uint8_t window[2 * WSIZE];     /**< Sliding window */
+	uint8_t pending[PENDING_SIZE]; /**< Output buffer */
+};
+
+/** Write bits to the output buffer
+ *
+ * @param stream Deflate stream.
+ * @param value  Bits (LSB first).
+ * @param count  Number of bits (at most 16).
+ *
+ */
+static inline void bits_put(deflate_stream_t *stream, uint32_t value,
+    unsigned int count)
+{
+	stream->bitbuf |= (uint64_t) value << stream->bitcnt;
+	stream->bitcnt += count;
+	
+	if (stream->bitcnt >= 32) {
+		uint8_t *dst = stream->pending + stream->pending_len;
+		
+		dst[0] = stream->bitbuf;
+		dst[1] = stream->bitbuf >> 8;
+		dst[2] = stream->bitbuf >> 16;
+		dst[3] = stream->bitbuf >> 24;
+		
+		stream->pending_len += 4;
+		stream->bitbuf >>= 32;
+		stream->bitcnt -= 32;
+	}
+}
+
+/** Pad the output to a byte boundary and write out all bits
+ *
+ * @param stream Deflate stream.
+ *
+ */
+static void bits_align(deflate_stream_t *stream)
+{
+	while (stream->bitcnt > 0) {
+		stream->pending[stream->pending_len++] = stream->bitbuf;
+		stream->bitbuf >>= 8;
+		stream->bitcnt = (stream->bitcnt > 8) ? stream->bitcnt - 8 : 0;
+	}
+	
+	stream->bitbuf = 0;
+}
+
+/** Reverse the order of code bits
+ *
+ */
+static uint16_t bits_reverse(uint16_t code, unsigned int len)
+{
+	uint16_t res = 0;
+	
+	for (unsigned int i = 0; i < len; i++) {
+		res = (res << 1) | (code & 1);
+		code >>= 1;
+	}
+	
+	return res;
+}
+
+/** Compare Huffman symbols by frequency (for qsort) */
+static int huffman_sym_cmp(const void *a, const void *b)
+{
+	const huffman_sym_t *sa = (const huffman_sym_t *) a;
+	const huffman_sym_t *sb = (const huffman_sym_t *) b;
+	
+	if (sa->key != sb->key)
+		return (sa->key < sb->key) ? -1 : 1;
+	
+	return (int) sa->sym - (int) sb->sym;
+}
+
+/** Compute code lengths of a minimum redundancy code
+ *
+ * In-place algorithm of Moffat and Katajainen. On input, the keys are
+ * the frequencies sorted in ascending order, on output they are the
+ * code lengths.
+ *
+ */
+static void huffman_minimum_redundancy(huffman_sym_t *syms, int count)
+{
+	if (count == 1) {
+		syms[0].key = 1;
+		return;
+	}
+	
+	syms[0].key += syms[1].key;
+	int root = 0;
+	int leaf = 2;
+	
+	for (int next = 1; next < count - 1; next++) {
+		if ((leaf >= count) || (syms[root].key < syms[leaf].key)) {
+			syms[next].key = syms[root].key;
+			syms[root++].key = next;
+		} else
+			syms[next].key = syms[leaf++].key;
+		
+		if ((leaf >= count) ||
+		    ((root < next) && (syms[root].key < syms[leaf].key))) {
+			syms[next].key += syms[root].key;
+			syms[root++].key = next;
+		} else
+			syms[next].key += syms[leaf++].key;
+	}
+	
+	syms[count - 2].key = 0;
+	for (int next = count - 3; next >= 0; next--)
+		syms[next].key = syms[syms[next].key].key + 1;
+	
+	int avail = 1;
+	int used = 0;
+	uint32_t depth = 0;
+	root = count - 2;
+	int next = count - 1;
+	
+	while (avail > 0) {
+		while ((root >= 0) && (syms[root].key == depth)) {
+			used++;
+			root--;
+		}
+		
+		while (avail > used) {
+			syms[next--].key = depth;
+			avail--;
+		}
+		
+		avail = 2 * used;
+		depth++;
+		used = 0;
+	}
+}
+
+/** Build a length-limited canonical Huffman code
+ *
+ * At least two symbols get a code, so that the code is complete
+ * even if fewer symbols are used.
+ *
+ * @param freq  Symbol frequencies.
+ * @param count Number of symbols.
+ * @param limit Maximum code length.
+ * @param codes Resulting codes.
+ *
+ */
+static void huffman_build(const uint32_t *freq, size_t count,
+    unsigned int limit, huffman_code_t *codes)
+{
+	huffman_sym_t syms[LITLEN_CODES];
+	unsigned int nums[MAX_BITS + 1];
+	size_t used = 0;
+	
+	for (size_t i = 0; i < count; i++) {
+		codes[i].len = 0;
+		codes[i].code = 0;
+		
+		if (freq[i] > 0) {
+			syms[used].key = freq[i];
+			syms[used].sym = i;
+			used++;
+		}
+	}
+	
+	/* Make sure there are at least two codes */
+	for (size_t i = 0; (used < 2) && (i < count); i++) {
+		if (freq[i] == 0) {
+			syms[used].key = 1;
+			syms[used].sym = i;
+			used++;
+		}
+	}
+	
+	qsort(syms, used, sizeof(huffman_sym_t), huffman_sym_cmp);
+	huffman_minimum_redundancy(syms, used);
+	
+	/* Limit the code lengths while keeping the code complete */
+	memset(nums, 0, sizeof(nums));
+	for (size_t i = 0; i < used; i++)
+		nums[(syms[i].key > limit) ? limit : syms[i].key]++;
+	
+	uint32_t total = 0;
+	for (unsigned int len = limit; len > 0; len--)
+		total += nums[len] << (limit - len);
+	
+	while (total != (UINT32_C(1) << limit)) {
+		nums[limit]--;
+		for (unsigned int len = limit - 1; len > 0; len--) {
+			if (nums[len] != 0) {
+				nums[len]--;
+				nums[len + 1] += 2;
+				break;
+			}
+		}
+		
+		total--;
+	}
+	
+	/* The most frequent symbols get the shortest codes */
+	size_t j = used;
+	for (unsigned int len = 1; len <= limit; len++) {
+		for (unsigned int k = nums[len]; k > 0; k--)
+			codes[syms[--j].sym].len = len;
+	}
+	
+	/* Assign canonical codes */
+	uint16_t next_code[MAX_BITS + 1];
+	uint16_t code = 0;
+	
+	memset(nums, 0, sizeof(nums));
+	for (size_t i = 0; i < count; i++)
+		nums[codes[i].len]++;
+	
+	nums[0] = 0;
+	for (unsigned int len = 1; len <= MAX_BITS; len++) {
+		code = (code + nums[len - 1]) << 1;
+		next_code[len] = code;
+	}
+	
+	for (size_t i = 0; i < count; i++) {
+		unsigned int len = codes[i].len;
+		if (len != 0)
+			codes[i].code = bits_reverse(next_code[len]++, len);
+	}
+}
+
+/** Build the fixed Huffman codes
+ *
+ */
+static void huffman_fixed(huffman_code_t *litlen, huffman_code_t *dist)
+{
+	for (size_t i = 0; i < LITLEN_CODES; i++) {
+		if (i < 144)
+			litlen[i].len = 8;
+		else if (i < 256)
+			litlen[i].len = 9;
+		else if (i < 280)
+			litlen[i].len = 7;
+		else
+			litlen[i].len = 8;
+	}
+	
+	/* Canonical codes from the lengths */
+	uint16_t next_code[MAX_BITS + 1];
+	unsigned int nums[MAX_BITS + 1];
+	uint16_t code = 0;
+	
+	memset(nums, 0, sizeof(nums));
+	for (size_t i = 0; i < LITLEN_CODES; i++)
+		nums[litlen[i].len]++;
+	
+	for (unsigned int len = 1; len <= MAX_BITS; len++) {
+		code = (code + nums[len - 1]) << 1;
+		next_code[len] = code;
+	}
+	
+	for (size_t i = 0; i < LITLEN_CODES; i++)
+		litlen[i].code = bits_reverse(next_code[litlen[i].len]++,
+		    litlen[i].len);
+	
+	for (size_t i = 0; i < DIST_CODES; i++) {
+		dist[i].len = 5;
+		dist[i].code = bits_reverse(i, 5);
+	}
+}
+
+/** Insert a position into the hash chains
+ *
+ * @param stream Deflate stream.
+ * @param pos    Window position (with at least MIN_MATCH bytes).
+ *
+ * @return Previous position with the same hash (0 if none).
+ *
+ */
+static inline size_t hash_insert(deflate_stream_t *stream, size_t pos)
+{
+	const uint8_t *data = stream->window + pos;
+	uint32_t val = data[0] | (data[1] << 8) | (data[2] << 16);
+	uint32_t hash = (val * UINT32_C(2654435761)) >> (32 - HASH_BITS);
+	
+	size_t head = stream->head[hash];
+	stream->prev[pos & WMASK] = head;
+	stream->head[hash] = pos;
+	
+	return head;
+}
+
+/** Find the longest match at the current position
+ *
+ * @param stream   Deflate stream.
+ * @param cur      First position of the hash chain to examine.
+ * @param best_len Length of a match to improve on.
+ *
+ * @return Length of the longest match, its position is stored in
+ *         match_start if it is longer than best_len.
+ *
+ */
+static size_t longest_match(deflate_stream_t *stream, size_t cur,
+    size_t best_len)
+{
+	const level_config_t *config = stream->config;
+	const uint8_t *scan = stream->window + stream->strstart;
+	
+	size_t max = (stream->lookahead < MAX_MATCH) ?
+	    stream->lookahead : MAX_MATCH;
+	size_t nice = (config->nice_length < max) ? config->nice_length : max;
+	size_t limit = (stream->strstart > MAX_DIST) ?
+	    stream->strstart - MAX_DIST : 0;
+	unsigned int chain = config->max_chain;
+	
+	if (best_len >= max)
+		return best_len;
+	
+	/* A good match was already found, do not try too hard */
+	if (best_len >= config->good_length)
+		chain >>= 2;
+	
+	do {
+		const uint8_t *match = stream->window + cur;
+		
+		if ((match[best_len] != scan[best_len]) ||
+		    (match[best_len - 1] != scan[best_len - 1]) ||
+		    (match[0] != scan[0]) || (match[1] != scan[1]))
+			continue;
+		
+		size_t len = 2;
+		
+		while (len + 8 <= max) {
+			if (load_uint64(scan + len) != load_uint64(match + len))
+				break;
+			
+			len += 8;
+		}
+		
+		while ((len < max) && (match[len] == scan[len]))
+			len++;
+		
+		if (len > best_len) {
+			stream->match_start = cur;
+			best_len = len;
+			
+			if (len >= nice)
+				break;
+		}
+	} while (((cur = stream->prev[cur & WMASK]) > limit) && (--chain != 0));
+	
+	return best_len;
+}
+
+/** Record a literal in the block
+ *
+ * @return True if the symbol buffer is full.
+ *
+ */
+static inline bool tally_literal(deflate_stream_t *stream, uint8_t lit)
+{
+	stream->sym_dist[stream->sym_next] = 0;
+	stream->sym_lc[stream->sym_next] = lit;
+	stream->sym_next++;
+	stream->litlen_freq[lit]++;
+	
+	return (stream->sym_next == SYM_BUFSIZE);
+}
+
+/** Distance code of a distance minus one */
+static inline uint8_t dist_code(deflate_stream_t *stream, size_t dist)
+{
+	return (dist < 256) ? stream->dist_code[dist] :
+	    stream->dist_code[256 + (dist >> 7)];
+}
+
+/** Record a match in the block
+ *
+ * @return True if the symbol buffer is full.
+ *
+ */
+static inline bool tally_match(deflate_stream_t *stream, size_t dist,
+    size_t len)
+{
+	stream->sym_dist[stream->sym_next] = dist;
+	stream->sym_lc[stream->sym_next] = len - MIN_MATCH;
+	stream->sym_next++;
+	stream->litlen_freq[END_BLOCK + 1 +
+	    stream->len_code[len - MIN_MATCH]]++;
+	stream->dist_freq[dist_code(stream, dist - 1)]++;
+	
+	return (stream->sym_next == SYM_BUFSIZE);
+}
+
+/** Run-length encode code lengths
+ *
+ * @param lens  Code lengths.
+ * @param count Number of code lengths.
+ * @param sym   Resulting code length symbols.
+ * @param extra Extra bits of the code length symbols.
+ *
+ * @return Number of code length symbols.
+ *
+ */
+static size_t lengths_rle(const uint8_t *lens, size_t count, uint8_t *sym,
+    uint8_t *extra)
+{
+	size_t cnt = 0;
+	size_t i = 0;
+	
+	while (i < count) {
+		uint8_t len = lens[i];
+		size_t run = 1;
+		
+		while ((i + run < count) && (lens[i + run] == len))
+			run++;
+		
+		i += run;
+		
+		if (len == 0) {
+			while (run >= 11) {
+				size_t rep = (run < 138) ? run : 138;
+				sym[cnt] = REPZ_11_138;
+				extra[cnt++] = rep - 11;
+				run -= rep;
+			}
+			
+			if (run >= 3) {
+				sym[cnt] = REPZ_3_10;
+				extra[cnt++] = run - 3;
+				run = 0;
+			}
+		} else {
+			sym[cnt] = len;
+			extra[cnt++] = 0;
+			run--;
+			
+			while (run >= 3) {
+				size_t rep = (run < 6) ? run : 6;
+				sym[cnt] = REP_3_6;
+				extra[cnt++] = rep - 3;
+				run -= rep;
+			}
+		}
+		
+		while (run > 0) {
+			sym[cnt] = len;
+			extra[cnt++] = 0;
+			run--;
+		}
+	}
+	
+	return cnt;
+}
+
+/** Number of extra bits of a code length symbol */
+static unsigned int cl_extra(uint8_t sym)
+{
+	switch (sym) {
+	case REP_3_6:
+		return 2;
+	case REPZ_3_10:
+		return 3;
+	case REPZ_11_138:
+		return 7;
+	default:
+		return 0;
+	}
+}
+
+/** Compute the size of the block data coded with given codes
+ *
+ * @return Size in bits (without the block header).
+ *
+ */
+static uint64_t block_cost(deflate_stream_t *stream,
+    const huffman_code_t *litlen, const huffman_code_t *dist)
+{
+	uint64_t bits = 0;
+	
+	for (size_t i = 0; i <= END_BLOCK; i++)
+		bits += (uint64_t) stream->litlen_freq[i] * litlen[i].len;
+	
+	for (size_t i = 0; i < sizeof(len_base); i++)
+		bits += (uint64_t) stream->litlen_freq[END_BLOCK + 1 + i] *
+		    (litlen[END_BLOCK + 1 + i].len + len_extra[i]);
+	
+	for (size_t i = 0; i < sizeof(dist_extra); i++)
+		bits += (uint64_t) stream->dist_freq[i] *
+		    (dist[i].len + dist_extra[i]);
+	
+	return bits;
+}
+
+/** Write the symbols of the block
+ *
+ */
+static void block_write(deflate_stream_t *stream,
+    const huffman_code_t *litlen, const huffman_code_t *dist)
+{
+	for (size_t i = 0; i < stream->sym_next; i++) {
+		size_t dst = stream->sym_dist[i];
+		uint8_t lc = stream->sym_lc[i];
+		
+		if (dst == 0) {
+			bits_put(stream, litlen[lc].code, litlen[lc].len);
+			continue;
+		}
+		
+		uint8_t code = stream->len_code[lc];
+		bits_put(stream, litlen[END_BLOCK + 1 + code].code,
+		    litlen[END_BLOCK + 1 + code].len);
+		if (len_extra[code] != 0)
+			bits_put(stream, lc - len_base[code], len_extra[code]);
+		
+		dst--;
+		code = dist_code(stream, dst);
+		bits_put(stream, dist[code].code, dist[code].len);
+		if (dist_extra[code] != 0)
+			bits_put(stream, dst - (dist_base[code] - 1),
+			    dist_extra[code]);
+	}
+	
+	bits_put(stream, litlen[END_BLOCK].code, litlen[END_BLOCK].len);
+}
+
+/** Write a stored block
+ *
+ * Blocks longer than the maximum payload are split.
+ *
+ */
+static void block_write_stored(deflate_stream_t *stream, size_t len,
+    bool last)
+{
+	const uint8_t *data = stream->window + stream->block_start;
+	
+	do {
+		size_t chunk = (len < MAX_STORED) ? len : MAX_STORED;
+		
+		bits_put(stream, ((last) && (chunk == len)) ? 1 : 0, 3);
+		bits_align(stream);
+		
+		uint8_t *dst = stream->pending + stream->pending_len;
+		dst[0] = chunk;
+		dst[1] = chunk >> 8;
+		dst[2] = ~chunk;
+		dst[3] = ~chunk >> 8;
+		memcpy(dst + 4, data, chunk);
+		
+		stream->pending_len += chunk + 4;
+		data += chunk;
+		len -= chunk;
+	} while (len > 0);
+}
+
+/** Emit the current block
+ *
+ * The block is coded in the shortest of the dynamic Huffman,
+ * fixed Huffman and stored forms.
+ *
+ * @param stream Deflate stream.
+ * @param last   Whether this is the last block of the stream.
+ *
+ */
+static void deflate_emit_block(deflate_stream_t *stream, bool last)
+{
+	size_t end = stream->strstart - (stream->match_available ? 1 : 0);
+	size_t stored_len = end - stream->block_start;
+	size_t chunks = (stored_len + MAX_STORED - 1) / MAX_STORED;
+	uint64_t stored_cost = ((chunks > 0) ? chunks : 1) * (3 + 7 + 32) +
+	    (uint64_t) stored_len * 8;
+	
+	if (stream->config->max_chain == 0) {
+		block_write_stored(stream, stored_len, last);
+		goto reset;
+	}
+	
+	stream->litlen_freq[END_BLOCK]++;
+	
+	/* Dynamic codes */
+	huffman_code_t litlen[LITLEN_CODES];
+	huffman_code_t dist[DIST_CODES];
+	huffman_code_t cl[CL_CODES];
+	
+	huffman_build(stream->litlen_freq, END_BLOCK + 1 + sizeof(len_base),
+	    MAX_BITS, litlen);
+	huffman_build(stream->dist_freq, sizeof(dist_extra), MAX_BITS, dist);
+	
+	size_t hlit = END_BLOCK + 1 + sizeof(len_base);
+	while ((hlit > END_BLOCK + 1) && (litlen[hlit - 1].len == 0))
+		hlit--;
+	
+	size_t hdist = sizeof(dist_extra);
+	while ((hdist > 1) && (dist[hdist - 1].len == 0))
+		hdist--;
+	
+	uint8_t lens[LITLEN_CODES + DIST_CODES];
+	uint8_t rle_sym[LITLEN_CODES + DIST_CODES];
+	uint8_t rle_extra[LITLEN_CODES + DIST_CODES];
+	
+	for (size_t i = 0; i < hlit; i++)
+		lens[i] = litlen[i].len;
+	
+	for (size_t i = 0; i < hdist; i++)
+		lens[hlit + i] = dist[i].len;
+	
+	size_t rle_cnt = lengths_rle(lens, hlit + hdist, rle_sym, rle_extra);
+	
+	uint32_t cl_freq[CL_CODES];
+	memset(cl_freq, 0, sizeof(cl_freq));
+	for (size_t i = 0; i < rle_cnt; i++)
+		cl_freq[rle_sym[i]]++;
+	
+	huffman_build(cl_freq, CL_CODES, MAX_CL_BITS, cl);
+	
+	size_t hclen = CL_CODES;
+	while ((hclen > 4) && (cl[cl_order[hclen - 1]].len == 0))
+		hclen--;
+	
+	uint64_t dynamic_cost = 3 + 5 + 5 + 4 + 3 * hclen +
+	    block_cost(stream, litlen, dist);
+	for (size_t i = 0; i < rle_cnt; i++)
+		dynamic_cost += cl[rle_sym[i]].len + cl_extra(rle_sym[i]);
+	
+	uint64_t fixed_cost = 3 + block_cost(stream, stream->fixed_litlen,
+	    stream->fixed_dist);
+	
+	if ((stored_cost <= fixed_cost) && (stored_cost <= dynamic_cost)) {
+		block_write_stored(stream, stored_len, last);
+	} else if (fixed_cost <= dynamic_cost) {
+		bits_put(stream, (last ? 1 : 0) | (1 << 1), 3);
+		block_write(stream, stream->fixed_litlen, stream->fixed_dist);
+	} else {
+		bits_put(stream, (last ? 1 : 0) | (2 << 1), 3);
+		bits_put(stream, hlit - 257, 5);
+		bits_put(stream, hdist - 1, 5);
+		bits_put(stream, hclen - 4, 4);
+		
+		for (size_t i = 0; i < hclen; i++)
+			bits_put(stream, cl[cl_order[i]].len, 3);
+		
+		for (size_t i = 0; i < rle_cnt; i++) {
+			bits_put(stream, cl[rle_sym[i]].code, cl[rle_sym[i]].len);
+			if (cl_extra(rle_sym[i]) != 0)
+				bits_put(stream, rle_extra[i], cl_extra(rle_sym[i]));
+		}
+		
+		block_write(stream, litlen, dist);
+	}
+	
+reset:
+	stream->block_start = end;
+	stream->sym_next = 0;
+	memset(stream->litlen_freq, 0, sizeof(stream->litlen_freq));
+	memset(stream->dist_freq, 0, sizeof(stream->dist_freq));
+	
+	if (last) {
+		bits_align(stream);
+		stream->done = true;
+	}
+}
+
+/** Check whether the block has to be emitted before the window slides
+ *
+ * The data of the block is kept in the window so that the block
+ * can always be stored.
+ *
+ */
+static inline bool deflate_must_emit(deflate_stream_t *stream)
+{
+	return (stream->strstart >= SLIDE_AT) && (stream->block_start < WSIZE);
+}
+
+/** Compress without compression
+ *
+ * @param stream Deflate stream.
+ * @param flush  Whether no more input follows the lookahead.
+ *
+ * @return False if all input was consumed and the stream can be
+ *         finished, true if the caller has to drain or feed more.
+ *
+ */
+static bool deflate_stored(deflate_stream_t *stream, bool flush)
+{
+	while (true) {
+		if (deflate_must_emit(stream)) {
+			deflate_emit_block(stream, false);
+			return true;
+		}
+		
+		if (stream->lookahead == 0)
+			return !flush;
+		
+		size_t room = MAX_STORED - (stream->strstart - stream->block_start);
+		size_t len = (stream->lookahead < room) ? stream->lookahead : room;
+		
+		stream->strstart += len;
+		stream->lookahead -= len;
+		
+		if (len == room) {
+			deflate_emit_block(stream, false);
+			return true;
+		}
+	}
+}
+
+/** Compress with greedy matching
+ *
+ * @param stream Deflate stream.
+ * @param flush  Whether no more input follows the lookahead.
+ *
+ * @return False if all input was consumed and the stream can be
+ *         finished, true if the caller has to drain or feed more.
+ *
+ */
+static bool deflate_greedy(deflate_stream_t *stream, bool flush)
+{
+	while (true) {
+		if (deflate_must_emit(stream)) {
+			deflate_emit_block(stream, false);
+			return true;
+		}
+		
+		if ((stream->lookahead < MIN_LOOKAHEAD) && (!flush))
+			return true;
+		
+		if (stream->lookahead == 0)
+			return false;
+		
+		size_t hash_head = 0;
+		if (stream->lookahead >= MIN_MATCH)
+			hash_head = hash_insert(stream, stream->strstart);
+		
+		size_t len = 0;
+		if ((hash_head != 0) && (stream->strstart - hash_head <= MAX_DIST))
+			len = longest_match(stream, hash_head, MIN_MATCH - 1);
+		
+		bool full;
+		
+		if (len >= MIN_MATCH) {
+			full = tally_match(stream,
+			    stream->strstart - stream->match_start, len);
+			stream->lookahead -= len;
+			
+			if ((len <= stream->config->max_lazy) &&
+			    (stream->lookahead >= MIN_MATCH)) {
+				/* Insert the positions covered by the match */
+				len--;
+				do {
+					stream->strstart++;
+					hash_insert(stream, stream->strstart);
+				} while (--len != 0);
+				
+				stream->strstart++;
+			} else
+				stream->strstart += len;
+		} else {
+			full = tally_literal(stream,
+			    stream->window[stream->strstart]);
+			stream->strstart++;
+			stream->lookahead--;
+		}
+		
+		if (full) {
+			deflate_emit_block(stream, false);
+			return true;
+		}
+	}
+}
+
+/** Compress with lazy matching
+ *
+ * A match is emitted only if the match at the next position
+ * is not longer.
+ *
+ * @param stream Deflate stream.
+ * @param flush  Whether no more input follows the lookahead.
+ *
+ * @return False if all input was consumed and the stream can be
+ *         finished, true if the caller has to drain or feed more.
+ *
+ */
+static bool deflate_lazy(deflate_stream_t *stream, bool flush)
+{
+	while (true) {
+		if (deflate_must_emit(stream)) {
+			deflate_emit_block(stream, false);
+			return true;
+		}
+		
+		if ((stream->lookahead < MIN_LOOKAHEAD) && (!flush))
+			return true;
+		
+		if (stream->lookahead == 0)
+			return false;
+		
+		size_t hash_head = 0;
+		if (stream->lookahead >= MIN_MATCH)
+			hash_head = hash_insert(stream, stream->strstart);
+		
+		stream->prev_length = stream->match_length;
+		stream->prev_dist = stream->match_dist;
+		stream->match_length = MIN_MATCH - 1;
+		
+		if ((hash_head != 0) &&
+		    (stream->prev_length < stream->config->max_lazy) &&
+		    (stream->strstart - hash_head <= MAX_DIST)) {
+			size_t len = longest_match(stream, hash_head,
+			    stream->prev_length);
+			
+			if (len > stream->prev_length) {
+				stream->match_length = len;
+				stream->match_dist =
+				    stream->strstart - stream->match_start;
+				
+				if ((len == MIN_MATCH) &&
+				    (stream->match_dist > TOO_FAR))
+					stream->match_length = MIN_MATCH - 1;
+			}
+		}
+		
+		if ((stream->prev_length >= MIN_MATCH) &&
+		    (stream->match_length <= stream->prev_length)) {
+			/* Emit the match of the previous position */
+			size_t max_insert = stream->strstart + stream->lookahead -
+			    MIN_MATCH;
+			bool full = tally_match(stream, stream->prev_dist,
+			    stream->prev_length);
+			
+			stream->lookahead -= stream->prev_length - 1;
+			
+			size_t len = stream->prev_length - 2;
+			do {
+				if (++stream->strstart <= max_insert)
+					hash_insert(stream, stream->strstart);
+			} while (--len != 0);
+			
+			stream->match_available = false;
+			stream->match_length = MIN_MATCH - 1;
+			stream->strstart++;
+			
+			if (full) {
+				deflate_emit_block(stream, false);
+				return true;
+			}
+		} else if (stream->match_available) {
+			/* Emit the previous position as a literal */
+			bool full = tally_literal(stream,
+			    stream->window[stream->strstart - 1]);
+			
+			stream->strstart++;
+			stream->lookahead--;
+			
+			if (full) {
+				deflate_emit_block(stream, false);
+				return true;
+			}
+		} else {
+			/* Defer the decision to the next position */
+			stream->match_available = true;
+			stream->strstart++;
+			stream->lookahead--;
+		}
+	}
+}
+
+/** Fill the window from the input
+ *
+ * Slides the window if the current position is too close to its end.
+ *
+ */
+static void deflate_fill(deflate_stream_t *stream)
+{
+	if ((stream->strstart >= SLIDE_AT) && (stream->block_start >= WSIZE)) {
+		memmove(stream->window, stream->window + WSIZE, WSIZE);
+		stream->strstart -= WSIZE;
+		stream->block_start -= WSIZE;
+		
+		for (size_t i = 0; i < HASH_SIZE; i++)
+			stream->head[i] = (stream->head[i] >= WSIZE) ?
+			    stream->head[i] - WSIZE : 0;
+		
+		for (size_t i = 0; i < WSIZE; i++)
+			stream->prev[i] = (stream->prev[i] >= WSIZE) ?
+			    stream->prev[i] - WSIZE : 0;
+	}
+	
+	size_t pos = stream->strstart + stream->lookahead;
+	size_t len = stream->srclen - stream->srccnt;
+	
+	if (len > 2 * WSIZE - pos)
+		len = 2 * WSIZE - pos;
+	
+	if (len > 0) {
+		memcpy(stream->window + pos, stream->src + stream->srccnt, len);
+		stream->srccnt += len;
+		stream->lookahead += len;
+	}
+}
+
+/** Compress the input available in the window
+ *
+ * Stops after a block was emitted or when more input is needed.
+ *
+ */
+static void deflate_compress(deflate_stream_t *stream)
+{
+	bool flush = (stream->finish) && (stream->srccnt == stream->srclen);
+	bool more;
+	
+	if (stream->config->max_chain == 0)
+		more = deflate_stored(stream, flush);
+	else if (stream->config->lazy)
+		more = deflate_lazy(stream, flush);
+	else
+		more = deflate_greedy(stream, flush);
+	
+	if (more)
+		return;
+	
+	if (stream->match_available) {
+		tally_literal(stream, stream->window[stream->strstart - 1]);
+		stream->match_available = false;
+	}
+	
+	deflate_emit_block(stream, true);
+}
+
+/** Compute the maximum size of compressed data
+ *
+ * @param srclen Size of the data to compress (bytes).
+ *
+ * @return Upper bound of the size of the deflate stream (bytes).
+ *
+ */
+size_t deflate_bound(size_t srclen)
+{
+	/* Blocks are at least 16 KiB, with a few bytes of overhead each */
+	return srclen + srclen / 1024 + 64;
+}
+
+/** Compress data
+ *
+ * @param src     Source data buffer.
+ * @param srclen  Source buffer size (bytes).
+ * @param dest    Destination data buffer.
+ * @param destlen Destination buffer size (bytes).
+ * @param level   Compression level (0 to 9).
+ * @param size    Place to store the size of the compressed data.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory or on output buffer overrun
+ *         (a buffer of deflate_bound() bytes is always sufficient).
+ *
+ */
+errno_t deflate(const void *src, size_t srclen, void *dest, size_t destlen,
+    int level, size_t *size)
+{
+	deflate_stream_t *stream;
+	
+	errno_t rc = deflate_stream_create(level, &stream);
+	if (rc != EOK)
+		return rc;
+	
+	deflate_stream_feed(stream, src, srclen);
+	deflate_stream_finish(stream);
+	
+	rc = deflate_stream_drain(stream, dest, destlen, size);
+	if ((rc == EOK) && (!deflate_stream_done(stream)))
+		rc = ENOMEM;
+	
+	deflate_stream_destroy(stream);
+	return rc;
+}
+
+/** Create a deflate stream
+ *
+ * The stream compresses data fed to it in chunks of arbitrary size,
+ * the output can be drained in chunks of arbitrary size.
+ *
+ * @param level  Compression level (DEFLATE_LEVEL_STORE to
+ *               DEFLATE_LEVEL_BEST).
+ * @param stream Place to store the new stream.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t deflate_stream_create(int level, deflate_stream_t **stream)
+{
+	if ((level < DEFLATE_LEVEL_STORE) || (level > DEFLATE_LEVEL_BEST))
+		return EINVAL;
+	
+	deflate_stream_t *s = malloc(sizeof(deflate_stream_t));
+	if (s == NULL)
+		return ENOMEM;
+	
+	s->config = &level_config[level];
+	s->done = false;
+	s->finish = false;
+	
+	s->src = NULL;
+	s->srclen = 0;
+	s->srccnt = 0;
+	
+	s->strstart = 0;
+	s->lookahead = 0;
+	s->block_start = 0;
+	s->match_start = 0;
+	s->match_length = MIN_MATCH - 1;
+	s->match_dist = 0;
+	s->prev_length = MIN_MATCH - 1;
+	s->prev_dist = 0;
+	s->match_available = false;
+	
+	s->bitbuf = 0;
+	s->bitcnt = 0;
+	s->pending_len = 0;
+	s->pending_out = 0;
+	
+	s->sym_next = 0;
+	memset(s->litlen_freq, 0, sizeof(s->litlen_freq));
+	memset(s->dist_freq, 0, sizeof(s->dist_freq));
+	memset(s->head, 0, sizeof(s->head));
+	memset(s->prev, 0, sizeof(s->prev));
+	
+	for (size_t code = 0; code < sizeof(len_base) - 1; code++) {
+		for (size_t i = 0; i < (1U << len_extra[code]); i++)
+			s->len_code[len_base[code] + i] = code;
+	}
+	
+	/* Length 258 has a code of its own */
+	s->len_code[MAX_MATCH - MIN_MATCH] = sizeof(len_base) - 1;
+	
+	for (size_t code = 0; code < 16; code++) {
+		for (size_t i = 0; i < (1U << dist_extra[code]); i++)
+			s->dist_code[dist_base[code] - 1 + i] = code;
+	}
+	
+	for (size_t code = 16; code < sizeof(dist_extra); code++) {
+		for (size_t i = 0; i < (1U << (dist_extra[code] - 7)); i++)
+			s->dist_code[256 + ((dist_base[code] - 1) >> 7) + i] = code;
+	}
+	
+	huffman_fixed(s->fixed_litlen, s->fixed_dist);
+	
+	*stream = s;
+	return EOK;
+}
+
+/** Destroy a deflate stream
+ *
+ * @param stream Deflate stream.
+ *
+ */
+void deflate_stream_destroy(deflate_stream_t *stream)
+{
+	free(stream);
+}
+
+/** Feed input to a deflate stream
+ *
+ * The data is not copied, the buffer must stay valid until the stream
+ * consumes it. The previous input must have been consumed, i.e. the
+ * last deflate_stream_drain() returned less than requested.
+ *
+ * @param stream Deflate stream.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ *
+ */
+void deflate_stream_feed(deflate_stream_t *stream, const void *src,
+    size_t srclen)
+{
+	stream->src = (const uint8_t *) src;
+	stream->srclen = srclen;
+	stream->srccnt = 0;
+}
+
+/** Mark the end of input of a deflate stream
+ *
+ * No more input is fed to the stream after the current one,
+ * the rest of the compressed data can be drained.
+ *
+ * @param stream Deflate stream.
+ *
+ */
+void deflate_stream_finish(deflate_stream_t *stream)
+{
+	stream->finish = true;
+}
+
+/** Drain output from a deflate stream
+ *
+ * Compresses as much of the input as needed to fill the buffer. Less
+ * than requested is returned only if more input is needed or if the
+ * stream is done.
+ *
+ * @param stream  Deflate stream.
+ * @param dest    Destination data buffer.
+ * @param destlen Destination buffer size (bytes).
+ * @param nread   Place to store the number of bytes drained.
+ *
+ * @return EOK on success.
+ *
+ */
+errno_t deflate_stream_drain(deflate_stream_t *stream, void *dest,
+    size_t destlen, size_t *nread)
+{
+	uint8_t *buf = (uint8_t *) dest;
+	size_t done = 0;
+	
+	while (done < destlen) {
+		size_t pending = stream->pending_len - stream->pending_out;
+		if (pending > 0) {
+			size_t len = destlen - done;
+			if (len > pending)
+				len = pending;
+			
+			memcpy(buf + done, stream->pending + stream->pending_out,
+			    len);
+			stream->pending_out += len;
+			done += len;
+			continue;
+		}
+		
+		stream->pending_len = 0;
+		stream->pending_out = 0;
+		
+		if (stream->done)
+			break;
+		
+		deflate_fill(stream);
+		deflate_compress(stream);
+		
+		/* Nothing was emitted and all input is in the window */
+		if ((stream->pending_len == 0) &&
+		    (stream->srccnt == stream->srclen))
+			break;
+	}
+	
+	*nread = done;
+	return EOK;
+}
+
+/** Check whether a deflate stream is done
+ *
+ * @param stream Deflate stream.
+ *
+ * @return True if the last block was emitted and all output drained.
+ *
+ */
+bool deflate_stream_done(deflate_stream_t *stream)
+{
+	return (stream->done) && (stream->pending_out == stream->pending_len);
+}
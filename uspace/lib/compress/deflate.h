@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBCOMPRESS_DEFLATE_H_
+#define LIBCOMPRESS_DEFLATE_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Store the data without compression */
+#define DEFLATE_LEVEL_STORE    0
+/** Fastest compression (greedy matching with short hash chains) */
+#define DEFLATE_LEVEL_FAST     1
+/** Default trade-off between speed and compression ratio */
+#define DEFLATE_LEVEL_DEFAULT  6
+/** Best compression (lazy matching with long hash chains) */
+#define DEFLATE_LEVEL_BEST     9
+
+/** Incremental deflate stream */
+typedef struct deflate_stream deflate_stream_t;
+
+extern size_t deflate_bound(size_t);
+extern errno_t deflate(const void *, size_t, void *, size_t, int, size_t *);
+
+extern errno_t deflate_stream_create(int, deflate_stream_t **);
+extern void deflate_stream_destroy(deflate_stream_t *);
+extern void deflate_stream_feed(deflate_stream_t *, const void *, size_t);
+extern void deflate_stream_finish(deflate_stream_t *);
+extern errno_t deflate_stream_drain(deflate_stream_t *, void *, size_t,
+    size_t *);
+extern bool deflate_stream_done(deflate_stream_t *);
+
+#endif
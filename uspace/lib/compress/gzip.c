@@ -32,6 +32,8 @@
 #include <mem.h>
 #include <byteorder.h>
 #include <stdlib.h>
+#include <adt/checksum.h>
+#include "deflate.h"
 #include "gzip.h"
 #include "inflate.h"
 
@@ -46,6 +48,11 @@
 #define GZIP_FLAG_FNAME     UINT8_C(1 << 3)
 #define GZIP_FLAG_FCOMMENT  UINT8_C(1 << 4)
 
+#define GZIP_XFL_BEST     UINT8_C(2)
+#define GZIP_XFL_FASTEST  UINT8_C(4)
+
+#define GZIP_OS_UNKNOWN  UINT8_C(255)
+
 typedef struct {
 	uint8_t id1;
 	uint8_t id2;
@@ -61,6 +68,56 @@ typedef struct {
 	uint32_t size;
 } __attribute__((packed)) gzip_footer_t;
 
+/** Gzip stream decoder state
+ *
+ */
+typedef enum {
+	GZIP_HEADER,        /**< Fixed header */
+	GZIP_EXTRA_LENGTH,  /**< Length of extra field */
+	GZIP_EXTRA,         /**< Extra field */
+	GZIP_NAME,          /**< File name */
+	GZIP_COMMENT,       /**< Comment */
+	GZIP_HCRC,          /**< Header CRC */
+	GZIP_BODY,          /**< Compressed data */
+	GZIP_FOOTER,        /**< Footer */
+	GZIP_DONE           /**< Footer verified */
+} gzip_mode_t;
+
+/** Incremental gzip decompression stream
+ *
+ */
+struct gzip_stream {
+	gzip_mode_t mode;           /**< Decoder state */
+	inflate_stream_t *inflate;  /**< Compressed data decoder */
+	
+	const uint8_t *src;         /**< Input buffer */
+	size_t srclen;              /**< Input buffer size */
+	size_t srccnt;              /**< Position in the input buffer */
+	
+	uint8_t buf[sizeof(gzip_header_t)];  /**< Header or footer bytes */
+	size_t buflen;              /**< Number of bytes in buf */
+	uint8_t flags;              /**< Header flags */
+	size_t skip;                /**< Bytes of extra field left */
+	
+	uint32_t crc32;             /**< CRC of the output so far */
+	uint32_t size;              /**< Size of the output so far */
+};
+
+/** Incremental gzip compression stream
+ *
+ */
+struct gzip_compress_stream {
+	gzip_mode_t mode;           /**< Encoder state */
+	deflate_stream_t *deflate;  /**< Compressed data encoder */
+	
+	uint8_t buf[sizeof(gzip_header_t)];  /**< Header or footer bytes */
+	size_t buflen;              /**< Number of bytes in buf */
+	size_t bufout;              /**< Number of bytes drained from buf */
+	
+	uint32_t crc32;             /**< CRC of the input so far */
+	uint32_t size;              /**< Size of the input so far */
+};
+
 /** Expand GZIP compressed data
  *
  * The routine allocates the output buffer based
@@ -175,9 +232,514 @@ errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
 	
 	errno_t ret = inflate(stream, stream_length, *dest, *destlen);
 	if (ret != EOK) {
-		free(dest);
+		free(*dest);
 		return ret;
 	}
 	
 	return EOK;
 }
+
+/** Create a gzip decompression stream
+ *
+ * @param stream Place to store the new stream.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_stream_create(gzip_stream_t **stream)
+{
+	gzip_stream_t *s = malloc(sizeof(gzip_stream_t));
+	if (s == NULL)
+		return ENOMEM;
+	
+	errno_t rc = inflate_stream_create(&s->inflate);
+	if (rc != EOK) {
+		free(s);
+		return rc;
+	}
+	
+	s->mode = GZIP_HEADER;
+	s->src = NULL;
+	s->srclen = 0;
+	s->srccnt = 0;
+	s->buflen = 0;
+	s->crc32 = 0;
+	s->size = 0;
+	
+	*stream = s;
+	return EOK;
+}
+
+/** Destroy a gzip decompression stream
+ *
+ * @param stream Gzip stream.
+ *
+ */
+void gzip_stream_destroy(gzip_stream_t *stream)
+{
+	inflate_stream_destroy(stream->inflate);
+	free(stream);
+}
+
+/** Feed input to a gzip decompression stream
+ *
+ * The data is not copied, the buffer must stay valid until the stream
+ * consumes it, i.e. until gzip_stream_drain() stops producing output
+ * or the stream is done.
+ *
+ * @param stream Gzip stream.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ *
+ */
+void gzip_stream_feed(gzip_stream_t *stream, const void *src, size_t srclen)
+{
+	if (stream->mode == GZIP_BODY) {
+		inflate_stream_feed(stream->inflate, src, srclen);
+		return;
+	}
+	
+	stream->src = (const uint8_t *) src;
+	stream->srclen = srclen;
+	stream->srccnt = 0;
+}
+
+/** Gather a fixed number of bytes from the input
+ *
+ * @param stream Gzip stream.
+ * @param size   Number of bytes to gather in the buffer.
+ *
+ * @return True if the buffer holds the requested number of bytes.
+ *
+ */
+static bool gzip_stream_gather(gzip_stream_t *stream, size_t size)
+{
+	while ((stream->buflen < size) && (stream->srccnt < stream->srclen)) {
+		stream->buf[stream->buflen] = stream->src[stream->srccnt];
+		stream->buflen++;
+		stream->srccnt++;
+	}
+	
+	return (stream->buflen == size);
+}
+
+/** Skip a zero-terminated string in the input
+ *
+ * @param stream Gzip stream.
+ *
+ * @return True if the terminating zero has been skipped.
+ *
+ */
+static bool gzip_stream_skip_string(gzip_stream_t *stream)
+{
+	while (stream->srccnt < stream->srclen) {
+		if (stream->src[stream->srccnt++] == 0)
+			return true;
+	}
+	
+	return false;
+}
+
+/** Decode the gzip header
+ *
+ * @param stream Gzip stream.
+ *
+ * @return EOK if the header has been decoded.
+ * @return ELIMIT if more input is needed.
+ * @return EINVAL on invalid compression method or invalid stream.
+ *
+ */
+static errno_t gzip_stream_header(gzip_stream_t *stream)
+{
+	gzip_header_t header;
+	uint16_t extra_length;
+	size_t len;
+	
+	while (true) {
+		switch (stream->mode) {
+		case GZIP_HEADER:
+			if (!gzip_stream_gather(stream, sizeof(header)))
+				return ELIMIT;
+			
+			memcpy(&header, stream->buf, sizeof(header));
+			if ((header.id1 != GZIP_ID1) ||
+			    (header.id2 != GZIP_ID2) ||
+			    (header.method != GZIP_METHOD_DEFLATE) ||
+			    ((header.flags & (~GZIP_FLAGS_MASK)) != 0))
+				return EINVAL;
+			
+			stream->flags = header.flags;
+			stream->buflen = 0;
+			stream->mode = GZIP_EXTRA_LENGTH;
+			break;
+		case GZIP_EXTRA_LENGTH:
+			if ((stream->flags & GZIP_FLAG_FEXTRA) != 0) {
+				if (!gzip_stream_gather(stream, sizeof(extra_length)))
+					return ELIMIT;
+				
+				memcpy(&extra_length, stream->buf,
+				    sizeof(extra_length));
+				stream->skip = uint16_t_le2host(extra_length);
+				stream->buflen = 0;
+			} else {
+				stream->skip = 0;
+			}
+			
+			stream->mode = GZIP_EXTRA;
+			break;
+		case GZIP_EXTRA:
+			len = stream->srclen - stream->srccnt;
+			if (len > stream->skip)
+				len = stream->skip;
+			
+			stream->srccnt += len;
+			stream->skip -= len;
+			if (stream->skip > 0)
+				return ELIMIT;
+			
+			stream->mode = GZIP_NAME;
+			break;
+		case GZIP_NAME:
+			if (((stream->flags & GZIP_FLAG_FNAME) != 0) &&
+			    (!gzip_stream_skip_string(stream)))
+				return ELIMIT;
+			
+			stream->mode = GZIP_COMMENT;
+			break;
+		case GZIP_COMMENT:
+			if (((stream->flags & GZIP_FLAG_FCOMMENT) != 0) &&
+			    (!gzip_stream_skip_string(stream)))
+				return ELIMIT;
+			
+			stream->mode = GZIP_HCRC;
+			break;
+		case GZIP_HCRC:
+			if ((stream->flags & GZIP_FLAG_FHCRC) != 0) {
+				if (!gzip_stream_gather(stream, 2))
+					return ELIMIT;
+				
+				stream->buflen = 0;
+			}
+			
+			/* Pass the rest of the input to the decoder */
+			inflate_stream_feed(stream->inflate,
+			    stream->src + stream->srccnt,
+			    stream->srclen - stream->srccnt);
+			stream->srccnt = stream->srclen;
+			stream->mode = GZIP_BODY;
+			break;
+		default:
+			return EOK;
+		}
+	}
+}
+
+/** Drain output from a gzip decompression stream
+ *
+ * Less than requested is returned only if more input is needed
+ * or if the stream is done. Once the compressed data ends, the
+ * CRC and size of the output are checked against the footer.
+ *
+ * @param stream  Gzip stream.
+ * @param dest    Destination data buffer.
+ * @param destlen Destination buffer size (bytes).
+ * @param nread   Place to store the number of bytes drained.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code, invalid deflate data,
+ *                invalid compression method, invalid stream
+ *                or a checksum mismatch.
+ *
+ */
+errno_t gzip_stream_drain(gzip_stream_t *stream, void *dest, size_t destlen,
+    size_t *nread)
+{
+	*nread = 0;
+	
+	errno_t rc = gzip_stream_header(stream);
+	if (rc == ELIMIT)
+		return EOK;
+	
+	if (rc != EOK)
+		return rc;
+	
+	if (stream->mode == GZIP_BODY) {
+		rc = inflate_stream_drain(stream->inflate, dest, destlen,
+		    nread);
+		if (rc != EOK)
+			return rc;
+		
+		stream->crc32 = compute_crc32_seed(dest, *nread, stream->crc32);
+		stream->size += *nread;
+		
+		if (!inflate_stream_done(stream->inflate))
+			return EOK;
+		
+		/* The footer follows the compressed data */
+		stream->buflen = inflate_stream_rest(stream->inflate,
+		    stream->buf, sizeof(gzip_footer_t));
+		stream->src = NULL;
+		stream->srclen = 0;
+		stream->srccnt = 0;
+		stream->mode = GZIP_FOOTER;
+	}
+	
+	if (stream->mode == GZIP_FOOTER) {
+		if (!gzip_stream_gather(stream, sizeof(gzip_footer_t)))
+			return EOK;
+		
+		gzip_footer_t footer;
+		memcpy(&footer, stream->buf, sizeof(footer));
+		
+		if ((uint32_t_le2host(footer.crc32) != stream->crc32) ||
+		    (uint32_t_le2host(footer.size) != stream->size))
+			return EINVAL;
+		
+		stream->mode = GZIP_DONE;
+	}
+	
+	return EOK;
+}
+
+/** Check whether a gzip decompression stream is done
+ *
+ * @param stream Gzip stream.
+ *
+ * @return True if all output was drained and the footer verified.
+ *
+ */
+bool gzip_stream_done(gzip_stream_t *stream)
+{
+	return (stream->mode == GZIP_DONE);
+}
+
+
+/** Fill in a gzip header
+ *
+ * @param header Header to fill in.
+ * @param level  Compression level.
+ *
+ */
+static void gzip_header_init(gzip_header_t *header, int level)
+{
+	header->id1 = GZIP_ID1;
+	header->id2 = GZIP_ID2;
+	header->method = GZIP_METHOD_DEFLATE;
+	header->flags = 0;
+	header->mtime = 0;
+	header->os = GZIP_OS_UNKNOWN;
+	
+	if (level == DEFLATE_LEVEL_BEST)
+		header->extra_flags = GZIP_XFL_BEST;
+	else if (level == DEFLATE_LEVEL_FAST)
+		header->extra_flags = GZIP_XFL_FASTEST;
+	else
+		header->extra_flags = 0;
+}
+
+/** Compress data into GZIP format
+ *
+ * The routine allocates the output buffer.
+ *
+ * @param[in]  src     Source data buffer.
+ * @param[in]  srclen  Source buffer size (bytes), at most 4 GiB.
+ * @param[in]  level   Compression level (0 to 9).
+ * @param[out] dest    Destination data buffer.
+ * @param[out] destlen Destination buffer size (bytes).
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_compress(const void *src, size_t srclen, int level, void **dest,
+    size_t *destlen)
+{
+	gzip_header_t header;
+	gzip_footer_t footer;
+	
+	size_t bound = sizeof(header) + deflate_bound(srclen) + sizeof(footer);
+	uint8_t *buf = malloc(bound);
+	if (buf == NULL)
+		return ENOMEM;
+	
+	gzip_header_init(&header, level);
+	memcpy(buf, &header, sizeof(header));
+	
+	size_t size;
+	errno_t rc = deflate(src, srclen, buf + sizeof(header),
+	    bound - sizeof(header) - sizeof(footer), level, &size);
+	if (rc != EOK) {
+		free(buf);
+		return rc;
+	}
+	
+	footer.crc32 = host2uint32_t_le(compute_crc32((uint8_t *) src, srclen));
+	footer.size = host2uint32_t_le(srclen);
+	memcpy(buf + sizeof(header) + size, &footer, sizeof(footer));
+	
+	*dest = buf;
+	*destlen = sizeof(header) + size + sizeof(footer);
+	return EOK;
+}
+
+/** Create a gzip compression stream
+ *
+ * @param level  Compression level (0 to 9).
+ * @param stream Place to store the new stream.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_compress_stream_create(int level, gzip_compress_stream_t **stream)
+{
+	gzip_compress_stream_t *s = malloc(sizeof(gzip_compress_stream_t));
+	if (s == NULL)
+		return ENOMEM;
+	
+	errno_t rc = deflate_stream_create(level, &s->deflate);
+	if (rc != EOK) {
+		free(s);
+		return rc;
+	}
+	
+	gzip_header_t header;
+	gzip_header_init(&header, level);
+	memcpy(s->buf, &header, sizeof(header));
+	
+	s->mode = GZIP_HEADER;
+	s->buflen = sizeof(header);
+	s->bufout = 0;
+	s->crc32 = 0;
+	s->size = 0;
+	
+	*stream = s;
+	return EOK;
+}
+
+/** Destroy a gzip compression stream
+ *
+ * @param stream Gzip compression stream.
+ *
+ */
+void gzip_compress_stream_destroy(gzip_compress_stream_t *stream)
+{
+	deflate_stream_destroy(stream->deflate);
+	free(stream);
+}
+
+/** Feed input to a gzip compression stream
+ *
+ * The data is not copied, the buffer must stay valid until the stream
+ * consumes it. The previous input must have been consumed, i.e. the
+ * last gzip_compress_stream_drain() returned less than requested.
+ *
+ * @param stream Gzip compression stream.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ *
+ */
+void gzip_compress_stream_feed(gzip_compress_stream_t *stream,
+    const void *src, size_t srclen)
+{
+	stream->crc32 = compute_crc32_seed((uint8_t *) src, srclen,
+	    stream->crc32);
+	stream->size += srclen;
+	
+	deflate_stream_feed(stream->deflate, src, srclen);
+}
+
+/** Mark the end of input of a gzip compression stream
+ *
+ * @param stream Gzip compression stream.
+ *
+ */
+void gzip_compress_stream_finish(gzip_compress_stream_t *stream)
+{
+	deflate_stream_finish(stream->deflate);
+}
+
+/** Drain output from a gzip compression stream
+ *
+ * Less than requested is returned only if more input is needed
+ * or if the stream is done.
+ *
+ * @param stream  Gzip compression stream.
+ * @param dest    Destination data buffer.
+ * @param destlen Destination buffer size (bytes).
+ * @param nread   Place to store the number of bytes drained.
+ *
+ * @return EOK on success.
+ *
+ */
+errno_t gzip_compress_stream_drain(gzip_compress_stream_t *stream,
+    void *dest, size_t destlen, size_t *nread)
+{
+	uint8_t *buf = (uint8_t *) dest;
+	size_t done = 0;
+	
+	while (done < destlen) {
+		size_t pending = stream->buflen - stream->bufout;
+		if (pending > 0) {
+			size_t len = destlen - done;
+			if (len > pending)
+				len = pending;
+			
+			memcpy(buf + done, stream->buf + stream->bufout, len);
+			stream->bufout += len;
+			done += len;
+			continue;
+		}
+		
+		if (stream->mode == GZIP_HEADER)
+			stream->mode = GZIP_BODY;
+		
+		if (stream->mode != GZIP_BODY) {
+			stream->mode = GZIP_DONE;
+			break;
+		}
+		
+		size_t len;
+		errno_t rc = deflate_stream_drain(stream->deflate, buf + done,
+		    destlen - done, &len);
+		if (rc != EOK) {
+			*nread = done;
+			return rc;
+		}
+		
+		done += len;
+		
+		if (!deflate_stream_done(stream->deflate))
+			break;
+		
+		gzip_footer_t footer;
+		footer.crc32 = host2uint32_t_le(stream->crc32);
+		footer.size = host2uint32_t_le(stream->size);
+		
+		memcpy(stream->buf, &footer, sizeof(footer));
+		stream->buflen = sizeof(footer);
+		stream->bufout = 0;
+		stream->mode = GZIP_FOOTER;
+	}
+	
+	*nread = done;
+	return EOK;
+}
+
+/** Check whether a gzip compression stream is done
+ *
+ * @param stream Gzip compression stream.
+ *
+ * @return True if all compressed data including the footer was drained.
+ *
+ */
+bool gzip_compress_stream_done(gzip_compress_stream_t *stream)
+{
+	return (stream->mode == GZIP_DONE) ||
+	    ((stream->mode == GZIP_FOOTER) &&
+	    (stream->bufout == stream->buflen));
+}
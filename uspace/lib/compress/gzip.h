@@ -29,8 +29,32 @@
 #ifndef LIBCOMPRESS_GZIP_H_
 #define LIBCOMPRESS_GZIP_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 
+/** Incremental gzip decompression stream */
+typedef struct gzip_stream gzip_stream_t;
+
+/** Incremental gzip compression stream */
+typedef struct gzip_compress_stream gzip_compress_stream_t;
+
 extern errno_t gzip_expand(void *, size_t, void **, size_t *);
 
+extern errno_t gzip_stream_create(gzip_stream_t **);
+extern void gzip_stream_destroy(gzip_stream_t *);
+extern void gzip_stream_feed(gzip_stream_t *, const void *, size_t);
+extern errno_t gzip_stream_drain(gzip_stream_t *, void *, size_t, size_t *);
+extern bool gzip_stream_done(gzip_stream_t *);
+
+extern errno_t gzip_compress(const void *, size_t, int, void **, size_t *);
+
+extern errno_t gzip_compress_stream_create(int, gzip_compress_stream_t **);
+extern void gzip_compress_stream_destroy(gzip_compress_stream_t *);
+extern void gzip_compress_stream_feed(gzip_compress_stream_t *, const void *,
+    size_t);
+extern void gzip_compress_stream_finish(gzip_compress_stream_t *);
+extern errno_t gzip_compress_stream_drain(gzip_compress_stream_t *, void *,
+    size_t, size_t *);
+extern bool gzip_compress_stream_done(gzip_compress_stream_t *);
+
 #endif
@@ -1,6 +1,7 @@
 /*
  * Copyright (c) 2010 Mark Adler
  * Copyright (c) 2010 Martin Decky
+ * Copyright (c) 2018 HelenOS contributors
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -30,12 +31,20 @@
 /** @file
  * @brief Implementation of inflate decompression
  *
- * A simple inflate implementation (decompression of `deflate' stream as
- * described by RFC 1951) based on puff.c by Mark Adler. This code is
- * currently not optimized for speed but for readability.
+ * An inflate implementation (decompression of `deflate' stream as
+ * described by RFC 1951) originally based on puff.c by Mark Adler.
  *
- * All dynamically allocated memory memory is taken from the stack. The
- * stack usage should be typically bounded by 2 KB.
+ * Huffman codes are decoded by a lookup in a table indexed by the next
+ * bits of the input. Codes longer than the table index fall back to the
+ * canonical bit-by-bit decoding of puff. Pairs of short literal codes are
+ * resolved by a single lookup. Input bits are kept in a 64-bit buffer,
+ * which holds all bits of a length/distance pair after a refill.
+ *
+ * The decoder is resumable: it only consumes bits of a symbol (including
+ * its extra bits) once they are all available and the output has room
+ * for the result. This allows decoding a stream incrementally from input
+ * chunks into a sliding window, as well as in one go from a buffer into
+ * another.
  *
  * Original copyright notice:
  *
@@ -66,9 +75,12 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <mem.h>
+#include <byteorder.h>
 #include "inflate.h"
+#include "load.h"
 
 /** Maximum bits in the Huffman code */
 #define MAX_HUFFMAN_BIT  15
@@ -87,39 +99,124 @@
 /** Number of all codes */
 #define MAX_CODE  (MAX_LITLEN + MAX_DIST)
 
-/** Check for input buffer overrun condition */
-#define CHECK_OVERRUN(state) \
-	do { \
-		if ((state).overrun) \
-			return ELIMIT; \
-	} while (false)
+/** Maximum length of a match */
+#define MAX_MATCH  258
+
+/** Index bits of the literal/length lookup table */
+#define LITLEN_ROOT_BITS  10
+/** Index bits of the distance lookup table */
+#define DIST_ROOT_BITS    8
+/** Index bits of the code length lookup table */
+#define ORDER_ROOT_BITS   7
+
+/** Size of the sliding window of a stream (at least twice 32 KiB) */
+#define WINDOW_SIZE  65536
+
+/** Table entry operations */
+enum {
+	/** Invalid symbol */
+	OP_INVALID = 0,
+	/** Code not resolved by the table, decode it bit by bit */
+	OP_SLOW = 1,
+	/** Literal (val) */
+	OP_LITERAL = 2,
+	/** Two literals (val low and high byte) */
+	OP_LITERAL2 = 3,
+	/** End of block */
+	OP_END = 4,
+	/** Length or distance base (val) with extra bits in the low nibble */
+	OP_BASE = 0x10
+};
+
+/** Huffman lookup table entry
+ *
+ */
+typedef struct {
+	uint8_t op;    /**< Operation */
+	uint8_t bits;  /**< Number of code bits consumed */
+	uint16_t val;  /**< Operation value */
+} huffman_entry_t;
 
+/** Kind of symbols coded by a Huffman code
+ *
+ */
+typedef enum {
+	HUFFMAN_LITLEN,
+	HUFFMAN_DIST,
+	HUFFMAN_ORDER
+} huffman_kind_t;
+
+/** Huffman code description
+ *
+ */
+typedef struct {
+	huffman_kind_t kind;                  /**< Kind of symbols */
+	size_t root_bits;                     /**< Index bits of the table */
+	huffman_entry_t *root;                /**< Lookup table */
+	uint16_t count[MAX_HUFFMAN_BIT + 1];  /**< Array of symbol counts */
+	uint16_t symbol[MAX_FIXED_LITLEN];    /**< Array of symbols */
+} huffman_t;
+
+/** Decoder state
+ *
+ */
+typedef enum {
+	INFLATE_HEADER,         /**< Block header */
+	INFLATE_STORED_LENGTH,  /**< Stored block length */
+	INFLATE_STORED,         /**< Stored block data */
+	INFLATE_TABLE_SIZES,    /**< Dynamic block table sizes */
+	INFLATE_TABLE_ORDER,    /**< Dynamic block code length code */
+	INFLATE_TABLE_LENGTHS,  /**< Dynamic block code lengths */
+	INFLATE_CODES,          /**< Compressed block data */
+	INFLATE_DONE            /**< Last block decoded */
+} inflate_mode_t;
 
 /** Inflate algorithm state
  *
  */
 typedef struct {
-	uint8_t *dest;    /**< Output buffer */
-	size_t destlen;   /**< Output buffer size */
-	size_t destcnt;   /**< Position in the output buffer */
+	inflate_mode_t mode;  /**< Decoder state */
+	bool last;            /**< Decoding the last block */
+	
+	uint8_t *dest;        /**< Output buffer or sliding window */
+	size_t destmask;      /**< Mask of positions in the output buffer */
+	size_t destsize;      /**< Output buffer size */
+	size_t destcnt;       /**< Position in the output */
+	size_t destlimit;     /**< Output position not to be reached */
+	bool destfull;        /**< The whole window holds valid history */
 	
-	uint8_t *src;     /**< Input buffer */
-	size_t srclen;    /**< Input buffer size */
-	size_t srccnt;    /**< Position in the input buffer */
+	const uint8_t *src;   /**< Input buffer */
+	size_t srclen;        /**< Input buffer size */
+	size_t srccnt;        /**< Position in the input buffer */
 	
-	uint16_t bitbuf;  /**< Bit buffer */
-	size_t bitlen;    /**< Number of bits in the bit buffer */
+	uint64_t bitbuf;      /**< Bit buffer */
+	size_t bitlen;        /**< Number of bits in the bit buffer */
 	
-	bool overrun;     /**< Overrun condition */
+	size_t stored;        /**< Bytes left in a stored block */
+	
+	uint16_t nlen;        /**< Number of literal/length code lengths */
+	uint16_t ndist;       /**< Number of distance code lengths */
+	uint16_t ncode;       /**< Number of code length code lengths */
+	uint16_t index;       /**< Number of code lengths read so far */
+	bool fixed;           /**< Tables hold the fixed codes */
+	uint16_t length[MAX_CODE];
+	
+	huffman_entry_t litlen_root[1 << LITLEN_ROOT_BITS];
+	huffman_entry_t dist_root[1 << DIST_ROOT_BITS];
+	huffman_entry_t order_root[1 << ORDER_ROOT_BITS];
+	huffman_t litlen;     /**< Literal/length code */
+	huffman_t dist;       /**< Distance code */
+	huffman_t order;      /**< Code length code */
 } inflate_state_t;
 
-/** Huffman code description
+/** Incremental inflate stream
  *
  */
-typedef struct {
-	uint16_t *count;   /**< Array of symbol counts */
-	uint16_t *symbol;  /**< Array of symbols */
-} huffman_t;
+struct inflate_stream {
+	inflate_state_t state;     /**< Decoder state */
+	size_t drained;            /**< Output position read by the user */
+	uint8_t window[WINDOW_SIZE];
+};
 
 /** Length codes
  *
@@ -162,161 +259,204 @@ static const short order[MAX_ORDER] = {
 	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
 };
 
-/** Static length symbol counts
+/** Refill the bit buffer
  *
- */
-static uint16_t len_count[MAX_HUFFMAN_BIT + 1] = {
-	0, 0, 0, 0, 0, 0, 0, 24, 152, 112, 0, 0, 0, 0, 0, 0
-};
-
-/** Static length symbols
- *
- */
-static uint16_t len_symbol[MAX_FIXED_LITLEN] = {
-	256, 257, 258, 259, 260, 261, 262, 263, 264, 265, 266, 267, 268,
-	269, 270, 271, 272, 273, 274, 275, 276, 277, 278, 279, 0, 1, 2,
-	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-	21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
-	37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52,
-	53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68,
-	69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84,
-	85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100,
-	101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113,
-	114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126,
-	127, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139,
-	140, 141, 142, 143, 280, 281, 282, 283, 284, 285, 286, 287, 144,
-	145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157,
-	158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170,
-	171, 172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183,
-	184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196,
-	197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209,
-	210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222,
-	223, 224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235,
-	236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247, 248,
-	249, 250, 251, 252, 253, 254, 255
-};
-
-/** Static distance symbol counts
+ * Loads as many whole bytes as fit into the bit buffer. Bits above
+ * the valid ones are either zero or copies of the following input bits.
+ *
+ * @param state Inflate state.
  *
  */
-static uint16_t dist_count[MAX_HUFFMAN_BIT + 1] = {
-	0, 0, 0, 0, 0, 30, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+static inline void bits_refill(inflate_state_t *state)
+{
+	if (state->srclen - state->srccnt >= sizeof(uint64_t)) {
+		uint64_t val = load_uint64(state->src + state->srccnt);
+		
+		state->bitbuf |= uint64_t_le2host(val) << state->bitlen;
+		state->srccnt += (63 - state->bitlen) >> 3;
+		state->bitlen |= 56;
+		return;
+	}
+	
+	while ((state->bitlen < 56) && (state->srccnt < state->srclen)) {
+		state->bitbuf |=
+		    ((uint64_t) state->src[state->srccnt]) << state->bitlen;
+		state->srccnt++;
+		state->bitlen += 8;
+	}
+}
 
-/** Static distance symbols
+/** Get bits from the bit buffer without consuming them
+ *
+ * @param state Inflate state.
+ * @param cnt   Number of bits to return (at most 32).
+ *
+ * @return Returned bits.
  *
  */
-static uint16_t dist_symbol[MAX_DIST] = {
-	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
-	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29
-};
+static inline uint32_t bits_peek(inflate_state_t *state, size_t cnt)
+{
+	return (uint32_t) (state->bitbuf & ((UINT64_C(1) << cnt) - 1));
+}
 
-/** Huffman code for lengths
+/** Consume bits from the bit buffer
+ *
+ * @param state Inflate state.
+ * @param cnt   Number of bits to consume.
  *
  */
-static huffman_t len_code = {
-	.count = len_count,
-	.symbol = len_symbol
-};
+static inline void bits_drop(inflate_state_t *state, size_t cnt)
+{
+	state->bitbuf >>= cnt;
+	state->bitlen -= cnt;
+}
 
-/** Huffman code for distances
+/** Discard the bits above the valid ones
+ *
+ * Needed before the input is consumed past the bit buffer.
+ *
+ * @param state Inflate state.
  *
  */
-static huffman_t dist_code = {
-	.count = dist_count,
-	.symbol = dist_symbol
-};
+static inline void bits_clean(inflate_state_t *state)
+{
+	if (state->bitlen < 64)
+		state->bitbuf &= (UINT64_C(1) << state->bitlen) - 1;
+}
 
 /** Get bits from the bit buffer
  *
  * @param state Inflate state.
- * @param cnt   Number of bits to return (at most 16).
+ * @param cnt   Number of bits to return (at most 32).
+ * @param bits  Returned bits.
  *
- * @return Returned bits.
+ * @return EOK on success.
+ * @return ELIMIT if the input does not hold enough bits.
  *
  */
-static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
+static inline errno_t get_bits(inflate_state_t *state, size_t cnt,
+    uint32_t *bits)
 {
-	/* Bit accumulator for at least 20 bits */
-	uint32_t val = state->bitbuf;
-	
-	while (state->bitlen < cnt) {
-		if (state->srccnt == state->srclen) {
-			state->overrun = true;
-			return 0;
-		}
-		
-		/* Load 8 more bits */
-		val |= ((uint32_t) state->src[state->srccnt]) << state->bitlen;
-		state->srccnt++;
-		state->bitlen += 8;
+	if (state->bitlen < cnt) {
+		bits_refill(state);
+		if (state->bitlen < cnt)
+			return ELIMIT;
 	}
 	
-	/* Update bits in the buffer */
-	state->bitbuf = (uint16_t) (val >> cnt);
-	state->bitlen -= cnt;
-	
-	return ((uint16_t) (val & ((1 << cnt) - 1)));
+	*bits = bits_peek(state, cnt);
+	bits_drop(state, cnt);
+	return EOK;
 }
 
-/** Decode `stored' block
+/** Write a byte to the output
  *
  * @param state Inflate state.
+ * @param byte  Byte to write.
  *
- * @return EOK on success.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
- * @return EINVAL on invalid data.
+ */
+static inline void put_byte(inflate_state_t *state, uint8_t byte)
+{
+	state->dest[state->destcnt & state->destmask] = byte;
+	state->destcnt++;
+}
+
+/** Copy a match from the previous output
+ *
+ * @param state Inflate state.
+ * @param dist  Distance of the match.
+ * @param len   Length of the match.
  *
  */
-static errno_t inflate_stored(inflate_state_t *state)
+static inline void put_match(inflate_state_t *state, size_t dist, size_t len)
 {
-	/* Discard bits in the bit buffer */
-	state->bitbuf = 0;
-	state->bitlen = 0;
-	
-	if (state->srccnt + 4 > state->srclen)
-		return ELIMIT;
+	size_t from = (state->destcnt - dist) & state->destmask;
+	size_t to = state->destcnt & state->destmask;
 	
-	uint16_t len =
-	    state->src[state->srccnt] | (state->src[state->srccnt + 1] << 8);
-	uint16_t len_compl =
-	    state->src[state->srccnt + 2] | (state->src[state->srccnt + 3] << 8);
-	
-	/* Check block length and its complement */
-	if (((int16_t) len) != ~((int16_t) len_compl))
-		return EINVAL;
-	
-	state->srccnt += 4;
-	
-	/* Check input buffer size */
-	if (state->srccnt + len > state->srclen)
-		return ELIMIT;
+	state->destcnt += len;
 	
-	/* Check output buffer size */
-	if (state->destcnt + len > state->destlen)
-		return ENOMEM;
+	if ((from + len <= state->destsize) && (to + len <= state->destsize)) {
+		uint8_t *dst = state->dest + to;
+		uint8_t *src = state->dest + from;
+		
+		if (dist >= len) {
+			memcpy(dst, src, len);
+		} else if (dist == 1) {
+			memset(dst, *src, len);
+		} else {
+			while (len-- > 0)
+				*dst++ = *src++;
+		}
+	} else {
+		/* The match wraps around the end of the window */
+		while (len-- > 0) {
+			state->dest[to] = state->dest[from];
+			to = (to + 1) & state->destmask;
+			from = (from + 1) & state->destmask;
+		}
+	}
+}
+
+/** Create a lookup table entry for a symbol
+ *
+ * @param kind   Kind of symbols.
+ * @param symbol Decoded symbol.
+ * @param bits   Length of the code of the symbol.
+ *
+ * @return Lookup table entry.
+ *
+ */
+static huffman_entry_t huffman_entry(huffman_kind_t kind, uint16_t symbol,
+    size_t bits)
+{
+	huffman_entry_t entry = {
+		.op = OP_INVALID,
+		.bits = bits,
+		.val = 0
+	};
 	
-	/* Copy data */
-	memcpy(state->dest + state->destcnt, state->src + state->srccnt, len);
-	state->srccnt += len;
-	state->destcnt += len;
+	switch (kind) {
+	case HUFFMAN_LITLEN:
+		if (symbol < 256) {
+			entry.op = OP_LITERAL;
+			entry.val = symbol;
+		} else if (symbol == 256) {
+			entry.op = OP_END;
+		} else if (symbol - 257 < MAX_LEN) {
+			entry.op = OP_BASE | lens_ext[symbol - 257];
+			entry.val = lens[symbol - 257];
+		}
+		break;
+	case HUFFMAN_DIST:
+		if (symbol < MAX_DIST) {
+			entry.op = OP_BASE | dists_ext[symbol];
+			entry.val = dists[symbol];
+		}
+		break;
+	case HUFFMAN_ORDER:
+		entry.op = OP_LITERAL;
+		entry.val = symbol;
+		break;
+	}
 	
-	return EOK;
+	return entry;
 }
 
-/** Decode a symbol using the Huffman code
+/** Decode a symbol using the canonical Huffman code
+ *
+ * Used for codes which are not resolved by the lookup table.
+ * Bits are consumed only if a symbol is decoded.
  *
  * @param state   Inflate state.
  * @param huffman Huffman code.
- * @param symbol  Decoded symbol.
+ * @param entry   Entry describing the decoded symbol.
  *
- * @param EOK on success.
- * @param EINVAL on invalid Huffman code.
+ * @return EOK on success.
+ * @return ELIMIT if the input does not hold enough bits.
+ * @return EINVAL on invalid Huffman code.
  *
  */
-static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
-    uint16_t *symbol)
+static errno_t huffman_decode_slow(inflate_state_t *state, huffman_t *huffman,
+    huffman_entry_t *entry)
 {
 	uint16_t code = 0; /* Decoded bits */
 	size_t first = 0;  /* First code of the given length */
@@ -326,13 +466,16 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
 	size_t len;  /* Current number of bits in the code */
 	for (len = 1; len <= MAX_HUFFMAN_BIT; len++) {
 		/* Get next bit */
-		code |= get_bits(state, 1);
-		CHECK_OVERRUN(*state);
+		if (len > state->bitlen)
+			return ELIMIT;
+		
+		code |= (state->bitbuf >> (len - 1)) & 1;
 		
 		uint16_t count = huffman->count[len];
 		if (code < first + count) {
 			/* Return decoded symbol */
-			*symbol = huffman->symbol[index + code - first];
+			*entry = huffman_entry(huffman->kind,
+			    huffman->symbol[index + code - first], len);
 			return EOK;
 		}
 		
@@ -346,6 +489,31 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
 	return EINVAL;
 }
 
+/** Decode a symbol using the Huffman code
+ *
+ * Bits are not consumed. The caller consumes entry->bits bits
+ * once it can process the symbol.
+ *
+ * @param state   Inflate state.
+ * @param huffman Huffman code.
+ * @param entry   Entry describing the decoded symbol.
+ *
+ * @return EOK on success.
+ * @return ELIMIT if the input does not hold enough bits.
+ * @return EINVAL on invalid Huffman code.
+ *
+ */
+static inline errno_t huffman_decode(inflate_state_t *state,
+    huffman_t *huffman, huffman_entry_t *entry)
+{
+	*entry = huffman->root[bits_peek(state, huffman->root_bits)];
+	
+	if ((entry->op == OP_SLOW) || (entry->bits > state->bitlen))
+		return huffman_decode_slow(state, huffman, entry);
+	
+	return EOK;
+}
+
 /** Construct Huffman tables from canonical Huffman code
  *
  * @param huffman Constructed Huffman tables.
@@ -369,6 +537,15 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 	for (symbol = 0; symbol < n; symbol++)
 		huffman->count[length[symbol]]++;
 	
+	/* Codes not resolved by the lookup table are decoded bit by bit */
+	size_t size = 1 << huffman->root_bits;
+	size_t i;
+	for (i = 0; i < size; i++) {
+		huffman->root[i].op = OP_SLOW;
+		huffman->root[i].bits = 0;
+		huffman->root[i].val = 0;
+	}
+	
 	if (huffman->count[0] == n) {
 		/* The code is complete, but decoding will fail */
 		return 0;
@@ -399,99 +576,217 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 		}
 	}
 	
+	/*
+	 * Fill the lookup table with the short codes. Codes are assigned
+	 * in the canonical order, their bits are stored in the input
+	 * starting with the most significant one.
+	 */
+	uint16_t code = 0;
+	size_t index = 0;
+	for (len = 1; len <= huffman->root_bits; len++) {
+		for (i = 0; i < huffman->count[len]; i++) {
+			size_t rev = 0;
+			for (size_t bit = 0; bit < len; bit++) {
+				if (code & (1 << bit))
+					rev |= 1 << (len - 1 - bit);
+			}
+			
+			huffman_entry_t entry = huffman_entry(huffman->kind,
+			    huffman->symbol[index], len);
+			for (size_t j = rev; j < size; j += 1 << len)
+				huffman->root[j] = entry;
+			
+			code++;
+			index++;
+		}
+		
+		code <<= 1;
+	}
+	
+	/*
+	 * Resolve pairs of literals fitting the lookup table index at once.
+	 * The table is processed backwards, so the second literal is
+	 * always looked up in an entry which has not been paired yet.
+	 */
+	if (huffman->kind == HUFFMAN_LITLEN) {
+		for (i = size; i-- > 0;) {
+			huffman_entry_t *first = &huffman->root[i];
+			if ((first->op != OP_LITERAL) ||
+			    (first->bits >= huffman->root_bits))
+				continue;
+			
+			huffman_entry_t *second = &huffman->root[i >> first->bits];
+			if ((second->op != OP_LITERAL) ||
+			    (first->bits + second->bits > huffman->root_bits))
+				continue;
+			
+			first->val |= second->val << 8;
+			first->bits += second->bits;
+			first->op = OP_LITERAL2;
+		}
+	}
+	
 	return left;
 }
 
-/** Decode literal/length and distance codes
- *
- * Decode until end-of-block code.
+/** Decode the block header
  *
- * @param state     Inflate state.
- * @param len_code  Huffman code for literal/length.
- * @param dist_code Huffman code for distance.
+ * @param state Inflate state.
  *
  * @return EOK on success.
- * @return ENOENT on distance too large.
- * @return EINVAL on invalid Huffman code.
  * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
+ * @return EINVAL on invalid data.
  *
  */
-static errno_t inflate_codes(inflate_state_t *state, huffman_t* len_code,
-    huffman_t* dist_code)
+static errno_t inflate_header(inflate_state_t *state)
 {
-	uint16_t symbol;
+	uint32_t bits;
+	errno_t rc = get_bits(state, 3, &bits);
+	if (rc != EOK)
+		return rc;
 	
-	do {
-		errno_t err = huffman_decode(state, len_code, &symbol);
-		if (err != EOK) {
-			/* Error decoding */
-			return err;
-		}
-		
-		if (symbol < 256) {
-			/* Write out literal */
-			if (state->destcnt == state->destlen)
-				return ENOMEM;
-			
-			state->dest[state->destcnt] = (uint8_t) symbol;
-			state->destcnt++;
-		} else if (symbol > 256) {
-			/* Compute length */
-			symbol -= 257;
-			if (symbol >= 29)
-				return EINVAL;
-			
-			size_t len = lens[symbol] + get_bits(state, lens_ext[symbol]);
-			CHECK_OVERRUN(*state);
+	/* Last block is indicated by a non-zero bit */
+	state->last = (bits & 1) != 0;
+	
+	/* Block type */
+	switch (bits >> 1) {
+	case 0:
+		/* Discard the bits up to the byte boundary */
+		bits_drop(state, state->bitlen & 7);
+		state->mode = INFLATE_STORED_LENGTH;
+		break;
+	case 1:
+		if (!state->fixed) {
+			size_t symbol;
+			for (symbol = 0; symbol < 144; symbol++)
+				state->length[symbol] = 8;
+			for (; symbol < 256; symbol++)
+				state->length[symbol] = 9;
+			for (; symbol < 280; symbol++)
+				state->length[symbol] = 7;
+			for (; symbol < MAX_FIXED_LITLEN; symbol++)
+				state->length[symbol] = 8;
 			
-			/* Get distance */
-			err = huffman_decode(state, dist_code, &symbol);
-			if (err != EOK)
-				return err;
+			huffman_construct(&state->litlen, state->length,
+			    MAX_FIXED_LITLEN);
 			
-			size_t dist = dists[symbol] + get_bits(state, dists_ext[symbol]);
-			if (dist > state->destcnt)
-				return ENOENT;
+			for (symbol = 0; symbol < MAX_DIST; symbol++)
+				state->length[symbol] = 5;
 			
-			if (state->destcnt + len > state->destlen)
-				return ENOMEM;
+			huffman_construct(&state->dist, state->length,
+			    MAX_DIST);
 			
-			while (len > 0) {
-				/* Copy len bytes from distance bytes back */
-				state->dest[state->destcnt]
-				    = state->dest[state->destcnt - dist];
-				state->destcnt++;
-				len--;
-			}
+			state->fixed = true;
 		}
-	} while (symbol != 256);
+		
+		state->mode = INFLATE_CODES;
+		break;
+	case 2:
+		state->mode = INFLATE_TABLE_SIZES;
+		break;
+	default:
+		return EINVAL;
+	}
 	
 	return EOK;
 }
 
-/** Decode `fixed codes' block
+/** Finish decoding of a block
+ *
+ * @param state Inflate state.
  *
- * @param state     Inflate state.
- * @param len_code  Huffman code for literal/length.
- * @param dist_code Huffman code for distance.
+ */
+static void inflate_block_end(inflate_state_t *state)
+{
+	state->mode = state->last ? INFLATE_DONE : INFLATE_HEADER;
+}
+
+/** Decode `stored' block length
+ *
+ * @param state Inflate state.
+ *
+ * @return EOK on success.
+ * @return ELIMIT on input buffer overrun.
+ * @return EINVAL on invalid data.
+ *
+ */
+static errno_t inflate_stored_length(inflate_state_t *state)
+{
+	uint32_t bits;
+	errno_t rc = get_bits(state, 32, &bits);
+	if (rc != EOK)
+		return rc;
+	
+	uint32_t len = bits & 0xffff;
+	uint32_t len_compl = bits >> 16;
+	
+	/* Check block length and its complement */
+	if (len != (~len_compl & 0xffff))
+		return EINVAL;
+	
+	state->stored = len;
+	state->mode = INFLATE_STORED;
+	return EOK;
+}
+
+/** Decode `stored' block data
+ *
+ * @param state Inflate state.
  *
  * @return EOK on success.
- * @return ENOENT on distance too large.
- * @return EINVAL on invalid Huffman code.
  * @return ELIMIT on input buffer overrun.
  * @return ENOMEM on output buffer overrun.
  *
  */
-static errno_t inflate_fixed(inflate_state_t *state, huffman_t *len_code,
-    huffman_t *dist_code)
+static errno_t inflate_stored(inflate_state_t *state)
 {
-	return inflate_codes(state, len_code, dist_code);
+	/* Bytes already in the bit buffer come first */
+	while ((state->stored > 0) && (state->bitlen >= 8)) {
+		if (state->destcnt == state->destlimit)
+			return ENOMEM;
+		
+		put_byte(state, bits_peek(state, 8));
+		bits_drop(state, 8);
+		state->stored--;
+	}
+	
+	bits_clean(state);
+	
+	while (state->stored > 0) {
+		if (state->srccnt == state->srclen)
+			return ELIMIT;
+		
+		if (state->destcnt == state->destlimit)
+			return ENOMEM;
+		
+		/* Copy data up to the end of the window */
+		size_t to = state->destcnt & state->destmask;
+		size_t len = state->stored;
+		
+		if (len > state->srclen - state->srccnt)
+			len = state->srclen - state->srccnt;
+		
+		if (len > state->destlimit - state->destcnt)
+			len = state->destlimit - state->destcnt;
+		
+		if (len > state->destsize - to)
+			len = state->destsize - to;
+		
+		memcpy(state->dest + to, state->src + state->srccnt, len);
+		state->srccnt += len;
+		state->destcnt += len;
+		state->stored -= len;
+	}
+	
+	inflate_block_end(state);
+	return EOK;
 }
 
-/** Decode `dynamic codes' block
+/** Decode literal/length and distance codes
  *
- * @param state     Inflate state.
+ * Decode until end-of-block code.
+ *
+ * @param state Inflate state.
  *
  * @return EOK on success.
  * @return ENOENT on distance too large.
@@ -500,107 +795,343 @@ static errno_t inflate_fixed(inflate_state_t *state, huffman_t *len_code,
  * @return ENOMEM on output buffer overrun.
  *
  */
-static errno_t inflate_dynamic(inflate_state_t *state)
+static errno_t inflate_codes(inflate_state_t *state)
 {
-	uint16_t length[MAX_CODE];
-	uint16_t dyn_len_count[MAX_HUFFMAN_BIT + 1];
-	uint16_t dyn_len_symbol[MAX_LITLEN];
-	uint16_t dyn_dist_count[MAX_HUFFMAN_BIT + 1];
-	uint16_t dyn_dist_symbol[MAX_DIST];
-	huffman_t dyn_len_code;
-	huffman_t dyn_dist_code;
-	
-	dyn_len_code.count = dyn_len_count;
-	dyn_len_code.symbol = dyn_len_symbol;
-	
-	dyn_dist_code.count = dyn_dist_count;
-	dyn_dist_code.symbol = dyn_dist_symbol;
+	huffman_entry_t entry;
+	errno_t rc;
 	
+	while (true) {
+		if (state->bitlen < 48)
+			bits_refill(state);
+		
+		rc = huffman_decode(state, &state->litlen, &entry);
+		if (rc != EOK)
+			return rc;
+		
+		if (entry.op == OP_LITERAL2) {
+			/* Write out two literals */
+			if (state->destlimit - state->destcnt < 2)
+				return ENOMEM;
+			
+			bits_drop(state, entry.bits);
+			put_byte(state, entry.val & 0xff);
+			put_byte(state, entry.val >> 8);
+			continue;
+		}
+		
+		if (entry.op == OP_LITERAL) {
+			/* Write out literal */
+			if (state->destcnt == state->destlimit)
+				return ENOMEM;
+			
+			bits_drop(state, entry.bits);
+			put_byte(state, entry.val);
+			continue;
+		}
+		
+		if (entry.op == OP_END) {
+			bits_drop(state, entry.bits);
+			inflate_block_end(state);
+			return EOK;
+		}
+		
+		if ((entry.op & OP_BASE) == 0)
+			return EINVAL;
+		
+		/* Compute length */
+		size_t extra = entry.op & 0x0f;
+		size_t used = entry.bits + extra;
+		if (used > state->bitlen)
+			return ELIMIT;
+		
+		size_t len = entry.val +
+		    ((state->bitbuf >> entry.bits) & ((1 << extra) - 1));
+		
+		/* Get distance (keeping the length bits for now) */
+		uint64_t bitbuf = state->bitbuf;
+		size_t bitlen = state->bitlen;
+		bits_drop(state, used);
+		
+		rc = huffman_decode(state, &state->dist, &entry);
+		if (rc == EOK) {
+			if ((entry.op & OP_BASE) == 0)
+				rc = EINVAL;
+			else if ((size_t) entry.bits + (entry.op & 0x0f) >
+			    state->bitlen)
+				rc = ELIMIT;
+		}
+		
+		if (rc != EOK) {
+			state->bitbuf = bitbuf;
+			state->bitlen = bitlen;
+			return rc;
+		}
+		
+		extra = entry.op & 0x0f;
+		size_t dist = entry.val +
+		    ((state->bitbuf >> entry.bits) & ((1 << extra) - 1));
+		
+		if ((dist > state->destcnt) && (!state->destfull))
+			return ENOENT;
+		
+		if (state->destlimit - state->destcnt < len) {
+			state->bitbuf = bitbuf;
+			state->bitlen = bitlen;
+			return ENOMEM;
+		}
+		
+		bits_drop(state, entry.bits + extra);
+		put_match(state, dist, len);
+	}
+}
+
+/** Decode `dynamic codes' block table sizes
+ *
+ * @param state Inflate state.
+ *
+ * @return EOK on success.
+ * @return ELIMIT on input buffer overrun.
+ * @return EINVAL on invalid data.
+ *
+ */
+static errno_t inflate_table_sizes(inflate_state_t *state)
+{
 	/* Get number of bits in each table */
-	uint16_t nlen = get_bits(state, 5) + 257;
-	CHECK_OVERRUN(*state);
-	
-	uint16_t ndist = get_bits(state, 5) + 1;
-	CHECK_OVERRUN(*state);
+	uint32_t bits;
+	errno_t rc = get_bits(state, 14, &bits);
+	if (rc != EOK)
+		return rc;
 	
-	uint16_t ncode = get_bits(state, 4) + 4;
-	CHECK_OVERRUN(*state);
+	state->nlen = (bits & 0x1f) + 257;
+	state->ndist = ((bits >> 5) & 0x1f) + 1;
+	state->ncode = (bits >> 10) + 4;
 	
-	if ((nlen > MAX_LITLEN) || (ndist > MAX_DIST)
-	    || (ncode > MAX_ORDER))
+	if ((state->nlen > MAX_LITLEN) || (state->ndist > MAX_DIST)
+	    || (state->ncode > MAX_ORDER))
 		return EINVAL;
 	
+	state->index = 0;
+	state->mode = INFLATE_TABLE_ORDER;
+	return EOK;
+}
+
+/** Decode `dynamic codes' block code length code
+ *
+ * @param state Inflate state.
+ *
+ * @return EOK on success.
+ * @return ELIMIT on input buffer overrun.
+ * @return EINVAL on invalid data.
+ *
+ */
+static errno_t inflate_table_order(inflate_state_t *state)
+{
 	/* Read code length code lengths */
-	uint16_t index;
-	for (index = 0; index < ncode; index++) {
-		length[order[index]] = get_bits(state, 3);
-		CHECK_OVERRUN(*state);
+	while (state->index < state->ncode) {
+		uint32_t bits;
+		errno_t rc = get_bits(state, 3, &bits);
+		if (rc != EOK)
+			return rc;
+		
+		state->length[order[state->index]] = bits;
+		state->index++;
 	}
 	
 	/* Set missing lengths to zero */
-	for (index = ncode; index < MAX_ORDER; index++)
-		length[order[index]] = 0;
+	for (size_t index = state->ncode; index < MAX_ORDER; index++)
+		state->length[order[index]] = 0;
 	
 	/* Build Huffman code */
-	int16_t rc = huffman_construct(&dyn_len_code, length, MAX_ORDER);
+	int16_t rc = huffman_construct(&state->order, state->length, MAX_ORDER);
 	if (rc != 0)
 		return EINVAL;
 	
+	state->index = 0;
+	state->mode = INFLATE_TABLE_LENGTHS;
+	return EOK;
+}
+
+/** Decode `dynamic codes' block code lengths
+ *
+ * @param state Inflate state.
+ *
+ * @return EOK on success.
+ * @return ELIMIT on input buffer overrun.
+ * @return EINVAL on invalid data.
+ *
+ */
+static errno_t inflate_table_lengths(inflate_state_t *state)
+{
+	size_t total = state->nlen + state->ndist;
+	
 	/* Read length/literal and distance code length tables */
-	index = 0;
-	while (index < nlen + ndist) {
-		uint16_t symbol;
-		errno_t err = huffman_decode(state, &dyn_len_code, &symbol);
+	while (state->index < total) {
+		if (state->bitlen < 14)
+			bits_refill(state);
+		
+		huffman_entry_t entry;
+		errno_t err = huffman_decode(state, &state->order, &entry);
 		if (err != EOK)
-			return EOK;
+			return err;
 		
+		uint16_t symbol = entry.val;
 		if (symbol < 16) {
-			length[index] = symbol;
-			index++;
-		} else {
-			uint16_t len = 0;
-			
-			if (symbol == 16) {
-				if (index == 0)
-					return EINVAL;
-				
-				len = length[index - 1];
-				symbol = get_bits(state, 2) + 3;
-				CHECK_OVERRUN(*state);
-			} else if (symbol == 17) {
-				symbol = get_bits(state, 3) + 3;
-				CHECK_OVERRUN(*state);
-			} else {
-				symbol = get_bits(state, 7) + 11;
-				CHECK_OVERRUN(*state);
-			}
-			
-			if (index + symbol > nlen + ndist)
+			bits_drop(state, entry.bits);
+			state->length[state->index] = symbol;
+			state->index++;
+			continue;
+		}
+		
+		uint16_t len = 0;
+		size_t extra;
+		uint16_t base;
+		
+		if (symbol == 16) {
+			if (state->index == 0)
 				return EINVAL;
 			
-			while (symbol > 0) {
-				length[index] = len;
-				index++;
-				symbol--;
-			}
+			len = state->length[state->index - 1];
+			extra = 2;
+			base = 3;
+		} else if (symbol == 17) {
+			extra = 3;
+			base = 3;
+		} else {
+			extra = 7;
+			base = 11;
+		}
+		
+		if (entry.bits + extra > state->bitlen)
+			return ELIMIT;
+		
+		bits_drop(state, entry.bits);
+		uint16_t repeat = base + bits_peek(state, extra);
+		bits_drop(state, extra);
+		
+		if (state->index + repeat > total)
+			return EINVAL;
+		
+		while (repeat > 0) {
+			state->length[state->index] = len;
+			state->index++;
+			repeat--;
 		}
 	}
 	
 	/* Check for end-of-block code */
-	if (length[256] == 0)
+	if (state->length[256] == 0)
 		return EINVAL;
 	
 	/* Build Huffman tables for literal/length codes */
-	rc = huffman_construct(&dyn_len_code, length, nlen);
-	if ((rc < 0) || ((rc > 0) && (dyn_len_code.count[0] + 1 != nlen)))
+	int16_t rc = huffman_construct(&state->litlen, state->length,
+	    state->nlen);
+	if ((rc < 0) || ((rc > 0) &&
+	    (state->litlen.count[0] + 1 != state->nlen)))
 		return EINVAL;
 	
 	/* Build Huffman tables for distance codes */
-	rc = huffman_construct(&dyn_dist_code, length + nlen, ndist);
-	if ((rc < 0) || ((rc > 0) && (dyn_dist_code.count[0] + 1 != ndist)))
+	rc = huffman_construct(&state->dist, state->length + state->nlen,
+	    state->ndist);
+	if ((rc < 0) || ((rc > 0) &&
+	    (state->dist.count[0] + 1 != state->ndist)))
 		return EINVAL;
 	
-	return inflate_codes(state, &dyn_len_code, &dyn_dist_code);
+	state->fixed = false;
+	state->mode = INFLATE_CODES;
+	return EOK;
+}
+
+/** Initialize inflate state
+ *
+ * @param state    Inflate state.
+ * @param dest     Output buffer.
+ * @param destsize Output buffer size.
+ * @param destmask Mask of positions in the output buffer
+ *                 (SIZE_MAX if the buffer does not wrap around).
+ *
+ */
+static void inflate_init(inflate_state_t *state, void *dest, size_t destsize,
+    size_t destmask)
+{
+	state->mode = INFLATE_HEADER;
+	state->last = false;
+	
+	state->dest = (uint8_t *) dest;
+	state->destmask = destmask;
+	state->destsize = destsize;
+	state->destcnt = 0;
+	state->destlimit = destsize;
+	state->destfull = false;
+	
+	state->src = NULL;
+	state->srclen = 0;
+	state->srccnt = 0;
+	
+	state->bitbuf = 0;
+	state->bitlen = 0;
+	
+	state->fixed = false;
+	
+	state->litlen.kind = HUFFMAN_LITLEN;
+	state->litlen.root_bits = LITLEN_ROOT_BITS;
+	state->litlen.root = state->litlen_root;
+	
+	state->dist.kind = HUFFMAN_DIST;
+	state->dist.root_bits = DIST_ROOT_BITS;
+	state->dist.root = state->dist_root;
+	
+	state->order.kind = HUFFMAN_ORDER;
+	state->order.root_bits = ORDER_ROOT_BITS;
+	state->order.root = state->order_root;
+}
+
+/** Run the decoder
+ *
+ * Decode until the end of the last block, the end of the input or
+ * the output limit.
+ *
+ * @param state Inflate state.
+ *
+ * @return EOK when the last block is decoded.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
+ * @return ELIMIT on input buffer overrun.
+ * @return ENOMEM on output buffer overrun.
+ *
+ */
+static errno_t inflate_run(inflate_state_t *state)
+{
+	errno_t rc = EOK;
+	
+	while (rc == EOK) {
+		switch (state->mode) {
+		case INFLATE_HEADER:
+			rc = inflate_header(state);
+			break;
+		case INFLATE_STORED_LENGTH:
+			rc = inflate_stored_length(state);
+			break;
+		case INFLATE_STORED:
+			rc = inflate_stored(state);
+			break;
+		case INFLATE_TABLE_SIZES:
+			rc = inflate_table_sizes(state);
+			break;
+		case INFLATE_TABLE_ORDER:
+			rc = inflate_table_order(state);
+			break;
+		case INFLATE_TABLE_LENGTHS:
+			rc = inflate_table_lengths(state);
+			break;
+		case INFLATE_CODES:
+			rc = inflate_codes(state);
+			break;
+		case INFLATE_DONE:
+			return EOK;
+		}
+	}
+	
+	return rc;
 }
 
 /** Inflate data
@@ -614,53 +1145,196 @@ static errno_t inflate_dynamic(inflate_state_t *state)
  * @return ENOENT on distance too large.
  * @return EINVAL on invalid Huffman code or invalid deflate data.
  * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
+ * @return ENOMEM on output buffer overrun or if the decoder state
+ *         cannot be allocated.
  *
  */
 errno_t inflate(void *src, size_t srclen, void *dest, size_t destlen)
 {
-	/* Initialize the state */
-	inflate_state_t state;
+	/* The state is too large for the stack */
+	inflate_state_t *state = malloc(sizeof(inflate_state_t));
+	if (state == NULL)
+		return ENOMEM;
 	
-	state.dest = (uint8_t *) dest;
-	state.destlen = destlen;
-	state.destcnt = 0;
+	inflate_init(state, dest, destlen, SIZE_MAX);
+	state->src = (uint8_t *) src;
+	state->srclen = srclen;
 	
-	state.src = (uint8_t *) src;
-	state.srclen = srclen;
-	state.srccnt = 0;
+	errno_t rc = inflate_run(state);
 	
-	state.bitbuf = 0;
-	state.bitlen = 0;
+	free(state);
+	return rc;
+}
+
+/** Create an inflate stream
+ *
+ * The stream decodes data fed to it in chunks of arbitrary size into
+ * a sliding window, from which the output can be drained.
+ *
+ * @param stream Place to store the new stream.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t inflate_stream_create(inflate_stream_t **stream)
+{
+	inflate_stream_t *s = malloc(sizeof(inflate_stream_t));
+	if (s == NULL)
+		return ENOMEM;
 	
-	state.overrun = false;
+	inflate_init(&s->state, s->window, WINDOW_SIZE, WINDOW_SIZE - 1);
+	s->drained = 0;
 	
-	uint16_t last;
-	errno_t ret = EOK;
+	*stream = s;
+	return EOK;
+}
+
+/** Destroy an inflate stream
+ *
+ * @param stream Inflate stream.
+ *
+ */
+void inflate_stream_destroy(inflate_stream_t *stream)
+{
+	free(stream);
+}
+
+/** Feed input to an inflate stream
+ *
+ * The data is not copied, the buffer must stay valid until the stream
+ * consumes it, i.e. until inflate_stream_drain() stops producing output
+ * or the stream is done. Any input not consumed yet is replaced.
+ *
+ * @param stream Inflate stream.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ *
+ */
+void inflate_stream_feed(inflate_stream_t *stream, const void *src,
+    size_t srclen)
+{
+	bits_clean(&stream->state);
 	
-	do {
-		/* Last block is indicated by a non-zero bit */
-		last = get_bits(&state, 1);
-		CHECK_OVERRUN(state);
-		
-		/* Block type */
-		uint16_t type = get_bits(&state, 2);
-		CHECK_OVERRUN(state);
+	stream->state.src = (const uint8_t *) src;
+	stream->state.srclen = srclen;
+	stream->state.srccnt = 0;
+}
+
+/** Drain output from an inflate stream
+ *
+ * Decodes as much of the input as needed to fill the buffer. Less
+ * than requested is returned only if more input is needed or if the
+ * stream is done.
+ *
+ * @param stream  Inflate stream.
+ * @param dest    Destination data buffer.
+ * @param destlen Destination buffer size (bytes).
+ * @param nread   Place to store the number of bytes drained.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
+ *
+ */
+errno_t inflate_stream_drain(inflate_stream_t *stream, void *dest,
+    size_t destlen, size_t *nread)
+{
+	inflate_state_t *state = &stream->state;
+	uint8_t *buf = (uint8_t *) dest;
+	bool starved = false;
+	size_t done = 0;
+	
+	while (done < destlen) {
+		size_t pending = state->destcnt - stream->drained;
+		if (pending > 0) {
+			size_t from = stream->drained & state->destmask;
+			size_t len = destlen - done;
+			
+			if (len > pending)
+				len = pending;
+			
+			if (len > WINDOW_SIZE - from)
+				len = WINDOW_SIZE - from;
+			
+			memcpy(buf + done, stream->window + from, len);
+			stream->drained += len;
+			done += len;
+			continue;
+		}
 		
-		switch (type) {
-		case 0:
-			ret = inflate_stored(&state);
+		if ((starved) || (state->mode == INFLATE_DONE))
 			break;
-		case 1:
-			ret = inflate_fixed(&state, &len_code, &dist_code);
-			break;
-		case 2:
-			ret = inflate_dynamic(&state);
-			break;
-		default:
-			ret = EINVAL;
+		
+		/* Keep the undrained output in the window */
+		if (state->destcnt >= WINDOW_SIZE)
+			state->destfull = true;
+		
+		state->destlimit = stream->drained + WINDOW_SIZE;
+		
+		errno_t rc = inflate_run(state);
+		if (rc == ELIMIT) {
+			starved = true;
+		} else if ((rc != EOK) && (rc != ENOMEM)) {
+			*nread = done;
+			return rc;
 		}
-	} while ((!last) && (ret == 0));
+	}
+	
+	*nread = done;
+	return EOK;
+}
+
+/** Check whether an inflate stream is done
+ *
+ * @param stream Inflate stream.
+ *
+ * @return True if the last block was decoded and all output drained.
+ *
+ */
+bool inflate_stream_done(inflate_stream_t *stream)
+{
+	return (stream->state.mode == INFLATE_DONE) &&
+	    (stream->state.destcnt == stream->drained);
+}
+
+/** Read the input following the end of a stream
+ *
+ * Once the stream is done, this consumes the input which follows
+ * the compressed data (such as a container trailer).
+ *
+ * @param stream Inflate stream.
+ * @param buf    Buffer for the data.
+ * @param size   Size of the buffer (bytes).
+ *
+ * @return Number of bytes read.
+ *
+ */
+size_t inflate_stream_rest(inflate_stream_t *stream, void *buf, size_t size)
+{
+	inflate_state_t *state = &stream->state;
+	uint8_t *dst = (uint8_t *) buf;
+	size_t done = 0;
+	
+	if (state->mode != INFLATE_DONE)
+		return 0;
+	
+	/* Discard the bits up to the byte boundary */
+	bits_drop(state, state->bitlen & 7);
+	
+	while ((done < size) && (state->bitlen >= 8)) {
+		dst[done++] = bits_peek(state, 8);
+		bits_drop(state, 8);
+	}
+	
+	bits_clean(state);
+	
+	size_t len = state->srclen - state->srccnt;
+	if (len > size - done)
+		len = size - done;
+	
+	memcpy(dst + done, state->src + state->srccnt, len);
+	state->srccnt += len;
 	
-	return ret;
+	return done + len;
 }
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../deflate.h"
+#include "../inflate.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(deflate);
+
+enum {
+	/** Size of the generated test data */
+	test_data_size = 200000,
+	/** Number of levels tested */
+	test_levels = DEFLATE_LEVEL_BEST + 1
+};
+
+static const char *sample_text =
+    "The deflate format compresses a sequence of bytes using a "
+    "combination of LZ77 and Huffman coding. ";
+
+/** Generate text-like data with repetitions at varying distances */
+static uint8_t *gen_text(size_t size)
+{
+	uint8_t *data = malloc(size);
+	if (data == NULL)
+		return NULL;
+	
+	size_t tlen = str_size(sample_text);
+	uint32_t seed = 1;
+	
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 0x3f) == 0)
+			data[i] = 'A' + ((seed >> 8) % 26);
+		else
+			data[i] = sample_text[i % tlen];
+	}
+	
+	return data;
+}
+
+/** Generate incompressible data */
+static uint8_t *gen_random(size_t size)
+{
+	uint8_t *data = malloc(size);
+	if (data == NULL)
+		return NULL;
+	
+	uint32_t seed = 42;
+	
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 16;
+	}
+	
+	return data;
+}
+
+/** Compress data in one go and check that it inflates back
+ *
+ * @return Size of the compressed data.
+ *
+ */
+static size_t round_trip(const uint8_t *data, size_t size, int level)
+{
+	size_t bound = deflate_bound(size);
+	uint8_t *comp = malloc(bound);
+	uint8_t *out = malloc(size + 1);
+	size_t csize;
+	
+	PCUT_ASSERT_NOT_NULL(comp);
+	PCUT_ASSERT_NOT_NULL(out);
+	
+	errno_t rc = deflate(data, size, comp, bound, level, &csize);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(csize <= bound);
+	
+	rc = inflate(comp, csize, out, size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, out, size));
+	
+	free(comp);
+	free(out);
+	return csize;
+}
+
+/** Compress data through a stream in small chunks and inflate it back */
+static void stream_round_trip(const uint8_t *data, size_t size, int level,
+    size_t inchunk, size_t outchunk)
+{
+	size_t bound = deflate_bound(size);
+	uint8_t *comp = malloc(bound);
+	uint8_t *out = malloc(size + 1);
+	deflate_stream_t *stream;
+	size_t pos = 0;
+	size_t csize = 0;
+	
+	PCUT_ASSERT_NOT_NULL(comp);
+	PCUT_ASSERT_NOT_NULL(out);
+	
+	errno_t rc = deflate_stream_create(level, &stream);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	
+	while (true) {
+		size_t len = bound - csize;
+		size_t nread;
+		
+		if (len > outchunk)
+			len = outchunk;
+		
+		rc = deflate_stream_drain(stream, comp + csize, len, &nread);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		
+		csize += nread;
+		if (nread == len)
+			continue;
+		
+		if (deflate_stream_done(stream))
+			break;
+		
+		PCUT_ASSERT_TRUE(pos < size);
+		
+		len = size - pos;
+		if (len > inchunk)
+			len = inchunk;
+		
+		deflate_stream_feed(stream, data + pos, len);
+		pos += len;
+		
+		if (pos == size)
+			deflate_stream_finish(stream);
+	}
+	
+	deflate_stream_destroy(stream);
+	
+	rc = inflate(comp, csize, out, size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, out, size));
+	
+	free(comp);
+	free(out);
+}
+
+/** Invalid levels are rejected */
+PCUT_TEST(invalid_level)
+{
+	deflate_stream_t *stream;
+	
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, deflate_stream_create(-1, &stream));
+	PCUT_ASSERT_ERRNO_VAL(EINVAL,
+	    deflate_stream_create(DEFLATE_LEVEL_BEST + 1, &stream));
+}
+
+/** Empty input */
+PCUT_TEST(empty)
+{
+	uint8_t data[1];
+	
+	for (int level = 0; level < test_levels; level++)
+		round_trip(data, 0, level);
+}
+
+/** Single byte */
+PCUT_TEST(single_byte)
+{
+	uint8_t data[1] = { 'x' };
+	
+	for (int level = 0; level < test_levels; level++)
+		round_trip(data, sizeof(data), level);
+}
+
+/** Text compresses at every level, better at higher ones */
+PCUT_TEST(text)
+{
+	uint8_t *data = gen_text(test_data_size);
+	size_t csize[test_levels];
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	
+	for (int level = 0; level < test_levels; level++)
+		csize[level] = round_trip(data, test_data_size, level);
+	
+	PCUT_ASSERT_TRUE(csize[DEFLATE_LEVEL_STORE] > test_data_size);
+	PCUT_ASSERT_TRUE(csize[DEFLATE_LEVEL_FAST] < test_data_size / 4);
+	PCUT_ASSERT_TRUE(csize[DEFLATE_LEVEL_DEFAULT] <=
+	    csize[DEFLATE_LEVEL_FAST]);
+	PCUT_ASSERT_TRUE(csize[DEFLATE_LEVEL_BEST] <=
+	    csize[DEFLATE_LEVEL_DEFAULT]);
+	
+	free(data);
+}
+
+/** Runs of a single byte */
+PCUT_TEST(zeros)
+{
+	uint8_t *data = calloc(test_data_size, 1);
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	
+	for (int level = 1; level < test_levels; level++)
+		PCUT_ASSERT_TRUE(round_trip(data, test_data_size, level) <
+		    test_data_size / 100);
+	
+	free(data);
+}
+
+/** Incompressible data does not grow beyond the bound */
+PCUT_TEST(random)
+{
+	uint8_t *data = gen_random(test_data_size);
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	
+	for (int level = 0; level < test_levels; level++)
+		round_trip(data, test_data_size, level);
+	
+	free(data);
+}
+
+/** Output buffer too small */
+PCUT_TEST(overrun)
+{
+	uint8_t *data = gen_random(test_data_size);
+	uint8_t *comp = malloc(test_data_size / 2);
+	size_t csize;
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(comp);
+	
+	errno_t rc = deflate(data, test_data_size, comp, test_data_size / 2,
+	    DEFLATE_LEVEL_DEFAULT, &csize);
+	PCUT_ASSERT_ERRNO_VAL(ENOMEM, rc);
+	
+	free(comp);
+	free(data);
+}
+
+/** Streaming with tiny and odd sized chunks */
+PCUT_TEST(stream_small_chunks)
+{
+	uint8_t *data = gen_text(test_data_size);
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	
+	stream_round_trip(data, test_data_size, DEFLATE_LEVEL_FAST, 1, 7);
+	stream_round_trip(data, test_data_size, DEFLATE_LEVEL_DEFAULT, 13, 1);
+	stream_round_trip(data, test_data_size, DEFLATE_LEVEL_STORE, 4099, 3);
+	
+	free(data);
+}
+
+/** Streaming with chunks larger than the window */
+PCUT_TEST(stream_large_chunks)
+{
+	uint8_t *text = gen_text(test_data_size);
+	uint8_t *rnd = gen_random(test_data_size);
+	
+	PCUT_ASSERT_NOT_NULL(text);
+	PCUT_ASSERT_NOT_NULL(rnd);
+	
+	for (int level = 0; level < test_levels; level++) {
+		stream_round_trip(text, test_data_size, level, 100000, 70000);
+		stream_round_trip(rnd, test_data_size, level, 65536, 4096);
+	}
+	
+	free(text);
+	free(rnd);
+}
+
+PCUT_EXPORT(deflate);
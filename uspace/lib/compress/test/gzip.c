@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../deflate.h"
+#include "../gzip.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(gzip);
+
+enum {
+	/** Size of the test data */
+	test_data_size = 100000
+};
+
+static uint8_t *gen_data(size_t size)
+{
+	uint8_t *data = malloc(size);
+	if (data == NULL)
+		return NULL;
+	
+	for (size_t i = 0; i < size; i++)
+		data[i] = (i % 251) ^ (i >> 10);
+	
+	return data;
+}
+
+/** One-shot compression expands back */
+PCUT_TEST(compress_expand)
+{
+	uint8_t *data = gen_data(test_data_size);
+	void *comp;
+	size_t csize;
+	void *out;
+	size_t osize;
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	
+	errno_t rc = gzip_compress(data, test_data_size, DEFLATE_LEVEL_DEFAULT,
+	    &comp, &csize);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(csize < test_data_size);
+	
+	rc = gzip_expand(comp, csize, &out, &osize);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(test_data_size, osize);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, out, osize));
+	
+	free(out);
+	free(comp);
+	free(data);
+}
+
+/** Streamed compression is verified by the decompression stream */
+PCUT_TEST(stream)
+{
+	uint8_t *data = gen_data(test_data_size);
+	uint8_t *comp = malloc(2 * test_data_size);
+	uint8_t *out = malloc(test_data_size);
+	gzip_compress_stream_t *cstream;
+	gzip_stream_t *stream;
+	size_t pos = 0;
+	size_t csize = 0;
+	size_t osize = 0;
+	size_t nread;
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(comp);
+	PCUT_ASSERT_NOT_NULL(out);
+	
+	errno_t rc = gzip_compress_stream_create(DEFLATE_LEVEL_BEST, &cstream);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	
+	while (true) {
+		rc = gzip_compress_stream_drain(cstream, comp + csize, 1000,
+		    &nread);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		
+		csize += nread;
+		if (nread == 1000)
+			continue;
+		
+		if (gzip_compress_stream_done(cstream))
+			break;
+		
+		size_t len = min(3000, test_data_size - pos);
+		gzip_compress_stream_feed(cstream, data + pos, len);
+		pos += len;
+		
+		if (pos == test_data_size)
+			gzip_compress_stream_finish(cstream);
+	}
+	
+	gzip_compress_stream_destroy(cstream);
+	
+	rc = gzip_stream_create(&stream);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	
+	gzip_stream_feed(stream, comp, csize);
+	
+	do {
+		rc = gzip_stream_drain(stream, out + osize,
+		    test_data_size - osize, &nread);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		osize += nread;
+	} while (nread > 0);
+	
+	PCUT_ASSERT_TRUE(gzip_stream_done(stream));
+	PCUT_ASSERT_INT_EQUALS(test_data_size, osize);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, out, osize));
+	
+	gzip_stream_destroy(stream);
+	free(out);
+	free(comp);
+	free(data);
+}
+
+/** Corrupted data fails the CRC check */
+PCUT_TEST(crc_mismatch)
+{
+	uint8_t *data = gen_data(test_data_size);
+	uint8_t *out = malloc(test_data_size);
+	void *comp;
+	size_t csize;
+	gzip_stream_t *stream;
+	size_t nread;
+	
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(out);
+	
+	errno_t rc = gzip_compress(data, test_data_size, DEFLATE_LEVEL_STORE,
+	    &comp, &csize);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	
+	/* Flip a bit of the stored payload */
+	((uint8_t *) comp)[csize / 2] ^= 1;
+	
+	rc = gzip_stream_create(&stream);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	
+	gzip_stream_feed(stream, comp, csize);
+	
+	size_t osize = 0;
+	do {
+		rc = gzip_stream_drain(stream, out + osize,
+		    test_data_size - osize, &nread);
+		osize += nread;
+	} while ((rc == EOK) && (nread > 0));
+	
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	
+	gzip_stream_destroy(stream);
+	free(comp);
+	free(out);
+	free(data);
+}
+
+PCUT_EXPORT(gzip);
@@ -35,6 +35,7 @@
 
 #include <assert.h>
 #include <adt/list.h>
+#include <macros.h>
 #include <stdlib.h>
 
 #include "drawctx.h"
@@ -121,6 +122,62 @@ void drawctx_set_font(drawctx_t *context, font_t *font)
 	context->font = font;
 }
 
+/** Number of pixels the span renderer samples at once */
+#define TRANSFER_SPAN  256
+
+/** Transfer the source to the surface scanline by scanline.
+ *
+ * Handles textured sources without masks and clipping, as long as both
+ * the filter and the compose function have span variants. Source
+ * coordinates are stepped along each scanline in fixed point.
+ *
+ * @return @c true if the transfer was done, @c false if the source
+ *         must be transferred pixel by pixel.
+ */
+static bool drawctx_transfer_span(drawctx_t *context,
+    sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
+{
+	source_t *source = context->source;
+	pixel_t buf[TRANSFER_SPAN];
+
+	if (context->shall_clip || context->mask != NULL ||
+	    source->mask != NULL || source->texture == NULL)
+		return false;
+
+	filter_span_t filter = filter_get_span(source->filter);
+	compose_span_t compose = compose_get_span(context->compose);
+	if (filter == NULL || compose == NULL)
+		return false;
+
+	/* Pixels outside of the surface are not drawn. */
+	pixelmap_t *dst_map = surface_pixmap_access(context->surface);
+	if (x >= dst_map->width || y >= dst_map->height)
+		return true;
+	if (width > dst_map->width - x)
+		width = dst_map->width - x;
+	if (height > dst_map->height - y)
+		height = dst_map->height - y;
+
+	pixelmap_t *src_map = surface_pixmap_access(source->texture);
+
+	for (sysarg_t _y = y; _y < y + height; ++_y) {
+		transform_step_t step;
+		transform_step_init(&step, &source->transform, x, _y);
+
+		pixel_t *dst = pixelmap_pixel_at(dst_map, x, _y);
+		sysarg_t count;
+		for (sysarg_t done = 0; done < width; done += count) {
+			count = min(width - done, TRANSFER_SPAN);
+			filter(src_map, &step, source->texture_extend, buf, count);
+			compose_alpha_span(buf, count, ALPHA(source->alpha));
+			compose(dst + done, buf, count);
+		}
+	}
+
+	surface_add_damaged_region(context->surface, x, y, width, height);
+	return true;
+}
+
 void drawctx_transfer(drawctx_t *context,
     sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
 {
@@ -147,7 +204,7 @@ void drawctx_transfer(drawctx_t *context,
 		}
 		surface_add_damaged_region(context->surface, x, y, width, height);
 
-	} else {
+	} else if (!drawctx_transfer_span(context, x, y, width, height)) {
 
 		bool clipped = false;
 		bool masked = false;
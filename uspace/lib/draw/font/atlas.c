@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup draw
+ * @{
+ */
+/**
+ * @file
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <macros.h>
+#include <mem.h>
+#include <str.h>
+
+#include "../drawctx.h"
+#include "../source.h"
+#include "atlas.h"
+
+/** Number of glyphs drawn by a single pass over the cell scanlines */
+#define RUN_BATCH  64
+
+/** Create a glyph atlas for a font.
+ *
+ * The cell width is the advancement of the font's glyph for 'M', the cell
+ * height is the line height of the font. The atlas is thus suitable for
+ * monospaced fonts; glyphs of other fonts are clipped to the cell.
+ *
+ * @param font Font to draw glyphs of
+ * @param out_atlas Place to store the new atlas
+ * @return EOK on success or an error code
+ */
+errno_t font_atlas_create(font_t *font, font_atlas_t **out_atlas)
+{
+	font_metrics_t fm;
+	errno_t rc = font_get_metrics(font, &fm);
+	if (rc != EOK)
+		return rc;
+	
+	glyph_id_t glyph_id;
+	rc = font_resolve_glyph(font, 'M', &glyph_id);
+	if (rc != EOK)
+		rc = font_resolve_glyph(font, U_SPECIAL, &glyph_id);
+	if (rc != EOK)
+		return rc;
+	
+	glyph_metrics_t gm;
+	rc = font_get_glyph_metrics(font, glyph_id, &gm);
+	if (rc != EOK)
+		return rc;
+	
+	metric_t width = glyph_metrics_get_advancement(&gm);
+	metric_t height = fm.ascender + fm.descender;
+	if (width <= 0 || height <= 0)
+		return EINVAL;
+	
+	font_atlas_t *atlas = calloc(1, sizeof(font_atlas_t));
+	if (atlas == NULL)
+		return ENOMEM;
+	
+	atlas->font = font;
+	atlas->cell_width = width;
+	atlas->cell_height = height;
+	atlas->ascender = fm.ascender;
+	
+	size_t cell = atlas->cell_width * atlas->cell_height;
+	atlas->coverage = malloc(FONT_ATLAS_GLYPHS * cell);
+	atlas->pixels = malloc(FONT_ATLAS_TILES * cell * sizeof(pixel_t));
+	atlas->scratch = surface_create(width, height, NULL, 0);
+	if (atlas->coverage == NULL || atlas->pixels == NULL ||
+	    atlas->scratch == NULL) {
+		font_atlas_destroy(atlas);
+		return ENOMEM;
+	}
+	
+	*out_atlas = atlas;
+	return EOK;
+}
+
+/** Destroy a glyph atlas.
+ *
+ * The font itself is not released.
+ */
+void font_atlas_destroy(font_atlas_t *atlas)
+{
+	if (atlas->scratch != NULL)
+		surface_destroy(atlas->scratch);
+	
+	free(atlas->coverage);
+	free(atlas->pixels);
+	free(atlas);
+}
+
+/** Get the size of an atlas cell in pixels. */
+void font_atlas_get_cell(font_atlas_t *atlas, sysarg_t *width,
+    sysarg_t *height)
+{
+	*width = atlas->cell_width;
+	*height = atlas->cell_height;
+}
+
+/** Resolve a character, falling back to the replacement glyph. */
+static errno_t font_atlas_resolve(font_atlas_t *atlas, wchar_t c,
+    glyph_id_t *glyph_id)
+{
+	errno_t rc = font_resolve_glyph(atlas->font, c, glyph_id);
+	if (rc != EOK) {
+		errno_t rc2 = font_resolve_glyph(atlas->font, U_SPECIAL,
+		    glyph_id);
+		if (rc2 != EOK)
+			return rc;
+	}
+	
+	return EOK;
+}
+
+/** Get the coverage of a glyph, rendering it if it is not cached. */
+static uint8_t *font_atlas_coverage(font_atlas_t *atlas, glyph_id_t glyph_id)
+{
+	size_t cell = atlas->cell_width * atlas->cell_height;
+	size_t slot = glyph_id % FONT_ATLAS_GLYPHS;
+	uint8_t *coverage = atlas->coverage + slot * cell;
+	
+	if (atlas->glyphs[slot].valid && atlas->glyphs[slot].glyph == glyph_id)
+		return coverage;
+	
+	/* Render the glyph in opaque white onto a transparent cell. */
+	pixel_t *pixels = surface_direct_access(atlas->scratch);
+	memset(pixels, 0, cell * sizeof(pixel_t));
+	
+	source_t source;
+	source_init(&source);
+	source_set_color(&source, PIXEL(255, 255, 255, 255));
+	
+	drawctx_t context;
+	drawctx_init(&context, atlas->scratch);
+	drawctx_set_source(&context, &source);
+	
+	errno_t rc = font_render_glyph(atlas->font, &context, &source, 0,
+	    atlas->ascender, glyph_id);
+	if (rc != EOK)
+		memset(pixels, 0, cell * sizeof(pixel_t));
+	
+	for (size_t i = 0; i < cell; i++)
+		coverage[i] = ALPHA(pixels[i]);
+	
+	atlas->glyphs[slot].glyph = glyph_id;
+	atlas->glyphs[slot].valid = true;
+	return coverage;
+}
+
+/** Blend two colors, 255 meaning the first one only. */
+static inline pixel_t font_atlas_blend(pixel_t fgcolor, pixel_t bgcolor,
+    unsigned int a)
+{
+	if (a == 0)
+		return bgcolor;
+	if (a == 255)
+		return fgcolor;
+	
+	unsigned int na = 255 - a;
+	return PIXEL(
+	    (ALPHA(fgcolor) * a + ALPHA(bgcolor) * na) / 255,
+	    (RED(fgcolor) * a + RED(bgcolor) * na) / 255,
+	    (GREEN(fgcolor) * a + GREEN(bgcolor) * na) / 255,
+	    (BLUE(fgcolor) * a + BLUE(bgcolor) * na) / 255);
+}
+
+/** Get the tile slot of a glyph drawn in the given colors. */
+static inline size_t font_atlas_tile_slot(glyph_id_t glyph_id,
+    pixel_t fgcolor, pixel_t bgcolor)
+{
+	return (glyph_id ^ (fgcolor * 0x9e3779b1U) ^
+	    (bgcolor * 0x85ebca6bU)) % FONT_ATLAS_TILES;
+}
+
+/** Get the pre-blended tile of a glyph, blending it if it is not cached.
+ *
+ * The tile is marked as used by the current run batch.
+ */
+static pixel_t *font_atlas_tile(font_atlas_t *atlas, size_t slot,
+    glyph_id_t glyph_id, pixel_t fgcolor, pixel_t bgcolor)
+{
+	size_t cell = atlas->cell_width * atlas->cell_height;
+	font_atlas_tile_t *tile = &atlas->tiles[slot];
+	pixel_t *pixels = atlas->pixels + slot * cell;
+	
+	tile->batch = atlas->batch;
+	
+	if (tile->valid && tile->glyph == glyph_id &&
+	    tile->fgcolor == fgcolor && tile->bgcolor == bgcolor) {
+		atlas->tile_hits++;
+		return pixels;
+	}
+	
+	atlas->tile_misses++;
+	
+	uint8_t *coverage = font_atlas_coverage(atlas, glyph_id);
+	for (size_t i = 0; i < cell; i++)
+		pixels[i] = font_atlas_blend(fgcolor, bgcolor, coverage[i]);
+	
+	tile->glyph = glyph_id;
+	tile->fgcolor = fgcolor;
+	tile->bgcolor = bgcolor;
+	tile->valid = true;
+	return pixels;
+}
+
+/** Draw a run of characters sharing the same colors.
+ *
+ * Each character occupies one atlas cell, the whole cell including
+ * the background is overwritten. The run is drawn in batches, scanline by
+ * scanline across all characters of a batch. A batch ends early when a
+ * character needs a tile slot already holding another glyph of the batch,
+ * so that no tile is replaced before it is drawn. Parts outside of the
+ * surface are clipped.
+ *
+ * @param atlas Glyph atlas
+ * @param surface Surface to draw to
+ * @param x Left side of the first cell
+ * @param y Top side of the cells
+ * @param text Characters to draw
+ * @param len Number of characters
+ * @param fgcolor Foreground color
+ * @param bgcolor Background color
+ * @return EOK on success or an error code
+ */
+errno_t font_atlas_draw_run(font_atlas_t *atlas, surface_t *surface,
+    sysarg_t x, sysarg_t y, const wchar_t *text, size_t len,
+    pixel_t fgcolor, pixel_t bgcolor)
+{
+	pixelmap_t *pixmap = surface_pixmap_access(surface);
+	sysarg_t cw = atlas->cell_width;
+	sysarg_t ch = atlas->cell_height;
+	
+	if (x >= pixmap->width || y >= pixmap->height)
+		return EOK;
+	
+	/* Draw only cells which fit horizontally. */
+	if (len > (pixmap->width - x) / cw)
+		len = (pixmap->width - x) / cw;
+	if (ch > pixmap->height - y)
+		ch = pixmap->height - y;
+	
+	pixel_t *tiles[RUN_BATCH];
+	size_t done = 0;
+	while (done < len) {
+		size_t max = min(len - done, RUN_BATCH);
+		size_t count = 0;
+		
+		atlas->batch++;
+		while (count < max) {
+			glyph_id_t glyph_id;
+			errno_t rc = font_atlas_resolve(atlas,
+			    text[done + count], &glyph_id);
+			if (rc != EOK)
+				return rc;
+			
+			size_t slot = font_atlas_tile_slot(glyph_id, fgcolor,
+			    bgcolor);
+			font_atlas_tile_t *tile = &atlas->tiles[slot];
+			if (count > 0 && tile->batch == atlas->batch &&
+			    tile->glyph != glyph_id)
+				break;
+			
+			tiles[count++] = font_atlas_tile(atlas, slot, glyph_id,
+			    fgcolor, bgcolor);
+		}
+		
+		for (sysarg_t row = 0; row < ch; row++) {
+			pixel_t *dst = pixelmap_pixel_at(pixmap,
+			    x + done * cw, y + row);
+			for (size_t i = 0; i < count; i++) {
+				memcpy(dst, tiles[i] + row * cw,
+				    cw * sizeof(pixel_t));
+				dst += cw;
+			}
+		}
+		
+		done += count;
+	}
+	
+	surface_add_damaged_region(surface, x, y, len * cw, ch);
+	return EOK;
+}
+
+/** @}
+ */
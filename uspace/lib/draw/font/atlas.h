@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup draw
+ * @{
+ */
+/**
+ * @file
+ */
+
+#ifndef DRAW_FONT_ATLAS_H_
+#define DRAW_FONT_ATLAS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <io/pixel.h>
+
+#include "../font.h"
+#include "../surface.h"
+
+/** Number of glyph coverage maps kept by an atlas */
+#define FONT_ATLAS_GLYPHS  256
+
+/** Number of pre-blended glyph tiles kept by an atlas */
+#define FONT_ATLAS_TILES  512
+
+typedef struct {
+	glyph_id_t glyph;
+	bool valid;
+} font_atlas_glyph_t;
+
+typedef struct {
+	glyph_id_t glyph;
+	pixel_t fgcolor;
+	pixel_t bgcolor;
+	bool valid;
+	/** Run batch which last used the tile */
+	unsigned int batch;
+} font_atlas_tile_t;
+
+/** Glyph atlas for cell based text rendering.
+ *
+ * Glyph coverage is rendered once into a packed array of cells. For each
+ * used combination of glyph and colors, a tile with the coverage blended
+ * between the foreground and background color is kept, so drawing a glyph
+ * amounts to copying its tile scanlines to the target surface.
+ */
+typedef struct {
+	font_t *font;
+	
+	/** Cell width and height in pixels */
+	sysarg_t cell_width;
+	sysarg_t cell_height;
+	/** Distance between top of the cell and baseline */
+	metric_t ascender;
+	
+	/** Scratch surface for rendering glyph coverage */
+	surface_t *scratch;
+	
+	/** Coverage cache, one byte per pixel of each cell */
+	font_atlas_glyph_t glyphs[FONT_ATLAS_GLYPHS];
+	uint8_t *coverage;
+	
+	/** Pre-blended tile cache, one pixel per pixel of each cell */
+	font_atlas_tile_t tiles[FONT_ATLAS_TILES];
+	pixel_t *pixels;
+	/** Current run batch */
+	unsigned int batch;
+	
+	/** Statistics */
+	size_t tile_hits;
+	size_t tile_misses;
+} font_atlas_t;
+
+extern errno_t font_atlas_create(font_t *, font_atlas_t **);
+extern void font_atlas_destroy(font_atlas_t *);
+extern void font_atlas_get_cell(font_atlas_t *, sysarg_t *, sysarg_t *);
+extern errno_t font_atlas_draw_run(font_atlas_t *, surface_t *, sysarg_t,
+    sysarg_t, const wchar_t *, size_t, pixel_t, pixel_t);
+
+#endif
+
+/** @}
+ */
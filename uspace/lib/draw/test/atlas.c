@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <pcut/pcut.h>
+#include <stdbool.h>
+#include "../font.h"
+#include "../surface.h"
+#include "../font/atlas.h"
+#include "../font/embedded.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(atlas);
+
+#define FGCOLOR  PIXEL(255, 255, 255, 255)
+#define BGCOLOR  PIXEL(255, 0, 0, 0)
+
+/** Check whether a cell of one surface equals a cell of another one. */
+static bool cells_equal(surface_t *a, sysarg_t ax, surface_t *b,
+    sysarg_t bx, sysarg_t cw, sysarg_t ch)
+{
+	for (sysarg_t y = 0; y < ch; y++) {
+		for (sysarg_t x = 0; x < cw; x++) {
+			if (surface_get_pixel(a, ax + x, y) !=
+			    surface_get_pixel(b, bx + x, y))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/** Draw a single character into the first cell of a surface. */
+static errno_t draw_char(font_atlas_t *atlas, surface_t *surface, wchar_t c)
+{
+	return font_atlas_draw_run(atlas, surface, 0, 0, &c, 1, FGCOLOR,
+	    BGCOLOR);
+}
+
+/** Glyphs sharing a tile slot are both drawn correctly within one run */
+PCUT_TEST(draw_run_slot_collision)
+{
+	font_t *font;
+	font_atlas_t *atlas;
+	sysarg_t cw, ch;
+	glyph_id_t glyphs[FONT_ATLAS_TILES];
+	wchar_t chars[FONT_ATLAS_TILES];
+	wchar_t run[2] = { 0, 0 };
+
+	errno_t rc = embedded_font_create(&font, 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = font_atlas_create(font, &atlas);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	font_atlas_get_cell(atlas, &cw, &ch);
+
+	surface_t *sa = surface_create(2 * cw, ch, NULL, 0);
+	surface_t *sb = surface_create(2 * cw, ch, NULL, 0);
+	surface_t *srun = surface_create(2 * cw, ch, NULL, 0);
+	PCUT_ASSERT_NOT_NULL(sa);
+	PCUT_ASSERT_NOT_NULL(sb);
+	PCUT_ASSERT_NOT_NULL(srun);
+
+	/*
+	 * With equal colors, glyphs map to the same tile slot iff their
+	 * IDs are equal modulo the number of tiles. Find two such glyphs
+	 * which also look different.
+	 */
+	for (size_t i = 0; i < FONT_ATLAS_TILES; i++)
+		chars[i] = 0;
+
+	for (wchar_t c = 0x21; c < 0x10000 && run[0] == 0; c++) {
+		glyph_id_t glyph_id;
+		if (font_resolve_glyph(font, c, &glyph_id) != EOK)
+			continue;
+
+		size_t slot = glyph_id % FONT_ATLAS_TILES;
+		if (chars[slot] == 0) {
+			chars[slot] = c;
+			glyphs[slot] = glyph_id;
+			continue;
+		}
+
+		if (glyphs[slot] == glyph_id)
+			continue;
+
+		rc = draw_char(atlas, sa, chars[slot]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		rc = draw_char(atlas, sb, c);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		if (!cells_equal(sa, 0, sb, 0, cw, ch)) {
+			run[0] = chars[slot];
+			run[1] = c;
+		}
+	}
+
+	PCUT_ASSERT_TRUE(run[0] != 0);
+
+	rc = font_atlas_draw_run(atlas, srun, 0, 0, run, 2, FGCOLOR, BGCOLOR);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_TRUE(cells_equal(srun, 0, sa, 0, cw, ch));
+	PCUT_ASSERT_TRUE(cells_equal(srun, cw, sb, 0, cw, ch));
+
+	surface_destroy(sa);
+	surface_destroy(sb);
+	surface_destroy(srun);
+	font_atlas_destroy(atlas);
+	font_release(font);
+}
+
+PCUT_EXPORT(atlas);
@@ -38,14 +38,32 @@
 #include <async.h>
 #include <nic/nic.h>
 #include <ipc/common.h>
+#include <stdint.h>
 
 
 typedef enum {
 	NIC_EV_ADDR_CHANGED = IPC_FIRST_USER_METHOD,
 	NIC_EV_RECEIVED,
-	NIC_EV_DEVICE_STATE
+	NIC_EV_DEVICE_STATE,
+	NIC_EV_RECEIVED_BATCH
 } nic_event_t;
 
+/** Maximum size of a NIC_EV_RECEIVED_BATCH payload */
+#define NIC_RX_BATCH_SIZE  (64 * 1024)
+
+/** Alignment of frame records in a NIC_EV_RECEIVED_BATCH payload */
+#define NIC_RX_BATCH_ALIGN  4
+
+/** Header preceding each frame in a NIC_EV_RECEIVED_BATCH payload
+ *
+ * The frame data follow the header immediately, the next header starts
+ * at the nearest NIC_RX_BATCH_ALIGN boundary after the frame data.
+ */
+typedef struct {
+	/** Frame size in bytes */
+	uint32_t size;
+} nic_rx_batch_hdr_t;
+
 extern errno_t nic_send_frame(async_sess_t *, void *, size_t);
 extern errno_t nic_callback_create(async_sess_t *, async_port_handler_t, void *);
 extern errno_t nic_get_state(async_sess_t *, nic_device_state_t *);
@@ -1198,69 +1198,76 @@ errno_t ext4_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 		return EOK;
 	}
 	
-	/* For now, we only read data from one block at a time */
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
-	aoff64_t file_block = pos / block_size;
-	uint32_t offset_in_block = pos % block_size;
-	uint32_t bytes = min(block_size - offset_in_block, size);
+	block_iov_t biov;
+	uint8_t *zeros = NULL;
+	size_t bytes = 0;
+	errno_t rc;
 	
 	/* Handle end of file */
-	if (pos + bytes > file_size)
-		bytes = file_size - pos;
-	
-	/* Get the real block number */
-	uint32_t fs_block;
-	errno_t rc = ext4_filesystem_get_inode_data_block_index(inode_ref,
-	    file_block, &fs_block);
-	if (rc != EOK) {
-		async_answer_0(callid, rc);
-		return rc;
-	}
-	
-	/*
-	 * Check for sparse file.
-	 * If ext4_filesystem_get_inode_data_block_index returned
-	 * fs_block == 0, it means that the given block is not allocated for the
-	 * file and we need to return a buffer of zeros
-	 */
-	uint8_t *buffer;
-	if (fs_block == 0) {
-		buffer = malloc(bytes);
-		if (buffer == NULL) {
-			async_answer_0(callid, ENOMEM);
-			return ENOMEM;
-		}
+	if (pos + size > file_size)
+		size = file_size - pos;
+	
+	/* Gather as many blocks as can be sent in a single answer */
+	block_iov_init(&biov);
+	while (bytes < size && !block_iov_full(&biov)) {
+		aoff64_t file_block = (pos + bytes) / block_size;
+		uint32_t offset_in_block = (pos + bytes) % block_size;
+		size_t chunk = min(block_size - offset_in_block, size - bytes);
 		
-		memset(buffer, 0, bytes);
+		/* Get the real block number */
+		uint32_t fs_block;
+		rc = ext4_filesystem_get_inode_data_block_index(inode_ref,
+		    file_block, &fs_block);
+		if (rc != EOK)
+			goto error;
 		
-		rc = async_data_read_finalize(callid, buffer, bytes);
-		*rbytes = bytes;
+		/*
+		 * Check for sparse file.
+		 * If ext4_filesystem_get_inode_data_block_index returned
+		 * fs_block == 0, it means that the given block is not
+		 * allocated for the file and we need to return zeros
+		 */
+		if (fs_block == 0) {
+			if (zeros == NULL) {
+				zeros = calloc(block_size, 1);
+				if (zeros == NULL) {
+					rc = ENOMEM;
+					goto error;
+				}
+			}
+			
+			rc = block_iov_add_buf(&biov, zeros, chunk);
+			assert(rc == EOK);
+		} else {
+			/* Usual case - we need to read a block from device */
+			block_t *block;
+			rc = block_get(&block, inst->service_id, fs_block,
+			    BLOCK_FLAGS_NONE);
+			if (rc != EOK)
+				goto error;
+			
+			rc = block_iov_add_block(&biov, block, offset_in_block,
+			    chunk);
+			assert(rc == EOK);
+		}
 		
-		free(buffer);
-		return rc;
-	}
-	
-	/* Usual case - we need to read a block from device */
-	block_t *block;
-	rc = block_get(&block, inst->service_id, fs_block, BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		async_answer_0(callid, rc);
-		return rc;
-	}
-	
-	assert(offset_in_block + bytes <= block_size);
-	rc = async_data_read_finalize(callid, block->data + offset_in_block, bytes);
-	if (rc != EOK) {
-		block_put(block);
-		return rc;
+		bytes += chunk;
 	}
 	
-	rc = block_put(block);
+	rc = block_iov_finalize(&biov, callid);
+	free(zeros);
 	if (rc != EOK)
 		return rc;
 	
 	*rbytes = bytes;
 	return EOK;
+	
+error:
+	(void) block_iov_fini(&biov);
+	free(zeros);
+	async_answer_0(callid, rc);
+	return rc;
 }
 
 /** Write bytes to file
@@ -38,6 +38,7 @@
 #include <io/chargrid.h>
 #include <surface.h>
 #include <gfx/font-8x16.h>
+#include <font/embedded.h>
 #include <io/con_srv.h>
 #include <io/concaps.h>
 #include <io/console.h>
@@ -47,6 +48,8 @@
 #include <atomic.h>
 #include <stdarg.h>
 #include <str.h>
+#include <macros.h>
+#include <mem.h>
 #include "window.h"
 #include "terminal.h"
 
@@ -60,6 +63,9 @@
 #define TERM_CAPS \
 	(CONSOLE_CAP_STYLE | CONSOLE_CAP_INDEXED | CONSOLE_CAP_RGB)
 
+/** Maximum number of cells drawn as a single text run */
+#define TERM_RUN_LEN  64
+
 static LIST_INITIALIZE(terms);
 
 static errno_t term_open(con_srvs_t *, con_srv_t *);
@@ -164,42 +170,139 @@ static inline void attrs_rgb(char_attrs_t attrs, pixel_t *bgcolor, pixel_t *fgco
 	}
 }
 
+/** Draw a span of cells of a row from the back buffer.
+ *
+ * Consecutive cells sharing colors are drawn by the glyph atlas as
+ * a single text run.
+ */
+static void term_update_cells(terminal_t *term, surface_t *surface,
+    sysarg_t sx, sysarg_t sy, sysarg_t row, sysarg_t col_from, sysarg_t col_to)
+{
+	wchar_t run[TERM_RUN_LEN];
+	size_t run_len = 0;
+	sysarg_t run_col = col_from;
+	pixel_t run_bgcolor = 0;
+	pixel_t run_fgcolor = 0;
+	
+	for (sysarg_t col = col_from; col <= col_to; col++) {
+		pixel_t bgcolor = 0;
+		pixel_t fgcolor = 0;
+		charfield_t *field = NULL;
+		
+		if (col < col_to) {
+			field = chargrid_charfield_at(term->backbuf, col, row);
+			
+			if (chargrid_cursor_at(term->backbuf, col, row))
+				attrs_rgb(field->attrs, &fgcolor, &bgcolor);
+			else
+				attrs_rgb(field->attrs, &bgcolor, &fgcolor);
+		}
+		
+		/* Flush the run when the colors change or at the end. */
+		if ((run_len > 0) && ((field == NULL) ||
+		    (run_len == TERM_RUN_LEN) || (bgcolor != run_bgcolor) ||
+		    (fgcolor != run_fgcolor))) {
+			font_atlas_draw_run(term->atlas, surface,
+			    sx + run_col * FONT_WIDTH, sy + row * FONT_SCANLINES,
+			    run, run_len, run_fgcolor, run_bgcolor);
+			run_len = 0;
+		}
+		
+		if (field == NULL)
+			break;
+		
+		if (run_len == 0) {
+			run_col = col;
+			run_bgcolor = bgcolor;
+			run_fgcolor = fgcolor;
+		}
+		
+		run[run_len++] = field->ch;
+	}
+}
+
 static void term_update_char(terminal_t *term, surface_t *surface,
     sysarg_t sx, sysarg_t sy, sysarg_t col, sysarg_t row)
 {
-	charfield_t *field =
-	    chargrid_charfield_at(term->backbuf, col, row);
-	
-	bool inverted = chargrid_cursor_at(term->backbuf, col, row);
+	term_update_cells(term, surface, sx, sy, row, col, col + 1);
+}
+
+/** Bring a row of the back buffer up to date and redraw its changes.
+ *
+ * @param force Redraw the whole row even if it did not change.
+ * @return @c true if anything was drawn.
+ */
+static bool term_update_row(terminal_t *term, surface_t *surface,
+    sysarg_t sx, sysarg_t sy, sysarg_t row, bool force)
+{
+	sysarg_t col_from = term->cols;
+	sysarg_t col_to = 0;
+	
+	for (sysarg_t col = 0; col < term->cols; col++) {
+		charfield_t *front_field =
+		    chargrid_charfield_at(term->frontbuf, col, row);
+		charfield_t *back_field =
+		    chargrid_charfield_at(term->backbuf, col, row);
+		bool update = false;
+		
+		if (front_field->ch != back_field->ch) {
+			back_field->ch = front_field->ch;
+			update = true;
+		}
+		
+		if (!attrs_same(front_field->attrs, back_field->attrs)) {
+			back_field->attrs = front_field->attrs;
+			update = true;
+		}
+		
+		front_field->flags &= ~CHAR_FLAG_DIRTY;
+		
+		if (update) {
+			if (col < col_from)
+				col_from = col;
+			col_to = col + 1;
+		}
+	}
 	
-	sysarg_t bx = sx + (col * FONT_WIDTH);
-	sysarg_t by = sy + (row * FONT_SCANLINES);
+	if (force) {
+		col_from = 0;
+		col_to = term->cols;
+	}
 	
-	pixel_t bgcolor = 0;
-	pixel_t fgcolor = 0;
+	if (col_from >= col_to)
+		return false;
 	
-	if (inverted)
-		attrs_rgb(field->attrs, &fgcolor, &bgcolor);
-	else
-		attrs_rgb(field->attrs, &bgcolor, &fgcolor);
+	term_update_cells(term, surface, sx, sy, row, col_from, col_to);
+	return true;
+}
+
+/** Move part of the surface up by a number of scanlines. */
+static void term_scroll_surface(surface_t *surface, sysarg_t x, sysarg_t y,
+    sysarg_t width, sysarg_t height, sysarg_t lines)
+{
+	pixelmap_t *pixmap = surface_pixmap_access(surface);
 	
-	// FIXME: Glyph type should be actually uint32_t
-	//        for full UTF-32 coverage.
+	if ((x >= pixmap->width) || (y >= pixmap->height))
+		return;
 	
-	uint16_t glyph = fb_font_glyph(field->ch, NULL);
+	width = min(width, pixmap->width - x);
+	height = min(height, pixmap->height - y);
+	if (lines >= height)
+		return;
 	
-	for (unsigned int y = 0; y < FONT_SCANLINES; y++) {
-		pixel_t *dst = pixelmap_pixel_at(
-		    surface_pixmap_access(surface), bx, by + y);
-		pixel_t *dst_max = pixelmap_pixel_at(
-		    surface_pixmap_access(surface), bx + FONT_WIDTH - 1, by + y);
-		if (!dst || !dst_max) continue;
-		int count = FONT_WIDTH;
-		while (count-- != 0) {
-			*dst++ = (fb_font[glyph][y] & (1 << count)) ? fgcolor : bgcolor;
+	if ((x == 0) && (width == pixmap->width)) {
+		memmove(pixelmap_pixel_at(pixmap, 0, y),
+		    pixelmap_pixel_at(pixmap, 0, y + lines),
+		    (height - lines) * width * sizeof(pixel_t));
+	} else {
+		for (sysarg_t line = y; line < y + height - lines; line++) {
+			memmove(pixelmap_pixel_at(pixmap, x, line),
+			    pixelmap_pixel_at(pixmap, x, line + lines),
+			    width * sizeof(pixel_t));
 		}
 	}
-	surface_add_damaged_region(surface, bx, by, FONT_WIDTH, FONT_SCANLINES);
+	
+	surface_add_damaged_region(surface, x, y, width, height - lines);
 }
 
 static bool term_update_scroll(terminal_t *term, surface_t *surface,
@@ -210,31 +313,31 @@ static bool term_update_scroll(terminal_t *term, surface_t *surface,
 	if (term->top_row == top_row)
 		return false;
 	
+	sysarg_t lines = (top_row + term->rows - term->top_row) % term->rows;
 	term->top_row = top_row;
 	
-	for (sysarg_t row = 0; row < term->rows; row++) {
-		for (sysarg_t col = 0; col < term->cols; col++) {
-			charfield_t *front_field =
-			    chargrid_charfield_at(term->frontbuf, col, row);
-			charfield_t *back_field =
-			    chargrid_charfield_at(term->backbuf, col, row);
-			bool update = false;
-			
-			if (front_field->ch != back_field->ch) {
-				back_field->ch = front_field->ch;
-				update = true;
-			}
-			
-			if (!attrs_same(front_field->attrs, back_field->attrs)) {
-				back_field->attrs = front_field->attrs;
-				update = true;
-			}
-			
-			front_field->flags &= ~CHAR_FLAG_DIRTY;
-			
-			if (update)
-				term_update_char(term, surface, sx, sy, col, row);
-		}
+	/*
+	 * Move the rendered rows up instead of redrawing them. The back
+	 * buffer is rotated the same way, so it keeps describing the
+	 * surface contents except for the rows uncovered at the bottom.
+	 */
+	term_scroll_surface(surface, sx, sy, term->cols * FONT_WIDTH,
+	    term->rows * FONT_SCANLINES, lines * FONT_SCANLINES);
+	term->backbuf->top_row = top_row;
+	
+	for (sysarg_t row = 0; row < term->rows; row++)
+		term_update_row(term, surface, sx, sy, row,
+		    row >= term->rows - lines);
+	
+	/* The cursor was moved along with the surface contents. */
+	if (chargrid_get_cursor_visibility(term->backbuf)) {
+		sysarg_t col;
+		sysarg_t row;
+		chargrid_get_cursor(term->backbuf, &col, &row);
+		
+		if (row >= lines)
+			term_update_char(term, surface, sx, sy, col, row - lines);
+		term_update_char(term, surface, sx, sy, col, row);
 	}
 	
 	return true;
@@ -295,34 +398,8 @@ static void term_update(terminal_t *term)
 		damage = true;
 	} else {
 		for (sysarg_t y = 0; y < term->rows; y++) {
-			for (sysarg_t x = 0; x < term->cols; x++) {
-				charfield_t *front_field =
-				    chargrid_charfield_at(term->frontbuf, x, y);
-				charfield_t *back_field =
-				    chargrid_charfield_at(term->backbuf, x, y);
-				bool update = false;
-				
-				if ((front_field->flags & CHAR_FLAG_DIRTY) ==
-				    CHAR_FLAG_DIRTY) {
-					if (front_field->ch != back_field->ch) {
-						back_field->ch = front_field->ch;
-						update = true;
-					}
-					
-					if (!attrs_same(front_field->attrs,
-					    back_field->attrs)) {
-						back_field->attrs = front_field->attrs;
-						update = true;
-					}
-					
-					front_field->flags &= ~CHAR_FLAG_DIRTY;
-				}
-				
-				if (update) {
-					term_update_char(term, surface, sx, sy, x, y);
-					damage = true;
-				}
-			}
+			if (term_update_row(term, surface, sx, sy, y, false))
+				damage = true;
 		}
 	}
 	
@@ -352,20 +429,8 @@ static void term_damage(terminal_t *term)
 	sysarg_t sy = term->widget.vpos;
 	
 	if (!term_update_scroll(term, surface, sx, sy)) {
-		for (sysarg_t y = 0; y < term->rows; y++) {
-			for (sysarg_t x = 0; x < term->cols; x++) {
-				charfield_t *front_field =
-				    chargrid_charfield_at(term->frontbuf, x, y);
-				charfield_t *back_field =
-				    chargrid_charfield_at(term->backbuf, x, y);
-				
-				back_field->ch = front_field->ch;
-				back_field->attrs = front_field->attrs;
-				front_field->flags &= ~CHAR_FLAG_DIRTY;
-				
-				term_update_char(term, surface, sx, sy, x, y);
-			}
-		}
+		for (sysarg_t y = 0; y < term->rows; y++)
+			term_update_row(term, surface, sx, sy, y, true);
 	}
 	
 	term_update_cursor(term, surface, sx, sy);
@@ -596,6 +661,12 @@ void deinit_terminal(terminal_t *term)
 	
 	if (term->backbuf)
 		chargrid_destroy(term->backbuf);
+	
+	if (term->atlas)
+		font_atlas_destroy(term->atlas);
+	
+	if (term->font)
+		font_release(term->font);
 }
 
 static void terminal_destroy(widget_t *widget)
@@ -727,6 +798,8 @@ bool init_terminal(terminal_t *term, widget_t *parent, const void *data,
 	
 	term->frontbuf = NULL;
 	term->backbuf = NULL;
+	term->font = NULL;
+	term->atlas = NULL;
 	
 	term->frontbuf = chargrid_create(term->cols, term->rows,
 	    CHARGRID_FLAG_NONE);
@@ -746,12 +819,24 @@ bool init_terminal(terminal_t *term, widget_t *parent, const void *data,
 	chargrid_clear(term->backbuf);
 	term->top_row = 0;
 	
+	errno_t rc = embedded_font_create(&term->font, FONT_SCANLINES);
+	if (rc != EOK) {
+		widget_deinit(&term->widget);
+		return false;
+	}
+	
+	rc = font_atlas_create(term->font, &term->atlas);
+	if (rc != EOK) {
+		widget_deinit(&term->widget);
+		return false;
+	}
+	
 	async_set_fallback_port_handler(term_connection, NULL);
 	con_srvs_init(&term->srvs);
 	term->srvs.ops = &con_ops;
 	term->srvs.sarg = term;
 	
-	errno_t rc = loc_server_register(NAME);
+	rc = loc_server_register(NAME);
 	if (rc != EOK) {
 		widget_deinit(&term->widget);
 		return false;
@@ -39,6 +39,7 @@
 #include <stddef.h>
 #include <fibril_synch.h>
 #include <font.h>
+#include <font/atlas.h>
 #include <io/chargrid.h>
 #include <io/con_srv.h>
 #include <adt/list.h>
@@ -66,6 +67,9 @@ typedef struct terminal {
 	chargrid_t *backbuf;
 	sysarg_t top_row;
 	
+	font_t *font;
+	font_atlas_t *atlas;
+	
 	service_id_t dsid;
 	con_srvs_t srvs;
 } terminal_t;
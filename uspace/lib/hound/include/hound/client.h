@@ -39,6 +39,7 @@
 #include <async.h>
 #include <pcm/format.h>
 #include <hound/protocol.h>
+#include <sys/time.h>
 
 #define HOUND_DEFAULT_TARGET "default"
 #define HOUND_ALL_TARGETS "all"
@@ -46,6 +47,22 @@
 typedef struct hound_context hound_context_t;
 typedef struct hound_stream hound_stream_t;
 
+/** Latency statistics of a stream that uses a shared ring */
+typedef struct {
+	/** Number of periods measured */
+	unsigned periods;
+	/** Shortest time from write to mix (usec) */
+	suseconds_t min;
+	/** Longest time from write to mix (usec) */
+	suseconds_t max;
+	/** Average time from write to mix (usec) */
+	suseconds_t avg;
+	/** Time the mixed data wait in the device buffer (usec) */
+	suseconds_t lead;
+	/** Number of mixes that ran out of data */
+	unsigned underruns;
+} hound_stream_stats_t;
+
 hound_context_t *hound_context_create_playback(const char *name,
     pcm_format_t format, size_t bsize);
 hound_context_t *hound_context_create_capture(const char *name,
@@ -65,11 +82,15 @@ errno_t hound_context_disconnect_target(hound_context_t *hound, const char *targ
 
 hound_stream_t *hound_stream_create(hound_context_t *hound, unsigned flags,
     pcm_format_t format, size_t bsize);
+hound_stream_t *hound_stream_create_ring(hound_context_t *hound,
+    unsigned flags, pcm_format_t format, size_t period, unsigned periods);
 void hound_stream_destroy(hound_stream_t *stream);
 
 errno_t hound_stream_write(hound_stream_t *stream, const void *data, size_t size);
 errno_t hound_stream_read(hound_stream_t *stream, void *data, size_t size);
 errno_t hound_stream_drain(hound_stream_t *stream);
+errno_t hound_stream_get_stats(hound_stream_t *stream,
+    hound_stream_stats_t *stats);
 
 errno_t hound_write_main_stream(hound_context_t *hound,
     const void *data, size_t size);
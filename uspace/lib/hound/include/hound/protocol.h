@@ -39,6 +39,7 @@
 #include <async.h>
 #include <errno.h>
 #include <pcm/format.h>
+#include <stdint.h>
 
 extern const char *HOUND_SERVICE;
 
@@ -57,6 +58,45 @@ typedef enum {
 typedef async_sess_t hound_sess_t;
 typedef intptr_t hound_context_id_t;
 
+/** Maximum number of periods in a shared ring */
+#define HOUND_RING_MAX_PERIODS  32
+
+/** Shared memory ring buffer of a stream.
+ *
+ * The client writes audio data and advances write_pos, the server mixes the
+ * data and advances read_pos. Both positions count bytes since the stream
+ * was created. The ring data follows the header.
+ */
+typedef struct {
+	/** Size of the data area in bytes */
+	size_t size;
+	/** Period size in bytes */
+	size_t period;
+	/** Total bytes written by the client */
+	volatile size_t write_pos;
+	/** Total bytes mixed by the server */
+	volatile size_t read_pos;
+	/** Uptime (usec) of the write that started a period, by period index */
+	volatile uint64_t stamp[HOUND_RING_MAX_PERIODS];
+	/** Latency statistics, maintained by the server */
+	struct {
+		/** Number of periods measured */
+		volatile uint32_t count;
+		/** Shortest time from write to mix (usec) */
+		volatile uint32_t min;
+		/** Longest time from write to mix (usec) */
+		volatile uint32_t max;
+		/** Duration of the last mixed chunk (usec) */
+		volatile uint32_t lead;
+		/** Sum of all measured times (usec) */
+		volatile uint64_t sum;
+	} latency;
+	/** Number of mixes that did not find enough data */
+	volatile uint32_t underruns;
+	/** Audio data */
+	uint8_t data[];
+} hound_ring_t;
+
 hound_sess_t *hound_service_connect(const char *service);
 void hound_service_disconnect(hound_sess_t *sess);
 
@@ -88,6 +128,11 @@ errno_t hound_service_disconnect_source_sink(hound_sess_t *sess, const char *sou
 
 errno_t hound_service_stream_enter(async_exch_t *exch, hound_context_id_t id,
     int flags, pcm_format_t format, size_t bsize);
+errno_t hound_service_stream_enter_ring(async_exch_t *exch,
+    hound_context_id_t id, int flags, pcm_format_t format,
+    hound_ring_t *ring);
+errno_t hound_service_stream_wait(async_exch_t *exch, size_t pos,
+    size_t *new_pos);
 errno_t hound_service_stream_drain(async_exch_t *exch);
 errno_t hound_service_stream_exit(async_exch_t *exch);
 
@@ -113,6 +158,11 @@ typedef struct hound_server_iface {
 	/** Create new stream tied to the context */
 	errno_t (*add_stream)(void *, hound_context_id_t, int, pcm_format_t, size_t,
 	    void **);
+	/** Create new stream that takes its data from a shared ring */
+	errno_t (*add_ring_stream)(void *, hound_context_id_t, int, pcm_format_t,
+	    hound_ring_t *, size_t, void **);
+	/** Block until the ring read position moves away from the given one */
+	errno_t (*ring_wait)(void *, size_t, size_t *);
 	/** Destroy existing stream */
 	errno_t (*rem_stream)(void *, void *);
 	/** Block until the stream buffer is empty */
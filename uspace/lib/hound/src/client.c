@@ -34,9 +34,14 @@
  * Common USB functions.
  */
 #include <adt/list.h>
+#include <align.h>
+#include <as.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <libarch/barrier.h>
 #include <loc.h>
+#include <macros.h>
+#include <mem.h>
 #include <str.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -58,6 +63,8 @@ struct hound_stream {
 	hound_context_t *context;
 	/** Stream flags */
 	int flags;
+	/** Shared ring buffer, NULL if the data are sent over IPC */
+	hound_ring_t *ring;
 };
 
 /**
@@ -304,6 +311,7 @@ hound_stream_t *hound_stream_create(hound_context_t *hound, unsigned flags,
 		new_stream->format = format;
 		new_stream->context = hound;
 		new_stream->flags = flags;
+		new_stream->ring = NULL;
 		const errno_t ret = hound_service_stream_enter(new_stream->exch,
 		    hound->id, flags, format, bsize);
 		if (ret != EOK) {
@@ -316,6 +324,71 @@ hound_stream_t *hound_stream_create(hound_context_t *hound, unsigned flags,
 	return new_stream;
 }
 
+/**
+ * Create a new stream that passes data in a shared ring buffer.
+ * @param hound Hound context.
+ * @param flags new stream flags.
+ * @param format new stream PCM format.
+ * @param period Period size in bytes, must hold entire frames.
+ * @param periods Number of periods in the ring.
+ * @return Valid pointer to a stream instance, NULL on failure.
+ *
+ * Writes to the stream copy data directly to memory shared with the
+ * server. IPC is only used to wait for free space, drain and exit.
+ * Only playback contexts support ring streams.
+ */
+hound_stream_t *hound_stream_create_ring(hound_context_t *hound,
+    unsigned flags, pcm_format_t format, size_t period, unsigned periods)
+{
+	assert(hound);
+	const size_t frame_size = pcm_format_frame_size(&format);
+	if (hound->record || frame_size == 0 || period == 0 ||
+	    (period % frame_size) != 0 || periods < 2 ||
+	    periods > HOUND_RING_MAX_PERIODS)
+		return NULL;
+
+	const size_t area_size =
+	    ALIGN_UP(sizeof(hound_ring_t) + period * periods, PAGE_SIZE);
+	hound_ring_t *ring = as_area_create(AS_AREA_ANY, area_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (ring == AS_MAP_FAILED)
+		return NULL;
+
+	memset(ring, 0, sizeof(hound_ring_t));
+	ring->size = period * periods;
+	ring->period = period;
+	ring->latency.min = UINT32_MAX;
+
+	hound_stream_t *new_stream = malloc(sizeof(hound_stream_t));
+	if (!new_stream) {
+		as_area_destroy(ring);
+		return NULL;
+	}
+
+	new_stream->exch = async_exchange_begin(hound->session);
+	if (!new_stream->exch) {
+		free(new_stream);
+		as_area_destroy(ring);
+		return NULL;
+	}
+	link_initialize(&new_stream->link);
+	new_stream->format = format;
+	new_stream->context = hound;
+	new_stream->flags = flags;
+	new_stream->ring = ring;
+	const errno_t ret = hound_service_stream_enter_ring(new_stream->exch,
+	    hound->id, flags, format, ring);
+	if (ret != EOK) {
+		async_exchange_end(new_stream->exch);
+		free(new_stream);
+		as_area_destroy(ring);
+		return NULL;
+	}
+	list_append(&new_stream->link, &hound->stream_list);
+	return new_stream;
+}
+
 /**
  * Destroy existing stream
  * @param stream The stream to destroy.
@@ -331,10 +404,63 @@ void hound_stream_destroy(hound_stream_t *stream)
 		hound_service_stream_exit(stream->exch);
 		async_exchange_end(stream->exch);
 		list_remove(&stream->link);
+		if (stream->ring)
+			as_area_destroy(stream->ring);
 		free(stream);
 	}
 }
 
+/**
+ * Copy data to the shared ring, wait for free space if necessary.
+ * @param stream The target stream, must use a ring.
+ * @param data data buffer
+ * @param size size of the @p data buffer.
+ * @return error code.
+ *
+ * The function waits until at least a period (or the whole remaining data)
+ * fits in the ring, so the server is asked at most once per period.
+ */
+static errno_t hound_ring_write(hound_stream_t *stream, const void *data,
+    size_t size)
+{
+	hound_ring_t *ring = stream->ring;
+	const uint8_t *src = data;
+	size_t wpos = ring->write_pos;
+
+	while (size > 0) {
+		size_t rpos = ring->read_pos;
+		const size_t space = ring->size - (wpos - rpos);
+		if (space < min(size, ring->period)) {
+			const errno_t ret = hound_service_stream_wait(
+			    stream->exch, rpos, &rpos);
+			if (ret != EOK && ret != ETIMEOUT)
+				return ret;
+			continue;
+		}
+
+		const size_t offset = wpos % ring->size;
+		const size_t chunk = min(min(size, space), ring->size - offset);
+		memcpy(ring->data + offset, src, chunk);
+
+		/* Stamp every period that starts in this chunk */
+		struct timeval now;
+		getuptime(&now);
+		const uint64_t stamp =
+		    (uint64_t) now.tv_sec * 1000000 + now.tv_usec;
+		for (size_t p = ROUND_UP(wpos, ring->period) / ring->period;
+		    p * ring->period < wpos + chunk; ++p)
+			ring->stamp[p % HOUND_RING_MAX_PERIODS] = stamp;
+
+		/* Data and stamps must be visible before the new position */
+		write_barrier();
+		wpos += chunk;
+		ring->write_pos = wpos;
+		src += chunk;
+		size -= chunk;
+	}
+	return EOK;
+}
+
 /**
  * Send new data to a stream.
  * @param stream The target stream
@@ -347,6 +473,8 @@ errno_t hound_stream_write(hound_stream_t *stream, const void *data, size_t size
 	assert(stream);
 	if (!data || size == 0)
 		return EBADMEM;
+	if (stream->ring)
+		return hound_ring_write(stream, data, size);
 	return hound_service_stream_write(stream->exch, data, size);
 }
 
@@ -362,6 +490,8 @@ errno_t hound_stream_read(hound_stream_t *stream, void *data, size_t size)
 	assert(stream);
 	if (!data || size == 0)
 		return EBADMEM;
+	if (stream->ring)
+		return ENOTSUP;
 	return hound_service_stream_read(stream->exch, data, size);
 }
 
@@ -376,6 +506,35 @@ errno_t hound_stream_drain(hound_stream_t *stream)
 	return hound_service_stream_drain(stream->exch);
 }
 
+/**
+ * Get latency statistics of a stream.
+ * @param stream The stream, must use a shared ring.
+ * @param[out] stats Latency statistics.
+ * @return Error code, ENOTSUP if the stream does not use a ring.
+ *
+ * The server measures the time between a period being written to the ring
+ * and being mixed into the device buffer. The lead time estimates how long
+ * the mixed data wait in the device before they are played.
+ */
+errno_t hound_stream_get_stats(hound_stream_t *stream,
+    hound_stream_stats_t *stats)
+{
+	assert(stream);
+	assert(stats);
+	hound_ring_t *ring = stream->ring;
+	if (!ring)
+		return ENOTSUP;
+
+	const uint32_t count = ring->latency.count;
+	stats->periods = count;
+	stats->min = count ? ring->latency.min : 0;
+	stats->max = count ? ring->latency.max : 0;
+	stats->avg = count ? ring->latency.sum / count : 0;
+	stats->lead = ring->latency.lead;
+	stats->underruns = ring->underruns;
+	return EOK;
+}
+
 /**
  * Main stream getter function.
  * @param hound Houndcontext.
@@ -34,6 +34,7 @@
  * Common USB functions.
  */
 #include <adt/list.h>
+#include <as.h>
 #include <errno.h>
 #include <loc.h>
 #include <macros.h>
@@ -63,6 +64,10 @@ enum ipc_methods {
 	IPC_M_HOUND_STREAM_EXIT,
 	/** Wait until there is no data in the stream */
 	IPC_M_HOUND_STREAM_DRAIN,
+	/** Switch IPC pipe to stream mode backed by a shared ring */
+	IPC_M_HOUND_STREAM_ENTER_RING,
+	/** Wait until the server consumes data from the shared ring */
+	IPC_M_HOUND_STREAM_WAIT,
 };
 
 
@@ -315,6 +320,55 @@ errno_t hound_service_stream_enter(async_exch_t *exch, hound_context_id_t id,
 	    c.arg, bsize);
 }
 
+/**
+ * Switch IPC exchange to a STREAM mode that uses a shared ring buffer.
+ * @param exch IPC exchange.
+ * @param id context id this stream should be associated with
+ * @param flags set stream properties
+ * @param format format of the new stream.
+ * @param ring Initialized ring, must be the start of an address space area.
+ * @return Error code.
+ *
+ * Audio data are passed in the ring, the exchange only carries
+ * wait/drain/exit requests afterwards.
+ */
+errno_t hound_service_stream_enter_ring(async_exch_t *exch,
+    hound_context_id_t id, int flags, pcm_format_t format,
+    hound_ring_t *ring)
+{
+	const format_convert_t c = { .f = {
+		.channels = format.channels,
+		.rate = format.sampling_rate / 100,
+		.format = format.sample_format,
+	}};
+	ipc_call_t call;
+	aid_t mid = async_send_3(exch, IPC_M_HOUND_STREAM_ENTER_RING, id,
+	    flags, c.arg, &call);
+	const errno_t rc = async_share_out_start(exch, ring,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+
+	errno_t ret;
+	async_wait_for(mid, &ret);
+	return rc != EOK ? rc : ret;
+}
+
+/**
+ * Wait until the server moves the read position of a shared ring.
+ * @param exch IPC exchange in ring STREAM MODE.
+ * @param pos Last read position known to the caller.
+ * @param[out] new_pos Current read position.
+ * @return Error code, ETIMEOUT if the position did not move for a while.
+ */
+errno_t hound_service_stream_wait(async_exch_t *exch, size_t pos,
+    size_t *new_pos)
+{
+	sysarg_t val = pos;
+	const errno_t ret =
+	    async_req_1_1(exch, IPC_M_HOUND_STREAM_WAIT, pos, &val);
+	*new_pos = val;
+	return ret;
+}
+
 /**
  * Destroy existing stream and return IPC exchange to general mode.
  * @param exch IPC exchange.
@@ -365,6 +419,7 @@ errno_t hound_service_stream_read(async_exch_t *exch, void *data, size_t size)
 
 static void hound_server_read_data(void *stream);
 static void hound_server_write_data(void *stream);
+static void hound_server_ring(void *stream);
 static const hound_server_iface_t *server_iface;
 
 /**
@@ -604,8 +659,60 @@ void hound_connection_handler(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 			}
 			break;
 		}
+		case IPC_M_HOUND_STREAM_ENTER_RING: {
+			/* check interface functions */
+			if (!server_iface || !server_iface->add_ring_stream
+			    || !server_iface->ring_wait
+			    || !server_iface->rem_stream) {
+				async_answer_0(callid, ENOTSUP);
+				break;
+			}
+
+			/* get parameters */
+			hound_context_id_t id = IPC_GET_ARG1(call);
+			const int flags = IPC_GET_ARG2(call);
+			const format_convert_t c = {.arg = IPC_GET_ARG3(call)};
+			const pcm_format_t f = {
+			    .sampling_rate = c.f.rate * 100,
+			    .channels = c.f.channels,
+			    .sample_format = c.f.format,
+			};
+
+			/* map the ring */
+			ipc_callid_t share_id;
+			size_t size = 0;
+			unsigned int share_flags = 0;
+			if (!async_share_out_receive(&share_id, &size,
+			    &share_flags)) {
+				async_answer_0(share_id, EINVAL);
+				async_answer_0(callid, EINVAL);
+				break;
+			}
+			void *area = NULL;
+			errno_t ret = async_share_out_finalize(share_id, &area);
+			if (ret != EOK || area == AS_MAP_FAILED) {
+				async_answer_0(callid, ret != EOK ? ret : ENOMEM);
+				break;
+			}
+
+			void *stream;
+			ret = server_iface->add_ring_stream(server_iface->server,
+			    id, flags, f, area, size, &stream);
+			if (ret != EOK) {
+				as_area_destroy(area);
+				async_answer_0(callid, ret);
+				break;
+			}
+			async_answer_0(callid, EOK);
+			/* accept wait calls */
+			hound_server_ring(stream);
+			server_iface->rem_stream(server_iface->server, stream);
+			as_area_destroy(area);
+			break;
+		}
 		case IPC_M_HOUND_STREAM_EXIT:
 		case IPC_M_HOUND_STREAM_DRAIN:
+		case IPC_M_HOUND_STREAM_WAIT:
 			/* Stream exit/drain is only allowed in stream context*/
 			async_answer_0(callid, EINVAL);
 			break;
@@ -706,6 +813,44 @@ static void hound_server_write_data(void *stream)
 	async_answer_0(callid, ret);
 }
 
+/**
+ * Answer position waits on a stream that uses a shared ring.
+ * @param stream target stream, the server mixes data from its ring.
+ */
+static void hound_server_ring(void *stream)
+{
+	while (true) {
+		ipc_call_t call;
+		ipc_callid_t callid = async_get_call(&call);
+		switch (IPC_GET_IMETHOD(call)) {
+		case IPC_M_HOUND_STREAM_WAIT: {
+			size_t pos = IPC_GET_ARG1(call);
+			const errno_t ret =
+			    server_iface->ring_wait(stream, pos, &pos);
+			async_answer_1(callid, ret, pos);
+			break;
+		}
+		case IPC_M_HOUND_STREAM_DRAIN: {
+			errno_t ret = ENOTSUP;
+			if (server_iface->drain_stream)
+				ret = server_iface->drain_stream(stream);
+			async_answer_0(callid, ret);
+			break;
+		}
+		case IPC_M_HOUND_STREAM_EXIT:
+			async_answer_0(callid, EOK);
+			return;
+		case 0:
+			/* Client hung up */
+			async_answer_0(callid, EOK);
+			return;
+		default:
+			async_answer_0(callid, EINVAL);
+			break;
+		}
+	}
+}
+
 
 /***
  * SERVER SIDE
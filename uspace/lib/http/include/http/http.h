@@ -72,6 +72,7 @@ typedef struct {
 typedef struct {
 	char *method;
 	char *path;
+	http_version_t version;
 	http_headers_t headers;
 } http_request_t;
 
@@ -126,6 +127,9 @@ extern http_request_t *http_request_create(const char *, const char *);
 extern void http_request_destroy(http_request_t *);
 extern errno_t http_request_format(http_request_t *, char **, size_t *);
 extern errno_t http_send_request(http_t *, http_request_t *);
+extern errno_t http_receive_request(receive_buffer_t *, http_request_t **,
+    size_t, unsigned);
+extern bool http_request_keep_alive(http_request_t *);
 extern errno_t http_receive_status(receive_buffer_t *, http_version_t *, uint16_t *,
     char **);
 extern errno_t http_receive_response(receive_buffer_t *, http_response_t **,
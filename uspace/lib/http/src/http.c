@@ -46,6 +46,13 @@
 #include <http/http.h>
 #include <http/receive-buffer.h>
 
+/** Connection buffer sizes in TCP service */
+#define HTTP_SND_BUF_SIZE  (16 * 1024)
+#define HTTP_RCV_BUF_SIZE  (64 * 1024)
+
+/** Size of memory shared with TCP service in each direction */
+#define HTTP_RING_SIZE  (64 * 1024)
+
 static errno_t http_receive(void *client_data, void *buf, size_t buf_size,
     size_t *nrecv)
 {
@@ -56,7 +63,7 @@ static errno_t http_receive(void *client_data, void *buf, size_t buf_size,
 
 http_t *http_create(const char *host, uint16_t port)
 {
-	http_t *http = malloc(sizeof(http_t));
+	http_t *http = calloc(1, sizeof(http_t));
 	if (http == NULL)
 		return NULL;
 	
@@ -106,6 +113,11 @@ errno_t http_connect(http_t *http)
 	if (rc != EOK)
 		return rc;
 	
+	/* Only speeds up large transfers, the connection works without it */
+	(void) tcp_conn_set_bufsize(http->conn, HTTP_SND_BUF_SIZE,
+	    HTTP_RCV_BUF_SIZE);
+	(void) tcp_conn_ring_create(http->conn, HTTP_RING_SIZE);
+	
 	return rc;
 }
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013 Martin Sucha
+ * Copyright (c) 2018 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup http
+ * @{
+ */
+/**
+ * @file
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <str.h>
+
+#include <http/http.h>
+#include "parse.h"
+
+static bool is_digit(char c)
+{
+	return (c >= '0' && c <= '9');
+}
+
+/** Receive an exact string.
+ *
+ * @param rb Receive buffer
+ * @param expect String which must follow
+ * @return EOK on success, HTTP_EPARSE if different data follow or
+ *         another error code
+ */
+errno_t http_expect(receive_buffer_t *rb, const char *expect)
+{
+	size_t ndisc;
+	errno_t rc = recv_discard_str(rb, expect, &ndisc);
+	if (rc != EOK)
+		return rc;
+	if (ndisc < str_length(expect))
+		return HTTP_EPARSE;
+	return EOK;
+}
+
+/** Receive a non-empty word of characters of a class.
+ *
+ * @param rb Receive buffer
+ * @param class Character class of the word
+ * @param str Place to store the newly allocated word
+ * @return EOK on success, HTTP_EPARSE if the word is empty or
+ *         another error code
+ */
+errno_t http_receive_word(receive_buffer_t *rb, char_class_func_t class,
+    char **str)
+{
+	receive_buffer_mark_t start;
+	receive_buffer_mark_t end;
+	
+	recv_mark(rb, &start);
+	errno_t rc = recv_while(rb, class);
+	if (rc != EOK) {
+		recv_unmark(rb, &start);
+		return rc;
+	}
+	recv_mark(rb, &end);
+	
+	rc = recv_cut_str(rb, &start, &end, str);
+	recv_unmark(rb, &start);
+	recv_unmark(rb, &end);
+	if (rc == EOK && **str == '\0') {
+		free(*str);
+		*str = NULL;
+		rc = HTTP_EPARSE;
+	}
+	return rc;
+}
+
+errno_t http_receive_uint8_t(receive_buffer_t *rb, uint8_t *out_value)
+{
+	char *str = NULL;
+	errno_t rc = http_receive_word(rb, is_digit, &str);
+	if (rc != EOK)
+		return rc;
+	
+	rc = str_uint8_t(str, NULL, 10, true, out_value);
+	free(str);
+	return rc;
+}
+
+errno_t http_receive_uint16_t(receive_buffer_t *rb, uint16_t *out_value)
+{
+	char *str = NULL;
+	errno_t rc = http_receive_word(rb, is_digit, &str);
+	if (rc != EOK)
+		return rc;
+	
+	rc = str_uint16_t(str, NULL, 10, true, out_value);
+	free(str);
+	return rc;
+}
+
+/** @}
+ */
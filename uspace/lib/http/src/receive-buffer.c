@@ -173,7 +173,11 @@ errno_t recv_char(receive_buffer_t *rb, char *c, bool consume)
 		if (rc != EOK)
 			return rc;
 		
-		rb->in = nrecv;
+		/* End of input */
+		if (nrecv == 0)
+			return EEMPTY;
+		
+		rb->in += nrecv;
 	}
 	
 	*c = rb->buffer[rb->out];
@@ -205,6 +209,10 @@ errno_t recv_discard(receive_buffer_t *rb, char discard, size_t *ndisc)
 {
 	char c = 0;
 	errno_t rc = recv_char(rb, &c, false);
+	if (rc == EEMPTY) {
+		*ndisc = 0;
+		return EOK;
+	}
 	if (rc != EOK)
 		return rc;
 	if (c != discard) {
@@ -297,28 +305,36 @@ errno_t recv_line(receive_buffer_t *rb, char *line, size_t size, size_t *nrecv)
 	size_t nr;
 	
 	while (written < size) {
+		/* Make sure there is some buffered data */
 		char c = 0;
-		errno_t rc = recv_char(rb, &c, true);
+		errno_t rc = recv_char(rb, &c, false);
 		if (rc != EOK)
 			return rc;
-		if (c == '\n') {
-			rc = recv_discard(rb, '\r', &nr);
-			if (rc != EOK)
-				return rc;
-
-			line[written++] = 0;
-			*nrecv = written;
-			return EOK;
-		}
-		else if (c == '\r') {
-			rc = recv_discard(rb, '\n', &nr);
-			if (rc != EOK)
-				return rc;
-			line[written++] = 0;
-			*nrecv = written;
-			return EOK;
-		}
-		line[written++] = c;
+		
+		/* Copy everything up to the end of line at once */
+		const char *start = rb->buffer + rb->out;
+		size_t avail = min(rb->in - rb->out, size - written);
+		size_t len = 0;
+		while (len < avail && start[len] != '\n' && start[len] != '\r')
+			len++;
+		
+		memcpy(line + written, start, len);
+		written += len;
+		rb->out += len;
+		if (len == avail)
+			continue;
+		
+		/* Found the end of line */
+		rc = recv_char(rb, &c, true);
+		if (rc != EOK)
+			return rc;
+		rc = recv_discard(rb, (c == '\n' ? '\r' : '\n'), &nr);
+		if (rc != EOK)
+			return rc;
+		
+		line[written++] = 0;
+		*nrecv = written;
+		return EOK;
 	}
 	
 	return ELIMIT;
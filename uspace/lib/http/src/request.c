@@ -42,6 +42,7 @@
 #include <inet/tcp.h>
 
 #include <http/http.h>
+#include "parse.h"
 
 #define HTTP_METHOD_LINE "%s %s HTTP/1.1\r\n"
 #define HTTP_REQUEST_LINE "\r\n"
@@ -65,6 +66,8 @@ http_request_t *http_request_create(const char *method, const char *path)
 		return NULL;
 	}
 	
+	req->version.major = 1;
+	req->version.minor = 1;
 	http_headers_init(&req->headers);
 	
 	return req;
@@ -155,5 +158,113 @@ errno_t http_send_request(http_t *http, http_request_t *req)
 	return rc;
 }
 
+static bool is_not_space(char c)
+{
+	return (c != ' ' && c != '\n' && c != '\r');
+}
+
+/** Receive a request line and request headers.
+ *
+ * Empty lines preceding the request line are ignored.
+ *
+ * @param rb Receive buffer
+ * @param out_request Place to store the new request
+ * @param max_headers_size Maximum size of a single header
+ * @param max_headers_count Maximum number of headers
+ * @return EOK on success or an error code
+ */
+errno_t http_receive_request(receive_buffer_t *rb, http_request_t **out_request,
+    size_t max_headers_size, unsigned max_headers_count)
+{
+	http_request_t *req = malloc(sizeof(http_request_t));
+	if (req == NULL)
+		return ENOMEM;
+	memset(req, 0, sizeof(http_request_t));
+	http_headers_init(&req->headers);
+	
+	size_t nrecv;
+	errno_t rc;
+	do {
+		rc = recv_eol(rb, &nrecv);
+		if (rc != EOK)
+			goto error;
+	} while (nrecv > 0);
+	
+	rc = http_receive_word(rb, is_not_space, &req->method);
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_expect(rb, " ");
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_receive_word(rb, is_not_space, &req->path);
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_expect(rb, " HTTP/");
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_receive_uint8_t(rb, &req->version.major);
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_expect(rb, ".");
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_receive_uint8_t(rb, &req->version.minor);
+	if (rc != EOK)
+		goto error;
+	
+	rc = recv_eol(rb, &nrecv);
+	if (rc == EOK && nrecv == 0)
+		rc = HTTP_EPARSE;
+	if (rc != EOK)
+		goto error;
+	
+	rc = http_headers_receive(rb, &req->headers, max_headers_size,
+	    max_headers_count);
+	if (rc != EOK)
+		goto error;
+	
+	rc = recv_eol(rb, &nrecv);
+	if (rc == EOK && nrecv == 0)
+		rc = HTTP_EPARSE;
+	if (rc != EOK)
+		goto error;
+	
+	*out_request = req;
+	return EOK;
+error:
+	http_request_destroy(req);
+	return rc;
+}
+
+/** Determine whether the connection persists after the request.
+ *
+ * HTTP/1.1 connections persist unless the client asks to close them,
+ * HTTP/1.0 connections only persist if the client asks for keep-alive.
+ *
+ * @param req Received request
+ * @return True if the connection should be kept open
+ */
+bool http_request_keep_alive(http_request_t *req)
+{
+	bool keep_alive = (req->version.major > 1) ||
+	    (req->version.major == 1 && req->version.minor >= 1);
+	
+	char *value = NULL;
+	if (http_headers_get(&req->headers, "Connection", &value) == EOK) {
+		if (str_casecmp(value, "close") == 0)
+			keep_alive = false;
+		else if (str_casecmp(value, "keep-alive") == 0)
+			keep_alive = true;
+	}
+	
+	return keep_alive;
+}
+
 /** @}
  */
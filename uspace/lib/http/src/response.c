@@ -40,69 +40,7 @@
 #include <macros.h>
 
 #include <http/http.h>
-
-static bool is_digit(char c)
-{
-	return (c >= '0' && c <= '9');
-}
-
-static errno_t receive_number(receive_buffer_t *rb, char **str)
-{
-	receive_buffer_mark_t start;
-	receive_buffer_mark_t end;
-	
-	recv_mark(rb, &start);
-	errno_t rc = recv_while(rb, is_digit);
-	if (rc != EOK) {
-		recv_unmark(rb, &start);
-		return rc;
-	}
-	recv_mark(rb, &end);
-	
-	rc = recv_cut_str(rb, &start, &end, str);
-	recv_unmark(rb, &start);
-	recv_unmark(rb, &end);
-	return rc;
-}
-
-static errno_t receive_uint8_t(receive_buffer_t *rb, uint8_t *out_value)
-{
-	char *str = NULL;
-	errno_t rc = receive_number(rb, &str);
-	
-	if (rc != EOK)
-		return rc;
-	
-	rc = str_uint8_t(str, NULL, 10, true, out_value);
-	free(str);
-	
-	return rc;
-}
-
-static errno_t receive_uint16_t(receive_buffer_t *rb, uint16_t *out_value)
-{
-	char *str = NULL;
-	errno_t rc = receive_number(rb, &str);
-	
-	if (rc != EOK)
-		return rc;
-	
-	rc = str_uint16_t(str, NULL, 10, true, out_value);
-	free(str);
-	
-	return rc;
-}
-
-static errno_t expect(receive_buffer_t *rb, const char *expect)
-{
-	size_t ndisc;
-	errno_t rc = recv_discard_str(rb, expect, &ndisc);
-	if (rc != EOK)
-		return rc;
-	if (ndisc < str_length(expect))
-		return HTTP_EPARSE;
-	return EOK;
-}
+#include "parse.h"
 
 static bool is_not_newline(char c)
 {
@@ -116,31 +54,31 @@ errno_t http_receive_status(receive_buffer_t *rb, http_version_t *out_version,
 	uint16_t status;
 	char *message = NULL;
 	
-	errno_t rc = expect(rb, "HTTP/");
+	errno_t rc = http_expect(rb, "HTTP/");
 	if (rc != EOK)
 		return rc;
 	
-	rc = receive_uint8_t(rb, &version.major);
+	rc = http_receive_uint8_t(rb, &version.major);
 	if (rc != EOK)
 		return rc;
 	
-	rc = expect(rb, ".");
+	rc = http_expect(rb, ".");
 	if (rc != EOK)
 		return rc;
 	
-	rc = receive_uint8_t(rb, &version.minor);
+	rc = http_receive_uint8_t(rb, &version.minor);
 	if (rc != EOK)
 		return rc;
 	
-	rc = expect(rb, " ");
+	rc = http_expect(rb, " ");
 	if (rc != EOK)
 		return rc;
 	
-	rc = receive_uint16_t(rb, &status);
+	rc = http_receive_uint16_t(rb, &status);
 	if (rc != EOK)
 		return rc;
 	
-	rc = expect(rb, " ");
+	rc = http_expect(rb, " ");
 	if (rc != EOK)
 		return rc;
 	
@@ -196,6 +196,14 @@ struct nic {
 	poll_request_handler on_poll_request;
 	/** Data specific for particular driver */
 	void *specific;
+	/** Buffer for packing received frames into a single notification */
+	uint8_t *rx_batch;
+	/** Number of bytes used in rx_batch */
+	size_t rx_batch_used;
+	/** Number of frames packed in rx_batch */
+	size_t rx_batch_frames;
+	/** Lock for rx_batch */
+	fibril_mutex_t rx_batch_lock;
 };
 
 /**
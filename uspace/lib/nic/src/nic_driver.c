@@ -36,8 +36,12 @@
  * @brief Internal implementation of general NIC operations
  */
 
+#include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
+#include <macros.h>
+#include <nic_iface.h>
+#include <stdlib.h>
 #include <ns.h>
 #include <stdio.h>
 #include <str_error.h>
@@ -51,7 +55,12 @@
 #include "nic_ev.h"
 #include "nic_impl.h"
 
-#define NIC_GLOBALS_MAX_CACHE_SIZE 16
+#define NIC_GLOBALS_MAX_CACHE_SIZE 64
+
+/** Minimal size of a frame data buffer, so that it can be recycled */
+#define NIC_FRAME_DATA_MIN 2048
+/** Frame data buffers larger than this are not kept in the cache */
+#define NIC_FRAME_DATA_MAX (16 * 1024)
 
 nic_globals_t nic_globals;
 
@@ -278,12 +287,19 @@ nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
 			return NULL;
 		
 		link_initialize(&frame->link);
+		frame->data = NULL;
+		frame->capacity = 0;
 	}
 
-	frame->data = malloc(size);
-	if (frame->data == NULL) {
-		free(frame);
-		return NULL;
+	/* Reuse the data buffer of a recycled frame if it is large enough */
+	if (frame->capacity < size) {
+		free(frame->data);
+		frame->capacity = max(size, NIC_FRAME_DATA_MIN);
+		frame->data = malloc(frame->capacity);
+		if (frame->data == NULL) {
+			free(frame);
+			return NULL;
+		}
 	}
 
 	frame->size = size;
@@ -291,6 +307,9 @@ nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
 }
 
 /** Release frame
+ *
+ * The frame is returned to the cache together with its data buffer
+ * so that nic_alloc_frame does not need to allocate it again.
  *
  * @param nic_data	The driver data
  * @param frame		The frame to release
@@ -300,15 +319,17 @@ void nic_release_frame(nic_t *nic_data, nic_frame_t *frame)
 	if (!frame)
 		return;
 
-	if (frame->data != NULL) {
+	frame->size = 0;
+	if (frame->capacity > NIC_FRAME_DATA_MAX) {
 		free(frame->data);
 		frame->data = NULL;
-		frame->size = 0;
+		frame->capacity = 0;
 	}
 
 	fibril_mutex_lock(&nic_globals.lock);
 	if (nic_globals.frame_cache_size >= NIC_GLOBALS_MAX_CACHE_SIZE) {
 		fibril_mutex_unlock(&nic_globals.lock);
+		free(frame->data);
 		free(frame);
 	} else {
 		list_prepend(&frame->link, &nic_globals.frame_cache);
@@ -506,15 +527,14 @@ void nic_set_tx_busy(nic_t *nic_data, int busy)
 	nic_data->tx_busy = busy;
 }
 
-/**
- * This is the function that the driver should call when it receives a frame.
- * The frame is checked by filters and then sent up to the NIL layer or
- * discarded. The frame is released.
+/** Check a received frame against the filters and update statistics.
  *
  * @param nic_data
  * @param frame		The received frame
+ *
+ * @return True if the frame should be passed to the client
  */
-void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+static bool nic_received_check(nic_t *nic_data, nic_frame_t *frame)
 {
 	/* Note: this function must not lock main lock, because loopback driver
 	 * 		 calls it inside send_frame handler (with locked main lock) */
@@ -540,21 +560,102 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+		return true;
+	}
+
+	switch (frame_type) {
+	case NIC_FRAME_UNICAST:
+		nic_data->stats.receive_filtered_unicast++;
+		break;
+	case NIC_FRAME_MULTICAST:
+		nic_data->stats.receive_filtered_multicast++;
+		break;
+	case NIC_FRAME_BROADCAST:
+		nic_data->stats.receive_filtered_broadcast++;
+		break;
+	}
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+	return false;
+}
+
+/** Count one receive notification sent to the client. */
+static void nic_received_notified(nic_t *nic_data)
+{
+	fibril_rwlock_write_lock(&nic_data->stats_lock);
+	nic_data->stats.receive_batches++;
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+}
+
+/** Send the frames packed in the receive batch buffer to the client.
+ *
+ * A batch holding a single frame is sent as an ordinary NIC_EV_RECEIVED.
+ * Must be called with rx_batch_lock held.
+ *
+ * @param nic_data
+ */
+static void nic_rx_batch_flush(nic_t *nic_data)
+{
+	if (nic_data->rx_batch_frames == 0)
+		return;
+
+	if (nic_data->rx_batch_frames == 1) {
+		nic_rx_batch_hdr_t *hdr = (nic_rx_batch_hdr_t *) nic_data->rx_batch;
+		nic_ev_received(nic_data->client_session, hdr + 1, hdr->size);
+	} else {
+		nic_ev_received_batch(nic_data->client_session, nic_data->rx_batch,
+		    nic_data->rx_batch_used);
+	}
+
+	nic_received_notified(nic_data);
+	nic_data->rx_batch_used = 0;
+	nic_data->rx_batch_frames = 0;
+}
+
+/** Append a frame to the receive batch buffer, flushing it when full.
+ *
+ * Must be called with rx_batch_lock held.
+ *
+ * @param nic_data
+ * @param frame		The received frame
+ *
+ * @return True if the frame was appended, false if it does not fit
+ *         into an empty batch either
+ */
+static bool nic_rx_batch_append(nic_t *nic_data, nic_frame_t *frame)
+{
+	size_t rsize = ALIGN_UP(sizeof(nic_rx_batch_hdr_t) + frame->size,
+	    NIC_RX_BATCH_ALIGN);
+
+	if (rsize > NIC_RX_BATCH_SIZE)
+		return false;
+
+	if (nic_data->rx_batch_used + rsize > NIC_RX_BATCH_SIZE)
+		nic_rx_batch_flush(nic_data);
+
+	nic_rx_batch_hdr_t *hdr =
+	    (nic_rx_batch_hdr_t *) (nic_data->rx_batch + nic_data->rx_batch_used);
+	hdr->size = frame->size;
+	memcpy(hdr + 1, frame->data, frame->size);
+
+	nic_data->rx_batch_used += rsize;
+	nic_data->rx_batch_frames++;
+	return true;
+}
+
+/**
+ * This is the function that the driver should call when it receives a frame.
+ * The frame is checked by filters and then sent up to the NIL layer or
+ * discarded. The frame is released.
+ *
+ * @param nic_data
+ * @param frame		The received frame
+ */
+void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+{
+	if (nic_received_check(nic_data, frame)) {
 		nic_ev_received(nic_data->client_session, frame->data,
 		    frame->size);
-	} else {
-		switch (frame_type) {
-		case NIC_FRAME_UNICAST:
-			nic_data->stats.receive_filtered_unicast++;
-			break;
-		case NIC_FRAME_MULTICAST:
-			nic_data->stats.receive_filtered_multicast++;
-			break;
-		case NIC_FRAME_BROADCAST:
-			nic_data->stats.receive_filtered_broadcast++;
-			break;
-		}
-		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+		nic_received_notified(nic_data);
 	}
 	nic_release_frame(nic_data, frame);
 }
@@ -562,8 +663,9 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 /**
  * Some NICs can receive multiple frames during single interrupt. These can
  * send them in whole list of frames (actually nic_frame_t structures), then
- * the list is deallocated and each frame is passed to the
- * nic_received_packet function.
+ * the list is deallocated. The frames that pass the filters are packed
+ * and sent to the client in as few NIC_EV_RECEIVED_BATCH notifications
+ * as possible.
  *
  * @param nic_data
  * @param frames		List of received frames
@@ -572,13 +674,37 @@ void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 {
 	if (frames == NULL)
 		return;
+
+	fibril_mutex_lock(&nic_data->rx_batch_lock);
+	if (nic_data->rx_batch == NULL)
+		nic_data->rx_batch = malloc(NIC_RX_BATCH_SIZE);
+
 	while (!list_empty(frames)) {
 		nic_frame_t *frame =
 			list_get_instance(list_first(frames), nic_frame_t, link);
 
 		list_remove(&frame->link);
-		nic_received_frame(nic_data, frame);
+
+		if (nic_data->rx_batch == NULL) {
+			/* No batch buffer, fall back to one frame at a time */
+			nic_received_frame(nic_data, frame);
+			continue;
+		}
+
+		if (nic_received_check(nic_data, frame) &&
+		    !nic_rx_batch_append(nic_data, frame)) {
+			nic_rx_batch_flush(nic_data);
+			nic_ev_received(nic_data->client_session, frame->data,
+			    frame->size);
+			nic_received_notified(nic_data);
+		}
+		nic_release_frame(nic_data, frame);
 	}
+
+	if (nic_data->rx_batch != NULL)
+		nic_rx_batch_flush(nic_data);
+	fibril_mutex_unlock(&nic_data->rx_batch_lock);
+
 	nic_driver_release_frame_list(frames);
 }
 
@@ -613,7 +739,11 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	nic_data->on_going_down = NULL;
 	nic_data->on_stopping = NULL;
 	nic_data->specific = NULL;
+	nic_data->rx_batch = NULL;
+	nic_data->rx_batch_used = 0;
+	nic_data->rx_batch_frames = 0;
 	
+	fibril_mutex_initialize(&nic_data->rx_batch_lock);
 	fibril_rwlock_initialize(&nic_data->main_lock);
 	fibril_rwlock_initialize(&nic_data->stats_lock);
 	fibril_rwlock_initialize(&nic_data->rxc_lock);
@@ -655,6 +785,7 @@ nic_t *nic_create_and_bind(ddf_dev_t *device)
  */
 static void nic_destroy(nic_t *nic_data)
 {
+	free(nic_data->rx_batch);
 	free(nic_data->specific);
 }
 
@@ -93,5 +93,30 @@ errno_t nic_ev_received(async_sess_t *sess, void *data, size_t size)
 	return retval;
 }
 
+/** Batch of frames received.
+ *
+ * @param sess Client callback session
+ * @param data Frames packed as described by nic_rx_batch_hdr_t
+ * @param size Size of the packed data in bytes
+ */
+errno_t nic_ev_received_batch(async_sess_t *sess, void *data, size_t size)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, NIC_EV_RECEIVED_BATCH, &answer);
+	errno_t retval = async_data_write_start(exch, data, size);
+
+	async_exchange_end(exch);
+
+	if (retval != EOK) {
+		async_forget(req);
+		return retval;
+	}
+
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 /** @}
  */
@@ -37,6 +37,8 @@
 #include <byteorder.h>
 #include <errno.h>
 #include <macros.h>
+#include <mem.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "format.h"
@@ -69,6 +71,176 @@ const pcm_format_t AUDIO_FORMAT_ANY = {
 
 static float get_normalized_sample(const void *buffer, size_t size,
     unsigned frame, unsigned channel, const pcm_format_t *f);
+static float get_mapped_sample(const void *buffer, size_t size,
+    unsigned frame, unsigned channel, const pcm_format_t *sf,
+    const pcm_format_t *df);
+
+/*
+ * Integer mixing kernels for the common format pairs. They work on
+ * samples in the host byte order, mixing into the destination with
+ * saturation. The generic float path handles everything else.
+ */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PCM_SAMPLE_SINT16_HOST  PCM_SAMPLE_SINT16_LE
+#define PCM_SAMPLE_SINT32_HOST  PCM_SAMPLE_SINT32_LE
+#else
+#define PCM_SAMPLE_SINT16_HOST  PCM_SAMPLE_SINT16_BE
+#define PCM_SAMPLE_SINT32_HOST  PCM_SAMPLE_SINT32_BE
+#endif
+
+#ifdef __SSE2__
+typedef int16_t v8i16_t __attribute__((vector_size(16)));
+#endif
+
+/** Mix frames of the source into the destination.
+ * @param dst Destination samples.
+ * @param src Source samples.
+ * @param frames Number of frames to mix.
+ * @param channels Number of channels of both (same layout kernels only).
+ */
+typedef void (*mix_kernel_t)(void *dst, const void *src, size_t frames,
+    unsigned channels);
+
+/** Mixing kernels for a pair of sample formats */
+typedef struct {
+	pcm_sample_format_t src;
+	pcm_sample_format_t dst;
+	/** Same number of channels */
+	mix_kernel_t same;
+	/** Mono source, stereo destination */
+	mix_kernel_t upmix;
+	/** Stereo source, mono destination */
+	mix_kernel_t downmix;
+} mix_kernels_t;
+
+static inline int16_t sat_s16(int32_t x)
+{
+	if (x > INT16_MAX)
+		return INT16_MAX;
+	if (x < INT16_MIN)
+		return INT16_MIN;
+	return x;
+}
+
+static inline int32_t sat_s32(int64_t x)
+{
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return x;
+}
+
+/* Source sample conversions to the destination range */
+#define S16_TO_S16(x)  ((int32_t) (x))
+#define S32_TO_S32(x)  ((int64_t) (x))
+#define S16_TO_S32(x)  ((int64_t) (x) * 65536)
+#define S32_TO_S16(x)  ((int32_t) ((x) >> 16))
+#define U8_TO_S16(x)   ((int32_t) (x) * 257 - 32768)
+
+#define MIX_SAME(name, stype, dtype, acc, conv, sat) \
+static void mix_##name(void *dst, const void *src, size_t frames, \
+    unsigned channels) \
+{ \
+	dtype *d = dst; \
+	const stype *s = src; \
+	const size_t count = frames * channels; \
+	for (size_t i = 0; i < count; ++i) \
+		d[i] = sat((acc) d[i] + conv(s[i])); \
+}
+
+#define MIX_UP_DOWN(name, stype, dtype, acc, conv, sat) \
+static void mix_##name##_up(void *dst, const void *src, size_t frames, \
+    unsigned channels) \
+{ \
+	dtype *d = dst; \
+	const stype *s = src; \
+	for (size_t i = 0; i < frames; ++i) { \
+		const acc v = conv(s[i]); \
+		d[2 * i] = sat(d[2 * i] + v); \
+		d[2 * i + 1] = sat(d[2 * i + 1] + v); \
+	} \
+} \
+static void mix_##name##_down(void *dst, const void *src, size_t frames, \
+    unsigned channels) \
+{ \
+	dtype *d = dst; \
+	const stype *s = src; \
+	for (size_t i = 0; i < frames; ++i) { \
+		const acc v = (conv(s[2 * i]) + conv(s[2 * i + 1])) / 2; \
+		d[i] = sat(d[i] + v); \
+	} \
+}
+
+#ifdef __SSE2__
+/** Mix 16-bit samples eight at a time with saturating SIMD adds. */
+static void mix_s16_s16(void *dst, const void *src, size_t frames,
+    unsigned channels)
+{
+	int16_t *d = dst;
+	const int16_t *s = src;
+	const size_t count = frames * channels;
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		v8i16_t a, b;
+		memcpy_unaligned(&a, d + i, sizeof(a));
+		memcpy_unaligned(&b, s + i, sizeof(b));
+		a = __builtin_ia32_paddsw128(a, b);
+		memcpy_unaligned(d + i, &a, sizeof(a));
+	}
+
+	for (; i < count; ++i)
+		d[i] = sat_s16((int32_t) d[i] + s[i]);
+}
+#else
+MIX_SAME(s16_s16, int16_t, int16_t, int32_t, S16_TO_S16, sat_s16)
+#endif
+MIX_UP_DOWN(s16_s16, int16_t, int16_t, int32_t, S16_TO_S16, sat_s16)
+MIX_SAME(s32_s32, int32_t, int32_t, int64_t, S32_TO_S32, sat_s32)
+MIX_UP_DOWN(s32_s32, int32_t, int32_t, int64_t, S32_TO_S32, sat_s32)
+MIX_SAME(s16_s32, int16_t, int32_t, int64_t, S16_TO_S32, sat_s32)
+MIX_UP_DOWN(s16_s32, int16_t, int32_t, int64_t, S16_TO_S32, sat_s32)
+MIX_SAME(s32_s16, int32_t, int16_t, int32_t, S32_TO_S16, sat_s16)
+MIX_UP_DOWN(s32_s16, int32_t, int16_t, int32_t, S32_TO_S16, sat_s16)
+MIX_SAME(u8_s16, uint8_t, int16_t, int32_t, U8_TO_S16, sat_s16)
+MIX_UP_DOWN(u8_s16, uint8_t, int16_t, int32_t, U8_TO_S16, sat_s16)
+
+#define MIX_KERNELS(name, src, dst) \
+	{ src, dst, mix_##name, mix_##name##_up, mix_##name##_down }
+
+static const mix_kernels_t mix_kernels[] = {
+	MIX_KERNELS(s16_s16, PCM_SAMPLE_SINT16_HOST, PCM_SAMPLE_SINT16_HOST),
+	MIX_KERNELS(s32_s32, PCM_SAMPLE_SINT32_HOST, PCM_SAMPLE_SINT32_HOST),
+	MIX_KERNELS(s16_s32, PCM_SAMPLE_SINT16_HOST, PCM_SAMPLE_SINT32_HOST),
+	MIX_KERNELS(s32_s16, PCM_SAMPLE_SINT32_HOST, PCM_SAMPLE_SINT16_HOST),
+	MIX_KERNELS(u8_s16, PCM_SAMPLE_UINT8, PCM_SAMPLE_SINT16_HOST),
+};
+
+/**
+ * Find an integer mixing kernel for the format pair.
+ * @param sf Source format.
+ * @param df Destination format.
+ * @return Kernel, NULL if the generic path has to be used.
+ */
+static mix_kernel_t mix_kernel_find(const pcm_format_t *sf,
+    const pcm_format_t *df)
+{
+	for (size_t i = 0; i < sizeof(mix_kernels) / sizeof(mix_kernels[0]);
+	    ++i) {
+		const mix_kernels_t *k = &mix_kernels[i];
+		if (k->src != sf->sample_format || k->dst != df->sample_format)
+			continue;
+		if (sf->channels == df->channels)
+			return k->same;
+		if (sf->channels == 1 && df->channels == 2)
+			return k->upmix;
+		if (sf->channels == 2 && df->channels == 1)
+			return k->downmix;
+		return NULL;
+	}
+	return NULL;
+}
 
 /**
  * Compare PCM format attribtues.
@@ -94,6 +266,12 @@ bool pcm_format_same(const pcm_format_t *a, const pcm_format_t* b)
  */
 void pcm_format_silence(void *dst, size_t size, const pcm_format_t *f)
 {
+	/* Silence of signed formats is zero in any byte order */
+	if (pcm_sample_format_is_signed(f->sample_format)) {
+		memset(dst, 0, size);
+		return;
+	}
+
 #define SET_NULL(type, endian, nullv) \
 do { \
 	type *buffer = dst; \
@@ -163,6 +341,11 @@ errno_t pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format
  *
  * Buffers must contain entire frames. Destination buffer is always filled.
  * If there are not enough data in the source buffer silent data is assumed.
+ *
+ * Common format pairs are mixed by integer kernels with saturation.
+ * For any format pair, a mono source is mixed into every channel of
+ * the destination and a stereo source is averaged into a mono
+ * destination.
  */
 errno_t pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
     size_t src_size, const pcm_format_t *sf, const pcm_format_t *df)
@@ -177,6 +360,15 @@ errno_t pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
 	if ((dst_size % dst_frame_size) != 0)
 		return EINVAL;
 
+	const mix_kernel_t kernel = mix_kernel_find(sf, df);
+	if (kernel) {
+		/* Missing source frames are silence, nothing to add */
+		const size_t frames = min(dst_size / dst_frame_size,
+		    src_size / src_frame_size);
+		kernel(dst, src, frames, df->channels);
+		return EOK;
+	}
+
 	/* This is so ugly it eats kittens, and puppies, and ducklings,
 	 * and all little fluffy things...
 	 */
@@ -188,7 +380,7 @@ do { \
 			const float a = \
 			    get_normalized_sample(dst, dst_size, i, j, df);\
 			const float b = \
-			    get_normalized_sample(src, src_size, i, j, sf);\
+			    get_mapped_sample(src, src_size, i, j, sf, df);\
 			float c = (a + b); \
 			if (c < -1.0) c = -1.0; \
 			if (c > 1.0) c = 1.0; \
@@ -307,6 +499,32 @@ do { \
 	return 0;
 #undef GET
 }
+
+/**
+ * Read a source sample mapped to a destination channel.
+ * @param buffer Source audio data
+ * @param size Size of the buffer
+ * @param frame Index of the frame to read
+ * @param channel Channel within the destination frame
+ * @param sf Pointer to the source format descriptor
+ * @param df Pointer to the destination format descriptor
+ * @return Normalized sample <-1,1>, 0.0 if the data could not be read
+ *
+ * Channels are mapped the same way as by the integer kernels. A mono
+ * source is mixed into every destination channel and a stereo source
+ * is averaged into a mono destination.
+ */
+static float get_mapped_sample(const void *buffer, size_t size,
+    unsigned frame, unsigned channel, const pcm_format_t *sf,
+    const pcm_format_t *df)
+{
+	if (sf->channels == 1)
+		return get_normalized_sample(buffer, size, frame, 0, sf);
+	if (sf->channels == 2 && df->channels == 1)
+		return (get_normalized_sample(buffer, size, frame, 0, sf) +
+		    get_normalized_sample(buffer, size, frame, 1, sf)) / 2;
+	return get_normalized_sample(buffer, size, frame, channel, sf);
+}
 /**
  * @}
  */
@@ -47,15 +47,35 @@ void *mmap(void *start, size_t length, int prot, int flags, int fd,
 //	if (!((flags & MAP_SHARED) ^ (flags & MAP_PRIVATE)))
 //		return MAP_FAILED;
 	
-	if (!(flags & MAP_ANONYMOUS))
+	if (flags & MAP_ANONYMOUS)
+		return as_area_create(start, length, prot, AS_AREA_UNPAGED);
+	
+	/*
+	 * File mappings are private. Modifications of a shared mapping would
+	 * not be carried through to the file.
+	 */
+	if ((flags & MAP_SHARED) && (prot & PROT_WRITE)) {
+		errno = ENOTSUP;
+		return MAP_FAILED;
+	}
+	
+	if (offset < 0) {
+		errno = EINVAL;
+		return MAP_FAILED;
+	}
+	
+	if (failed(vfs_mmap(fd, offset, length, prot | AS_AREA_CACHEABLE,
+	    &start)))
 		return MAP_FAILED;
 	
-	return as_area_create(start, length, prot, AS_AREA_UNPAGED);
+	return start;
 }
 
 int munmap(void *start, size_t length)
 {
-	int rc = as_area_destroy(start);
+	errno_t rc = vfs_munmap(start);
+	if (rc == ENOENT)
+		rc = as_area_destroy(start);
 	if (rc != EOK) {
 		errno = rc;
 		return -1;
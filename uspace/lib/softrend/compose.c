@@ -33,8 +33,22 @@
  * @file
  */
 
+#include <mem.h>
 #include "compose.h"
 
+/*
+ * The SIMD variant of compose_over_span() uses GCC vector extensions,
+ * which the compiler lowers to SSE2 or NEON instructions.
+ */
+#if (defined(__SSE2__) || defined(__ARM_NEON)) && \
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define COMPOSE_VECTOR
+
+typedef uint8_t v16u8_t __attribute__((vector_size(16)));
+typedef uint16_t v8u16_t __attribute__((vector_size(16)));
+typedef uint32_t v4u32_t __attribute__((vector_size(16)));
+#endif
+
 pixel_t compose_clr(pixel_t fg, pixel_t bg)
 {
 	return 0;
@@ -101,5 +115,164 @@ pixel_t compose_add(pixel_t fg, pixel_t bg)
 	return 0;
 }
 
+/** Divide 16-bit lanes by 255, exact for values up to 255 * 255. */
+#define DIV255(x) (((x) + 0x00010001 + (((x) >> 8) & 0x00ff00ff)) >> 8)
+
+/** Compose a pixel over an opaque destination pixel.
+ *
+ * Gives the same result as compose_over() does for opaque destination
+ * pixels, but in integer arithmetic with two channels in each 32-bit
+ * operation.
+ */
+static inline pixel_t compose_over_opaque(pixel_t fg, pixel_t bg)
+{
+	uint32_t mf = ALPHA(fg);
+	uint32_t mb = 255 - mf;
+
+	uint32_t rb = (fg & 0x00ff00ff) * mf + (bg & 0x00ff00ff) * mb;
+	uint32_t g = ((fg >> 8) & 0xff) * mf + ((bg >> 8) & 0xff) * mb;
+
+	rb = DIV255(rb) & 0x00ff00ff;
+	g = DIV255(g) & 0xff;
+
+	return 0xff000000 | rb | (g << 8);
+}
+
+static inline pixel_t compose_over_pixel(pixel_t fg, pixel_t bg)
+{
+	if (ALPHA(fg) == 0)
+		return bg;
+	if (ALPHA(bg) != 255)
+		return compose_over(fg, bg);
+	if (ALPHA(fg) == 255)
+		return fg;
+
+	return compose_over_opaque(fg, bg);
+}
+
+#ifdef COMPOSE_VECTOR
+
+/** Blend two pixels in 16-bit lanes over opaque destination pixels. */
+static inline v8u16_t compose_over_lanes(v8u16_t fg, v8u16_t bg)
+{
+	const v8u16_t amask = { 3, 3, 3, 3, 7, 7, 7, 7 };
+	v8u16_t mf = __builtin_shuffle(fg, amask);
+	v8u16_t res = fg * mf + bg * (255 - mf);
+
+	return (res + 1 + (res >> 8)) >> 8;
+}
+
+/** Compose four pixels at once, destination pixels must be opaque. */
+static inline void compose_over_vector(pixel_t *dst, const pixel_t *src)
+{
+	const v16u8_t zero = { 0 };
+	const v16u8_t lo = { 0, 16, 1, 17, 2, 18, 3, 19,
+	    4, 20, 5, 21, 6, 22, 7, 23 };
+	const v16u8_t hi = { 8, 24, 9, 25, 10, 26, 11, 27,
+	    12, 28, 13, 29, 14, 30, 15, 31 };
+	const v16u8_t pack = { 0, 2, 4, 6, 8, 10, 12, 14,
+	    16, 18, 20, 22, 24, 26, 28, 30 };
+	v16u8_t fg, bg;
+	v8u16_t res_lo, res_hi;
+	v4u32_t res;
+
+	memcpy_unaligned(&fg, src, sizeof(fg));
+	memcpy_unaligned(&bg, dst, sizeof(bg));
+
+	res_lo = compose_over_lanes(
+	    (v8u16_t) __builtin_shuffle(fg, zero, lo),
+	    (v8u16_t) __builtin_shuffle(bg, zero, lo));
+	res_hi = compose_over_lanes(
+	    (v8u16_t) __builtin_shuffle(fg, zero, hi),
+	    (v8u16_t) __builtin_shuffle(bg, zero, hi));
+
+	res = (v4u32_t) __builtin_shuffle((v16u8_t) res_lo, (v16u8_t) res_hi,
+	    pack);
+	res |= 0xff000000;
+
+	memcpy_unaligned(dst, &res, sizeof(res));
+}
+
+#endif
+
+/** Copy a span of source pixels to the destination. */
+void compose_src_span(pixel_t *dst, const pixel_t *src, size_t count)
+{
+	memcpy(dst, src, count * sizeof(pixel_t));
+}
+
+/** Compose a span of source pixels over the destination.
+ *
+ * Equivalent to calling compose_over() on every pair of pixels. Fully
+ * transparent source pixels are skipped. Over opaque destinations (the
+ * common case when composing onto a screen) opaque source pixels are
+ * copied and the rest is blended four pixels at a time where SIMD is
+ * available.
+ */
+void compose_over_span(pixel_t *dst, const pixel_t *src, size_t count)
+{
+	size_t i = 0;
+
+#ifdef COMPOSE_VECTOR
+	for (; i + 4 <= count; i += 4) {
+		uint32_t fa = src[i] & src[i + 1] & src[i + 2] & src[i + 3];
+		uint32_t fo = src[i] | src[i + 1] | src[i + 2] | src[i + 3];
+		uint32_t ba = dst[i] & dst[i + 1] & dst[i + 2] & dst[i + 3];
+
+		if (ALPHA(fo) == 0) {
+			continue;
+		} else if (ALPHA(ba) == 255) {
+			if (ALPHA(fa) == 255)
+				memcpy_unaligned(&dst[i], &src[i],
+				    4 * sizeof(pixel_t));
+			else
+				compose_over_vector(&dst[i], &src[i]);
+		} else {
+			for (size_t j = i; j < i + 4; j++)
+				dst[j] = compose_over_pixel(src[j], dst[j]);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		dst[i] = compose_over_pixel(src[i], dst[i]);
+}
+
+/** Get the span variant of a compose function.
+ *
+ * @return Span compose function or @c NULL if there is none.
+ */
+compose_span_t compose_get_span(compose_t compose)
+{
+	if (compose == compose_src)
+		return compose_src_span;
+	if (compose == compose_over)
+		return compose_over_span;
+
+	return NULL;
+}
+
+/** Scale alpha of a span of pixels.
+ *
+ * @param pixels	Pixels to modify
+ * @param count		Number of pixels
+ * @param alpha		Alpha multiplier, 255 means no change
+ */
+void compose_alpha_span(pixel_t *pixels, size_t count, uint8_t alpha)
+{
+	if (alpha == 255)
+		return;
+
+	if (alpha == 0) {
+		memset(pixels, 0, count * sizeof(pixel_t));
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t a = ALPHA(pixels[i]) * alpha;
+		pixels[i] = (pixels[i] & 0x00ffffff) | ((DIV255(a) & 0xff) << 24);
+	}
+}
+
 /** @}
  */
@@ -36,6 +36,7 @@
 
 #include "filter.h"
 #include <io/pixel.h>
+#include <mem.h>
 
 
 static long round(double val)
@@ -119,5 +120,131 @@ pixel_t filter_bicubic(pixelmap_t *pixmap, double x, double y,
 	return 0;
 }
 
+static inline pixel_t span_pixel(pixelmap_t *pixmap, native_t x, native_t y,
+    pixelmap_extend_t extend)
+{
+	if (((sysarg_t) x) < pixmap->width && ((sysarg_t) y) < pixmap->height)
+		return pixmap->data[y * pixmap->width + x];
+
+	return pixelmap_get_extended_pixel(pixmap, x, y, extend);
+}
+
+/** Interpolate two pixels, weight is 0 to 256 in favour of @a p2.
+ *
+ * Two channels are processed at once in 16-bit lanes.
+ */
+static inline pixel_t lerp_pixels(pixel_t p1, pixel_t p2, unsigned weight)
+{
+	uint32_t rb1 = p1 & 0x00ff00ff;
+	uint32_t ag1 = (p1 >> 8) & 0x00ff00ff;
+	uint32_t rb2 = p2 & 0x00ff00ff;
+	uint32_t ag2 = (p2 >> 8) & 0x00ff00ff;
+
+	uint32_t rb = ((rb1 * (256 - weight) + rb2 * weight) >> 8) & 0x00ff00ff;
+	uint32_t ag = (ag1 * (256 - weight) + ag2 * weight) & 0xff00ff00;
+
+	return rb | ag;
+}
+
+void filter_nearest_span(pixelmap_t *pixmap, transform_step_t *step,
+    pixelmap_extend_t extend, pixel_t *out, size_t count)
+{
+	const int64_t half = TRANSFORM_STEP_ONE / 2;
+
+	if (step->dx == TRANSFORM_STEP_ONE && step->dy == 0) {
+		/* Plain translation, the span maps to a single source row */
+		native_t x = (step->x + half) >> TRANSFORM_STEP_SHIFT;
+		native_t y = (step->y + half) >> TRANSFORM_STEP_SHIFT;
+		step->x += count * TRANSFORM_STEP_ONE;
+
+		if (((sysarg_t) y) < pixmap->height) {
+			pixel_t *row = pixmap->data + y * pixmap->width;
+
+			while (count > 0 && x < 0) {
+				*out++ = pixelmap_get_extended_pixel(pixmap, x++, y,
+				    extend);
+				count--;
+			}
+
+			if (((sysarg_t) x) < pixmap->width) {
+				size_t inside = pixmap->width - x;
+				if (inside > count)
+					inside = count;
+
+				memcpy(out, row + x, inside * sizeof(pixel_t));
+				out += inside;
+				x += inside;
+				count -= inside;
+			}
+		}
+
+		while (count-- > 0)
+			*out++ = pixelmap_get_extended_pixel(pixmap, x++, y, extend);
+
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		out[i] = span_pixel(pixmap, (step->x + half) >> TRANSFORM_STEP_SHIFT,
+		    (step->y + half) >> TRANSFORM_STEP_SHIFT, extend);
+		step->x += step->dx;
+		step->y += step->dy;
+	}
+}
+
+void filter_bilinear_span(pixelmap_t *pixmap, transform_step_t *step,
+    pixelmap_extend_t extend, pixel_t *out, size_t count)
+{
+	const int frac_shift = TRANSFORM_STEP_SHIFT - 8;
+
+	for (size_t i = 0; i < count; i++) {
+		native_t x = step->x >> TRANSFORM_STEP_SHIFT;
+		native_t y = step->y >> TRANSFORM_STEP_SHIFT;
+		unsigned fx = (step->x >> frac_shift) & 0xff;
+		unsigned fy = (step->y >> frac_shift) & 0xff;
+		pixel_t p00, p01, p10, p11;
+
+		step->x += step->dx;
+		step->y += step->dy;
+
+		if (fx == 0 && fy == 0) {
+			out[i] = span_pixel(pixmap, x, y, extend);
+			continue;
+		}
+
+		if (x >= 0 && ((sysarg_t) x + 1) < pixmap->width &&
+		    y >= 0 && ((sysarg_t) y + 1) < pixmap->height) {
+			pixel_t *p = pixmap->data + y * pixmap->width + x;
+			p00 = p[0];
+			p01 = p[1];
+			p10 = p[pixmap->width];
+			p11 = p[pixmap->width + 1];
+		} else {
+			p00 = pixelmap_get_extended_pixel(pixmap, x, y, extend);
+			p01 = pixelmap_get_extended_pixel(pixmap, x + 1, y, extend);
+			p10 = pixelmap_get_extended_pixel(pixmap, x, y + 1, extend);
+			p11 = pixelmap_get_extended_pixel(pixmap, x + 1, y + 1,
+			    extend);
+		}
+
+		out[i] = lerp_pixels(lerp_pixels(p00, p01, fx),
+		    lerp_pixels(p10, p11, fx), fy);
+	}
+}
+
+/** Get the span variant of a filter.
+ *
+ * @return Span filter or @c NULL if there is none.
+ */
+filter_span_t filter_get_span(filter_t filter)
+{
+	if (filter == filter_nearest)
+		return filter_nearest_span;
+	if (filter == filter_bilinear)
+		return filter_bilinear_span;
+
+	return NULL;
+}
+
 /** @}
  */
@@ -37,13 +37,30 @@
 #define SOFTREND_FILTER_H_
 
 #include <io/pixelmap.h>
+#include <stddef.h>
+
+#include "transform.h"
 
 typedef pixel_t (*filter_t)(pixelmap_t *, double, double, pixelmap_extend_t);
 
+/** Sample a whole span of source pixels.
+ *
+ * Fills the output array with the filtered pixels at the points
+ * produced by the fixed-point stepping, advancing it past the span.
+ */
+typedef void (*filter_span_t)(pixelmap_t *, transform_step_t *,
+    pixelmap_extend_t, pixel_t *, size_t);
+
 extern pixel_t filter_nearest(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bilinear(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bicubic(pixelmap_t *, double, double, pixelmap_extend_t);
 
+extern void filter_nearest_span(pixelmap_t *, transform_step_t *,
+    pixelmap_extend_t, pixel_t *, size_t);
+extern void filter_bilinear_span(pixelmap_t *, transform_step_t *,
+    pixelmap_extend_t, pixel_t *, size_t);
+extern filter_span_t filter_get_span(filter_t);
+
 #endif
 
 /** @}
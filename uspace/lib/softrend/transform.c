@@ -194,5 +194,29 @@ void transform_apply_affine(const transform_t *trans, double *x, double *y)
 	    trans->matrix[1][2];
 }
 
+static int64_t transform_step_fixed(double val)
+{
+	val *= TRANSFORM_STEP_ONE;
+	return val > 0 ? (int64_t) (val + 0.5) : (int64_t) (val - 0.5);
+}
+
+/** Prepare fixed-point stepping of a span starting at (x, y).
+ *
+ * @param step	Stepping state to initialize
+ * @param trans	Affine transformation
+ * @param x	Horizontal coordinate of the first point of the span
+ * @param y	Vertical coordinate of the span
+ */
+void transform_step_init(transform_step_t *step, const transform_t *trans,
+    double x, double y)
+{
+	transform_apply_affine(trans, &x, &y);
+
+	step->x = transform_step_fixed(x);
+	step->y = transform_step_fixed(y);
+	step->dx = transform_step_fixed(trans->matrix[0][0]);
+	step->dy = transform_step_fixed(trans->matrix[1][0]);
+}
+
 /** @}
  */
@@ -37,13 +37,31 @@
 #define SOFTREND_TRANSFORM_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define TRANSFORM_MATRIX_DIM  3
 
+/** Number of fractional bits in transform_step_t coordinates */
+#define TRANSFORM_STEP_SHIFT  16
+#define TRANSFORM_STEP_ONE    (((int64_t) 1) << TRANSFORM_STEP_SHIFT)
+
 typedef struct {
 	double matrix[TRANSFORM_MATRIX_DIM][TRANSFORM_MATRIX_DIM];
 } transform_t;
 
+/** Affine transformation of a horizontal span in fixed point.
+ *
+ * Holds the transformed coordinates of the current point and their
+ * increments for every step to the right, so that a whole scanline
+ * can be transformed with additions only.
+ */
+typedef struct {
+	int64_t x;
+	int64_t y;
+	int64_t dx;
+	int64_t dy;
+} transform_step_t;
+
 extern void transform_product(transform_t *, const transform_t *,
     const transform_t *);
 extern void transform_invert(transform_t *);
@@ -58,6 +76,9 @@ extern bool transform_is_fast(transform_t *);
 extern void transform_apply_linear(const transform_t *, double *, double *);
 extern void transform_apply_affine(const transform_t *, double *, double *);
 
+extern void transform_step_init(transform_step_t *, const transform_t *,
+    double, double);
+
 #endif
 
 /** @}
@@ -34,16 +34,22 @@
 /** @file
  */
 
+#include <align.h>
 #include <macros.h>
 #include <errno.h>
+#include <libarch/barrier.h>
 #include <stdlib.h>
 #include <str_error.h>
+#include <sys/time.h>
 
 #include "hound_ctx.h"
 #include "audio_data.h"
 #include "connection.h"
 #include "log.h"
 
+/** Longest time a single ring wait request blocks (usec) */
+#define RING_WAIT_TIMEOUT  1000000
+
 static errno_t update_data(audio_source_t *source, size_t size);
 static errno_t new_data(audio_sink_t *sink);
 
@@ -172,6 +178,14 @@ typedef struct hound_ctx_stream {
 	fibril_mutex_t guard;
 	/** buffer status change condition */
 	fibril_condvar_t change;
+	/** Shared ring buffer, NULL if data arrive over IPC */
+	hound_ring_t *ring;
+	/** Ring data size, kept here so the client cannot change it */
+	size_t ring_size;
+	/** Ring period size */
+	size_t ring_period;
+	/** Ring read position, published to the client after each mix */
+	size_t ring_read;
 } hound_ctx_stream_t;
 
 /**
@@ -258,6 +272,10 @@ hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
 		stream->flags = flags;
 		stream->format = format;
 		stream->allowed_size = buffer_size;
+		stream->ring = NULL;
+		stream->ring_size = 0;
+		stream->ring_period = 0;
+		stream->ring_read = 0;
 		stream_append(ctx, stream);
 		log_verbose("CTX: %p added stream; flags:%#x ch: %u r:%u f:%s",
 		    ctx, flags, format.channels, format.sampling_rate,
@@ -266,6 +284,63 @@ hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
 	return stream;
 }
 
+/**
+ * Create new stream that mixes data directly from a shared ring.
+ * @param ctx Assocaited hound context.
+ * @param flags Stream modidfiers.
+ * @param format PCM data format.
+ * @param ring Ring buffer shared with the client.
+ * @param area_size Size of the shared area that starts with @p ring.
+ * @param[out] stream Pointer to a new stream structure.
+ * @return Error code.
+ */
+errno_t hound_ctx_create_ring_stream(hound_ctx_t *ctx, int flags,
+    pcm_format_t format, hound_ring_t *ring, size_t area_size,
+    hound_ctx_stream_t **stream)
+{
+	assert(ctx);
+	assert(ring);
+	assert(stream);
+
+	if (hound_ctx_is_record(ctx))
+		return ENOTSUP;
+
+	/* The client may change the header at any time, read it once */
+	const size_t size = ring->size;
+	const size_t period = ring->period;
+	const size_t frame_size = pcm_format_frame_size(&format);
+	if (area_size < sizeof(hound_ring_t) || frame_size == 0 ||
+	    period == 0 || size == 0 ||
+	    size > area_size - sizeof(hound_ring_t) ||
+	    (size % period) != 0 || (period % frame_size) != 0 ||
+	    size / period > HOUND_RING_MAX_PERIODS)
+		return EINVAL;
+
+	hound_ctx_stream_t *new_stream =
+	    hound_ctx_create_stream(ctx, flags, format, 0);
+	if (!new_stream)
+		return ENOMEM;
+
+	fibril_mutex_lock(&new_stream->guard);
+	ring->read_pos = 0;
+	ring->latency.count = 0;
+	ring->latency.min = UINT32_MAX;
+	ring->latency.max = 0;
+	ring->latency.lead = 0;
+	ring->latency.sum = 0;
+	ring->underruns = 0;
+	new_stream->ring = ring;
+	new_stream->ring_size = size;
+	new_stream->ring_period = period;
+	new_stream->ring_read = 0;
+	fibril_mutex_unlock(&new_stream->guard);
+
+	log_verbose("CTX: %p ring stream %p: %zu bytes, %zu byte periods",
+	    ctx, new_stream, size, period);
+	*stream = new_stream;
+	return EOK;
+}
+
 /**
  * Destroy existing stream structure.
  * @param stream The stream to destroy.
@@ -349,6 +424,105 @@ errno_t hound_ctx_stream_read(hound_ctx_stream_t *stream, void *data, size_t siz
 	return EEMPTY;
 }
 
+/**
+ * Number of bytes the client has written to a ring and the server did not
+ * mix yet.
+ * @param stream Stream using a shared ring, guard must be held.
+ * @return Number of bytes available.
+ */
+static size_t stream_ring_pending(hound_ctx_stream_t *stream)
+{
+	const size_t avail = stream->ring->write_pos - stream->ring_read;
+	return min(avail, stream->ring_size);
+}
+
+/**
+ * Update ring latency statistics after mixing.
+ * @param stream Stream using a shared ring, guard must be held.
+ * @param consumed Number of ring bytes mixed, starting at ring_read.
+ * @param frames Number of frames requested by the mix.
+ * @param f Destination data format.
+ */
+static void stream_ring_stats(hound_ctx_stream_t *stream, size_t consumed,
+    size_t frames, const pcm_format_t *f)
+{
+	hound_ring_t *ring = stream->ring;
+	const size_t rpos = stream->ring_read;
+	const size_t period = stream->ring_period;
+
+	struct timeval tv;
+	getuptime(&tv);
+	const uint64_t now = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+
+	for (size_t p = ROUND_UP(rpos, period) / period;
+	    p * period < rpos + consumed; ++p) {
+		const uint64_t stamp = ring->stamp[p % HOUND_RING_MAX_PERIODS];
+		const uint32_t age = (now > stamp) ?
+		    min(now - stamp, UINT32_MAX) : 0;
+		if (age < ring->latency.min)
+			ring->latency.min = age;
+		if (age > ring->latency.max)
+			ring->latency.max = age;
+		ring->latency.sum += age;
+		ring->latency.count++;
+	}
+
+	/* The device keeps the mixed chunk queued while the previous plays */
+	if (f->sampling_rate)
+		ring->latency.lead =
+		    (uint64_t) frames * 1000000 / f->sampling_rate;
+}
+
+/**
+ * Mix data from a shared ring to the destination buffer.
+ * @param stream Stream using a shared ring, guard must be held.
+ * @param data Destination audio buffer.
+ * @param size Size of the @p data buffer.
+ * @param f Destination data format.
+ * @return Size of the destination buffer touched with stream's data.
+ */
+static size_t stream_ring_mix(hound_ctx_stream_t *stream, void *data,
+    size_t size, const pcm_format_t *f)
+{
+	hound_ring_t *ring = stream->ring;
+	const size_t src_frame_size = pcm_format_frame_size(&stream->format);
+	const size_t dst_frame_size = pcm_format_frame_size(f);
+	const size_t needed_frames = size / dst_frame_size;
+
+	const size_t avail = stream_ring_pending(stream);
+	/* Do not read the data before the write position */
+	read_barrier();
+
+	const size_t frames = min(avail / src_frame_size, needed_frames);
+	if (frames < needed_frames && ring->write_pos != 0)
+		ring->underruns++;
+
+	/* Frames never straddle the end of the ring */
+	const size_t consumed = frames * src_frame_size;
+	uint8_t *dst = data;
+	size_t done = 0;
+	while (done < consumed) {
+		const size_t offset = (stream->ring_read + done) %
+		    stream->ring_size;
+		const size_t chunk =
+		    min(consumed - done, stream->ring_size - offset);
+		const size_t dst_chunk =
+		    chunk / src_frame_size * dst_frame_size;
+		pcm_format_convert_and_mix(dst, dst_chunk,
+		    ring->data + offset, chunk, &stream->format, f);
+		dst += dst_chunk;
+		done += chunk;
+	}
+
+	stream_ring_stats(stream, consumed, needed_frames, f);
+
+	/* The client may reuse the space once the position moves */
+	memory_barrier();
+	stream->ring_read += consumed;
+	ring->read_pos = stream->ring_read;
+	return frames * dst_frame_size;
+}
+
 /**
  * Add (mix) stream data to the destination buffer.
  * @param stream The source stream.
@@ -362,7 +536,9 @@ size_t hound_ctx_stream_add_self(hound_ctx_stream_t *stream, void *data,
 {
 	assert(stream);
 	fibril_mutex_lock(&stream->guard);
-	const size_t ret = audio_pipe_mix_data(&stream->fifo, data, size, f);
+	const size_t ret = stream->ring ?
+	    stream_ring_mix(stream, data, size, f) :
+	    audio_pipe_mix_data(&stream->fifo, data, size, f);
 	fibril_condvar_signal(&stream->change);
 	fibril_mutex_unlock(&stream->guard);
 	return ret;
@@ -377,11 +553,40 @@ void hound_ctx_stream_drain(hound_ctx_stream_t *stream)
 	assert(stream);
 	log_debug("Draining stream");
 	fibril_mutex_lock(&stream->guard);
-	while (audio_pipe_bytes(&stream->fifo))
+	/* A trailing partial frame in the ring is never mixed */
+	while (stream->ring ? (stream_ring_pending(stream) >=
+	    pcm_format_frame_size(&stream->format)) :
+	    audio_pipe_bytes(&stream->fifo))
 		fibril_condvar_wait(&stream->change, &stream->guard);
 	fibril_mutex_unlock(&stream->guard);
 }
 
+/**
+ * Block until the ring read position moves away from the given one.
+ * @param stream Target stream, must use a shared ring.
+ * @param pos Read position known to the client.
+ * @param[out] new_pos Current read position.
+ * @return Error code, ETIMEOUT if the position did not change in time.
+ */
+errno_t hound_ctx_stream_wait(hound_ctx_stream_t *stream, size_t pos,
+    size_t *new_pos)
+{
+	assert(stream);
+	assert(new_pos);
+	if (!stream->ring)
+		return EINVAL;
+
+	errno_t ret = EOK;
+	fibril_mutex_lock(&stream->guard);
+	while (stream->ring_read == pos && ret == EOK) {
+		ret = fibril_condvar_wait_timeout(&stream->change,
+		    &stream->guard, RING_WAIT_TIMEOUT);
+	}
+	*new_pos = stream->ring_read;
+	fibril_mutex_unlock(&stream->guard);
+	return ret;
+}
+
 /**
  * Update context data.
  * @param source Source abstraction.
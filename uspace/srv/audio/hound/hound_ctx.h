@@ -69,6 +69,9 @@ bool hound_ctx_is_record(hound_ctx_t *ctx);
 
 hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
     pcm_format_t format, size_t buffer_size);
+errno_t hound_ctx_create_ring_stream(hound_ctx_t *ctx, int flags,
+    pcm_format_t format, hound_ring_t *ring, size_t area_size,
+    hound_ctx_stream_t **stream);
 void hound_ctx_destroy_stream(hound_ctx_stream_t *stream);
 
 errno_t hound_ctx_stream_write(hound_ctx_stream_t *stream, const void *buffer,
@@ -77,6 +80,8 @@ errno_t hound_ctx_stream_read(hound_ctx_stream_t *stream, void *buffer, size_t s
 size_t hound_ctx_stream_add_self(hound_ctx_stream_t *stream, void *data,
     size_t size, const pcm_format_t *f);
 void hound_ctx_stream_drain(hound_ctx_stream_t *stream);
+errno_t hound_ctx_stream_wait(hound_ctx_stream_t *stream, size_t pos,
+    size_t *new_pos);
 
 #endif
 
@@ -129,6 +129,32 @@ static errno_t iface_add_stream(void *server, hound_context_id_t id, int flags,
 	return EOK;
 }
 
+static errno_t iface_add_ring_stream(void *server, hound_context_id_t id,
+    int flags, pcm_format_t format, hound_ring_t *ring, size_t size,
+    void **data)
+{
+	assert(data);
+	assert(server);
+
+	log_verbose("%s: %p, %" PRIxn " %x ch:%u r:%u f:%s", __FUNCTION__,
+	    server, id, flags, format.channels, format.sampling_rate,
+	    pcm_sample_format_str(format.sample_format));
+	hound_ctx_t *ctx = hound_get_ctx_by_id(server, id);
+	if (!ctx)
+		return ENOENT;
+	hound_ctx_stream_t *stream = NULL;
+	const errno_t ret =
+	    hound_ctx_create_ring_stream(ctx, flags, format, ring, size, &stream);
+	if (ret == EOK)
+		*data = stream;
+	return ret;
+}
+
+static errno_t iface_ring_wait(void *stream, size_t pos, size_t *new_pos)
+{
+	return hound_ctx_stream_wait(stream, pos, new_pos);
+}
+
 static errno_t iface_rem_stream(void *server, void *stream)
 {
 	hound_ctx_destroy_stream(stream);
@@ -159,6 +185,8 @@ hound_server_iface_t hound_iface = {
 	.connect = iface_connect,
 	.disconnect = iface_disconnect,
 	.add_stream = iface_add_stream,
+	.add_ring_stream = iface_add_ring_stream,
+	.ring_wait = iface_ring_wait,
 	.rem_stream = iface_rem_stream,
 	.drain_stream = iface_drain_stream,
 	.stream_data_write = iface_stream_data_write,
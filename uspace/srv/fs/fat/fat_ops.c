@@ -1237,27 +1237,38 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 	if (nodep->type == FAT_FILE) {
 		/*
-		 * Our strategy for regular file reads is to read one block at
-		 * most and make use of the possibility to return less data than
-		 * requested. This keeps the code very simple.
+		 * Our strategy for regular file reads is to gather as many
+		 * blocks as can be sent in a single answer and make use of
+		 * the possibility to return less data than requested.
 		 */
 		if (pos >= nodep->size) {
 			/* reading beyond the EOF */
 			bytes = 0;
 			(void) async_data_read_finalize(callid, NULL, 0);
 		} else {
-			bytes = min(len, BPS(bs) - pos % BPS(bs));
-			bytes = min(bytes, nodep->size - pos);
-			rc = fat_block_get(&b, bs, nodep, pos / BPS(bs),
-			    BLOCK_FLAGS_NONE);
-			if (rc != EOK) {
-				fat_node_put(fn);
-				async_answer_0(callid, rc);
-				return rc;
+			block_iov_t biov;
+			aoff64_t bpos;
+			size_t chunk;
+
+			len = min(len, nodep->size - pos);
+			bytes = 0;
+			block_iov_init(&biov);
+			while (bytes < len && !block_iov_full(&biov)) {
+				bpos = pos + bytes;
+				chunk = min(len - bytes, BPS(bs) - bpos % BPS(bs));
+				rc = fat_block_get(&b, bs, nodep, bpos / BPS(bs),
+				    BLOCK_FLAGS_NONE);
+				if (rc != EOK) {
+					(void) block_iov_fini(&biov);
+					fat_node_put(fn);
+					async_answer_0(callid, rc);
+					return rc;
+				}
+				(void) block_iov_add_block(&biov, b,
+				    bpos % BPS(bs), chunk);
+				bytes += chunk;
 			}
-			(void) async_data_read_finalize(callid,
-			    b->data + pos % BPS(bs), bytes);
-			rc = block_put(b);
+			rc = block_iov_finalize(&biov, callid);
 			if (rc != EOK) {
 				fat_node_put(fn);
 				return rc;
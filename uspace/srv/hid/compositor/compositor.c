@@ -56,6 +56,7 @@
 #include <async.h>
 #include <loc.h>
 #include <task.h>
+#include <sys/time.h>
 
 #include <io/keycode.h>
 #include <io/mode.h>
@@ -82,6 +83,15 @@
 #define ANIMATE_WINDOW_TRANSFORMS 0
 #endif
 
+/** Refresh rate assumed for outputs which do not report any */
+#define DEFAULT_REFRESH_RATE  60
+
+/** Maximum number of separate damaged rectangles per viewport */
+#define DAMAGE_RECTS  8
+
+/** Maximum number of opaque windows considered for occlusion */
+#define OCCLUDERS_MAX  16
+
 static char *server_name;
 static sysarg_t coord_origin;
 static pixel_t bg_color;
@@ -103,6 +113,8 @@ typedef struct {
 	double angle;
 	uint8_t opacity;
 	surface_t *surface;
+	/** Hidden below opaque windows in the area being repainted */
+	bool occluded;
 } window_t;
 
 static service_id_t winreg_id;
@@ -138,6 +150,9 @@ typedef struct {
 	async_sess_t *sess;
 	desktop_point_t pos;
 	surface_t *surface;
+	/** Damaged rectangles (global coordinates) to repaint in next frame */
+	desktop_rect_t damage[DAMAGE_RECTS];
+	size_t damage_count;
 } viewport_t;
 
 static desktop_rect_t viewport_bound_rect;
@@ -146,6 +161,17 @@ static LIST_INITIALIZE(viewport_list);
 
 static FIBRIL_MUTEX_INITIALIZE(discovery_mtx);
 
+/*
+ * Frame pacing and statistics, protected by viewport_list_mtx.
+ */
+static fibril_timer_t *frame_timer;
+static bool frame_pending = false;
+static struct timeval frame_last;
+static compositor_stats_t frame_stats;
+static struct timeval stats_start;
+static sysarg_t stats_frames;
+static sysarg_t stats_pixels;
+
 /** Input server proxy */
 static input_t *input;
 static bool active = false;
@@ -377,198 +403,392 @@ static void comp_restrict_pointers(void)
 	fibril_mutex_unlock(&pointer_list_mtx);
 }
 
-static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
-    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+/** Invert a horizontal or vertical line of pixels on a surface.
+ *
+ * The caller is responsible for marking the line as damaged.
+ */
+static void comp_invert_line(surface_t *surface, sysarg_t x, sysarg_t y,
+    sysarg_t len, bool vertical)
 {
-	fibril_mutex_lock(&viewport_list_mtx);
-	fibril_mutex_lock(&window_list_mtx);
-	fibril_mutex_lock(&pointer_list_mtx);
+	pixelmap_t *pixmap = surface_pixmap_access(surface);
+	pixel_t *pixel = pixelmap_pixel_at(pixmap, x, y);
+	if (pixel == NULL)
+		return;
 
-	list_foreach(viewport_list, link, viewport_t, vp) {
-		/* Determine what part of the viewport must be updated. */
-		sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
-		surface_get_resolution(vp->surface, &w_dmg_vp, &h_dmg_vp);
-		bool isec_vp = rectangle_intersect(
-		    x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob,
-		    vp->pos.x, vp->pos.y, w_dmg_vp, h_dmg_vp,
-		    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
+	size_t stride = vertical ? pixmap->width : 1;
+	sysarg_t max = vertical ? pixmap->height - y : pixmap->width - x;
+	if (len > max)
+		len = max;
 
-		if (isec_vp) {
+	while (len-- != 0) {
+		*pixel = INVERT(*pixel);
+		pixel += stride;
+	}
+}
 
-			/* Paint background color. */
-			for (sysarg_t y = y_dmg_vp - vp->pos.y; y <  y_dmg_vp - vp->pos.y + h_dmg_vp; ++y) {
-				pixel_t *dst = pixelmap_pixel_at(
-				    surface_pixmap_access(vp->surface), x_dmg_vp - vp->pos.x, y);
-				sysarg_t count = w_dmg_vp;
-				while (count-- != 0) {
-					*dst++ = bg_color;
-				}
+/** Check whether the first rectangle contains the second one. */
+static bool comp_rect_contains(desktop_rect_t *outer, sysarg_t x, sysarg_t y,
+    sysarg_t w, sysarg_t h)
+{
+	return (desktop_coord_t) x >= outer->x && (desktop_coord_t) y >= outer->y &&
+	    (desktop_coord_t) (x + w) <= outer->x + outer->w &&
+	    (desktop_coord_t) (y + h) <= outer->y + outer->h;
+}
+
+/** Check whether a window is known to hide everything below it.
+ *
+ * Only fully opaque, decorated windows that are not rotated qualify.
+ * Decorated windows paint their whole surface with opaque pixels.
+ */
+static bool comp_window_is_opaque(window_t *win)
+{
+	return win->surface != NULL && win->opacity == 255 &&
+	    (win->flags & WINDOW_DECORATED) != 0 &&
+	    win->transform.matrix[0][1] == 0 && win->transform.matrix[1][0] == 0;
+}
+
+/** Mark windows which are not visible in an area.
+ *
+ * Walks the window list from the top down, collecting the rectangles
+ * covered by opaque windows. A window whose part within the area lies
+ * inside one of the rectangles above it is marked as occluded and is
+ * not composed. Window list lock must be held.
+ *
+ * @return @c true if the whole area is covered by an opaque window.
+ */
+static bool comp_mark_occluded(sysarg_t x_area, sysarg_t y_area,
+    sysarg_t w_area, sysarg_t h_area)
+{
+	desktop_rect_t occluders[OCCLUDERS_MAX];
+	size_t count = 0;
+
+	list_foreach(window_list, link, window_t, win) {
+		win->occluded = false;
+		if (!win->surface)
+			continue;
+
+		sysarg_t x_win, y_win, w_win, h_win;
+		sysarg_t x_vis, y_vis, w_vis, h_vis;
+		surface_get_resolution(win->surface, &w_win, &h_win);
+		comp_coord_bounding_rect(0, 0, w_win, h_win, win->transform,
+		    &x_win, &y_win, &w_win, &h_win);
+		if (!rectangle_intersect(x_area, y_area, w_area, h_area,
+		    x_win, y_win, w_win, h_win, &x_vis, &y_vis, &w_vis, &h_vis))
+			continue;
+
+		for (size_t i = 0; i < count; i++) {
+			if (comp_rect_contains(&occluders[i], x_vis, y_vis,
+			    w_vis, h_vis)) {
+				win->occluded = true;
+				break;
 			}
-			surface_add_damaged_region(vp->surface,
-			    x_dmg_vp - vp->pos.x, y_dmg_vp - vp->pos.y, w_dmg_vp, h_dmg_vp);
-
-			transform_t transform;
-			source_t source;
-			drawctx_t context;
-
-			source_init(&source);
-			source_set_filter(&source, filter);
-			drawctx_init(&context, vp->surface);
-			drawctx_set_compose(&context, compose_over);
-			drawctx_set_source(&context, &source);
-
-			/* For each window. */
-			for (link_t *link = window_list.head.prev;
-			    link != &window_list.head; link = link->prev) {
-
-				/* Determine what part of the window intersects with the
-				 * updated area of the current viewport. */
-				window_t *win = list_get_instance(link, window_t, link);
-				if (!win->surface) {
-					continue;
+		}
+
+		if (win->occluded || count == OCCLUDERS_MAX ||
+		    !comp_window_is_opaque(win) || w_win <= 2 || h_win <= 2)
+			continue;
+
+		/* Edge pixels may be blended with what lies below. */
+		occluders[count].x = x_win + 1;
+		occluders[count].y = y_win + 1;
+		occluders[count].w = w_win - 2;
+		occluders[count].h = h_win - 2;
+		count++;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (comp_rect_contains(&occluders[i], x_area, y_area, w_area, h_area))
+			return true;
+	}
+
+	return false;
+}
+
+/** Repaint part of a viewport.
+ *
+ * Viewport, window and pointer list locks must be held.
+ *
+ * @param vp Viewport to repaint
+ * @param rect Damaged rectangle in global coordinates
+ * @return Number of repainted pixels
+ */
+static sysarg_t comp_repaint(viewport_t *vp, desktop_rect_t *rect)
+{
+	/* Determine what part of the viewport must be updated. */
+	sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
+	surface_get_resolution(vp->surface, &w_dmg_vp, &h_dmg_vp);
+	bool isec_vp = rectangle_intersect(
+	    rect->x, rect->y, rect->w, rect->h,
+	    vp->pos.x, vp->pos.y, w_dmg_vp, h_dmg_vp,
+	    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
+
+	if (!isec_vp)
+		return 0;
+
+	/* Skip windows hidden below opaque windows. */
+	bool bg_occluded = comp_mark_occluded(x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp);
+
+	/* Paint background color. */
+	for (sysarg_t y = y_dmg_vp - vp->pos.y; !bg_occluded &&
+	    y < y_dmg_vp - vp->pos.y + h_dmg_vp; ++y) {
+		pixel_t *dst = pixelmap_pixel_at(
+		    surface_pixmap_access(vp->surface), x_dmg_vp - vp->pos.x, y);
+		sysarg_t count = w_dmg_vp;
+		while (count-- != 0) {
+			*dst++ = bg_color;
+		}
+	}
+	surface_add_damaged_region(vp->surface,
+	    x_dmg_vp - vp->pos.x, y_dmg_vp - vp->pos.y, w_dmg_vp, h_dmg_vp);
+
+	transform_t transform;
+	source_t source;
+	drawctx_t context;
+
+	source_init(&source);
+	source_set_filter(&source, filter);
+	drawctx_init(&context, vp->surface);
+	drawctx_set_compose(&context, compose_over);
+	drawctx_set_source(&context, &source);
+
+	/* For each window. */
+	for (link_t *link = window_list.head.prev;
+	    link != &window_list.head; link = link->prev) {
+
+		/* Determine what part of the window intersects with the
+		 * updated area of the current viewport. */
+		window_t *win = list_get_instance(link, window_t, link);
+		if (!win->surface || win->occluded) {
+			continue;
+		}
+		sysarg_t x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win;
+		surface_get_resolution(win->surface, &w_dmg_win, &h_dmg_win);
+		comp_coord_bounding_rect(0, 0, w_dmg_win, h_dmg_win, win->transform,
+		    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
+		bool isec_win = rectangle_intersect(
+		    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
+		    x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win,
+		    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
+
+		if (isec_win) {
+			/* Prepare conversion from global coordinates to viewport
+			 * coordinates. */
+			transform = win->transform;
+			double_point_t pos;
+			pos.x = vp->pos.x;
+			pos.y = vp->pos.y;
+			transform_translate(&transform, -pos.x, -pos.y);
+
+			source_set_transform(&source, transform);
+			source_set_texture(&source, win->surface,
+			    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+			source_set_alpha(&source, PIXEL(win->opacity, 0, 0, 0));
+
+			drawctx_transfer(&context,
+			    x_dmg_win - vp->pos.x, y_dmg_win - vp->pos.y, w_dmg_win, h_dmg_win);
+		}
+	}
+
+	list_foreach(pointer_list, link, pointer_t, ptr) {
+		if (ptr->ghost.surface) {
+
+			sysarg_t x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost;
+			sysarg_t x_dmg_ghost, y_dmg_ghost, w_dmg_ghost, h_dmg_ghost;
+			surface_get_resolution(ptr->ghost.surface, &w_bnd_ghost, &h_bnd_ghost);
+			comp_coord_bounding_rect(0, 0, w_bnd_ghost, h_bnd_ghost, ptr->ghost.transform,
+			    &x_bnd_ghost, &y_bnd_ghost, &w_bnd_ghost, &h_bnd_ghost);
+			bool isec_ghost = rectangle_intersect(
+			    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
+			    x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost,
+			    &x_dmg_ghost, &y_dmg_ghost, &w_dmg_ghost, &h_dmg_ghost);
+
+			if (isec_ghost) {
+				/* FIXME: Ghost is currently drawn based on the bounding
+				 * rectangle of the window, which is sufficient as long
+				 * as the windows can be rotated only by 90 degrees.
+				 * For ghost to be compatible with arbitrary-angle
+				 * rotation, it should be drawn as four lines adjusted
+				 * by the transformation matrix. That would however
+				 * require to equip libdraw with line drawing functionality. */
+
+				transform_t transform = ptr->ghost.transform;
+				double_point_t pos;
+				pos.x = vp->pos.x;
+				pos.y = vp->pos.y;
+				transform_translate(&transform, -pos.x, -pos.y);
+
+				if (y_bnd_ghost == y_dmg_ghost) {
+					comp_invert_line(vp->surface,
+					    x_dmg_ghost - vp->pos.x, y_dmg_ghost - vp->pos.y,
+					    w_dmg_ghost, false);
 				}
-				sysarg_t x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win;
-				surface_get_resolution(win->surface, &w_dmg_win, &h_dmg_win);
-				comp_coord_bounding_rect(0, 0, w_dmg_win, h_dmg_win, win->transform,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-				bool isec_win = rectangle_intersect(
-				    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-				    x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-
-				if (isec_win) {
-					/* Prepare conversion from global coordinates to viewport
-					 * coordinates. */
-					transform = win->transform;
-					double_point_t pos;
-					pos.x = vp->pos.x;
-					pos.y = vp->pos.y;
-					transform_translate(&transform, -pos.x, -pos.y);
-
-					source_set_transform(&source, transform);
-					source_set_texture(&source, win->surface,
-					    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
-					source_set_alpha(&source, PIXEL(win->opacity, 0, 0, 0));
-
-					drawctx_transfer(&context,
-					    x_dmg_win - vp->pos.x, y_dmg_win - vp->pos.y, w_dmg_win, h_dmg_win);
+
+				if (y_bnd_ghost + h_bnd_ghost == y_dmg_ghost + h_dmg_ghost) {
+					comp_invert_line(vp->surface,
+					    x_dmg_ghost - vp->pos.x,
+					    y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1,
+					    w_dmg_ghost, false);
 				}
-			}
 
-			list_foreach(pointer_list, link, pointer_t, ptr) {
-				if (ptr->ghost.surface) {
-
-					sysarg_t x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost;
-					sysarg_t x_dmg_ghost, y_dmg_ghost, w_dmg_ghost, h_dmg_ghost;
-					surface_get_resolution(ptr->ghost.surface, &w_bnd_ghost, &h_bnd_ghost);
-					comp_coord_bounding_rect(0, 0, w_bnd_ghost, h_bnd_ghost, ptr->ghost.transform,
-					    &x_bnd_ghost, &y_bnd_ghost, &w_bnd_ghost, &h_bnd_ghost);
-					bool isec_ghost = rectangle_intersect(
-					    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-					    x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost,
-					    &x_dmg_ghost, &y_dmg_ghost, &w_dmg_ghost, &h_dmg_ghost);
-
-					if (isec_ghost) {
-						/* FIXME: Ghost is currently drawn based on the bounding
-						 * rectangle of the window, which is sufficient as long
-						 * as the windows can be rotated only by 90 degrees.
-						 * For ghost to be compatible with arbitrary-angle
-						 * rotation, it should be drawn as four lines adjusted
-						 * by the transformation matrix. That would however
-						 * require to equip libdraw with line drawing functionality. */
-
-						transform_t transform = ptr->ghost.transform;
-						double_point_t pos;
-						pos.x = vp->pos.x;
-						pos.y = vp->pos.y;
-						transform_translate(&transform, -pos.x, -pos.y);
-
-						pixel_t ghost_color;
-
-						if (y_bnd_ghost == y_dmg_ghost) {
-							for (sysarg_t x = x_dmg_ghost - vp->pos.x;
-								    x < x_dmg_ghost - vp->pos.x + w_dmg_ghost; ++x) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y);
-								surface_put_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y, INVERT(ghost_color));
-							}
-						}
-
-						if (y_bnd_ghost + h_bnd_ghost == y_dmg_ghost + h_dmg_ghost) {
-							for (sysarg_t x = x_dmg_ghost - vp->pos.x;
-								    x < x_dmg_ghost - vp->pos.x + w_dmg_ghost; ++x) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1);
-								surface_put_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1, INVERT(ghost_color));
-							}
-						}
-
-						if (x_bnd_ghost == x_dmg_ghost) {
-							for (sysarg_t y = y_dmg_ghost - vp->pos.y;
-								    y < y_dmg_ghost - vp->pos.y + h_dmg_ghost; ++y) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x, y);
-								surface_put_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x, y, INVERT(ghost_color));
-							}
-						}
-
-						if (x_bnd_ghost + w_bnd_ghost == x_dmg_ghost + w_dmg_ghost) {
-							for (sysarg_t y = y_dmg_ghost - vp->pos.y;
-								    y < y_dmg_ghost - vp->pos.y + h_dmg_ghost; ++y) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1, y);
-								surface_put_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1, y, INVERT(ghost_color));
-							}
-						}
-					}
+				if (x_bnd_ghost == x_dmg_ghost) {
+					comp_invert_line(vp->surface,
+					    x_dmg_ghost - vp->pos.x, y_dmg_ghost - vp->pos.y,
+					    h_dmg_ghost, true);
+				}
 
+				if (x_bnd_ghost + w_bnd_ghost == x_dmg_ghost + w_dmg_ghost) {
+					comp_invert_line(vp->surface,
+					    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1,
+					    y_dmg_ghost - vp->pos.y, h_dmg_ghost, true);
 				}
 			}
 
-			list_foreach(pointer_list, link, pointer_t, ptr) {
-
-				/* Determine what part of the pointer intersects with the
-				 * updated area of the current viewport. */
-				sysarg_t x_dmg_ptr, y_dmg_ptr, w_dmg_ptr, h_dmg_ptr;
-				surface_t *sf_ptr = ptr->cursor.states[ptr->state];
-				surface_get_resolution(sf_ptr, &w_dmg_ptr, &h_dmg_ptr);
-				bool isec_ptr = rectangle_intersect(
-				    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-				    ptr->pos.x, ptr->pos.y, w_dmg_ptr, h_dmg_ptr,
-				    &x_dmg_ptr, &y_dmg_ptr, &w_dmg_ptr, &h_dmg_ptr);
-
-				if (isec_ptr) {
-					/* Pointer is currently painted directly by copying pixels.
-					 * However, it is possible to draw the pointer similarly
-					 * as window by using drawctx_transfer. It would allow
-					 * more sophisticated control over drawing, but would also
-					 * cost more regarding the performance. */
-
-					sysarg_t x_vp = x_dmg_ptr - vp->pos.x;
-					sysarg_t y_vp = y_dmg_ptr - vp->pos.y;
-					sysarg_t x_ptr = x_dmg_ptr - ptr->pos.x;
-					sysarg_t y_ptr = y_dmg_ptr - ptr->pos.y;
-
-					for (sysarg_t y = 0; y < h_dmg_ptr; ++y) {
-						pixel_t *src = pixelmap_pixel_at(
-						    surface_pixmap_access(sf_ptr), x_ptr, y_ptr + y);
-						pixel_t *dst = pixelmap_pixel_at(
-						    surface_pixmap_access(vp->surface), x_vp, y_vp + y);
-						sysarg_t count = w_dmg_ptr;
-						while (count-- != 0) {
-							*dst = (*src & 0xff000000) ? *src : *dst;
-							++dst; ++src;
-						}
-					}
-					surface_add_damaged_region(vp->surface, x_vp, y_vp, w_dmg_ptr, h_dmg_ptr);
-				}
+		}
+	}
+
+	list_foreach(pointer_list, link, pointer_t, ptr) {
 
+		/* Determine what part of the pointer intersects with the
+		 * updated area of the current viewport. */
+		sysarg_t x_dmg_ptr, y_dmg_ptr, w_dmg_ptr, h_dmg_ptr;
+		surface_t *sf_ptr = ptr->cursor.states[ptr->state];
+		surface_get_resolution(sf_ptr, &w_dmg_ptr, &h_dmg_ptr);
+		bool isec_ptr = rectangle_intersect(
+		    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
+		    ptr->pos.x, ptr->pos.y, w_dmg_ptr, h_dmg_ptr,
+		    &x_dmg_ptr, &y_dmg_ptr, &w_dmg_ptr, &h_dmg_ptr);
+
+		if (isec_ptr) {
+			/* Pointer is currently painted directly by copying pixels.
+			 * However, it is possible to draw the pointer similarly
+			 * as window by using drawctx_transfer. It would allow
+			 * more sophisticated control over drawing, but would also
+			 * cost more regarding the performance. */
+
+			sysarg_t x_vp = x_dmg_ptr - vp->pos.x;
+			sysarg_t y_vp = y_dmg_ptr - vp->pos.y;
+			sysarg_t x_ptr = x_dmg_ptr - ptr->pos.x;
+			sysarg_t y_ptr = y_dmg_ptr - ptr->pos.y;
+
+			for (sysarg_t y = 0; y < h_dmg_ptr; ++y) {
+				pixel_t *src = pixelmap_pixel_at(
+				    surface_pixmap_access(sf_ptr), x_ptr, y_ptr + y);
+				pixel_t *dst = pixelmap_pixel_at(
+				    surface_pixmap_access(vp->surface), x_vp, y_vp + y);
+				sysarg_t count = w_dmg_ptr;
+				while (count-- != 0) {
+					*dst = (*src & 0xff000000) ? *src : *dst;
+					++dst; ++src;
+				}
 			}
+			surface_add_damaged_region(vp->surface, x_vp, y_vp, w_dmg_ptr, h_dmg_ptr);
 		}
+
+	}
+
+	return w_dmg_vp * h_dmg_vp;
+}
+
+/** Add a damaged rectangle to the viewport damage set.
+ *
+ * Rectangles overlapping the new one are merged with it. When the set
+ * is full, the new rectangle is merged with an existing one.
+ * Viewport list lock must be held.
+ */
+static void comp_damage_add(viewport_t *vp, sysarg_t x, sysarg_t y,
+    sysarg_t w, sysarg_t h)
+{
+	desktop_rect_t rect = { x, y, w, h };
+	size_t i = 0;
+
+	while (i < vp->damage_count) {
+		desktop_rect_t *cur = &vp->damage[i];
+		sysarg_t x_isec, y_isec, w_isec, h_isec;
+
+		if (!rectangle_intersect(rect.x, rect.y, rect.w, rect.h,
+		    cur->x, cur->y, cur->w, cur->h,
+		    &x_isec, &y_isec, &w_isec, &h_isec) &&
+		    vp->damage_count < DAMAGE_RECTS) {
+			i++;
+			continue;
+		}
+
+		/* Merge and start over, the union may overlap others. */
+		sysarg_t x_u, y_u, w_u, h_u;
+		rectangle_union(rect.x, rect.y, rect.w, rect.h,
+		    cur->x, cur->y, cur->w, cur->h, &x_u, &y_u, &w_u, &h_u);
+		rect.x = x_u;
+		rect.y = y_u;
+		rect.w = w_u;
+		rect.h = h_u;
+
+		vp->damage[i] = vp->damage[--vp->damage_count];
+		i = 0;
+	}
+
+	vp->damage[vp->damage_count++] = rect;
+}
+
+/** Determine the delay until the next frame is due. */
+static suseconds_t comp_frame_delay(void)
+{
+	sysarg_t rate = 0;
+	list_foreach(viewport_list, link, viewport_t, vp) {
+		if (vp->mode.refresh_rate > rate)
+			rate = vp->mode.refresh_rate;
+	}
+
+	if (rate == 0)
+		rate = DEFAULT_REFRESH_RATE;
+
+	struct timeval now;
+	getuptime(&now);
+
+	suseconds_t delay = 1000000 / rate - tv_sub_diff(&now, &frame_last);
+
+	/* Zero would mean no timeout at all */
+	return delay > 0 ? delay : 1;
+}
+
+/** Update frame statistics. Viewport list lock must be held. */
+static void comp_stats_update(sysarg_t pixels)
+{
+	struct timeval now;
+	getuptime(&now);
+
+	frame_stats.frames++;
+	frame_stats.pixels += pixels;
+	stats_frames++;
+	stats_pixels += pixels;
+
+	suseconds_t elapsed = tv_sub_diff(&now, &stats_start);
+	if (elapsed >= 1000000) {
+		frame_stats.frame_rate =
+		    (uint64_t) stats_frames * 1000000 / elapsed;
+		frame_stats.pixel_rate =
+		    (uint64_t) stats_pixels * 1000000 / elapsed;
+		stats_frames = 0;
+		stats_pixels = 0;
+		stats_start = now;
+	}
+}
+
+/** Compose one frame out of the damage accumulated since the last one. */
+static void comp_frame(void *arg)
+{
+	sysarg_t pixels = 0;
+
+	fibril_mutex_lock(&viewport_list_mtx);
+	frame_pending = false;
+	getuptime(&frame_last);
+
+	fibril_mutex_lock(&window_list_mtx);
+	fibril_mutex_lock(&pointer_list_mtx);
+
+	list_foreach(viewport_list, link, viewport_t, vp) {
+		for (size_t i = 0; i < vp->damage_count; i++)
+			pixels += comp_repaint(vp, &vp->damage[i]);
+		vp->damage_count = 0;
 	}
 
 	fibril_mutex_unlock(&pointer_list_mtx);
@@ -579,15 +799,59 @@ static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
 		list_foreach(viewport_list, link, viewport_t, vp) {
 			sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
 			surface_get_damaged_region(vp->surface, &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
+			if (w_dmg_vp == 0 || h_dmg_vp == 0)
+				continue;
 			surface_reset_damaged_region(vp->surface);
 			visualizer_update_damaged_region(vp->sess,
 			    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp, 0, 0);
 		}
 	}
-	
+
+	comp_stats_update(pixels);
+
+	fibril_mutex_unlock(&viewport_list_mtx);
+}
+
+/** Mark a region as damaged.
+ *
+ * The region is repainted with the next frame. Frames are composed at
+ * most once per refresh period of the outputs.
+ */
+static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
+    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+{
+	fibril_mutex_lock(&viewport_list_mtx);
+
+	list_foreach(viewport_list, link, viewport_t, vp) {
+		sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
+		surface_get_resolution(vp->surface, &w_dmg_vp, &h_dmg_vp);
+		bool isec_vp = rectangle_intersect(
+		    x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob,
+		    vp->pos.x, vp->pos.y, w_dmg_vp, h_dmg_vp,
+		    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
+
+		if (isec_vp)
+			comp_damage_add(vp, x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp);
+	}
+
+	if (!frame_pending) {
+		frame_pending = true;
+		fibril_timer_set(frame_timer, comp_frame_delay(), comp_frame, NULL);
+	}
+
 	fibril_mutex_unlock(&viewport_list_mtx);
 }
 
+static void comp_get_stats(ipc_callid_t iid, ipc_call_t *icall)
+{
+	fibril_mutex_lock(&viewport_list_mtx);
+	compositor_stats_t stats = frame_stats;
+	fibril_mutex_unlock(&viewport_list_mtx);
+
+	async_answer_4(iid, EOK, stats.frames, stats.pixels, stats.frame_rate,
+	    stats.pixel_rate);
+}
+
 static void comp_window_get_event(window_t *win, ipc_callid_t iid, ipc_call_t *icall)
 {
 	window_event_t *event = (window_event_t *) prodcons_consume(&win->queue);
@@ -957,6 +1221,9 @@ static void client_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 				comp_post_event_win(event_unfocus, win_unfocus);
 			}
 
+			return;
+		} else if (IPC_GET_IMETHOD(call) == WINDOW_GET_STATS) {
+			comp_get_stats(callid, &call);
 			return;
 		} else {
 			async_answer_0(callid, EINVAL);
@@ -2247,6 +2514,14 @@ static errno_t compositor_srv_init(char *input_svc, char *name)
 	/* Color of the viewport background. Must be opaque. */
 	bg_color = PIXEL(255, 69, 51, 103);
 	
+	/* Frames are composed by the timer fibril. */
+	frame_timer = fibril_timer_create(NULL);
+	if (frame_timer == NULL) {
+		printf("%s: Unable to create frame timer\n", NAME);
+		return ENOMEM;
+	}
+	getuptime(&stats_start);
+	
 	/* Register compositor server. */
 	async_set_fallback_port_handler(client_connection, NULL);
 	
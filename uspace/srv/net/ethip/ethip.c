@@ -61,6 +61,7 @@ static errno_t ethip_get_mac48(iplink_srv_t *srv, addr48_t *mac);
 static errno_t ethip_set_mac48(iplink_srv_t *srv, addr48_t *mac);
 static errno_t ethip_addr_add(iplink_srv_t *srv, inet_addr_t *addr);
 static errno_t ethip_addr_remove(iplink_srv_t *srv, inet_addr_t *addr);
+static errno_t ethip_get_stats(iplink_srv_t *srv, iplink_stats_t *stats);
 
 static void ethip_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg);
 
@@ -73,7 +74,8 @@ static iplink_ops_t ethip_iplink_ops = {
 	.get_mac48 = ethip_get_mac48,
 	.set_mac48 = ethip_set_mac48,
 	.addr_add = ethip_addr_add,
-	.addr_remove = ethip_addr_remove
+	.addr_remove = ethip_addr_remove,
+	.get_stats = ethip_get_stats
 };
 
 static errno_t ethip_init(void)
@@ -309,6 +311,14 @@ static errno_t ethip_addr_remove(iplink_srv_t *srv, inet_addr_t *addr)
 	return ethip_nic_addr_remove(nic, addr);
 }
 
+static errno_t ethip_get_stats(iplink_srv_t *srv, iplink_stats_t *stats)
+{
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+	
+	*stats = nic->stats;
+	return EOK;
+}
+
 int main(int argc, char *argv[])
 {
 	errno_t rc;
@@ -67,6 +67,9 @@ typedef struct ethip_nic {
 	 * (of the type ethip_link_addr_t)
 	 */
 	list_t addr_list;
+	
+	/** Receive statistics */
+	iplink_stats_t stats;
 } ethip_nic_t;
 
 /** Ethernet frame */
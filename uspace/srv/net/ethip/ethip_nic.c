@@ -35,6 +35,7 @@
  */
 
 #include <adt/list.h>
+#include <align.h>
 #include <async.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -275,6 +276,10 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_callid_t callid,
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Ethernet PDU contents (%zu bytes)",
 	    size);
 
+	nic->stats.rx_frames++;
+	nic->stats.rx_batches++;
+	nic->stats.rx_bytes += size;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "call ethip_received");
 	rc = ethip_received(&nic->iplink, data, size);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "free data");
@@ -284,6 +289,51 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_callid_t callid,
 	async_answer_0(callid, rc);
 }
 
+/** Process a batch of received frames.
+ *
+ * The frames are packed as described by nic_rx_batch_hdr_t.
+ */
+static void ethip_nic_received_batch(ethip_nic_t *nic, ipc_callid_t callid,
+    ipc_call_t *call)
+{
+	errno_t rc;
+	uint8_t *data;
+	size_t size;
+	size_t offs;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() nic=%p", nic);
+
+	rc = async_data_write_accept((void **)&data, false, 0,
+	    NIC_RX_BATCH_SIZE, 0, &size);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "data_write_accept() failed");
+		return;
+	}
+
+	nic->stats.rx_batches++;
+
+	offs = 0;
+	while (offs + sizeof(nic_rx_batch_hdr_t) <= size) {
+		nic_rx_batch_hdr_t *hdr = (nic_rx_batch_hdr_t *) (data + offs);
+		if (hdr->size > size - offs - sizeof(nic_rx_batch_hdr_t)) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Truncated frame batch");
+			break;
+		}
+
+		nic->stats.rx_frames++;
+		nic->stats.rx_bytes += hdr->size;
+
+		/* Errors in individual frames do not fail the whole batch */
+		(void) ethip_received(&nic->iplink, hdr + 1, hdr->size);
+
+		offs += ALIGN_UP(sizeof(nic_rx_batch_hdr_t) + hdr->size,
+		    NIC_RX_BATCH_ALIGN);
+	}
+
+	free(data);
+	async_answer_0(callid, EOK);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, ipc_callid_t callid,
     ipc_call_t *call)
 {
@@ -316,6 +366,9 @@ static void ethip_nic_cb_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, callid, &call);
 			break;
+		case NIC_EV_RECEIVED_BATCH:
+			ethip_nic_received_batch(nic, callid, &call);
+			break;
 		default:
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "unknown IPC method: %" PRIun, IPC_GET_IMETHOD(call));
 			async_answer_0(callid, ENOTSUP);
@@ -91,6 +91,8 @@ static errno_t inet_iplink_recv(iplink_t *iplink, iplink_recv_sdu_t *sdu, ip_ver
 	inet_link_t *ilink;
 
 	ilink = (inet_link_t *)iplink_get_userptr(iplink);
+	ilink->rx_packets++;
+	ilink->rx_bytes += sdu->size;
 
 	switch (ver) {
 	case ip_v4:
@@ -108,6 +110,7 @@ static errno_t inet_iplink_recv(iplink_t *iplink, iplink_recv_sdu_t *sdu, ip_ver
 
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "failed decoding PDU");
+		ilink->rx_errors++;
 		return rc;
 	}
 
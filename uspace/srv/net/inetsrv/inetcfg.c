@@ -184,6 +184,34 @@ static errno_t inetcfg_link_get(sysarg_t link_id, inet_link_info_t *linfo)
 	return EOK;
 }
 
+static errno_t inetcfg_link_get_stats(sysarg_t link_id,
+    inet_link_stats_t *stats)
+{
+	inet_link_t *ilink;
+	iplink_stats_t lstats;
+	errno_t rc;
+
+	ilink = inet_link_get_by_id(link_id);
+	if (ilink == NULL) {
+		return ENOENT;
+	}
+
+	memset(stats, 0, sizeof(inet_link_stats_t));
+	stats->rx_packets = ilink->rx_packets;
+	stats->rx_bytes = ilink->rx_bytes;
+	stats->rx_errors = ilink->rx_errors;
+
+	/* Not all link services keep statistics */
+	rc = iplink_get_stats(ilink->iplink, &lstats);
+	if (rc == EOK) {
+		stats->link_rx_frames = lstats.rx_frames;
+		stats->link_rx_batches = lstats.rx_batches;
+		stats->link_rx_bytes = lstats.rx_bytes;
+	}
+
+	return EOK;
+}
+
 static errno_t inetcfg_link_remove(sysarg_t link_id)
 {
 	return ENOTSUP;
@@ -558,6 +586,40 @@ static void inetcfg_link_get_srv(ipc_callid_t callid, ipc_call_t *call)
 	async_answer_1(callid, retval, linfo.def_mtu);
 }
 
+static void inetcfg_link_get_stats_srv(ipc_callid_t callid, ipc_call_t *call)
+{
+	ipc_callid_t rcallid;
+	size_t size;
+	sysarg_t link_id;
+	inet_link_stats_t stats;
+	errno_t rc;
+
+	link_id = IPC_GET_ARG1(*call);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "inetcfg_link_get_stats_srv()");
+
+	if (!async_data_read_receive(&rcallid, &size)) {
+		async_answer_0(rcallid, EREFUSED);
+		async_answer_0(callid, EREFUSED);
+		return;
+	}
+
+	if (size != sizeof(inet_link_stats_t)) {
+		async_answer_0(rcallid, EINVAL);
+		async_answer_0(callid, EINVAL);
+		return;
+	}
+
+	rc = inetcfg_link_get_stats(link_id, &stats);
+	if (rc != EOK) {
+		async_answer_0(rcallid, rc);
+		async_answer_0(callid, rc);
+		return;
+	}
+
+	rc = async_data_read_finalize(rcallid, &stats, size);
+	async_answer_0(callid, rc);
+}
+
 static void inetcfg_link_remove_srv(ipc_callid_t callid, ipc_call_t *call)
 {
 	sysarg_t link_id;
@@ -784,6 +846,9 @@ void inet_cfg_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case INETCFG_LINK_GET:
 			inetcfg_link_get_srv(callid, &call);
 			break;
+		case INETCFG_LINK_GET_STATS:
+			inetcfg_link_get_stats_srv(callid, &call);
+			break;
 		case INETCFG_LINK_REMOVE:
 			inetcfg_link_remove_srv(callid, &call);
 			break;
@@ -110,6 +110,12 @@ typedef struct {
 	size_t def_mtu;
 	addr48_t mac;
 	bool mac_valid;
+	/** Packets received from the link */
+	uint64_t rx_packets;
+	/** Bytes received from the link */
+	uint64_t rx_bytes;
+	/** Received packets that could not be decoded */
+	uint64_t rx_errors;
 } inet_link_t;
 
 typedef struct {
@@ -38,6 +38,7 @@
 #include <byteorder.h>
 #include <errno.h>
 #include <inet/endpoint.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "pdu.h"
@@ -139,7 +140,8 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
-	hdr->window = host2uint16_t_be(seg->wnd);
+	/* Without window scaling larger windows cannot be advertised */
+	hdr->window = host2uint16_t_be(min(seg->wnd, UINT16_MAX));
 	hdr->checksum = 0;
 	hdr->urg_ptr = host2uint16_t_be(seg->up);
 }
@@ -34,6 +34,7 @@
  * @file HelenOS service implementation
  */
 
+#include <as.h>
 #include <async.h>
 #include <errno.h>
 #include <str_error.h>
@@ -46,6 +47,7 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <vfs/vfs.h>
 
 #include "conn.h"
 #include "service.h"
@@ -57,6 +59,9 @@
 /** Maximum amount of data transferred in one send call */
 #define MAX_MSG_SIZE DATA_XFER_LIMIT
 
+/** Amount of file data read at once when sending a file */
+#define SEND_FILE_CHUNK (16 * 1024)
+
 static void tcp_ev_data(tcp_cconn_t *);
 static void tcp_ev_connected(tcp_cconn_t *);
 static void tcp_ev_conn_failed(tcp_cconn_t *);
@@ -329,6 +334,9 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
  */
 static void tcp_cconn_destroy(tcp_cconn_t *cconn)
 {
+	if (cconn->ring != NULL)
+		as_area_destroy(cconn->ring);
+
 	list_remove(&cconn->lclient);
 	free(cconn);
 }
@@ -673,6 +681,96 @@ static errno_t tcp_conn_send_impl(tcp_client_t *client, sysarg_t conn_id,
 	return EOK;
 }
 
+/** Send file contents via connection.
+ *
+ * Handle client request to send file data (with parameters unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param file    Open file handle
+ * @param pos     Position in the file to start at
+ * @param size    Number of bytes to send
+ * @param nsent   Place to store number of bytes actually sent
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_send_file_impl(tcp_client_t *client, sysarg_t conn_id,
+    int file, aoff64_t pos, size_t size, size_t *nsent)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+	tcp_error_t trc;
+
+	*nsent = 0;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	if (size == 0)
+		return EOK;
+
+	void *buf = malloc(min(size, SEND_FILE_CHUNK));
+	if (buf == NULL)
+		return ENOMEM;
+
+	size_t sent = 0;
+	while (sent < size) {
+		size_t nr;
+		rc = vfs_read(file, &pos, buf, min(size - sent, SEND_FILE_CHUNK),
+		    &nr);
+		if (rc != EOK || nr == 0)
+			break;
+
+		trc = tcp_uc_send(cconn->conn, buf, nr, 0);
+		if (trc != TCP_EOK) {
+			rc = EIO;
+			break;
+		}
+
+		sent += nr;
+	}
+
+	free(buf);
+	*nsent = sent;
+	return rc;
+}
+
+/** Set connection buffer sizes.
+ *
+ * Handle client request to set buffer sizes (with parameters unmarshalled).
+ *
+ * @param client   TCP client
+ * @param conn_id  Connection ID
+ * @param snd_size Send buffer size
+ * @param rcv_size Receive buffer size
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_bufsize_impl(tcp_client_t *client,
+    sysarg_t conn_id, size_t snd_size, size_t rcv_size)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+	tcp_error_t trc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	trc = tcp_uc_set_bufsize(cconn->conn, snd_size, rcv_size);
+	switch (trc) {
+	case TCP_EOK:
+		return EOK;
+	case TCP_EILLEGAL:
+		return EINVAL;
+	case TCP_ENORES:
+		return ENOMEM;
+	default:
+		return EIO;
+	}
+}
+
 /** Receive data from connection.
  *
  * Handle client request to receive data (with parameters unmarshalled).
@@ -1002,6 +1100,46 @@ static void tcp_conn_send_srv(tcp_client_t *client, ipc_callid_t iid,
 	free(data);
 }
 
+/** Send file contents via connection.
+ *
+ * Handle client request to send file data. The client passes the file
+ * handle right after the request.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_send_file_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	aoff64_t pos;
+	size_t size;
+	size_t nsent = 0;
+	int file;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_send_file_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	pos = MERGE_LOUP32(IPC_GET_ARG2(*icall), IPC_GET_ARG3(*icall));
+	size = IPC_GET_ARG4(*icall);
+
+	rc = vfs_receive_handle(false, &file);
+	if (rc != EOK) {
+		async_answer_0(iid, rc);
+		return;
+	}
+
+	rc = vfs_open(file, MODE_READ);
+	if (rc == EOK)
+		rc = tcp_conn_send_file_impl(client, conn_id, file, pos, size,
+		    &nsent);
+
+	vfs_put(file);
+	async_answer_1(iid, rc, nsent);
+}
+
 /** Read received data from connection without blocking.
  *
  * Handle client request to read received data via connection without blocking.
@@ -1119,6 +1257,171 @@ static void tcp_conn_recv_wait_srv(tcp_client_t *client, ipc_callid_t iid,
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_recv_wait_srv(): OK");
 }
 
+/** Set connection buffer sizes.
+ *
+ * Handle client request to set buffer sizes of a connection.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_set_bufsize_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_set_bufsize_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	rc = tcp_conn_set_bufsize_impl(client, conn_id, IPC_GET_ARG2(*icall),
+	    IPC_GET_ARG3(*icall));
+	async_answer_0(iid, rc);
+}
+
+/** Set up memory shared with client.
+ *
+ * Handle client request to share memory for data transfers on a
+ * connection. The client shares the memory right after the request.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_ring_create_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	ipc_callid_t callid;
+	tcp_cconn_t *cconn;
+	sysarg_t conn_id;
+	size_t ring_size;
+	size_t size;
+	unsigned int flags;
+	void *ring;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_ring_create_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	ring_size = IPC_GET_ARG2(*icall);
+
+	if (!async_share_out_receive(&callid, &size, &flags)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc == EOK && cconn->ring != NULL)
+		rc = EBUSY;
+	if (rc == EOK && (ring_size < 2 || ring_size > TCP_RING_SIZE_MAX ||
+	    size < 2 * ring_size ||
+	    (flags & (AS_AREA_READ | AS_AREA_WRITE)) !=
+	    (AS_AREA_READ | AS_AREA_WRITE)))
+		rc = EINVAL;
+
+	if (rc != EOK) {
+		async_answer_0(callid, rc);
+		async_answer_0(iid, rc);
+		return;
+	}
+
+	rc = async_share_out_finalize(callid, &ring);
+	if (rc != EOK || ring == AS_MAP_FAILED) {
+		async_answer_0(iid, rc != EOK ? rc : ENOMEM);
+		return;
+	}
+
+	cconn->ring = ring;
+	cconn->ring_size = ring_size;
+	async_answer_0(iid, EOK);
+}
+
+/** Send data via connection from shared memory.
+ *
+ * Handle client request to send data the client has placed in the
+ * transmit part of the shared memory.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_ring_send_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	tcp_cconn_t *cconn;
+	sysarg_t conn_id;
+	size_t offs;
+	size_t size;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_ring_send_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	offs = IPC_GET_ARG2(*icall);
+	size = IPC_GET_ARG3(*icall);
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		async_answer_0(iid, rc);
+		return;
+	}
+
+	if (cconn->ring == NULL || offs > cconn->ring_size ||
+	    size > cconn->ring_size - offs) {
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	/* Data are queued straight from the shared memory */
+	rc = tcp_conn_send_impl(client, conn_id, cconn->ring + offs, size);
+	async_answer_0(iid, rc);
+}
+
+/** Receive data from connection into shared memory.
+ *
+ * Handle client request to fill the receive part of the shared memory
+ * with received data without blocking.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_ring_recv_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	tcp_cconn_t *cconn;
+	sysarg_t conn_id;
+	size_t size, rsize;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_ring_recv_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	size = IPC_GET_ARG2(*icall);
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		async_answer_0(iid, rc);
+		return;
+	}
+
+	if (cconn->ring == NULL) {
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	size = min(size, cconn->ring_size);
+	rc = tcp_conn_recv_impl(client, conn_id,
+	    cconn->ring + cconn->ring_size, size, &rsize);
+	if (rc != EOK) {
+		async_answer_0(iid, rc);
+		return;
+	}
+
+	async_answer_1(iid, EOK, rsize);
+}
+
 /** Initialize TCP client structure.
  *
  * @param client TCP client
@@ -1225,12 +1528,27 @@ static void tcp_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case TCP_CONN_SEND:
 			tcp_conn_send_srv(&client, callid, &call);
 			break;
+		case TCP_CONN_SEND_FILE:
+			tcp_conn_send_file_srv(&client, callid, &call);
+			break;
 		case TCP_CONN_RECV:
 			tcp_conn_recv_srv(&client, callid, &call);
 			break;
 		case TCP_CONN_RECV_WAIT:
 			tcp_conn_recv_wait_srv(&client, callid, &call);
 			break;
+		case TCP_CONN_SET_BUFSIZE:
+			tcp_conn_set_bufsize_srv(&client, callid, &call);
+			break;
+		case TCP_CONN_RING_CREATE:
+			tcp_conn_ring_create_srv(&client, callid, &call);
+			break;
+		case TCP_CONN_RING_SEND:
+			tcp_conn_ring_send_srv(&client, callid, &call);
+			break;
+		case TCP_CONN_RING_RECV:
+			tcp_conn_ring_recv_srv(&client, callid, &call);
+			break;
 		default:
 			async_answer_0(callid, ENOTSUP);
 			break;
@@ -352,6 +352,11 @@ typedef struct tcp_cconn {
 	/** Client */
 	struct tcp_client *client;
 	link_t lclient;
+	/** Memory shared with the client, transmit part followed by receive
+	 * part, or @c NULL */
+	uint8_t *ring;
+	/** Size of each part of the shared memory */
+	size_t ring_size;
 } tcp_cconn_t;
 
 /** TCP client listener */
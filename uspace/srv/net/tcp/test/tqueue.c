@@ -200,6 +200,55 @@ PCUT_TEST(new_data_small_win)
 	PCUT_ASSERT_EQUALS(10, trans_seg[0]->seq);
 }
 
+/** Test sending more data than fits in one segment */
+PCUT_TEST(new_data_multi_seg)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 4096;
+	conn->snd_buf_used = 3000;
+	conn->snd_buf_fin = true;
+	for (i = 0; i < 3000; i++)
+		conn->snd_buf[i] = i;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+
+	PCUT_ASSERT_EQUALS(3011, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(0, conn->snd_buf_used);
+	PCUT_ASSERT_FALSE(conn->snd_buf_fin);
+	PCUT_ASSERT_INT_EQUALS(3, list_count(&conn->retransmit.list));
+
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_EQUALS(10, trans_seg[0]->seq);
+	PCUT_ASSERT_EQUALS(CTL_ACK, trans_seg[0]->ctrl);
+	PCUT_ASSERT_EQUALS(CTL_ACK, trans_seg[1]->ctrl);
+	PCUT_ASSERT_EQUALS(trans_seg[0]->seq + trans_seg[0]->len,
+	    trans_seg[1]->seq);
+	PCUT_ASSERT_EQUALS(trans_seg[1]->seq + trans_seg[1]->len,
+	    trans_seg[2]->seq);
+	PCUT_ASSERT_EQUALS(CTL_FIN | CTL_ACK, trans_seg[2]->ctrl);
+	PCUT_ASSERT_EQUALS(3011, trans_seg[2]->seq + trans_seg[2]->len);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
 /** Test flushing tqueue due to receiving an ACK */
 PCUT_TEST(ack_received)
 {
@@ -54,6 +54,13 @@
 
 #define RETRANSMIT_TIMEOUT	(2*1000*1000)
 
+/** Maximum amount of text in one segment.
+ *
+ * Segments this large still fit in an Ethernet frame together with
+ * IPv6 and TCP headers, so they need not be fragmented.
+ */
+#define SEG_TEXT_MAX	1440
+
 static void retransmit_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
 static void tcp_tqueue_timer_clear(tcp_conn_t *);
@@ -110,50 +117,57 @@ void tcp_tqueue_ctrl_seg(tcp_conn_t *conn, tcp_control_t ctrl)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_tqueue_ctrl_seg(%p, %u)", conn, ctrl);
 
 	seg = tcp_segment_make_ctrl(ctrl);
+	if (seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		return;
+	}
+
 	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
 }
 
+/** Transmit segment and add it to the retransmission queue.
+ *
+ * The segment itself is kept for retransmission, so that no copy needs
+ * to be made. Segments which occupy no sequence space are deleted.
+ *
+ * @param conn Connection
+ * @param seg  Segment (ownership transferred)
+ */
 static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 {
-	tcp_segment_t *rt_seg;
-	tcp_tqueue_entry_t *tqe;
+	tcp_tqueue_entry_t *tqe = NULL;
 
 	assert(fibril_mutex_is_locked(&conn->lock));
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_seg(%p, %p)", conn->name, conn,
 	    seg);
 
-	/*
-	 * Add segment to retransmission queue
-	 */
-
 	if (seg->len > 0) {
-		rt_seg = tcp_segment_dup(seg);
-		if (rt_seg == NULL) {
-			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-			/* XXX Handle properly */
-			return;
-		}
-
 		tqe = calloc(1, sizeof(tcp_tqueue_entry_t));
 		if (tqe == NULL) {
 			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
 			/* XXX Handle properly */
-			return;
 		}
+	}
 
-		tqe->conn = conn;
-		tqe->seg = rt_seg;
-		rt_seg->seq = conn->snd_nxt;
-
-		list_append(&tqe->link, &conn->retransmit.list);
+	tcp_prepare_transmit_segment(conn, seg);
 
-		/* Set retransmission timer */
-		tcp_tqueue_timer_set(conn);
+	if (tqe == NULL) {
+		tcp_segment_delete(seg);
+		return;
 	}
 
-	tcp_prepare_transmit_segment(conn, seg);
+	/*
+	 * Add segment to retransmission queue
+	 */
+
+	tqe->conn = conn;
+	tqe->seg = seg;
+
+	list_append(&tqe->link, &conn->retransmit.list);
+
+	/* Set retransmission timer */
+	tcp_tqueue_timer_set(conn);
 }
 
 static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
@@ -173,6 +187,9 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 }
 
 /** Transmit data from the send buffer.
+ *
+ * All data the send window allows are cut into segments at once and
+ * removed from the send buffer in one step.
  *
  * @param conn	Connection
  */
@@ -182,8 +199,11 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 	size_t xfer_seqlen;
 	size_t snd_buf_seqlen;
 	size_t data_size;
+	size_t seg_size;
+	size_t sent;
 	tcp_control_t ctrl;
 	bool send_fin;
+	bool last;
 
 	tcp_segment_t *seg;
 
@@ -206,35 +226,43 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
 	data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
-	if (send_fin) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
-	}
+	sent = 0;
+	do {
+		seg_size = min(data_size - sent, SEG_TEXT_MAX);
+		last = (sent + seg_size == data_size);
+
+		if (last && send_fin) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.",
+			    conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
-	}
+		seg = tcp_segment_make_data(ctrl, conn->snd_buf + sent,
+		    seg_size);
+		if (seg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
+			break;
+		}
 
-	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+		sent += seg_size;
 
-	if (send_fin)
-		conn->snd_buf_fin = false;
+		if (ctrl == CTL_FIN) {
+			conn->snd_buf_fin = false;
+			tcp_conn_fin_sent(conn);
+		}
 
-	fibril_condvar_broadcast(&conn->snd_buf_cv);
+		tcp_tqueue_seg(conn, seg);
+	} while (!last);
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+	/* Remove data from send buffer */
+	memmove(conn->snd_buf, conn->snd_buf + sent,
+	    conn->snd_buf_used - sent);
+	conn->snd_buf_used -= sent;
 
-	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
+	fibril_condvar_broadcast(&conn->snd_buf_cv);
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
@@ -321,7 +349,6 @@ static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
 	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -345,17 +372,9 @@ static void retransmit_timeout_func(void *arg)
 
 	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
-		/* XXX Handle properly */
-		return;
-	}
-
+	/* Transmission does not take ownership, send the queued segment */
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_conn_transmit_segment(tqe->conn, tqe->seg);
 
 	/* Reset retransmission timer */
 	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
@@ -39,11 +39,16 @@
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
+#include <stdlib.h>
 #include "conn.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
 
+/** Limits for connection buffer sizes */
+#define BUF_SIZE_MIN	1024
+#define BUF_SIZE_MAX	(1024 * 1024)
+
 /*
  * User calls
  */
@@ -305,6 +310,72 @@ void tcp_uc_delete(tcp_conn_t *conn)
 	tcp_conn_delete(conn);
 }
 
+/** Set buffer sizes user call.
+ *
+ * (Not in spec.) Resize the send and receive buffers of a connection.
+ * A buffer cannot shrink below its contents and the receive buffer cannot
+ * shrink below the part of the window already offered to the peer.
+ *
+ * @param conn     Connection
+ * @param snd_size New send buffer size
+ * @param rcv_size New receive buffer size
+ */
+tcp_error_t tcp_uc_set_bufsize(tcp_conn_t *conn, size_t snd_size,
+    size_t rcv_size)
+{
+	uint8_t *buf;
+	size_t rcv_committed;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_set_bufsize(%zu, %zu)",
+	    conn->name, snd_size, rcv_size);
+
+	if (snd_size < BUF_SIZE_MIN || snd_size > BUF_SIZE_MAX ||
+	    rcv_size < BUF_SIZE_MIN || rcv_size > BUF_SIZE_MAX)
+		return TCP_EILLEGAL;
+
+	tcp_conn_lock(conn);
+
+	if (conn->cstate == st_closed) {
+		tcp_conn_unlock(conn);
+		return TCP_ENOTEXIST;
+	}
+
+	rcv_committed = conn->rcv_buf_size - conn->rcv_wnd;
+	if (snd_size < conn->snd_buf_used || rcv_size < rcv_committed) {
+		tcp_conn_unlock(conn);
+		return TCP_EILLEGAL;
+	}
+
+	buf = realloc(conn->snd_buf, snd_size);
+	if (buf == NULL) {
+		tcp_conn_unlock(conn);
+		return TCP_ENORES;
+	}
+
+	conn->snd_buf = buf;
+	conn->snd_buf_size = snd_size;
+
+	buf = realloc(conn->rcv_buf, rcv_size);
+	if (buf == NULL) {
+		tcp_conn_unlock(conn);
+		return TCP_ENORES;
+	}
+
+	conn->rcv_buf = buf;
+	conn->rcv_wnd = rcv_size - rcv_committed;
+	conn->rcv_buf_size = rcv_size;
+
+	/* Writers may be waiting for space */
+	fibril_condvar_broadcast(&conn->snd_buf_cv);
+
+	/* Let the peer know about the new receive window */
+	if (tcp_conn_got_syn(conn))
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+
+	tcp_conn_unlock(conn);
+	return TCP_EOK;
+}
+
 void tcp_uc_set_cb(tcp_conn_t *conn, tcp_cb_t *cb, void *arg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_uc_set_cb(%p, %p, %p)",
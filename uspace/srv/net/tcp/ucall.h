@@ -50,6 +50,7 @@ extern tcp_error_t tcp_uc_close(tcp_conn_t *);
 extern void tcp_uc_abort(tcp_conn_t *);
 extern void tcp_uc_status(tcp_conn_t *, tcp_conn_status_t *);
 extern void tcp_uc_delete(tcp_conn_t *);
+extern tcp_error_t tcp_uc_set_bufsize(tcp_conn_t *, size_t, size_t);
 extern void tcp_uc_set_cb(tcp_conn_t *, tcp_cb_t *, void *);
 extern void *tcp_uc_get_userptr(tcp_conn_t *);
 
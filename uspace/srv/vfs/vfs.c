@@ -100,6 +100,14 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 	
+	/*
+	 * Initialize the page cache used by the pager.
+	 */
+	if (!vfs_page_cache_init()) {
+		printf("%s: Failed to initialize page cache\n", NAME);
+		return ENOMEM;
+	}
+	
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
@@ -481,6 +481,10 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 	
+	/* Drop stale pages of the node from the pager's page cache. */
+	if (!read)
+		vfs_page_cache_invalidate((vfs_triplet_t *) file->node);
+	
 	/* Unlock the VFS node. */
 	if (rlock) {
 		fibril_rwlock_read_unlock(&file->node->contents_rwlock);
@@ -597,6 +601,7 @@ errno_t vfs_op_rename(int basefd, char *old, char *new)
 	
 	/* If the node is not held by anyone, try to destroy it. */
 	if (orig_unlinked) {
+		vfs_page_cache_invalidate(&new_lr_orig.triplet);
 		vfs_node_t *node = vfs_node_peek(&new_lr_orig);
 		if (!node)
 			out_destroy(&new_lr_orig.triplet);
@@ -621,6 +626,7 @@ errno_t vfs_op_resize(int fd, int64_t size)
 	    file->node->service_id, file->node->index, size);
 	if (rc == EOK)
 		file->node->size = size;
+	vfs_page_cache_invalidate((vfs_triplet_t *) file->node);
 	
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -758,6 +764,9 @@ errno_t vfs_op_unlink(int parentfd, int expectfd, char *path)
 	rc = vfs_lookup_internal(parent->node, path, L_UNLINK, &lr);
 	if (rc != EOK)
 		goto exit;
+	
+	/* The index may be reused by another file. */
+	vfs_page_cache_invalidate(&lr.triplet);
 
 	/* If the node is not held by anyone, try to destroy it. */
 	vfs_node_t *node = vfs_node_peek(&lr);
@@ -815,6 +824,8 @@ errno_t vfs_op_unmount(int mpfd)
 		return rc;
 	}
 	
+	vfs_page_cache_invalidate_fs(mp->node->mount->fs_handle,
+	    mp->node->mount->service_id);
 	vfs_node_forget(mp->node->mount);
 	vfs_node_put(mp->node);
 	mp->node->mount = NULL;
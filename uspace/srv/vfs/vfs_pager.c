@@ -36,56 +36,355 @@
  */
 
 #include "vfs.h"
+#include <adt/hash_table.h>
+#include <adt/hash.h>
+#include <adt/list.h>
+#include <align.h>
+#include <libarch/config.h>
 #include <async.h>
 #include <fibril_synch.h>
 #include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
 #include <as.h>
 
-void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
+/** Number of pages read ahead on a page cache miss. */
+#define PAGE_CLUSTER_PAGES	16
+#define PAGE_CLUSTER_SIZE	(PAGE_CLUSTER_PAGES * PAGE_SIZE)
+
+/** Maximum number of clusters kept in the page cache. */
+#define PAGE_CACHE_CLUSTERS	128
+
+/**
+ * Instances of this type represent a cluster of consecutive file pages held
+ * in the page cache. Mappings of the file share the cluster's frames.
+ */
+typedef struct {
+	ht_link_t link;		/**< Page cache hash table link. */
+	link_t lru_link;	/**< Page cache LRU list link. */
+	vfs_triplet_t triplet;	/**< Identity of the cached file. */
+	aoff64_t cluster;	/**< Index of the cluster within the file. */
+	void *data;		/**< Address space area holding the pages. */
+	size_t size;		/**< Size of the area. */
+} page_cluster_t;
+
+typedef struct {
+	vfs_triplet_t *triplet;
+	aoff64_t cluster;
+} page_cluster_key_t;
+
+/** Mutex protecting the page cache. */
+static FIBRIL_MUTEX_INITIALIZE(page_cache_mutex);
+
+/** Page cache hash table and the LRU list of its clusters. */
+static hash_table_t page_cache;
+static LIST_INITIALIZE(page_cache_lru);
+static size_t page_cache_count = 0;
+
+/**
+ * Page cache generation. Incremented on each invalidation so that a cluster
+ * read concurrently with a modification of the file is not cached.
+ */
+static unsigned page_cache_gen = 0;
+
+static size_t page_cluster_key_hash(void *key)
 {
-	aoff64_t offset = IPC_GET_ARG1(*request);
-	size_t page_size = IPC_GET_ARG2(*request);
-	int fd = IPC_GET_ARG3(*request);
-	void *page;
-	errno_t rc;
+	page_cluster_key_t *ckey = key;
+	size_t hash = hash_combine(ckey->triplet->fs_handle,
+	    ckey->triplet->index);
+	hash = hash_combine(hash, ckey->triplet->service_id);
+	return hash_combine(hash, ckey->cluster);
+}
+
+static size_t page_cluster_hash(const ht_link_t *item)
+{
+	page_cluster_t *c = hash_table_get_inst(item, page_cluster_t, link);
+	page_cluster_key_t ckey = {
+		.triplet = &c->triplet,
+		.cluster = c->cluster
+	};
+	
+	return page_cluster_key_hash(&ckey);
+}
+
+static bool page_cluster_key_equal(void *key, const ht_link_t *item)
+{
+	page_cluster_key_t *ckey = key;
+	page_cluster_t *c = hash_table_get_inst(item, page_cluster_t, link);
+	return c->triplet.fs_handle == ckey->triplet->fs_handle &&
+	    c->triplet.service_id == ckey->triplet->service_id &&
+	    c->triplet.index == ckey->triplet->index &&
+	    c->cluster == ckey->cluster;
+}
+
+static void page_cluster_remove_callback(ht_link_t *item)
+{
+	page_cluster_t *c = hash_table_get_inst(item, page_cluster_t, link);
+	
+	/*
+	 * The frames remain referenced by the address spaces that have
+	 * them mapped, we only drop our own reference here.
+	 */
+	list_remove(&c->lru_link);
+	page_cache_count--;
+	as_area_destroy(c->data);
+	free(c);
+}
+
+/** Page cache hash table operations. */
+static hash_table_ops_t page_cache_ops = {
+	.hash = page_cluster_hash,
+	.key_hash = page_cluster_key_hash,
+	.key_equal = page_cluster_key_equal,
+	.equal = NULL,
+	.remove_callback = page_cluster_remove_callback
+};
+
+/** Initialize the page cache.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_page_cache_init(void)
+{
+	return hash_table_create(&page_cache, 0, 0, &page_cache_ops);
+}
+
+/** Drop cached pages of a file system node.
+ *
+ * Must be called whenever the contents of the node change.
+ *
+ * @param triplet	Identity of the node.
+ */
+void vfs_page_cache_invalidate(vfs_triplet_t *triplet)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+	
+	page_cache_gen++;
+	list_foreach_safe(page_cache_lru, cur, next) {
+		page_cluster_t *c = list_get_instance(cur, page_cluster_t,
+		    lru_link);
+		if (c->triplet.fs_handle == triplet->fs_handle &&
+		    c->triplet.service_id == triplet->service_id &&
+		    c->triplet.index == triplet->index)
+			hash_table_remove_item(&page_cache, &c->link);
+	}
+	
+	fibril_mutex_unlock(&page_cache_mutex);
+}
+
+/** Drop cached pages of all nodes of a file system instance.
+ *
+ * @param fs_handle	File system handle.
+ * @param service_id	Service ID of the file system instance.
+ */
+void vfs_page_cache_invalidate_fs(fs_handle_t fs_handle,
+    service_id_t service_id)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+	
+	page_cache_gen++;
+	list_foreach_safe(page_cache_lru, cur, next) {
+		page_cluster_t *c = list_get_instance(cur, page_cluster_t,
+		    lru_link);
+		if (c->triplet.fs_handle == fs_handle &&
+		    c->triplet.service_id == service_id)
+			hash_table_remove_item(&page_cache, &c->link);
+	}
+	
+	fibril_mutex_unlock(&page_cache_mutex);
+}
 
-	page = as_area_create(AS_AREA_ANY, page_size,
+/** Answer a page-in request with a page.
+ *
+ * @param rid		Request to answer.
+ * @param page		Page to answer with or NULL for a page of zeros.
+ * @param copy		Answer with a private copy of the page.
+ */
+static void page_in_answer(ipc_callid_t rid, void *page, bool copy)
+{
+	if ((page != NULL) && !copy) {
+		async_answer_1(rid, EOK, (sysarg_t) page);
+		return;
+	}
+	
+	void *priv = as_area_create(AS_AREA_ANY, PAGE_SIZE,
 	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
 	    AS_AREA_UNPAGED);
-
-	if (page == AS_MAP_FAILED) {
+	if (priv == AS_MAP_FAILED) {
 		async_answer_0(rid, ENOMEM);
 		return;
 	}
+	
+	if (page != NULL)
+		memcpy(priv, page, PAGE_SIZE);
+	else
+		memset(priv, 0, PAGE_SIZE);
+	
+	async_answer_1(rid, EOK, (sysarg_t) priv);
+	as_area_destroy(priv);
+}
 
+/** Read a cluster of file pages.
+ *
+ * @param fd		File descriptor of the file.
+ * @param cluster	Index of the cluster within the file.
+ * @param size		Size of the cluster (multiple of the page size).
+ *
+ * @return		Address space area holding the cluster or NULL.
+ */
+static void *page_cluster_read(int fd, aoff64_t cluster, size_t size)
+{
+	void *data = as_area_create(AS_AREA_ANY, size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (data == AS_MAP_FAILED)
+		return NULL;
+	
 	rdwr_io_chunk_t chunk = {
-		.buffer = page,
-		.size = page_size
+		.buffer = data,
+		.size = size
 	};
-
+	
 	size_t total = 0;
-	aoff64_t pos = offset;
+	aoff64_t pos = cluster * PAGE_CLUSTER_SIZE;
 	do {
-		rc = vfs_rdwr_internal(fd, pos, true, &chunk);
-		if (rc != EOK)
-			break;
+		errno_t rc = vfs_rdwr_internal(fd, pos, true, &chunk);
+		if (rc != EOK) {
+			as_area_destroy(data);
+			return NULL;
+		}
 		if (chunk.size == 0)
 			break;
 		total += chunk.size;
 		pos += chunk.size;
 		chunk.buffer += chunk.size;
-		chunk.size = page_size - total;
-	} while (total < page_size);
-
-	async_answer_1(rid, rc, (sysarg_t) page);
-
+		chunk.size = size - total;
+	} while (total < size);
+	
 	/*
-	 * FIXME:
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
+	 * Clear the rest of the area. This also makes sure that all its pages
+	 * are present so that they can be handed out to the pager clients.
 	 */
-	as_area_destroy(page);
+	memset(data + total, 0, size - total);
+	return data;
+}
+
+/** Handle a page-in request.
+ *
+ * On a page cache miss, the whole cluster containing the page is read ahead
+ * and cached, so that faults on the neighbouring pages and faults in other
+ * mappings of the same file are served without reading from the file system.
+ *
+ * The request arguments are: offset within the area, page size, file
+ * descriptor, index of the file page mapped at the start of the area and
+ * VFS_PAGER_* flags.
+ */
+void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
+{
+	aoff64_t offset = IPC_GET_ARG1(*request);
+	size_t page_size = IPC_GET_ARG2(*request);
+	int fd = IPC_GET_ARG3(*request);
+	aoff64_t first = IPC_GET_ARG4(*request);
+	unsigned int flags = IPC_GET_ARG5(*request);
+	bool copy = (flags & VFS_PAGER_COPY) != 0;
+
+	if (page_size != PAGE_SIZE) {
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+	
+	vfs_file_t *file = vfs_file_get(fd);
+	if (file == NULL) {
+		async_answer_0(rid, EBADF);
+		return;
+	}
+	
+	vfs_triplet_t triplet = {
+		.fs_handle = file->node->fs_handle,
+		.service_id = file->node->service_id,
+		.index = file->node->index
+	};
+	aoff64_t file_size = file->node->size;
+	vfs_file_put(file);
+	
+	aoff64_t pos = first * PAGE_SIZE + offset;
+	if (pos >= file_size) {
+		/* Mapping beyond the end of file */
+		page_in_answer(rid, NULL, copy);
+		return;
+	}
+	
+	page_cluster_key_t ckey = {
+		.triplet = &triplet,
+		.cluster = pos / PAGE_CLUSTER_SIZE
+	};
+	size_t coff = pos % PAGE_CLUSTER_SIZE;
+	
+	fibril_mutex_lock(&page_cache_mutex);
+	
+	ht_link_t *lnk = hash_table_find(&page_cache, &ckey);
+	if (lnk != NULL) {
+		page_cluster_t *c = hash_table_get_inst(lnk, page_cluster_t,
+		    link);
+		list_remove(&c->lru_link);
+		list_prepend(&c->lru_link, &page_cache_lru);
+		page_in_answer(rid, coff < c->size ? c->data + coff : NULL,
+		    copy);
+		fibril_mutex_unlock(&page_cache_mutex);
+		return;
+	}
+	
+	unsigned gen = page_cache_gen;
+	fibril_mutex_unlock(&page_cache_mutex);
+	
+	size_t size = min(file_size - ckey.cluster * PAGE_CLUSTER_SIZE,
+	    PAGE_CLUSTER_SIZE);
+	size = ALIGN_UP(size, PAGE_SIZE);
+	
+	void *data = page_cluster_read(fd, ckey.cluster, size);
+	if (data == NULL) {
+		async_answer_0(rid, EIO);
+		return;
+	}
+	
+	page_cluster_t *c = malloc(sizeof(page_cluster_t));
+	
+	fibril_mutex_lock(&page_cache_mutex);
+	
+	if ((c == NULL) || (gen != page_cache_gen) ||
+	    (hash_table_find(&page_cache, &ckey) != NULL)) {
+		/*
+		 * The file has changed while we were reading it or someone
+		 * else has cached the cluster in the meantime. Do not cache
+		 * our copy.
+		 */
+		fibril_mutex_unlock(&page_cache_mutex);
+		page_in_answer(rid, data + coff, copy);
+		as_area_destroy(data);
+		free(c);
+		return;
+	}
+	
+	c->triplet = triplet;
+	c->cluster = ckey.cluster;
+	c->data = data;
+	c->size = size;
+	link_initialize(&c->lru_link);
+	
+	hash_table_insert(&page_cache, &c->link);
+	list_prepend(&c->lru_link, &page_cache_lru);
+	page_cache_count++;
+	
+	if (page_cache_count > PAGE_CACHE_CLUSTERS) {
+		page_cluster_t *victim = list_get_instance(
+		    list_last(&page_cache_lru), page_cluster_t, lru_link);
+		hash_table_remove_item(&page_cache, &victim->link);
+	}
+	
+	page_in_answer(rid, data + coff, copy);
+	
+	fibril_mutex_unlock(&page_cache_mutex);
 }
 
 /**